@@ -161,7 +161,14 @@ int32 UContentValidationCommandlet::Main(const FString& FullCommandLine)
 	}
 
 	TArray<FString> AllWarningsAndErrors;
-	UEditorValidator::ValidatePackages(ChangedPackageNames, DeletedPackageNames, MaxPackagesToLoad, AllWarningsAndErrors, EDataValidationUsecase::Commandlet);
+	const bool bPackagesValid = UEditorValidator::ValidatePackages(ChangedPackageNames, DeletedPackageNames, MaxPackagesToLoad, AllWarningsAndErrors, EDataValidationUsecase::Commandlet);
+
+	// Opt in, so builds can fail on invalid assets such as AI states sets over their cost budget
+	if (!bPackagesValid && Switches.Contains(TEXT("FailOnInvalidPackages")))
+	{
+		UE_LOG(LogLyraContentValidation, Display, TEXT("ContentValidation returning 1. Validated packages have issues."));
+		ReturnVal = 1;
+	}
 
 	if (!UEditorValidator::ValidateProjectSettings())
 	{
@@ -0,0 +1,55 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "EditorValidator_AIStatesSet.h"
+
+#include "AI/AIStates/AIStatesSet.h"
+#include "AI/AIStates/AIStatesSetCost.h"
+#include "LyraEditor.h"
+#include "Validation/EditorValidator.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(EditorValidator_AIStatesSet)
+
+#define LOCTEXT_NAMESPACE "EditorValidator"
+
+UEditorValidator_AIStatesSet::UEditorValidator_AIStatesSet()
+	: Super()
+{
+}
+
+bool UEditorValidator_AIStatesSet::CanValidateAsset_Implementation(UObject* InAsset) const
+{
+	return Super::CanValidateAsset_Implementation(InAsset) && (InAsset ? InAsset->IsA(UAIStatesSet::StaticClass()) : false);
+}
+
+EDataValidationResult UEditorValidator_AIStatesSet::ValidateLoadedAsset_Implementation(UObject* InAsset, TArray<FText>& ValidationErrors)
+{
+	UAIStatesSet* StatesSet = Cast<UAIStatesSet>(InAsset);
+	check(StatesSet);
+
+	const FAIStatesSetCost Cost = FAIStatesSetCost::Estimate(*StatesSet);
+	const float Budget = FAIStatesSetCost::GetBudget();
+
+	UE_LOG(LogLyraEditor, Display, TEXT("    %s cost %.1f (budget %.1f): %d conditions, %d world scans, %d EQS queries, %d interrupt variants, %d unreachable states"),
+		*StatesSet->GetName(), Cost.Score, Budget, Cost.NumConditions, Cost.NumWorldScanConditions, Cost.NumEQSQueries, Cost.NumInterruptVariants, Cost.UnreachableStates.Num());
+
+	for (const FString& UnreachableState : Cost.UnreachableStates)
+	{
+		AssetWarning(InAsset, FText::Format(LOCTEXT("AIStatesSet_UnreachableState", "{0} and can never be picked"), FText::FromString(UnreachableState)));
+	}
+
+	if (Cost.IsOverBudget(Budget))
+	{
+		AssetFails(InAsset, FText::Format(LOCTEXT("AIStatesSet_OverBudget", "Static cost {0} is over the budget of {1}: {2} conditions of which {3} scan every registered AI, {4} EQS queries, {5} interrupt variants, {6} unreachable states"),
+			FText::AsNumber(Cost.Score), FText::AsNumber(Budget), FText::AsNumber(Cost.NumConditions), FText::AsNumber(Cost.NumWorldScanConditions),
+			FText::AsNumber(Cost.NumEQSQueries), FText::AsNumber(Cost.NumInterruptVariants), FText::AsNumber(Cost.UnreachableStates.Num())), ValidationErrors);
+	}
+
+	if (GetValidationResult() != EDataValidationResult::Invalid)
+	{
+		AssetPasses(InAsset);
+	}
+
+	return GetValidationResult();
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,23 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "EditorValidator.h"
+
+#include "EditorValidator_AIStatesSet.generated.h"
+
+class FText;
+class UObject;
+
+UCLASS()
+class UEditorValidator_AIStatesSet : public UEditorValidator
+{
+	GENERATED_BODY()
+
+public:
+	UEditorValidator_AIStatesSet();
+
+protected:
+	virtual bool CanValidateAsset_Implementation(UObject* InAsset) const override;
+	virtual EDataValidationResult ValidateLoadedAsset_Implementation(UObject* InAsset, TArray<FText>& ValidationErrors) override;
+};
@@ -1,15 +1,26 @@
 #include "AI/AIStateController.h"
 
 #include "AIStates/AIStatesSet.h"
+#include "AIStates/AIStatesSettings.h"
+#include "AIStates/AIStatesStats.h"
 #include "AIStates/AIStatesSubsystem.h"
+#include "AIStates/AIStatesWeightedSampler.h"
 #include "AICharacter.h"
 
+#include "AbilitySystemComponent.h"
 #include "AbilitySystemGlobals.h"
 #include "NavigationSystem.h"
 #include "AbilitySystemBlueprintLibrary.h"
 #include "BehaviorTree/BlackboardComponent.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "Perception/AIPerceptionSystem.h"
+#include "Perception/AISense_Hearing.h"
+#include "Perception/AISense_Sight.h"
 #include "InstancedStruct.h"
+#include "Misc/ScopeExit.h"
 #include "AbilitySystem/LyraAbilitySystemComponent.h"
+#include "BrainComponent.h"
+#include "System/LyraSignificanceManager.h"
 
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
 TAutoConsoleVariable<int32> FAIStatesCVars::CVarAIStatesDebug(
@@ -21,6 +32,46 @@ TAutoConsoleVariable<int32> FAIStatesCVars::CVarAIStatesDebug(
 		ECVF_Cheat);
 #endif
 
+namespace AIStateController
+{
+	static TAutoConsoleVariable<int32> CVarDirtyTracking(
+		TEXT("lyra.aistates.dirtytracking"),
+		1,
+		TEXT("Re-evaluate only AI states which inputs changed.\n")
+		TEXT("0 = off, every state is evaluated on every update\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarAsyncLineOfSight(
+		TEXT("lyra.aistates.asynclineofsight"),
+		1,
+		TEXT("Serve line of sight to actors from a per controller cache refreshed by batched async traces.\n")
+		TEXT("0 = off, every query sweeps on the game thread\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarReachabilityCache(
+		TEXT("lyra.aistates.reachabilitycache"),
+		1,
+		TEXT("Serve direct navmesh path queries from the reachability cache shared by every controller.\n")
+		TEXT("0 = off, every query raycasts the navmesh on the game thread\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+}
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Evaluated States"), STAT_AIStates_EvaluatedStates, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cached States"), STAT_AIStates_CachedStates, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Weighted Sampler Spills"), STAT_AIStates_WeightedSamplerSpills, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line Of Sight Cache Hits"), STAT_AIStates_LineOfSightCacheHits, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blocking Line Of Sight Traces"), STAT_AIStates_BlockingLineOfSightTraces, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance Tier Changes"), STAT_AIStates_SignificanceTierChanges, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Reachability Cache Hits"), STAT_AIStates_ReachabilityCacheHits, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blocking Reachability Raycasts"), STAT_AIStates_BlockingReachabilityRaycasts, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Squad Intents Followed"), STAT_AIStates_SquadIntentsFollowed, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Prepare State Evaluation"), STAT_AIStates_PrepareStateEvaluation, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Apply State Evaluation"), STAT_AIStates_ApplyStateEvaluation, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Select Ability"), STAT_AIStates_SelectAbility, STATGROUP_AIStates);
+
 #define BIND_PERCEPTION_ATTRIBUTE_EVENT(AttributeName) \
 	FGameplayAttribute AttributeName##Attribute = UPerceptionAttributeSet::Get##AttributeName##Attribute(); \
 	Perception->Set##AttributeName(ASC->GetNumericAttribute(AttributeName##Attribute)); \
@@ -43,14 +94,23 @@ void AAIStateController::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	const UWorld* const WorldLocal = GetWorld();
 	if(ensureMsgf(WorldLocal != nullptr, TEXT("World is nullptr!")))
 	{
-		WorldLocal->GetTimerManager().ClearTimer(UpdateAIStateTimerHandle);
+		if(auto* AIStatesSubsystem = WorldLocal->GetSubsystem<UAIStatesSubsystem>())
+		{
+			AIStatesSubsystem->UnregisterAIActor(this);
+		}
 	}
 
-	for(FAIStateRuntimeData& State : AIStates)
+	InterruptWatcher.Disarm();
+	UnbindStateDependencies(false);
+	UnbindStateDependencies(true);
+
+	if(auto* SignificanceManager = WorldLocal ? USignificanceManager::Get<ULyraSignificanceManager>(WorldLocal) : nullptr)
 	{
-		State.Conditions.Empty();
+		SignificanceManager->UnregisterObject(this);
 	}
-	AIStates.Empty();
+
+	BlockedStates.Empty();
+	LineOfSightCache.Reset();
 	
 	Super::EndPlay(EndPlayReason);
 }
@@ -60,27 +120,94 @@ void AAIStateController::SetPawn(APawn* InPawn)
 	Super::SetPawn(InPawn);
 
 	const UWorld* const WorldLocal = GetWorld();
-	if(ensureMsgf(WorldLocal != nullptr, TEXT("World is nullptr!")))
+	if(!ensureMsgf(WorldLocal != nullptr, TEXT("World is nullptr!")))
+	{
+		return;
+	}
+
+	auto* AIStatesSubsystem = WorldLocal->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AIStatesSubsystem is nullptr!")))
 	{
 		return;
 	}
 
 	// AI States setup
 	auto* AICharacter = Cast<AAICharacter>(GetPawn());
-	if (AICharacter && AICharacter->AIStatesSetConfig /* temp testing */)
+	if (AICharacter && AICharacter->AIStatesSetConfig /* temp testing */ && SetupAIStatesFromConfig())
 	{
-		if(SetupAIStatesFromConfig())
+		// For things like that cant be bound easily to tags - like PlayerDistance
+		AIStatesSubsystem->ScheduleStateUpdates(this, GetAIStatesUpdateInterval());
+
+		if(auto* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(WorldLocal))
 		{
-			// For things like that cant be bound easily to tags - like PlayerDistance
-			WorldLocal->GetTimerManager().SetTimer(UpdateAIStateTimerHandle, this, &ThisClass::UpdateAIState, AICharacter->AIStatesSetConfig->AIStatesUpdateRate_TESTING , true);
+			SignificanceManager->RegisterAIStateController(this);
 		}
 	}
+	else
+	{
+		AIStatesSubsystem->UnscheduleStateUpdates(this);
+	}
 
-	auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AIStatesSubsystem is nullptr!")))
+	AIStatesSubsystem->RegisterAIActor(this);
+}
+
+void AAIStateController::SetAIStatesUpdateInterval(float NewUpdateInterval)
+{
+	AIStatesUpdateIntervalOverride = NewUpdateInterval;
+
+	if(auto* AIStatesSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UAIStatesSubsystem>() : nullptr)
+	{
+		AIStatesSubsystem->SetStateUpdateInterval(this, GetAIStatesUpdateInterval());
+	}
+}
+
+float AAIStateController::GetAIStatesUpdateInterval() const
+{
+	const FAIStatesSignificanceTier* Tier = UAIStatesSettings::Get()->GetSignificanceTier(SignificanceTier);
+	const float IntervalScale = Tier ? Tier->StateUpdateIntervalScale : 1.0f;
+
+	if(AIStatesUpdateIntervalOverride > 0.0f)
 	{
-		AIStatesSubsystem->RegisterAIActor(this);
+		return AIStatesUpdateIntervalOverride * IntervalScale;
 	}
+
+	return AIStatesSetConfig.IsValid() ? AIStatesSetConfig->AIStatesUpdateRate_TESTING * IntervalScale : 0.0f;
+}
+
+void AAIStateController::SetSignificance(float NewSignificance)
+{
+	Significance = NewSignificance;
+
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	SetSignificanceTier(AIStatesSignificance::SelectTier(Settings->SignificanceTiers, Significance, SignificanceTier, Settings->SignificanceHysteresis));
+}
+
+void AAIStateController::SetSignificanceTier(int32 NewTier)
+{
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	if(NewTier == SignificanceTier || Settings->SignificanceTiers.IsValidIndex(NewTier) == false)
+	{
+		return;
+	}
+
+	SignificanceTier = NewTier;
+	INC_DWORD_STAT(STAT_AIStates_SignificanceTierChanges);
+
+	if(auto* AIStatesSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UAIStatesSubsystem>() : nullptr)
+	{
+		AIStatesSubsystem->SetStateUpdateInterval(this, GetAIStatesUpdateInterval());
+	}
+
+	if(BrainComponent)
+	{
+		BrainComponent->SetComponentTickInterval(Settings->SignificanceTiers[SignificanceTier].BehaviorTreeTickInterval);
+	}
+}
+
+bool AAIStateController::CanUseEQS() const
+{
+	const FAIStatesSignificanceTier* Tier = UAIStatesSettings::Get()->GetSignificanceTier(SignificanceTier);
+	return Tier == nullptr || Tier->bAllowEQS;
 }
 
 void AAIStateController::BroadcastOnInterruptibleAbilityUpdate_Debug(const FName& Text)
@@ -88,6 +215,63 @@ void AAIStateController::BroadcastOnInterruptibleAbilityUpdate_Debug(const FName
 	OnInterruptibleAbilityUpdate_Debug.Broadcast(Text);
 }
 
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+void AAIStateController::RecordDebugEvent(EAIStatesDebugEvent Event, FName Name, float Probability)
+{
+	if(FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0)
+	{
+		DebugRing.Add({ GetWorld()->GetTimeSeconds(), Event, Name, Probability });
+	}
+}
+#endif
+
+void AAIStateController::ClearActiveInterruptibleAction()
+{
+	bActiveInterruptibleAction = false;
+	ActiveInterruptibleAbilityTag = FGameplayTag();
+	InterruptWatcher.Disarm();
+}
+
+FName AAIStateController::GetCurrentStateName() const
+{
+	return AIStatesSetConfig.IsValid() && AIStatesSetConfig->States.IsValidIndex(CurrentAIStateIndex) ? AIStatesSetConfig->States[CurrentAIStateIndex].StateName : NAME_None;
+}
+
+FString AAIStateController::GetActiveActionName() const
+{
+	if(bActiveInterruptibleAction && ActiveInterruptibleAbilityTag == DefaultApproachAbility.InterruptibleAbilityTag)
+	{
+		return DefaultApproachAbility.GetAbilityName();
+	}
+
+	return ActiveAbilityData ? ActiveAbilityData->GetAbilityName() : FString();
+}
+
+void AAIStateController::OnInterruptWatcherFired()
+{
+	// Debug
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0)
+	{
+		BroadcastOnInterruptibleAbilityUpdate_Debug("Interrupted");
+	}
+	RecordDebugEvent(EAIStatesDebugEvent::Interrupted, NAME_None, 1.0f);
+#endif
+
+	// Cleared before cancelling, so states picked once the ability ends can start a new interruptible action
+	const FGameplayTag InterruptedAbilityTag = ActiveInterruptibleAbilityTag;
+	ClearActiveInterruptibleAction();
+
+	UAbilitySystemComponent* AbilitySystemComp = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetPawn());
+	if(InterruptedAbilityTag.IsValid() && AbilitySystemComp)
+	{
+		const FGameplayTagContainer InterruptedAbilityTags(InterruptedAbilityTag);
+		AbilitySystemComp->CancelAbilities(&InterruptedAbilityTags);
+	}
+
+	OnActiveAbilityInterrupted.Broadcast();
+}
+
 bool AAIStateController::HasDirectNavPathToActor(const AActor* Other, const float OffsetFromTarget) const
 {
 	if (GetPawn() == nullptr || Other == nullptr)
@@ -107,16 +291,41 @@ bool AAIStateController::HasDirectNavPathToLocation(const FVector& FromLocation,
 	const FVector ToTarget = ToLocation - FromLocation;
 	if (ToTarget.Size() > OffsetFromTarget)
 	{
-		const UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(GetWorld());
-		if(ensureMsgf(NavSystem != nullptr, TEXT("NavSystem is nullptr!")))
+		UWorld* const WorldLocal = GetWorld();
+		const UNavigationSystemV1* NavSystem = UNavigationSystemV1::GetNavigationSystem(WorldLocal);
+		if(!ensureMsgf(NavSystem != nullptr, TEXT("NavSystem is nullptr!")))
 		{
 			return false;
 		}
 
 		const FVector NavTargetLocation = ToLocation - ToTarget.GetSafeNormal() * OffsetFromTarget;
+
+		// Segments asked recently by any controller are served from the shared reachability cache
+		auto* AIStatesSubsystem = WorldLocal->GetSubsystem<UAIStatesSubsystem>();
+		FAIStatesReachabilityKey ReachabilityKey;
+		if(AIStateController::CVarReachabilityCache.GetValueOnGameThread() > 0 && AIStatesSubsystem)
+		{
+			FAIStatesReachabilityCache& Reachability = AIStatesSubsystem->GetReachability();
+			ReachabilityKey = Reachability.MakeKey(FromLocation, NavTargetLocation, DefaultNavigationFilterClass);
+			const EAIStatesReachability CachedReachability = Reachability.Query(ReachabilityKey, FromLocation, NavTargetLocation,
+				WorldLocal->GetTimeSeconds(), UAIStatesSettings::Get()->ReachabilityCacheTimeToLive, false);
+			if(CachedReachability != EAIStatesReachability::Unknown)
+			{
+				INC_DWORD_STAT(STAT_AIStates_ReachabilityCacheHits);
+				return CachedReachability == EAIStatesReachability::Reachable;
+			}
+		}
+
+		INC_DWORD_STAT(STAT_AIStates_BlockingReachabilityRaycasts);
 		FVector OutHitLocation;
+		const bool bReachable = !NavSystem->NavigationRaycast(GetPawn(), FromLocation, NavTargetLocation, OutHitLocation, DefaultNavigationFilterClass, GetPawn()->GetController());
+
+		if(AIStateController::CVarReachabilityCache.GetValueOnGameThread() > 0 && AIStatesSubsystem)
+		{
+			AIStatesSubsystem->GetReachability().Store(ReachabilityKey, bReachable, WorldLocal->GetTimeSeconds());
+		}
 
-		return !NavSystem->NavigationRaycast(GetPawn(), FromLocation, NavTargetLocation, OutHitLocation, DefaultNavigationFilterClass, GetPawn()->GetController());
+		return bReachable;
 	}
 	else
 	{
@@ -124,6 +333,38 @@ bool AAIStateController::HasDirectNavPathToLocation(const FVector& FromLocation,
 	}
 }
 
+EAIStatesReachability AAIStateController::QueryDirectNavPathToActor(const AActor* Other, float OffsetFromTarget) const
+{
+	if (GetPawn() == nullptr || Other == nullptr)
+	{
+		return EAIStatesReachability::Unknown;
+	}
+
+	return QueryDirectNavPathToLocation(GetPawn()->GetActorLocation(), Other->GetTargetLocation(GetPawn()), OffsetFromTarget);
+}
+
+EAIStatesReachability AAIStateController::QueryDirectNavPathToLocation(const FVector& FromLocation, const FVector& ToLocation, float OffsetFromTarget) const
+{
+	const FVector ToTarget = ToLocation - FromLocation;
+	if (ToTarget.Size() <= OffsetFromTarget)
+	{
+		return EAIStatesReachability::Reachable;
+	}
+
+	UWorld* const WorldLocal = GetWorld();
+	auto* AIStatesSubsystem = WorldLocal ? WorldLocal->GetSubsystem<UAIStatesSubsystem>() : nullptr;
+	if(AIStatesSubsystem == nullptr)
+	{
+		return EAIStatesReachability::Unknown;
+	}
+
+	// Missing and expired results are raycast with the next batch
+	const FVector NavTargetLocation = ToLocation - ToTarget.GetSafeNormal() * OffsetFromTarget;
+	FAIStatesReachabilityCache& Reachability = AIStatesSubsystem->GetReachability();
+	return Reachability.Query(Reachability.MakeKey(FromLocation, NavTargetLocation, DefaultNavigationFilterClass), FromLocation, NavTargetLocation,
+		WorldLocal->GetTimeSeconds(), UAIStatesSettings::Get()->ReachabilityCacheTimeToLive);
+}
+
 bool AAIStateController::HasLineOfSightToActor(AActor* Other, FVector ViewPoint, const float TraceSphereRadius) const
 {
 	if (GetPawn() == nullptr || Other == nullptr)
@@ -132,26 +373,75 @@ bool AAIStateController::HasLineOfSightToActor(AActor* Other, FVector ViewPoint,
 		return false;
 	}
 
+	UWorld* const WorldLocal = GetWorld();
+	if(!ensureMsgf(WorldLocal != nullptr, TEXT("World is nullptr!")))
+	{
+		return false;
+	}
+
 	const FVector TargetLocation = Other->GetTargetLocation(GetPawn());
-	if (ViewPoint.IsZero())
+
+	// Cache entries are traced from the pawn, explicit view points always sweep
+	const bool bFromPawn = ViewPoint.IsZero();
+	if (bFromPawn)
 	{
 		ViewPoint = GetPawn()->GetActorLocation();
 	}
 
-	TArray<AActor*> ActorToIgnore;
-	ActorToIgnore.Add(Other);
+	auto* AIStatesSubsystem = WorldLocal->GetSubsystem<UAIStatesSubsystem>();
+	FAIStatesLineOfSightEntry* CacheEntry = nullptr;
+	if(AIStateController::CVarAsyncLineOfSight.GetValueOnGameThread() > 0 && AIStatesSubsystem && bFromPawn)
+	{
+		CacheEntry = &LineOfSightCache.FindOrAdd(Other, TraceSphereRadius);
+		if(CacheEntry->HasResult())
+		{
+			// Expired result is still served, the refresh arrives next frame
+			const FAIStatesSignificanceTier* Tier = UAIStatesSettings::Get()->GetSignificanceTier(SignificanceTier);
+			const float TimeToLive = UAIStatesSettings::Get()->LineOfSightCacheTimeToLive * (Tier ? Tier->LineOfSightIntervalScale : 1.0f);
+			if(CacheEntry->NeedsRefresh(WorldLocal->GetTimeSeconds(), TimeToLive))
+			{
+				CacheEntry->bPending = true;
+				AIStatesSubsystem->RequestLineOfSight(this, Other, ViewPoint, TargetLocation, TraceSphereRadius);
+			}
+
+			INC_DWORD_STAT(STAT_AIStates_LineOfSightCacheHits);
+			return CacheEntry->bHasLineOfSight;
+		}
+	}
+
+	// First query of a target has nothing to serve yet and sweeps right away, same as queries from other view points
+	INC_DWORD_STAT(STAT_AIStates_BlockingLineOfSightTraces);
+	const bool bHasLineOfSight = WorldLocal->SweepTestByChannel(ViewPoint, TargetLocation, FQuat::Identity, ECC_Visibility,
+		FCollisionShape::MakeSphere(TraceSphereRadius), FAIStatesLineOfSightQueue::MakeQueryParams(GetPawn(), Other)) == false;
+
+	if(CacheEntry)
+	{
+		CacheEntry->bHasLineOfSight = bHasLineOfSight;
+		CacheEntry->ResultTime = WorldLocal->GetTimeSeconds();
+	}
+
+	return bHasLineOfSight;
+}
 
-	return HasLineOfSightToLocation(ViewPoint, TargetLocation, ActorToIgnore, TraceSphereRadius);
+void AAIStateController::OnLineOfSightResult(const AActor* Target, float TraceSphereRadius, bool bHasLineOfSight, double WorldTime) const
+{
+	if(FAIStatesLineOfSightEntry* CacheEntry = LineOfSightCache.Find(Target, TraceSphereRadius))
+	{
+		CacheEntry->bHasLineOfSight = bHasLineOfSight;
+		CacheEntry->ResultTime = WorldTime;
+		CacheEntry->bPending = false;
+	}
 }
 
 bool AAIStateController::HasLineOfSightToLocation(const FVector& FromLocation, const FVector& ToLocation, const TArray<AActor*>& ActorsToIgnore, float TraceSphereRadius) const
 {
 	const UWorld* const WorldLocal = GetWorld();
-	if(ensureMsgf(WorldLocal != nullptr, TEXT("World is nullptr!")))
+	if(!ensureMsgf(WorldLocal != nullptr, TEXT("World is nullptr!")))
 	{
 		return false;
 	}
 	
+	INC_DWORD_STAT(STAT_AIStates_BlockingLineOfSightTraces);
 	FCollisionQueryParams CollisionParams(SCENE_QUERY_STAT(WeaponLineOfSight), true, this->GetPawn());
 	CollisionParams.AddIgnoredActors(ActorsToIgnore);
 
@@ -173,20 +463,32 @@ void AAIStateController::SetTarget(AActor* NewTarget)
 {
 	if (CurrentTarget != NewTarget)
 	{
-		if (UBlackboardComponent* BlackboardComp = GetBlackboardComponent())
+		// Target and search location reach behavior tree observers together, once the target is fully switched
+		FAIStatesBlackboardBatchScope BlackboardBatch(BlackboardWriter);
+
+		UAIStatesSubsystem* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+		if (GetBlackboardComponent())
 		{
 			if (NewTarget)
 			{
-				BlackboardComp->SetValueAsObject(TargetActorKeyName, NewTarget);
-				BlackboardComp->ClearValue(SearchLocationKeyName);
+				BlackboardWriter.SetValueAsObject(BlackboardKeys.TargetActor, NewTarget);
+				BlackboardWriter.ClearValue(BlackboardKeys.SearchLocation);
 			}
 			else
 			{
-				BlackboardComp->ClearValue(TargetActorKeyName);
+				BlackboardWriter.ClearValue(BlackboardKeys.TargetActor);
 				
 				if (CurrentTarget)
 				{
-					BlackboardComp->SetValueAsVector(SearchLocationKeyName, CurrentTarget->GetActorLocation());
+					// Target remembered by the team is searched for where it was sensed last, not where it is
+					FVector SearchLocation = CurrentTarget->GetActorLocation();
+					if(const FAIStatesPerceivedTarget* PerceivedTarget = AIStatesSubsystem ? AIStatesSubsystem->GetTeamPerception().Find(GetGenericTeamId(), CurrentTarget) : nullptr)
+					{
+						SearchLocation = PerceivedTarget->LastKnownLocation;
+						SearchedSensedTime = PerceivedTarget->LastSensedTime;
+					}
+
+					BlackboardWriter.SetValueAsVector(BlackboardKeys.SearchLocation, SearchLocation);
 				}
 			}
 		}
@@ -196,11 +498,102 @@ void AAIStateController::SetTarget(AActor* NewTarget)
 		}
 		
 		CurrentTarget = NewTarget;
+
+		// Attack token of the previous target is free for other controllers right away
+		if(AIStatesSubsystem)
+		{
+			AIStatesSubsystem->ReleaseAttackToken(this);
+		}
+
+		UAbilitySystemComponent* NewTargetASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(NewTarget);
+		UnbindStateDependencies(true);
+		BindStateDependencies(NewTargetASC, true);
+		InterruptWatcher.OnTargetChanged(NewTargetASC);
+	}
+}
+
+void AAIStateController::UpdateTargetFromTeamPerception(const FAIStatesTeamPerception& TeamPerception, float MinTargetConfidence)
+{
+	const APawn* OwnPawn = GetPawn();
+	if(OwnPawn == nullptr)
+	{
+		return;
+	}
+
+	FAIStatesBlackboardBatchScope BlackboardBatch(BlackboardWriter);
+
+	// Current target is kept while the team is sure about it, so controllers don't swap between equally confident targets
+	const FGenericTeamId TeamId = GetGenericTeamId();
+	const FAIStatesPerceivedTarget* CurrentPerceivedTarget = TeamPerception.Find(TeamId, CurrentTarget);
+	if(CurrentPerceivedTarget && CurrentPerceivedTarget->Confidence >= MinTargetConfidence)
+	{
+		return;
+	}
+
+	if(const FAIStatesPerceivedTarget* BestTarget = TeamPerception.FindBestTarget(TeamId, OwnPawn->GetActorLocation(), MinTargetConfidence))
+	{
+		SetTarget(BestTarget->Target.Get());
+		return;
+	}
+
+	// Lost target is searched for at its last known location by SetTarget
+	if(CurrentTarget)
+	{
+		SetTarget(nullptr);
+		return;
+	}
+
+	// Without target, the newest memory of the team not searched yet becomes the search location
+	const FAIStatesPerceivedTarget* RememberedTarget = TeamPerception.FindBestTarget(TeamId, OwnPawn->GetActorLocation(), 0.0f);
+	if(RememberedTarget && RememberedTarget->LastSensedTime > SearchedSensedTime)
+	{
+		if(GetBlackboardComponent())
+		{
+			BlackboardWriter.SetValueAsVector(BlackboardKeys.SearchLocation, RememberedTarget->LastKnownLocation);
+			SearchedSensedTime = RememberedTarget->LastSensedTime;
+		}
+	}
+}
+
+void AAIStateController::OnTargetPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus)
+{
+	const UAIStatesSet* AIStatesSet = AIStatesSetConfig.Get();
+	if(Actor == nullptr || AIStatesSet == nullptr || AIStatesSet->bShareTeamPerception == false || Stimulus.WasSuccessfullySensed() == false)
+	{
+		return;
+	}
+
+	// Teammates are heard through footsteps and gunfire too, only enemies are worth sharing
+	if(GetTeamAttitudeTowards(*Actor) != ETeamAttitude::Hostile)
+	{
+		return;
+	}
+
+	EAIStatesStimulusSense Sense;
+	const TSubclassOf<UAISense> SenseClass = UAIPerceptionSystem::GetSenseClassForStimulus(this, Stimulus);
+	if(SenseClass == UAISense_Sight::StaticClass())
+	{
+		Sense = EAIStatesStimulusSense::Sight;
+	}
+	else if(SenseClass == UAISense_Hearing::StaticClass())
+	{
+		Sense = EAIStatesStimulusSense::Hearing;
+	}
+	else
+	{
+		return;
+	}
+
+	if(UAIStatesSubsystem* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>())
+	{
+		AIStatesSubsystem->ReportStimulus(this, Actor, Stimulus.StimulusLocation, Sense, Stimulus.Strength);
 	}
 }
 
 void AAIStateController::OnDeathStarted()
 {
+	InterruptWatcher.Disarm();
+
 	auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
 	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI States subsystem is nullptr!")))
 	{
@@ -210,9 +603,9 @@ void AAIStateController::OnDeathStarted()
 
 void AAIStateController::AbortSearch()
 {
-	if (UBlackboardComponent* BlackboardComp = GetBlackboardComponent())
+	if (GetBlackboardComponent())
 	{
-		BlackboardComp->ClearValue(SearchLocationKeyName);
+		BlackboardWriter.ClearValue(BlackboardKeys.SearchLocation);
 	}
 	else
 	{
@@ -223,11 +616,14 @@ void AAIStateController::AbortSearch()
 void AAIStateController::ReturnHome(const FTransform& HomeTransform)
 {	
 	CurrentTarget = nullptr;
+	UnbindStateDependencies(true);
+	InterruptWatcher.OnTargetChanged(nullptr);
 
-	if(UBlackboardComponent* BlackBoard = GetBlackboardComponent())
+	if(GetBlackboardComponent())
 	{
-		BlackBoard->ClearValue(SearchLocationKeyName);
-		BlackBoard->ClearValue(TargetActorKeyName);
+		FAIStatesBlackboardBatchScope BlackboardBatch(BlackboardWriter);
+		BlackboardWriter.ClearValue(BlackboardKeys.SearchLocation);
+		BlackboardWriter.ClearValue(BlackboardKeys.TargetActor);
 	}
 	else
 	{
@@ -235,6 +631,18 @@ void AAIStateController::ReturnHome(const FTransform& HomeTransform)
 	}
 }
 
+bool AAIStateController::InitializeBlackboard(UBlackboardComponent& BlackboardComp, UBlackboardData& BlackboardAsset)
+{
+	const bool bInitialized = Super::InitializeBlackboard(BlackboardComp, BlackboardAsset);
+
+	// Key names are looked up once per blackboard asset instead of on every write
+	BlackboardKeys.TargetActor = BlackboardComp.GetKeyID(TargetActorKeyName);
+	BlackboardKeys.SearchLocation = BlackboardComp.GetKeyID(SearchLocationKeyName);
+	BlackboardWriter.SetBlackboard(&BlackboardComp);
+
+	return bInitialized;
+}
+
 void AAIStateController::OnPossess(APawn* InPawn)
 {
 	const AAICharacter* AICharacter = Cast<AAICharacter>(InPawn);
@@ -247,6 +655,11 @@ void AAIStateController::OnPossess(APawn* InPawn)
 		UE_LOG(LogTemp, Warning, TEXT("AAIStateController::AbortSearch - Blackboard component for this controller is invalid!"))
 	}
 
+	if (UAIPerceptionComponent* AIPerception = GetPerceptionComponent())
+	{
+		AIPerception->OnTargetPerceptionUpdated.AddUniqueDynamic(this, &ThisClass::OnTargetPerceptionUpdated);
+	}
+
 	Super::OnPossess(InPawn);
 }
 
@@ -272,76 +685,344 @@ FGenericTeamId AAIStateController::GetGenericTeamId() const
 
 void AAIStateController::UpdateAIState()
 {
-	if(CurrentTarget == nullptr || bActiveInterruptibleAction)
+	FAIStatesConditionEvaluation Evaluation;
+	if(PrepareStateEvaluation(Evaluation))
 	{
-		return;
+		ApplyStateEvaluation(Evaluation);
+	}
+}
+
+bool AAIStateController::PrepareStateEvaluation(FAIStatesConditionEvaluation& OutEvaluation)
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_PrepareStateEvaluation);
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*AIStatesTraceName, AIStatesChannel);
+
+	// Evaluations which end here, like squad members following their leader, finish timing right away
+	bool bPrepared = false;
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT
+	{
+		EvaluationTiming.AddStep(StartCycles);
+		if(bPrepared == false)
+		{
+			EvaluationTiming.FinishEvaluation();
+		}
+	};
+
+	if(bActiveInterruptibleAction || FollowSquadIntent())
+	{
+		return false;
+	}
+
+	if(CurrentTarget == nullptr)
+	{
+		return false;
 	}
-	
-	TArray<TPair<int32, float>> AvailableStateIndexesWithWeight;
-	float AccumulatedWeights = 0.0f;
+
+	const int32 NumStates = GetAIStatesData().Num();
+
+	OutEvaluation.Context = FAIStatesEvaluationContext(this);
+	OutEvaluation.EvaluationMode = FAIStatesProgram::GetEvaluationMode();
+	OutEvaluation.StatesSet = AIStatesSetConfig.Get();
+	OutEvaluation.Program = AIStatesSetConfig.IsValid() ? &AIStatesSetConfig->GetConditionProgram() : nullptr;
+
+	// States without change events are always re-evaluated, distance states on a slower interval
+	OutEvaluation.bDirtyTracking = AIStateController::CVarDirtyTracking.GetValueOnGameThread() > 0
+		&& AIStatesSetConfig.IsValid() && DirtyStates.Num() == NumStates;
+	if(OutEvaluation.bDirtyTracking)
+	{
+		const FAIStatesDependencyIndex& DependencyIndex = AIStatesSetConfig->GetDependencyIndex();
+		DirtyStates.CombineWithBitwiseOR(DependencyIndex.GetUntrackedStates(), EBitwiseOperatorFlags::MaintainSize);
+
+		const double WorldTime = GetWorld()->GetTimeSeconds();
+		if(WorldTime >= NextDistanceStatesUpdateTime)
+		{
+			DirtyStates.CombineWithBitwiseOR(DependencyIndex.GetDistanceStates(), EBitwiseOperatorFlags::MaintainSize);
+			NextDistanceStatesUpdateTime = WorldTime + UAIStatesSettings::Get()->DistanceStatesReevaluationInterval;
+		}
+	}
+
+	OutEvaluation.PendingStates.Init(false, NumStates);
+	OutEvaluation.EvaluatedStates.Init(false, NumStates);
+	OutEvaluation.Results.Init(false, NumStates);
+
+	for(int32 StateIndex = 0; StateIndex < NumStates; StateIndex++)
+	{
+		if(IsStateBlocked(StateIndex) == false && (OutEvaluation.bDirtyTracking == false || DirtyStates[StateIndex]))
+		{
+			OutEvaluation.PendingStates[StateIndex] = true;
+		}
+	}
+
+	bPrepared = true;
+	return true;
+}
+
+void AAIStateController::ApplyStateEvaluation(FAIStatesConditionEvaluation& Evaluation)
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_ApplyStateEvaluation);
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*AIStatesTraceName, AIStatesChannel);
+
+	// Blackboard writes of this update are committed together once the new state is entered
+	FAIStatesBlackboardBatchScope BlackboardBatch(BlackboardWriter);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT
+	{
+		EvaluationTiming.AddStep(StartCycles);
+		EvaluationTiming.FinishEvaluation();
+	};
+
+	// Available state indexes weighted by state weight
+	FAIStatesDecision StateDecision(EAIStatesDecisionKind::State, CurrentAIStateIndex);
 
 	// Collect Available States
-	for(int32 StateIndex = 0; StateIndex < AIStates.Num(); StateIndex++)
+	const TArray<FAIStateRuntimeData>& AIStates = GetAIStatesData();
+	for(int32 StateIndex = 0; StateIndex < AIStates.Num() && StateIndex < Evaluation.PendingStates.Num(); StateIndex++)
 	{
-		const auto& [StateWeight, bStateBlocked, bMakeBlockedOnExit, Conditions, Abilities] = AIStates[StateIndex];
-		if(bStateBlocked)
+		if(IsStateBlocked(StateIndex))
 		{
 			continue;
 		}
 
-		bool bIsStateAvailable = true;
-		
-		for(const TSharedPtr<FAIStateConditionData> AIStateCondition : Conditions)
+		bool bIsStateAvailable = false;
+		if(Evaluation.PendingStates[StateIndex])
 		{
-			if(AIStateCondition == nullptr || AIStateCondition->CheckCondition(this) == false)
+			// States not evaluated by a worker are evaluated here
+			bIsStateAvailable = Evaluation.EvaluatedStates[StateIndex]
+				? Evaluation.Results[StateIndex]
+				: AreStateConditionsMet(StateIndex, Evaluation.EvaluationMode, Evaluation.Context);
+			INC_DWORD_STAT(STAT_AIStates_EvaluatedStates);
+
+			if(CachedStateAvailability.IsValidIndex(StateIndex))
 			{
-				bIsStateAvailable = false;
-				break;
+				CachedStateAvailability[StateIndex] = bIsStateAvailable;
+				DirtyStates[StateIndex] = false;
 			}
 		}
-			
+		else
+		{
+			bIsStateAvailable = CachedStateAvailability[StateIndex];
+			INC_DWORD_STAT(STAT_AIStates_CachedStates);
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+			if(Evaluation.EvaluationMode == EAIStatesConditionEvaluationMode::Compare && AreStateConditionsMet(StateIndex, Evaluation.EvaluationMode, Evaluation.Context) != bIsStateAvailable)
+			{
+				UE_LOG(LogTemp, Error, TEXT("AAIStateController::ApplyStateEvaluation - Cached availability of state %s is stale, an input is not tracked!"),
+					*AIStatesSetConfig->States[StateIndex].StateName.ToString())
+			}
+#endif
+		}
+
 		if(bIsStateAvailable)
 		{
-			AccumulatedWeights += StateWeight;
-			AvailableStateIndexesWithWeight.Add({StateIndex, StateWeight});
+			StateDecision.AddCandidate(StateIndex, AIStates[StateIndex].StateWeight);
 		}
 	}
 
-	// Setup probability partitions per ability
-	// Replace weights with probability thresholds
-	for(int32 i = 0; i < AvailableStateIndexesWithWeight.Num(); i++)
+	if(StateDecision.GetCandidates().HasSpilled())
 	{
-		TPair<int32, float>& CurrentStateProbabilityData = AvailableStateIndexesWithWeight[i];
-		
-		const float PercentageChance =  CurrentStateProbabilityData.Value / AccumulatedWeights;
-		if(i > 0)
+		INC_DWORD_STAT(STAT_AIStates_WeightedSamplerSpills);
+	}
+
+	// Pick state with probability proportional to its weight
+	const int32 PickedStateIndex = PickDecision(StateDecision);
+	if(PickedStateIndex != INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_AIStates_StatesSelected);
+		EnterState(PickedStateIndex);
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+		RecordDebugEvent(EAIStatesDebugEvent::State, AIStatesSetConfig.IsValid() ? AIStatesSetConfig->States[PickedStateIndex].StateName : NAME_None,
+			StateDecision.GetPickedProbability());
+#endif
+
+		// Regular members of the squad follow this decision instead of evaluating their own states
+		if(auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>())
 		{
-			const float LastChanceThreshold = AvailableStateIndexesWithWeight[i-1].Value;
-			CurrentStateProbabilityData.Value = LastChanceThreshold + PercentageChance;
+			AIStatesSubsystem->GetSquads().PublishIntent(*this, CurrentTarget, CurrentAIStateIndex, GetWorld()->GetTimeSeconds());
 		}
-		else
+	}
+}
+
+void AAIStateController::EnterState(int32 StateIndex)
+{
+	if(CurrentAIStateIndex == StateIndex)
+	{
+		return;
+	}
+
+	const TArray<FAIStateRuntimeData>& AIStates = GetAIStatesData();
+	if(BlockedStates.IsValidIndex(CurrentAIStateIndex) && AIStates.IsValidIndex(CurrentAIStateIndex))
+	{
+		BlockedStates[CurrentAIStateIndex] = AIStates[CurrentAIStateIndex].bMakeBlockedOnExit;
+	}
+
+	CurrentAIStateIndex = StateIndex;
+}
+
+bool AAIStateController::FollowSquadIntent()
+{
+	auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	const FAIStatesSquad* Squad = AIStatesSubsystem ? AIStatesSubsystem->GetSquads().FindSquad(*this) : nullptr;
+	if(Squad == nullptr || Squad->GetLeader() == this)
+	{
+		return false;
+	}
+
+	// Stale intent or intent of another states set is not followed, the member evaluates its states itself
+	const FAIStatesSquadIntent& Intent = Squad->Intent;
+	const TArray<FAIStateRuntimeData>& AIStates = GetAIStatesData();
+	AActor* IntentTarget = Intent.Target.Get();
+	if(IntentTarget == nullptr || Intent.StatesSet.Get() != AIStatesSetConfig.Get() || AIStates.IsValidIndex(Intent.StateIndex) == false
+		|| IsStateBlocked(Intent.StateIndex) || Intent.IsFresh(GetWorld()->GetTimeSeconds(), UAIStatesSettings::Get()->SquadIntentTimeout) == false)
+	{
+		return false;
+	}
+
+	// Conditions against the shared target were checked by the leader, only conditions of this member are left.
+	// They see the intent target without switching to it, so a member failing them keeps its own target
+	{
+		TGuardValue<TObjectPtr<AActor>> IntentTargetGuard(CurrentTarget, IntentTarget);
+		for(const FAIStateConditionData* Condition : AIStates[Intent.StateIndex].SquadMemberConditions)
 		{
-			CurrentStateProbabilityData.Value = PercentageChance;
+			if(Condition->CheckCondition(this) == false)
+			{
+				return false;
+			}
 		}
 	}
 
-	// Pick state with ChanceThreshold greater or equal than random chance
-	const float RandomChanceThreshold =  FMath::RandRange(0.0f, 1.0f);
+	SetTarget(IntentTarget);
+
+	INC_DWORD_STAT(STAT_AIStates_SquadIntentsFollowed);
+	// Traced as the only candidate, picked by a zero roll
+	FAIStatesDecision IntentDecision(EAIStatesDecisionKind::State, CurrentAIStateIndex);
+	IntentDecision.AddCandidate(Intent.StateIndex, AIStates[Intent.StateIndex].StateWeight);
+	IntentDecision.Pick(0.0f);
+	RecordDecision(IntentDecision);
+	EnterState(Intent.StateIndex);
+	return true;
+}
+
+bool AAIStateController::IsSquadLeader() const
+{
+	const auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	const FAIStatesSquad* Squad = AIStatesSubsystem ? AIStatesSubsystem->GetSquads().FindSquad(*this) : nullptr;
+	return Squad && Squad->GetLeader() == this;
+}
 
-	for(const TPair<int32, float>& AvailableStateData : AvailableStateIndexesWithWeight)
+bool AAIStateController::GetSquadFormationLocation(FVector& OutLocation) const
+{
+	const auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	const FAIStatesSquad* Squad = AIStatesSubsystem ? AIStatesSubsystem->GetSquads().FindSquad(*this) : nullptr;
+	if(Squad == nullptr || Squad->Intent.PublishTime < 0.0)
 	{
-		if(AvailableStateData.Value >= RandomChanceThreshold)
+		return false;
+	}
+
+	OutLocation = Squad->GetFormationSlotLocation(AIStatesSubsystem->GetSquads().GetFormationSlot(*this), UAIStatesSettings::Get()->SquadFormationSpacing);
+	return true;
+}
+
+const TArray<FAIStateRuntimeData>& AAIStateController::GetAIStatesData() const
+{
+	static const TArray<FAIStateRuntimeData> NoStates;
+	return AIStatesSetConfig.IsValid() ? AIStatesSetConfig->GetRuntimeStates() : NoStates;
+}
+
+bool AAIStateController::RunActiveAbilityQuery(const FAIStatesEQSQueryFinished& OnQueryFinished)
+{
+	UEnvQuery* Query = ActiveAbilityData ? ActiveAbilityData->GetEQS() : nullptr;
+	auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(Query == nullptr || AIStatesSubsystem == nullptr)
+	{
+		return false;
+	}
+
+	AIStatesSubsystem->RunCachedQuery(Query, ActiveAbilityData->GetEQSParams(), this, ActiveAbilityData->GetEQSDistribution(), OnQueryFinished);
+	return true;
+}
+
+SIZE_T AAIStateController::GetAIStatesAllocatedSize() const
+{
+	return BlockedStates.GetAllocatedSize() + DirtyStates.GetAllocatedSize() + CachedStateAvailability.GetAllocatedSize() + DecisionTrace.GetAllocatedSize()
+		+ LineOfSightCache.GetAllocatedSize();
+}
+
+int32 AAIStateController::PickDecision(FAIStatesDecision& Decision) const
+{
+	const int32 ChosenIndex = Decision.Pick(DecisionRandomStream);
+	if(ChosenIndex != INDEX_NONE)
+	{
+		RecordDecision(Decision);
+	}
+
+	return ChosenIndex;
+}
+
+void AAIStateController::RecordDecision(const FAIStatesDecision& Decision) const
+{
+	if(DecisionTrace.IsEnabled() == false)
+	{
+		return;
+	}
+
+	FAIStatesDecisionRecord Record = Decision.GetRecord();
+	Record.WorldTime = GetWorld()->GetTimeSeconds();
+	DecisionTrace.Add(Record);
+}
+
+bool AAIStateController::AreStateConditionsMet(int32 StateIndex, EAIStatesConditionEvaluationMode EvaluationMode, FAIStatesEvaluationContext& EvaluationContext)
+{
+	auto EvaluateVirtual = [this, StateIndex]()
+	{
+		const TArray<FAIStateRuntimeData>& AIStates = GetAIStatesData();
+		if(AIStates.IsValidIndex(StateIndex) == false)
 		{
-			if(CurrentAIStateIndex != AvailableStateData.Key)
+			return false;
+		}
+
+		const FAIStateRuntimeData& AIState = AIStates[StateIndex];
+		for(int32 ConditionIndex = 0; ConditionIndex < AIState.Conditions.Num(); ConditionIndex++)
+		{
+			const FAIStateConditionData* AIStateCondition = AIState.Conditions[ConditionIndex];
+			if(AIStateCondition == nullptr)
 			{
-				auto& OldState = AIStates[CurrentAIStateIndex];
-				OldState.bStateBlocked = OldState.bMakeBlockedOnExit;
-				
-				CurrentAIStateIndex = AvailableStateData.Key;
+				return false;
+			}
+
+			AISTATES_SCOPE_CONDITION(AIState.ConditionProfiles[ConditionIndex]);
+			INC_DWORD_STAT(STAT_AIStates_ConditionsEvaluated);
+			if(AIStateCondition->CheckCondition(this) == false)
+			{
+				return false;
 			}
-			break;
 		}
+
+		return true;
+	};
+
+	const TArray<FAIStateRuntimeData>& AIStates = GetAIStatesData();
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(AIStates.IsValidIndex(StateIndex) ? *AIStates[StateIndex].TraceName : TEXT("InvalidState"), AIStatesChannel);
+
+	const int32 ConditionGroup = AIStatesSetConfig.IsValid() ? AIStatesSetConfig->GetStateConditionGroup(StateIndex) : INDEX_NONE;
+	if(ConditionGroup == INDEX_NONE || EvaluationMode == EAIStatesConditionEvaluationMode::Virtual)
+	{
+		return EvaluateVirtual();
+	}
+
+	const bool bResult = AIStatesSetConfig->GetConditionProgram().EvaluateGroup(ConditionGroup, EvaluationContext);
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if(EvaluationMode == EAIStatesConditionEvaluationMode::Compare && EvaluateVirtual() != bResult)
+	{
+		UE_LOG(LogTemp, Error, TEXT("AAIStateController::AreStateConditionsMet - Compiled conditions of state %s differ from virtual conditions!"),
+			*AIStatesSetConfig->States[StateIndex].StateName.ToString())
 	}
+#endif
+
+	return bResult;
 }
 
 bool AAIStateController::SetupAIStatesFromConfig()
@@ -353,7 +1034,18 @@ bool AAIStateController::SetupAIStatesFromConfig()
 		return false;
 	}
 	
+	// Subscriptions were made for inputs of the previous states set
+	InterruptWatcher.Disarm();
+	UnbindStateDependencies(false);
+	UnbindStateDependencies(true);
+
 	AIStatesSetConfig = AICharacter->AIStatesSetConfig;
+	ActiveAbilityData = nullptr;
+	CurrentApproachInterruptibleData = nullptr;
+	AIStatesTraceName = FString::Printf(TEXT("%s [%s]"), *GetName(), *AIStatesSetConfig->GetName());
+
+	// Compiles condition program and runtime states of sets which were not loaded from disk
+	const int32 NumStates = AIStatesSetConfig->GetRuntimeStates().Num();
 
 	TObjectPtr<UAbilitySystemComponent> OwnerASC = AICharacter->GetAbilitySystemComponent();
 	if (IsValid(OwnerASC) == false)
@@ -362,39 +1054,117 @@ bool AAIStateController::SetupAIStatesFromConfig()
 		return false;
 	}
 
-	AIStates.Empty();
-	
-	for(FAIStateDataConfig& AIStateData : AIStatesSetConfig->States)
+	// State data is shared through the states set, only mutable per bot state is set up here
+	BlockedStates.Init(false, NumStates);
+
+	DefaultApproachTargetData = AIStatesSetConfig->DefaultApproachData;
+
+	// Same match seed and controller index give the same sequence of decisions
+	auto* AIStatesSubsystem = GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(DecisionControllerIndex == INDEX_NONE && AIStatesSubsystem)
 	{
-		auto& [StateWeight, bStateBlocked, bMakeBlockedOnExit, Conditions, Abilities] =
-			AIStates.Add_GetRef({ AIStateData.StateWeight, false, AIStateData.bBlockOnExit, {}, {} });
-			
-		for(FInstancedStruct& ConditionInstancedStruct : AIStateData.Conditions)
-		{
-			Conditions.Add(MakeShareable(ConditionInstancedStruct.GetMutablePtr<FAIStateConditionData>()));
-		}
-			
-		for(auto& [Ability] : AIStateData.Abilities)
-		{
-			if(auto* StateActionData = Ability.GetMutablePtr<FAIStateActionData>())
-			{
-				Abilities.Add(MakeShareable(StateActionData));
-			}
-		}
+		DecisionControllerIndex = AIStatesSubsystem->AcquireDecisionControllerIndex();
 	}
 
-	DefaultApproachTargetData = AIStatesSetConfig->DefaultApproachData;
+	const int32 DecisionSeed = static_cast<int32>(HashCombine(GetTypeHash(AIStatesSubsystem ? AIStatesSubsystem->GetMatchSeed() : 0), GetTypeHash(DecisionControllerIndex)));
+	DecisionRandomStream.Initialize(DecisionSeed);
+	DecisionTrace.Initialize(DecisionSeed, UAIStatesSettings::Get()->DecisionTraceLength);
+
+	// Every state is evaluated on the first update, later only states which inputs changed
+	DirtyStates.Init(true, NumStates);
+	CachedStateAvailability.Init(false, NumStates);
+	NextDistanceStatesUpdateTime = 0.0;
+
+	BindStateDependencies(OwnerASC, false);
+	BindStateDependencies(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(CurrentTarget), true);
 	
 	return true;
 }
 
+void AAIStateController::BindStateDependencies(UAbilitySystemComponent* ASC, bool bTarget)
+{
+	if(IsValid(ASC) == false || AIStatesSetConfig.IsValid() == false)
+	{
+		return;
+	}
+
+	const FAIStatesDependencyIndex& DependencyIndex = AIStatesSetConfig->GetDependencyIndex();
+	for(const FGameplayTag& Tag : bTarget ? DependencyIndex.GetTargetTags() : DependencyIndex.GetSelfTags())
+	{
+		ASC->RegisterGameplayTagEvent(Tag, EGameplayTagEventType::AnyCountChange).AddUObject(this, &ThisClass::OnStateDependencyTagChanged, bTarget);
+	}
+
+	for(const FGameplayAttribute& Attribute : bTarget ? DependencyIndex.GetTargetAttributes() : DependencyIndex.GetSelfAttributes())
+	{
+		ASC->GetGameplayAttributeValueChangeDelegate(Attribute).AddUObject(this, &ThisClass::OnStateDependencyAttributeChanged, bTarget);
+	}
+
+	TWeakObjectPtr<UAbilitySystemComponent>& BoundASC = bTarget ? DependencyTargetASC : DependencySelfASC;
+	BoundASC = ASC;
+
+	// Newly bound target changes every state reading it
+	if(bTarget && DirtyStates.Num() == DependencyIndex.GetNumStates())
+	{
+		DirtyStates.CombineWithBitwiseOR(DependencyIndex.GetTargetStates(), EBitwiseOperatorFlags::MaintainSize);
+	}
+}
+
+void AAIStateController::UnbindStateDependencies(bool bTarget)
+{
+	TWeakObjectPtr<UAbilitySystemComponent>& BoundASC = bTarget ? DependencyTargetASC : DependencySelfASC;
+	UAbilitySystemComponent* ASC = BoundASC.Get();
+	BoundASC.Reset();
+
+	if(ASC == nullptr || AIStatesSetConfig.IsValid() == false)
+	{
+		return;
+	}
+
+	const FAIStatesDependencyIndex& DependencyIndex = AIStatesSetConfig->GetDependencyIndex();
+	for(const FGameplayTag& Tag : bTarget ? DependencyIndex.GetTargetTags() : DependencyIndex.GetSelfTags())
+	{
+		ASC->RegisterGameplayTagEvent(Tag, EGameplayTagEventType::AnyCountChange).RemoveAll(this);
+	}
+
+	for(const FGameplayAttribute& Attribute : bTarget ? DependencyIndex.GetTargetAttributes() : DependencyIndex.GetSelfAttributes())
+	{
+		ASC->GetGameplayAttributeValueChangeDelegate(Attribute).RemoveAll(this);
+	}
+
+	if(bTarget && DirtyStates.Num() == DependencyIndex.GetNumStates())
+	{
+		DirtyStates.CombineWithBitwiseOR(DependencyIndex.GetTargetStates(), EBitwiseOperatorFlags::MaintainSize);
+	}
+}
+
+void AAIStateController::OnStateDependencyTagChanged(const FGameplayTag Tag, int32 NewCount, bool bFromTarget)
+{
+	if(AIStatesSetConfig.IsValid() && DirtyStates.Num() == AIStatesSetConfig->GetDependencyIndex().GetNumStates())
+	{
+		AIStatesSetConfig->GetDependencyIndex().MarkTagDependents(Tag, bFromTarget, DirtyStates);
+	}
+}
+
+void AAIStateController::OnStateDependencyAttributeChanged(const FOnAttributeChangeData& ChangeData, bool bFromTarget)
+{
+	if(AIStatesSetConfig.IsValid() && DirtyStates.Num() == AIStatesSetConfig->GetDependencyIndex().GetNumStates())
+	{
+		AIStatesSetConfig->GetDependencyIndex().MarkAttributeDependents(ChangeData.Attribute, bFromTarget, DirtyStates);
+	}
+}
+
 void AAIStateController::StartApproachingTarget()
 {
+	// Watched data is replaced below
+	InterruptWatcher.Disarm();
+
 	DefaultApproachAbility.MovementGaitData = CurrentAbilityApproachTargetData.MovementGaitData;
 	DefaultApproachAbility.InterruptibleActionData = CurrentAbilityApproachTargetData.InterruptibleData;
 	
 	DefaultApproachAbility.Activate(this);
 	bActiveInterruptibleAction = true;
+	ActiveInterruptibleAbilityTag = DefaultApproachAbility.InterruptibleAbilityTag;
+	InterruptWatcher.Arm(*this, CurrentApproachInterruptibleData ? *CurrentApproachInterruptibleData : DefaultApproachAbility.InterruptibleActionData);
 
 	// Debug
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
@@ -402,173 +1172,156 @@ void AAIStateController::StartApproachingTarget()
 	{
 		OnChangedActiveAbilityStateDelegate_Debug.Broadcast("Approaching");	
 	}
+	RecordDebugEvent(EAIStatesDebugEvent::Approach, "Approaching", 1.0f);
 #endif
 }
 
 bool AAIStateController::GetWeightedAbility_STATES(TSubclassOf<ULyraGameplayAbility>& OutAbilityClass)
 {
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_SelectAbility);
+
 	OutAbilityClass = nullptr;
-	float AccumulatedWeights = 0.0f;
-	TArray<TPair<int32, float>> AvailableAbilitiesChanceThresholds;
+
+	float PickedProbability = 0.0f;
+	FAIStateActionData* AbilityToActivate = PickCurrentStateAbility(PickedProbability);
+	if(AbilityToActivate == nullptr)
+	{
+		return false;
+	}
+
+	ActiveAbilityData = AbilityToActivate;
+	OutAbilityClass = AbilityToActivate->Activate(this);
+	bActiveInterruptibleAction = AbilityToActivate->CanAbilityBeInterrupted();
+	ActiveInterruptibleAbilityTag = bActiveInterruptibleAction ? AbilityToActivate->GetInterruptibleAbilityTag() : FGameplayTag();
+
+	// Interrupt conditions are evaluated only when their inputs change, until the action ends
+	const FAIInterruptibleActionData* InterruptibleData = bActiveInterruptibleAction ? AbilityToActivate->GetInterruptibleActionData() : nullptr;
+	if(InterruptibleData)
+	{
+		InterruptWatcher.Arm(*this, *InterruptibleData);
+	}
+	else
+	{
+		InterruptWatcher.Disarm();
+	}
+
+	CurrentApproachInterruptibleData = AbilityToActivate->GetApproachInterruptibleActionData();
+	if(AbilityToActivate->GetApproachTargetData(CurrentAbilityApproachTargetData) == false)
+	{
+		CurrentAbilityApproachTargetData = DefaultApproachTargetData;
+		CurrentApproachInterruptibleData = AIStatesSetConfig.IsValid() ? &AIStatesSetConfig->DefaultApproachData.InterruptibleData : nullptr;
+	}
+
+	// Debug
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0 && AIStatesSetConfig.IsValid())
+	{
+		constexpr int32 PercentageMultiplier = 100;
+		const FString AbilityToActivateString = FString::Printf(TEXT("%ls%hs%ls"),
+		*AbilityToActivate->GetAbilityName(), " | ", *(FString::FromInt(static_cast<int32>(PickedProbability * PercentageMultiplier)) + "%"));
+		
+		OnSelectedAbilityDelegate_Debug.Broadcast(PreviousState_Debug, PreviousAbility_Debug,
+			AIStatesSetConfig->States[CurrentAIStateIndex].StateName,
+			*AbilityToActivateString);
+			
+		PreviousState_Debug = AIStatesSetConfig->States[CurrentAIStateIndex].StateName;
+		PreviousAbility_Debug = *AbilityToActivateString;
+	}
+	RecordDebugEvent(EAIStatesDebugEvent::Ability, *AbilityToActivate->GetAbilityName(), PickedProbability);
+#endif
 	
+	return true;
+}
+
+FAIStateActionData* AAIStateController::PickCurrentStateAbility(float& OutProbability)
+{
+	OutProbability = 0.0f;
+
+	const TArray<FAIStateRuntimeData>& AIStates = GetAIStatesData();
 	if(!AIStates.IsValidIndex(CurrentAIStateIndex))
 	{
-		UE_LOG(LogTemp, Warning, TEXT("AAIStatesController::GetWeightedAbility_STATES - CurrentAIStateIndex out of bounds!."))
-		return false;
+		UE_LOG(LogTemp, Warning, TEXT("AAIStatesController::PickCurrentStateAbility - CurrentAIStateIndex out of bounds!."))
+		return nullptr;
 	}
 
-	// Collect available abilities with weights
-	const TArray<TSharedPtr<FAIStateActionData>>& CurrentStateAbilitiesPool = AIStates[CurrentAIStateIndex].Abilities;
+	// Collect available ability indexes with weights
+	FAIStatesDecision AbilityDecision(EAIStatesDecisionKind::Ability, CurrentAIStateIndex);
+	const TArray<FAIStateActionData*>& CurrentStateAbilitiesPool = AIStates[CurrentAIStateIndex].Abilities;
 	for(int32 i = 0; i < CurrentStateAbilitiesPool.Num(); i++)
 	{
 		const auto& Ability = CurrentStateAbilitiesPool[i];
 		
 		if(Ability && Ability->CanAbilityBeActivated(this))
 		{
-			AccumulatedWeights += Ability->ProbabilityWeight;
-			AvailableAbilitiesChanceThresholds.Add({i, Ability->ProbabilityWeight});
+			AbilityDecision.AddCandidate(i, Ability->ProbabilityWeight);
 		}
 	}
 
-	if(AccumulatedWeights == 0.0f)
+	const TAIStatesWeightedSampler<int32>& AvailableAbilitiesSampler = AbilityDecision.GetCandidates();
+	if(AvailableAbilitiesSampler.HasSpilled())
 	{
-		UE_LOG(LogTemp, Error, TEXT("AAIStatesController::GetWeightedAbility_STATES - Accumulated weights were equal ZERO."));
-		return false;
+		INC_DWORD_STAT(STAT_AIStates_WeightedSamplerSpills);
 	}
 
-	// Setup probability partitions
-	// Turn weights into ChanceThresholds
-	for(int32 i = 0; i < AvailableAbilitiesChanceThresholds.Num(); i++)
+	if(AvailableAbilitiesSampler.IsEmpty())
 	{
-		TPair<int32, float>& AbilityData = AvailableAbilitiesChanceThresholds[i];
-		const auto PercentageChance =  AbilityData.Value / AccumulatedWeights;
-			
-		if(i > 0)
-		{
-			const float LastChanceThreshold = AvailableAbilitiesChanceThresholds[i-1].Value;
-			AbilityData.Value = LastChanceThreshold + PercentageChance;
-		}
-		else
-		{
-			AbilityData.Value = PercentageChance;
-		}
+		UE_LOG(LogTemp, Error, TEXT("AAIStatesController::PickCurrentStateAbility - Accumulated weights were equal ZERO."));
+		return nullptr;
+	}
 
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-		if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0 && GEngine)
+	if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0 && GEngine)
+	{
+		for(int32 i = 0; i < AvailableAbilitiesSampler.Num(); i++)
 		{
 			constexpr int32 Key = 100;
 			constexpr float TimeToDisplay = 4.0f;
 			GEngine->AddOnScreenDebugMessage(i + Key, TimeToDisplay, FColor::Blue,FString::Printf(TEXT("%ls%hs%f"),
-				*CurrentStateAbilitiesPool[AbilityData.Key]->GetAbilityName(), ": ", PercentageChance));
+				*CurrentStateAbilitiesPool[AvailableAbilitiesSampler.GetItem(i)]->GetAbilityName(), ": ", AvailableAbilitiesSampler.GetProbability(i)));
 		}
-#endif
-	}
-	
-	// Pick ability with ChanceThreshold greater or equal than random chance
-	constexpr float MinRandomChance = 0.f;
-	constexpr float MaxRandomChance = 1.f;
-	const float RandomChanceThreshold = FMath::RandRange(MinRandomChance, MaxRandomChance);
-	
-	for(const TPair<int32, float>& ChanceThreshold : AvailableAbilitiesChanceThresholds)
-	{
-		if(ChanceThreshold.Value >= RandomChanceThreshold && CurrentStateAbilitiesPool.IsValidIndex(ChanceThreshold.Key))
-		{
-			const TSharedPtr<FAIStateActionData> AbilityToActivate = CurrentStateAbilitiesPool[ChanceThreshold.Key];
-			if(AbilityToActivate == nullptr)
-			{
-				break;
-			}
-
-			OutAbilityClass = AbilityToActivate->Activate(this);
-			bActiveInterruptibleAction = AbilityToActivate->CanAbilityBeInterrupted();
-
-			if(AbilityToActivate->GetApproachTargetData(CurrentAbilityApproachTargetData) == false)
-			{
-				CurrentAbilityApproachTargetData = DefaultApproachTargetData;
-			}
-
-			// Debug
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-			if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0 && AIStatesSetConfig.IsValid())
-			{
-				const int32 CurrentIndex = AvailableAbilitiesChanceThresholds.IndexOfByKey(ChanceThreshold);
-				const float PercentageChance = CurrentIndex > 0 ? AvailableAbilitiesChanceThresholds[CurrentIndex-1].Value : ChanceThreshold.Value;
-
-				constexpr int32 PercentageMultiplier = 100;
-				const FString AbilityToActivateString = FString::Printf(TEXT("%ls%hs%ls"),
-				*AbilityToActivate->GetAbilityName(), " | ", *(FString::FromInt(static_cast<int32>(PercentageChance * PercentageMultiplier)) + "%"));
-				
-				OnSelectedAbilityDelegate_Debug.Broadcast(PreviousState_Debug, PreviousAbility_Debug,
-					AIStatesSetConfig->States[CurrentAIStateIndex].StateName,
-					*AbilityToActivateString);
-					
-				PreviousState_Debug = AIStatesSetConfig->States[CurrentAIStateIndex].StateName;
-				PreviousAbility_Debug = *AbilityToActivateString;
-			}
-#endif
-			
-			return true;
-		}
-	}
-
-	// Debug
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-	if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0 && AIStatesSetConfig.IsValid())
-	{
-		OnSelectedAbilityDelegate_Debug.Broadcast(PreviousState_Debug, PreviousAbility_Debug,
-				AIStatesSetConfig->States[CurrentAIStateIndex].StateName,
-				"None");
 	}
 #endif
 	
-	UE_LOG(LogTemp, Error, TEXT("AAIStatesController::GetWeightedAbility_STATES - No ability was chosen."));
-	return false;
+	// Pick ability with probability proportional to its weight
+	const int32 PickedAbilityIndex = PickDecision(AbilityDecision);
+	OutProbability = AbilityDecision.GetPickedProbability();
+	return CurrentStateAbilitiesPool[PickedAbilityIndex];
 }
 
 bool AAIStateController::GetWeightedAbility(const TArray<TSubclassOf<ULyraGameplayAbility>>& Abilities, TSubclassOf<ULyraGameplayAbility>& OutAbilityClass) const
 {
 	const ULyraAbilitySystemComponent* ASC = Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetPawn()));
-	if(ensureMsgf(ASC != nullptr, TEXT("Ability system component is nullptr!")))
+	if(!ensureMsgf(ASC != nullptr, TEXT("Ability system component is nullptr!")))
 	{
 		return false;
 	}
 
-	float WeightSum = 0.f;
-
-	TArray<TPair<TSubclassOf<ULyraGameplayAbility>, float>> AbilityWeights;
-
-	for (const TSubclassOf<ULyraGameplayAbility>& AbilityClass : Abilities)
+	// Ability classes aren't part of the states set, the pick is traced as a roll
+	FAIStatesDecision AbilityClassDecision(EAIStatesDecisionKind::Roll, INDEX_NONE);
+	for (int32 AbilityIndex = 0; AbilityIndex < Abilities.Num(); AbilityIndex++)
 	{
-		const float Weight = ASC->GetAbilityWeight(AbilityClass);
-		WeightSum += Weight;
-
-		AbilityWeights.Add(TPair<TSubclassOf<ULyraGameplayAbility>, float>(AbilityClass, Weight));
+		AbilityClassDecision.AddCandidate(AbilityIndex, ASC->GetAbilityWeight(Abilities[AbilityIndex]));
 	}
 
-	const float Rand = FMath::RandRange(0.f, WeightSum);
+	if(AbilityClassDecision.GetCandidates().HasSpilled())
+	{
+		INC_DWORD_STAT(STAT_AIStates_WeightedSamplerSpills);
+	}
 
-	float AccWeight = 0.f;
-	for (const TPair<TSubclassOf<ULyraGameplayAbility>, float>& AbilityWithWeight : AbilityWeights)
+	const int32 PickedIndex = PickDecision(AbilityClassDecision);
+	if(PickedIndex == INDEX_NONE)
 	{
-		const float Weight = AbilityWithWeight.Value;
-		if (Weight > 0)
-		{
-			AccWeight += Weight;
-			if (AccWeight > Rand)
-			{
-				OutAbilityClass = AbilityWithWeight.Key;
-				return true;
-			}
-		}
+		return false;
 	}
 
-	return false;
+	OutAbilityClass = Abilities[PickedIndex];
+	return true;
 }
 
 bool AAIStateController::GetActivatableAbilityByWeight(const FGameplayTagContainer& AbilityTags, AActor* Target, bool bCheckAffection, FGameplayTag AlwaysCheckAffectionForTag, TSubclassOf<ULyraGameplayAbility>& OutAbility) const
 {
 	ULyraAbilitySystemComponent* ASC = Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(GetPawn()));
-	if(ensureMsgf(ASC != nullptr, TEXT("Ability system component is nullptr!")))
+	if(!ensureMsgf(ASC != nullptr, TEXT("Ability system component is nullptr!")))
 	{
 		return false;
 	}
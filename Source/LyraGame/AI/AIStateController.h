@@ -4,7 +4,15 @@
 #include "CoreMinimal.h"
 #include "AIController.h"
 #include "AIStates/AIStatesSet.h"
+#include "AIStates/AIStatesDecisionTrace.h"
+#include "AIStates/AIStatesLineOfSight.h"
+#include "AIStates/AIStatesReachability.h"
+#include "AIStates/AIStatesAgentRegistry.h"
+#include "AIStates/AIStatesInterruptWatcher.h"
+#include "AIStates/AIStatesDebugOverlay.h"
+#include "AIStates/AIStatesBlackboardWriter.h"
 #include "GameplayEffectTypes.h"
+#include "Perception/AIPerceptionTypes.h"
 
 #include "AIStateController.generated.h"
 
@@ -19,9 +27,19 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(
 	FOnSelectedAbilitySignature_Debug, FName, PreviousStateName, FName, PreviousAbilityName, FName, CurrentStateName, FName, CurrentAbilityName);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(
 	FOnChangedActiveAbilityStateSignature_Debug, FName, AbilityState);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnActiveAbilityInterruptedSignature);
 
 struct FAIStateConditionData;
 struct FAIStateRuntimeData;
+class FAIStatesTeamPerception;
+
+// Blackboard key ids of the key names the controller writes, invalid for keys missing in the blackboard asset
+struct FAIStatesBlackboardKeys
+{
+	FBlackboard::FKey TargetActor = FBlackboard::InvalidKey;
+	FBlackboard::FKey SearchLocation = FBlackboard::InvalidKey;
+};
+
 class ULyraGameplayAbility;
 class UAIStatesSet;
 
@@ -56,6 +74,9 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void ClearTarget();
 
+	// Function taking the most confident target remembered by the team, or searching the last known location once no target is confident enough
+	void UpdateTargetFromTeamPerception(const FAIStatesTeamPerception& TeamPerception, float MinTargetConfidence);
+
 	// Function clearing search location in Blackboard
 	UFUNCTION(BlueprintCallable)
 	void AbortSearch();
@@ -68,34 +89,122 @@ public:
 	UFUNCTION(BlueprintCallable, Category=AI)
 	void UpdateAIState();
 
+	// Function resolving which states have to be evaluated in this update. Returns false if the controller doesn't pick states now
+	bool PrepareStateEvaluation(FAIStatesConditionEvaluation& OutEvaluation);
+
+	// Function evaluating states not evaluated yet, then picking the next state from available states
+	void ApplyStateEvaluation(FAIStatesConditionEvaluation& Evaluation);
+
+	// Function changing time between state evaluations scheduled by AI states subsystem
+	UFUNCTION(BlueprintCallable, Category=AI)
+	void SetAIStatesUpdateInterval(float NewUpdateInterval);
+
+	// Getter function retrieving time between state evaluations of this controller, scaled by its significance tier
+	UFUNCTION(BlueprintPure, Category=AI)
+	float GetAIStatesUpdateInterval() const;
+
+	// Function mapping significance computed by the significance manager to a significance tier
+	void SetSignificance(float NewSignificance);
+
+	// Function moving this controller to the significance tier, rescheduling its updates and behavior tree ticks
+	void SetSignificanceTier(int32 NewTier);
+
+	// Getter function retrieving level of detail tier of this controller, zero is the most significant
+	UFUNCTION(BlueprintPure, Category=AI)
+	int32 GetSignificanceTier() const { return SignificanceTier; }
+
+	// Getter function retrieving if behavior trees and abilities of this controller may run environment queries in its significance tier
+	UFUNCTION(BlueprintPure, Category=AI)
+	bool CanUseEQS() const;
+
+	// Getter function retrieving if this controller leads its squad and evaluates states for its members
+	UFUNCTION(BlueprintPure, Category=AI)
+	bool IsSquadLeader() const;
+
+	// Getter function retrieving location of the formation slot of this controller around its squad leader. False outside of squads
+	UFUNCTION(BlueprintCallable, Category=AI)
+	bool GetSquadFormationLocation(FVector& OutLocation) const;
+
 	// Function enabling AI states updating
 	UFUNCTION(BlueprintCallable, Category=AI)
-	void ClearActiveInterruptibleAction() { bActiveInterruptibleAction = false; }
+	void ClearActiveInterruptibleAction();
+
+	// Called by the interrupt watcher once any interrupt variant of the active interruptible action passes
+	void OnInterruptWatcherFired();
+
+	// Getter function retrieving watcher of the active interruptible action
+	FAIStatesInterruptWatcher& GetInterruptWatcher() { return InterruptWatcher; }
+	const FAIStatesInterruptWatcher& GetInterruptWatcher() const { return InterruptWatcher; }
+
+	// Getter function retrieving name of the current state, none without states set
+	FName GetCurrentStateName() const;
+
+	// Getter function retrieving name of the running action, the approach while it runs, otherwise the ability activated last
+	FString GetActiveActionName() const;
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	// Getter function retrieving last debug events, drawn by the debug overlay of AI states subsystem
+	const FAIStatesDebugRing& GetDebugRing() const { return DebugRing; }
+#endif
 
 	// Getter function retrieving available abilities
 	UFUNCTION(BlueprintCallable, Category=AI)
 	bool GetWeightedAbility_STATES(TSubclassOf<ULyraGameplayAbility>& OutAbilityClass);
 
+	// Picks ability of the current state among activatable ones by their weights without activating it, nullptr if none can be activated
+	FAIStateActionData* PickCurrentStateAbility(float& OutProbability);
+
 	// Getter function retrieving ready ability by its weight
 	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category=AI)
 	bool GetActivatableAbilityByWeight(const FGameplayTagContainer& AbilityTags, AActor* Target, bool bCheckAffection, FGameplayTag AlwaysCheckAffectionForTag, TSubclassOf<ULyraGameplayAbility>& OutAbility) const;
 	
 	bool GetWeightedAbility(const TArray<TSubclassOf<ULyraGameplayAbility>>& Abilities, TSubclassOf<ULyraGameplayAbility>& OutAbilityClass) const;
-	const TArray<FAIStateRuntimeData>& GetAIStatesData() const { return AIStates ;}
+	const TArray<FAIStateRuntimeData>& GetAIStatesData() const;
+	UAIStatesSet* GetAIStatesSetConfig() const { return AIStatesSetConfig.Get(); }
 	bool SetupAIStatesFromConfig();
 	void StartApproachingTarget();
 
+	// Getter function retrieving last weighted decisions of this controller together with seed of its random stream
+	const FAIStatesDecisionTrace& GetDecisionTrace() const { return DecisionTrace; }
+
+	// Picks candidate of the decision by the next roll of the decision random stream and traces the pick, INDEX_NONE if there is nothing to pick.
+	// Every roll of the stream goes through here, so a trace accounts for the whole sequence of its seed
+	int32 PickDecision(FAIStatesDecision& Decision) const;
+
+	// Runs environment query of the last activated ability through the EQS cache of the AI states subsystem, picking location by its distribution.
+	// False if the ability has no query
+	UFUNCTION(BlueprintCallable, Category=AI)
+	bool RunActiveAbilityQuery(const FAIStatesEQSQueryFinished& OnQueryFinished);
+
+	// Getter function retrieving index of this controller in the match, stable across runs spawning bots in the same order
+	int32 GetDecisionControllerIndex() const { return DecisionControllerIndex; }
+
+	// Getter function retrieving heap memory of AI states data owned by this controller, shared states set data excluded
+	SIZE_T GetAIStatesAllocatedSize() const;
+
+	// Getter function retrieving game thread time this controller spent evaluating states
+	const FAIStatesEvaluationTiming& GetEvaluationTiming() const { return EvaluationTiming; }
+
+	// Handle of the agent registered for this controller in the AI states subsystem, stale while not registered
+	FAIStatesAgentHandle GetAgentHandle() const { return AgentHandle; }
+	void SetAgentHandle(FAIStatesAgentHandle InAgentHandle) { AgentHandle = InAgentHandle; }
+
+	// Stores line of sight result traced by the AI states subsystem line of sight queue
+	void OnLineOfSightResult(const AActor* Target, float TraceSphereRadius, bool bHasLineOfSight, double WorldTime) const;
+
 protected:
 
 	// Helper function determining if there is a line of sight from one location to another
 	UFUNCTION(BlueprintCallable, meta = (AutoCreateRefTerm = "ActorsToIgnore"))
 	bool HasLineOfSightToLocation(const FVector& FromLocation, const FVector& ToLocation, const TArray<AActor*>& ActorsToIgnore, float TraceSphereRadius = 30.f) const;
 
-	// Helper function determining if there is a line of sight from one location to target actor
+	// Helper function determining if there is a line of sight from one location to target actor.
+	// Results from the pawn are cached per target, expired results are served while their refresh is traced asynchronously.
+	// Non-zero ViewPoint sweeps right away
 	UFUNCTION(BlueprintCallable)
 	bool HasLineOfSightToActor(AActor* Other, FVector ViewPoint = FVector::ZeroVector, float TraceSphereRadius = 30.f) const;
 
-	// Helper function determining if there is any path on navmesh from one location to another
+	// Helper function determining if there is any path on navmesh from one location to another. Recent results of nearby segments are served from the reachability cache
 	UFUNCTION(BlueprintCallable)
 	bool HasDirectNavPathToLocation(const FVector& FromLocation, const FVector& ToLocation, float OffsetFromTarget = 0.f) const;
 
@@ -103,8 +212,59 @@ protected:
 	UFUNCTION(BlueprintCallable)
 	bool HasDirectNavPathToActor(const AActor* Other, float OffsetFromTarget = 0.f) const;
 
+public:
+
+	// Non-blocking direct navmesh path query from this controller to other actor for conditions and decorators. Unknown until the first batched raycast finishes
+	UFUNCTION(BlueprintCallable, Category=AI)
+	EAIStatesReachability QueryDirectNavPathToActor(const AActor* Other, float OffsetFromTarget = 0.f) const;
+
+	// Non-blocking direct navmesh path query between two locations. Unknown until the first batched raycast finishes
+	UFUNCTION(BlueprintCallable, Category=AI)
+	EAIStatesReachability QueryDirectNavPathToLocation(const FVector& FromLocation, const FVector& ToLocation, float OffsetFromTarget = 0.f) const;
+
+protected:
+
+	// Resolves blackboard key ids of the key names
+	virtual bool InitializeBlackboard(UBlackboardComponent& BlackboardComp, UBlackboardData& BlackboardAsset) override;
+
 	UFUNCTION()
 	void OnDeathStarted();
+
+	// Reports sight and hearing stimuli of the perception component to the perception memory of the team
+	UFUNCTION()
+	void OnTargetPerceptionUpdated(AActor* Actor, FAIStimulus Stimulus);
+
+	// Evaluates entry conditions of state with given index using selected evaluation path
+	bool AreStateConditionsMet(int32 StateIndex, EAIStatesConditionEvaluationMode EvaluationMode, FAIStatesEvaluationContext& EvaluationContext);
+
+	// Subscribes to tag and attribute changes of given ability system component read by state conditions
+	void BindStateDependencies(UAbilitySystemComponent* ASC, bool bTarget);
+
+	// Removes subscriptions made by BindStateDependencies
+	void UnbindStateDependencies(bool bTarget);
+
+	void OnStateDependencyTagChanged(const FGameplayTag Tag, int32 NewCount, bool bFromTarget);
+	void OnStateDependencyAttributeChanged(const FOnAttributeChangeData& ChangeData, bool bFromTarget);
+
+	// Switches current state, blocking the previous one if it blocks on exit
+	void EnterState(int32 StateIndex);
+
+	// Takes target and state published by the squad leader if they pass conditions of this member. False if the controller evaluates states itself
+	bool FollowSquadIntent();
+
+	// Adds decision made in the current state to the decision trace
+	void RecordDecision(const FAIStatesDecision& Decision) const;
+
+	bool IsStateBlocked(int32 StateIndex) const { return BlockedStates.IsValidIndex(StateIndex) && BlockedStates[StateIndex]; }
+
+	// Getter function retrieving blackboard key ids resolved from the key names
+	const FAIStatesBlackboardKeys& GetBlackboardKeys() const { return BlackboardKeys; }
+
+	// Getter function retrieving blackboard writer, batching writes made during a state update
+	FAIStatesBlackboardWriter& GetBlackboardWriter() { return BlackboardWriter; }
+
+	// Forces re-evaluation of every state in the next update
+	void MarkAllStatesDirty() { DirtyStates.SetRange(0, DirtyStates.Num(), true); }
 	
 	virtual void OnPossess(APawn* InPawn) override;
 
@@ -134,12 +294,23 @@ public:
 	UPROPERTY(EditAnywhere, Category = Blackboard)
 	FName ShouldOrbitKeyName;
 	//
+
+	// Time between state evaluations of this controller. Zero or less uses update rate from AIStatesSetConfig
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = AI)
+	float AIStatesUpdateIntervalOverride = 0.0f;
 	
 	FApproachTargetData DefaultApproachTargetData;
 	FApproachTargetData CurrentAbilityApproachTargetData;
 
 	FApproachTargetAbility DefaultApproachAbility;
 
+	// Interrupt data of the current approach owned by the states set, watched instead of the uncompiled copy in DefaultApproachAbility
+	const FAIInterruptibleActionData* CurrentApproachInterruptibleData = nullptr;
+
+	// Broadcast once interrupt conditions of the active interruptible action pass, after its ability was cancelled
+	UPROPERTY(BlueprintAssignable)
+	FOnActiveAbilityInterruptedSignature OnActiveAbilityInterrupted;
+
 	// Debug variables
 	UFUNCTION(BlueprintCallable)
 	void BroadcastOnInterruptibleAbilityUpdate_Debug(const FName& Text);
@@ -152,25 +323,80 @@ public:
 	
 	UPROPERTY(BlueprintAssignable)
 	FOnChangedActiveAbilityStateSignature_Debug OnInterruptibleAbilityUpdate_Debug;
-	
-	UPROPERTY(EditAnywhere)
-	TSubclassOf<UUserWidget> PerAIWidgetClass_Debug;
 	//
 
 private:
 
-	UPROPERTY()
-	TArray<FAIStateRuntimeData> AIStates;
-
 	UPROPERTY()
 	TWeakObjectPtr<UAIStatesSet> AIStatesSetConfig;
 
-	FTimerHandle UpdateAIStateTimerHandle;
 	// Debug variables
 	FName PreviousState_Debug;
 	FName PreviousAbility_Debug;
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	FAIStatesDebugRing DebugRing;
+
+	// Adds event to the debug ring while lyra.aistates.debug is on
+	void RecordDebugEvent(EAIStatesDebugEvent Event, FName Name, float Probability);
+#endif
 	//
 	int CurrentAIStateIndex = 0;
 	bool bActiveInterruptibleAction = false;
 	bool bStatesUpdateRequested = false;
+
+	// States blocked after being exited, one bit per state. Everything else about states is shared through AIStatesSetConfig
+	TBitArray<> BlockedStates;
+
+	// States which inputs changed since their last evaluation, one bit per state
+	TBitArray<> DirtyStates;
+
+	// Result of the last condition evaluation per state
+	TBitArray<> CachedStateAvailability;
+
+	// Ability system components which tag and attribute changes mark states dirty
+	TWeakObjectPtr<UAbilitySystemComponent> DependencySelfASC;
+	TWeakObjectPtr<UAbilitySystemComponent> DependencyTargetASC;
+
+	FAIStatesBlackboardKeys BlackboardKeys;
+	FAIStatesBlackboardWriter BlackboardWriter;
+
+	// Time of the last team sensing given to the search location, older memories are not searched again
+	double SearchedSensedTime = -1.0;
+
+	// World time at which states with distance conditions are re-evaluated
+	double NextDistanceStatesUpdateTime = 0.0;
+
+	// Random stream of every roll of the controller, drawn only through PickDecision so decisions can be reproduced
+	FRandomStream DecisionRandomStream;
+
+	// Index given by AI states subsystem on the first setup, seeds the random stream together with the match seed
+	int32 DecisionControllerIndex = INDEX_NONE;
+
+	// Ability activated last by GetWeightedAbility_STATES, points into AIStatesSetConfig
+	const FAIStateActionData* ActiveAbilityData = nullptr;
+
+	// Ability tag of the active interruptible action, cancelled once its interrupt conditions pass
+	FGameplayTag ActiveInterruptibleAbilityTag;
+
+	// Watches interrupt conditions of the active interruptible action, armed on its activation
+	FAIStatesInterruptWatcher InterruptWatcher;
+
+	// Last state and ability decisions, replayable against the states set. Mutable as rolls of const getters are traced too
+	mutable FAIStatesDecisionTrace DecisionTrace;
+
+	// Line of sight results to targets, filled by the line of sight queue of the AI states subsystem
+	mutable FAIStatesLineOfSightCache LineOfSightCache;
+
+	// Handle into agents of the AI states subsystem, set on registration
+	FAIStatesAgentHandle AgentHandle;
+
+	// Game thread time of state evaluations, worker thread time of parallel evaluation excluded
+	FAIStatesEvaluationTiming EvaluationTiming;
+
+	// Insights scope name of state evaluations of this controller, controller name followed by its states set
+	FString AIStatesTraceName;
+
+	// Last significance from the significance manager and level of detail tier picked for it
+	float Significance = 0.0f;
+	int32 SignificanceTier = 0;
 };
@@ -0,0 +1,120 @@
+#include "AIStatesAgentRegistry.h"
+
+#include "AbilitySystemComponent.h"
+#include "AI/AIStateController.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesAgentRegistry)
+
+FAIStatesAgentHandle FAIStatesAgentRegistry::Add(UAbilitySystemComponent* ASC, AAIStateController* Controller, FGenericTeamId Team, const FVector& Location, int32 SpatialAgentId)
+{
+	int32 Slot = INDEX_NONE;
+	if(FreeSlots.IsEmpty() == false)
+	{
+		Slot = FreeSlots.Pop(false);
+	}
+	else
+	{
+		Slot = SlotDenseIndexes.Add(INDEX_NONE);
+		SlotGenerations.Add(0);
+	}
+
+	const int32 DenseIndex = AbilitySystemComponents.Add(ASC);
+	Controllers.Add(Controller);
+	Teams.Add(Team);
+	Locations.Add(Location);
+	SpatialAgentIds.Add(SpatialAgentId);
+	DenseSlots.Add(Slot);
+
+	SlotDenseIndexes[Slot] = DenseIndex;
+	return { Slot, SlotGenerations[Slot] };
+}
+
+bool FAIStatesAgentRegistry::Remove(FAIStatesAgentHandle Handle)
+{
+	const int32 DenseIndex = GetDenseIndex(Handle);
+	if(DenseIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// The last agent takes the dense index of the removed one, so columns stay packed
+	const int32 LastIndex = Num() - 1;
+	if(DenseIndex != LastIndex)
+	{
+		SwapDense(DenseIndex, LastIndex);
+	}
+
+	AbilitySystemComponents.Pop(false);
+	Controllers.Pop(false);
+	Teams.Pop(false);
+	Locations.Pop(false);
+	SpatialAgentIds.Pop(false);
+	DenseSlots.Pop(false);
+
+	// New generation makes every handle to the slot stale
+	SlotDenseIndexes[Handle.Slot] = INDEX_NONE;
+	SlotGenerations[Handle.Slot]++;
+	FreeSlots.Add(Handle.Slot);
+
+	return true;
+}
+
+void FAIStatesAgentRegistry::SwapDense(int32 A, int32 B)
+{
+	AbilitySystemComponents.Swap(A, B);
+	Controllers.Swap(A, B);
+	Teams.Swap(A, B);
+	Locations.Swap(A, B);
+	SpatialAgentIds.Swap(A, B);
+	DenseSlots.Swap(A, B);
+
+	SlotDenseIndexes[DenseSlots[A]] = A;
+	SlotDenseIndexes[DenseSlots[B]] = B;
+}
+
+void FAIStatesAgentRegistry::Reset()
+{
+	AbilitySystemComponents.Reset();
+	Controllers.Reset();
+	Teams.Reset();
+	Locations.Reset();
+	SpatialAgentIds.Reset();
+	DenseSlots.Reset();
+
+	// Generations are kept, handles given out before the reset stay stale
+	FreeSlots.Reset();
+	for(int32 Slot = SlotDenseIndexes.Num() - 1; Slot >= 0; Slot--)
+	{
+		SlotDenseIndexes[Slot] = INDEX_NONE;
+		SlotGenerations[Slot]++;
+		FreeSlots.Add(Slot);
+	}
+}
+
+int32 FAIStatesAgentRegistry::GetDenseIndex(FAIStatesAgentHandle Handle) const
+{
+	if(SlotDenseIndexes.IsValidIndex(Handle.Slot) == false || SlotGenerations[Handle.Slot] != Handle.Generation)
+	{
+		return INDEX_NONE;
+	}
+
+	return SlotDenseIndexes[Handle.Slot];
+}
+
+FAIStatesAgentHandle FAIStatesAgentRegistry::GetHandle(int32 DenseIndex) const
+{
+	if(DenseSlots.IsValidIndex(DenseIndex) == false)
+	{
+		return FAIStatesAgentHandle();
+	}
+
+	const int32 Slot = DenseSlots[DenseIndex];
+	return { Slot, SlotGenerations[Slot] };
+}
+
+SIZE_T FAIStatesAgentRegistry::GetAllocatedSize() const
+{
+	return AbilitySystemComponents.GetAllocatedSize() + Controllers.GetAllocatedSize() + Teams.GetAllocatedSize()
+		+ Locations.GetAllocatedSize() + SpatialAgentIds.GetAllocatedSize() + DenseSlots.GetAllocatedSize() + SlotDenseIndexes.GetAllocatedSize()
+		+ SlotGenerations.GetAllocatedSize() + FreeSlots.GetAllocatedSize();
+}
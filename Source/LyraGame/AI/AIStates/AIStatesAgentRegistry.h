@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericTeamAgentInterface.h"
+
+#include "AIStatesAgentRegistry.generated.h"
+
+class AAIStateController;
+class UAbilitySystemComponent;
+
+// Stable handle of a registered agent. Handles of removed agents never match agents registered later into the same slot
+struct FAIStatesAgentHandle
+{
+	int32 Slot = INDEX_NONE;
+	uint32 Generation = 0;
+
+	bool IsSet() const { return Slot != INDEX_NONE; }
+
+	bool operator==(const FAIStatesAgentHandle& Other) const { return Slot == Other.Slot && Generation == Other.Generation; }
+
+	friend uint32 GetTypeHash(const FAIStatesAgentHandle& Handle) { return HashCombine(GetTypeHash(Handle.Slot), GetTypeHash(Handle.Generation)); }
+};
+
+/**
+ * FAIStatesAgentRegistry
+ *
+ *	Generational sparse set of registered AI agents. Agents are added and removed in constant time and stay densely
+ *	packed, so per agent columns are iterated over contiguous memory. Removing an agent moves the last agent into its
+ *	dense index, handles stay valid.
+ */
+USTRUCT()
+struct LYRAGAME_API FAIStatesAgentRegistry
+{
+	GENERATED_BODY()
+
+	FAIStatesAgentHandle Add(UAbilitySystemComponent* ASC, AAIStateController* Controller, FGenericTeamId Team, const FVector& Location, int32 SpatialAgentId);
+
+	// Removes agent of the handle, false if the handle is stale
+	bool Remove(FAIStatesAgentHandle Handle);
+
+	void Reset();
+
+	bool IsValid(FAIStatesAgentHandle Handle) const { return GetDenseIndex(Handle) != INDEX_NONE; }
+
+	// Dense index of the handle agent, INDEX_NONE if the handle is stale. Only valid until the next removal
+	int32 GetDenseIndex(FAIStatesAgentHandle Handle) const;
+
+	FAIStatesAgentHandle GetHandle(int32 DenseIndex) const;
+
+	int32 Num() const { return AbilitySystemComponents.Num(); }
+
+	// Columns indexed by dense index
+	const TArray<TObjectPtr<UAbilitySystemComponent>>& GetAbilitySystemComponents() const { return AbilitySystemComponents; }
+	const TArray<TWeakObjectPtr<AAIStateController>>& GetControllers() const { return Controllers; }
+	const TArray<FGenericTeamId>& GetTeams() const { return Teams; }
+	const TArray<FVector>& GetLocations() const { return Locations; }
+	const TArray<int32>& GetSpatialAgentIds() const { return SpatialAgentIds; }
+
+	void SetTeam(int32 DenseIndex, FGenericTeamId Team) { Teams[DenseIndex] = Team; }
+	void SetLocation(int32 DenseIndex, const FVector& Location) { Locations[DenseIndex] = Location; }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	// Swaps column entries at dense indexes A and B
+	void SwapDense(int32 A, int32 B);
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UAbilitySystemComponent>> AbilitySystemComponents;
+
+	TArray<TWeakObjectPtr<AAIStateController>> Controllers;
+	TArray<FGenericTeamId> Teams;
+
+	// Avatar locations, refreshed once per tick by the subsystem
+	TArray<FVector> Locations;
+
+	// Ids of agents in the spatial grid, INDEX_NONE if not in the grid
+	TArray<int32> SpatialAgentIds;
+
+	// Slot of every dense index
+	TArray<int32> DenseSlots;
+
+	// Dense index and generation of every slot, dense index is INDEX_NONE for free slots
+	TArray<int32> SlotDenseIndexes;
+	TArray<uint32> SlotGenerations;
+
+	TArray<int32> FreeSlots;
+};
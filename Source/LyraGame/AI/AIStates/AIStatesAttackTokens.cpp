@@ -0,0 +1,223 @@
+#include "AIStatesAttackTokens.h"
+
+#include "AIStatesSettings.h"
+#include "AIStatesStats.h"
+#include "AI/AIStateController.h"
+#include "Algo/BinarySearch.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attack Tokens Granted"), STAT_AIStates_AttackTokensGranted, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Attack Tokens Preempted"), STAT_AIStates_AttackTokensPreempted, STATGROUP_AIStates);
+
+void FAIStatesAttackTokenArbiter::Request(const AAIStateController& Controller, const AActor& Target, float Threat, double WorldTime)
+{
+	const FObjectKey ControllerKey(&Controller);
+	const FObjectKey TargetKey(&Target);
+
+	if(const FObjectKey* HeldTarget = HeldTokens.Find(ControllerKey))
+	{
+		if(*HeldTarget == TargetKey)
+		{
+			FAIStatesAttackTokenHolder* Holder = Targets[TargetKey].Holders.FindByPredicate([&Controller](const FAIStatesAttackTokenHolder& TokenHolder)
+			{
+				return TokenHolder.Controller.Get() == &Controller;
+			});
+			if(Holder)
+			{
+				Holder->Threat = Threat;
+				Holder->RequestTime = WorldTime;
+			}
+			return;
+		}
+
+		Release(Controller);
+	}
+
+	const FObjectKey* RequestedTarget = RequestedTokens.Find(ControllerKey);
+	if(RequestedTarget && *RequestedTarget != TargetKey)
+	{
+		Release(Controller);
+	}
+
+	FAIStatesTargetAttackTokens& TargetTokens = Targets.FindOrAdd(TargetKey);
+	TargetTokens.Target = &Target;
+	TargetTokens.Requests.Add(ControllerKey, { &Controller, Threat, WorldTime });
+	RequestedTokens.Add(ControllerKey, TargetKey);
+}
+
+bool FAIStatesAttackTokenArbiter::HasToken(const AAIStateController& Controller, const AActor* Target) const
+{
+	const FObjectKey* HeldTarget = HeldTokens.Find(FObjectKey(&Controller));
+	return HeldTarget && (Target == nullptr || *HeldTarget == FObjectKey(Target));
+}
+
+void FAIStatesAttackTokenArbiter::Release(const AAIStateController& Controller)
+{
+	const FObjectKey ControllerKey(&Controller);
+
+	FObjectKey TargetKey;
+	if(HeldTokens.RemoveAndCopyValue(ControllerKey, TargetKey))
+	{
+		if(FAIStatesTargetAttackTokens* TargetTokens = Targets.Find(TargetKey))
+		{
+			TargetTokens->Holders.RemoveAllSwap([&Controller](const FAIStatesAttackTokenHolder& Holder)
+			{
+				return Holder.Controller.Get() == &Controller;
+			});
+		}
+	}
+
+	if(RequestedTokens.RemoveAndCopyValue(ControllerKey, TargetKey))
+	{
+		if(FAIStatesTargetAttackTokens* TargetTokens = Targets.Find(TargetKey))
+		{
+			TargetTokens->Requests.Remove(ControllerKey);
+		}
+	}
+}
+
+void FAIStatesAttackTokenArbiter::SetNumTokens(const AActor& Target, int32 NumTokens)
+{
+	FAIStatesTargetAttackTokens& TargetTokens = Targets.FindOrAdd(FObjectKey(&Target));
+	TargetTokens.Target = &Target;
+	TargetTokens.NumTokens = NumTokens;
+}
+
+float FAIStatesAttackTokenArbiter::CalculatePriority(const AAIStateController& Controller, const AActor& Target, float Threat)
+{
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	const APawn* Pawn = Controller.GetPawn();
+	const float Distance = Pawn ? FVector::Dist(Pawn->GetActorLocation(), Target.GetActorLocation()) : Settings->AttackTokenMaxDistance;
+
+	return Settings->AttackTokenDistanceWeight * (1.0f - FMath::Clamp(Distance / Settings->AttackTokenMaxDistance, 0.0f, 1.0f))
+		+ Settings->AttackTokenThreatWeight * Threat;
+}
+
+float FAIStatesAttackTokenArbiter::GetRequestTimeout(const AAIStateController& Controller)
+{
+	return UAIStatesSettings::Get()->AttackTokenRequestTimeout + Controller.GetAIStatesUpdateInterval();
+}
+
+void FAIStatesAttackTokenArbiter::ReleaseHolder(FAIStatesTargetAttackTokens& TargetTokens, int32 HolderIndex)
+{
+	HeldTokens.Remove(FObjectKey(TargetTokens.Holders[HolderIndex].Controller));
+	TargetTokens.Holders.RemoveAtSwap(HolderIndex, 1, false);
+}
+
+void FAIStatesAttackTokenArbiter::Arbitrate(double WorldTime)
+{
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+
+	TArray<FAIStatesAttackTokenHolder, TInlineAllocator<16>> Candidates;
+	for(auto TargetIt = Targets.CreateIterator(); TargetIt; ++TargetIt)
+	{
+		FAIStatesTargetAttackTokens& TargetTokens = TargetIt->Value;
+		const AActor* Target = TargetTokens.Target.Get();
+
+		// Tokens of destroyed targets go back to nobody
+		if(Target == nullptr)
+		{
+			for(int32 HolderIndex = TargetTokens.Holders.Num() - 1; HolderIndex >= 0; HolderIndex--)
+			{
+				ReleaseHolder(TargetTokens, HolderIndex);
+			}
+			for(const TPair<FObjectKey, FAIStatesAttackTokenRequest>& Request : TargetTokens.Requests)
+			{
+				RequestedTokens.Remove(Request.Key);
+			}
+			TargetIt.RemoveCurrent();
+			continue;
+		}
+
+		// Holders which stopped asking or held the token too long lose it, the timed out ones have to ask again
+		for(int32 HolderIndex = TargetTokens.Holders.Num() - 1; HolderIndex >= 0; HolderIndex--)
+		{
+			FAIStatesAttackTokenHolder& Holder = TargetTokens.Holders[HolderIndex];
+			const AAIStateController* HolderController = Holder.Controller.Get();
+			if(HolderController == nullptr || WorldTime - Holder.RequestTime > GetRequestTimeout(*HolderController)
+				|| WorldTime - Holder.GrantTime > Settings->AttackTokenMaxHoldTime)
+			{
+				ReleaseHolder(TargetTokens, HolderIndex);
+				continue;
+			}
+
+			Holder.Priority = CalculatePriority(*HolderController, *Target, Holder.Threat);
+		}
+
+		Candidates.Reset();
+		for(auto RequestIt = TargetTokens.Requests.CreateIterator(); RequestIt; ++RequestIt)
+		{
+			const FAIStatesAttackTokenRequest& Request = RequestIt->Value;
+			const AAIStateController* RequestController = Request.Controller.Get();
+			if(RequestController == nullptr || WorldTime - Request.RequestTime > GetRequestTimeout(*RequestController))
+			{
+				RequestedTokens.Remove(RequestIt->Key);
+				RequestIt.RemoveCurrent();
+				continue;
+			}
+
+			Candidates.Add({ Request.Controller, Request.Threat, CalculatePriority(*RequestController, *Target, Request.Threat), WorldTime, Request.RequestTime });
+		}
+
+		if(Candidates.IsEmpty() && TargetTokens.Holders.IsEmpty() && TargetTokens.NumTokens == INDEX_NONE)
+		{
+			TargetIt.RemoveCurrent();
+			continue;
+		}
+
+		const int32 NumTokens = FMath::Max(TargetTokens.NumTokens != INDEX_NONE ? TargetTokens.NumTokens : Settings->AttackTokensPerTarget, 0);
+
+		// Weakest holders first, best candidates last
+		auto ByPriority = [](const FAIStatesAttackTokenHolder& A, const FAIStatesAttackTokenHolder& B) { return A.Priority < B.Priority; };
+		TargetTokens.Holders.Sort(ByPriority);
+		Candidates.Sort(ByPriority);
+
+		while(TargetTokens.Holders.Num() > NumTokens)
+		{
+			ReleaseHolder(TargetTokens, 0);
+			TargetTokens.Holders.Sort(ByPriority);
+		}
+
+		while(Candidates.Num() > 0)
+		{
+			const FAIStatesAttackTokenHolder& BestCandidate = Candidates.Last();
+			if(TargetTokens.Holders.Num() >= NumTokens)
+			{
+				// Full target only gives the token of its weakest holder to a clearly better candidate
+				if(TargetTokens.Holders.IsEmpty() || BestCandidate.Priority <= TargetTokens.Holders[0].Priority + Settings->AttackTokenPreemptionMargin)
+				{
+					break;
+				}
+
+				const FAIStatesAttackTokenHolder& PreemptedHolder = TargetTokens.Holders[0];
+				TargetTokens.Requests.Add(FObjectKey(PreemptedHolder.Controller), { PreemptedHolder.Controller, PreemptedHolder.Threat, PreemptedHolder.RequestTime });
+				RequestedTokens.Add(FObjectKey(PreemptedHolder.Controller), TargetIt->Key);
+				HeldTokens.Remove(FObjectKey(PreemptedHolder.Controller));
+				TargetTokens.Holders.RemoveAt(0, 1, false);
+				INC_DWORD_STAT(STAT_AIStates_AttackTokensPreempted);
+			}
+
+			const FObjectKey CandidateKey(BestCandidate.Controller);
+			TargetTokens.Requests.Remove(CandidateKey);
+			RequestedTokens.Remove(CandidateKey);
+			HeldTokens.Add(CandidateKey, TargetIt->Key);
+
+			const int32 InsertIndex = Algo::UpperBound(TargetTokens.Holders, BestCandidate, ByPriority);
+			TargetTokens.Holders.Insert(BestCandidate, InsertIndex);
+			Candidates.Pop(false);
+			INC_DWORD_STAT(STAT_AIStates_AttackTokensGranted);
+		}
+	}
+}
+
+void FAIStatesAttackTokenArbiter::Reset()
+{
+	Targets.Reset();
+	HeldTokens.Reset();
+	RequestedTokens.Reset();
+}
+
+int32 FAIStatesAttackTokenArbiter::GetNumHolders(const AActor& Target) const
+{
+	const FAIStatesTargetAttackTokens* TargetTokens = Targets.Find(FObjectKey(&Target));
+	return TargetTokens ? TargetTokens->Holders.Num() : 0;
+}
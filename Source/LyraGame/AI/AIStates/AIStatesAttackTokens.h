@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+class AAIStateController;
+
+// Pending request of a controller for an attack token of a target
+struct FAIStatesAttackTokenRequest
+{
+	TWeakObjectPtr<const AAIStateController> Controller;
+
+	// Threat reported by the requesting controller, added to its priority
+	float Threat = 0.0f;
+
+	// World time of the last request, controllers which stop asking drop out
+	double RequestTime = 0.0;
+};
+
+// Controller holding an attack token of a target
+struct FAIStatesAttackTokenHolder
+{
+	TWeakObjectPtr<const AAIStateController> Controller;
+	float Threat = 0.0f;
+
+	// Priority computed in the last arbitration
+	float Priority = 0.0f;
+
+	double GrantTime = 0.0;
+	double RequestTime = 0.0;
+};
+
+// Attack tokens of a single target
+struct FAIStatesTargetAttackTokens
+{
+	TWeakObjectPtr<const AActor> Target;
+
+	// Number of tokens of this target, INDEX_NONE uses AttackTokensPerTarget from AI states settings
+	int32 NumTokens = INDEX_NONE;
+
+	TArray<FAIStatesAttackTokenHolder> Holders;
+
+	// Requests of controllers not holding a token, by controller
+	TMap<FObjectKey, FAIStatesAttackTokenRequest> Requests;
+};
+
+/**
+ * FAIStatesAttackTokenArbiter
+ *
+ *	Hands out a fixed number of attack tokens per target. Controllers only ask for a token, tokens are granted in a single
+ *	arbitration pass by priority from distance and threat, so bots seeing a free slot in the same tick can't all take it.
+ *	Holders which stop asking or hold a token too long lose it, better candidates preempt the weakest holder.
+ */
+class LYRAGAME_API FAIStatesAttackTokenArbiter
+{
+public:
+
+	// Asks for a token of the target or renews the held one. Asking for another target releases the held token
+	void Request(const AAIStateController& Controller, const AActor& Target, float Threat, double WorldTime);
+
+	// True if controller holds a token of the target, or of any target if Target is nullptr
+	bool HasToken(const AAIStateController& Controller, const AActor* Target = nullptr) const;
+
+	// Releases token and request of the controller
+	void Release(const AAIStateController& Controller);
+
+	// Changes number of tokens of the target, INDEX_NONE restores the default. Surplus holders are released by the next arbitration
+	void SetNumTokens(const AActor& Target, int32 NumTokens);
+
+	// Drops expired holders and requests, then grants free tokens and preempts weaker holders
+	void Arbitrate(double WorldTime);
+
+	void Reset();
+
+	// Getter function retrieving number of controllers holding a token of the target
+	int32 GetNumHolders(const AActor& Target) const;
+
+private:
+
+	// Priority of a controller for a token of the target, closer and more threatening controllers first
+	static float CalculatePriority(const AAIStateController& Controller, const AActor& Target, float Threat);
+
+	// Time the controller may go without asking before its request or token is dropped, covers its evaluation interval
+	static float GetRequestTimeout(const AAIStateController& Controller);
+
+	void ReleaseHolder(FAIStatesTargetAttackTokens& TargetTokens, int32 HolderIndex);
+
+	TMap<FObjectKey, FAIStatesTargetAttackTokens> Targets;
+
+	// Target whose token each controller holds, by controller
+	TMap<FObjectKey, FObjectKey> HeldTokens;
+
+	// Target each controller without token asks for, by controller
+	TMap<FObjectKey, FObjectKey> RequestedTokens;
+};
@@ -0,0 +1,68 @@
+#include "AIStatesBenchmark.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesBenchmark)
+
+FString FAIStatesBenchmarkResult::GetCSVHeader()
+{
+	return TEXT("Bots,Frames,AvgGameThreadMs,PeakGameThreadMs,AvgAIStatesMs,PeakAIStatesMs,AvgAllocationsPerFrame,UsedPhysicalMB,Objects,BotsPerTier");
+}
+
+FString FAIStatesBenchmarkResult::ToCSVRow() const
+{
+	// Tiers share one column, separated by slashes
+	const FString TierPopulationString = FString::JoinBy(TierPopulation, TEXT("/"), [](int32 NumTierBots) { return FString::FromInt(NumTierBots); });
+	return FString::Printf(TEXT("%d,%d,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%d,%s"), NumBots, NumFrames, AverageGameThreadMs, PeakGameThreadMs,
+		AverageAIStatesMs, PeakAIStatesMs, AverageAllocations, UsedPhysicalMemory / (1024.0 * 1024.0), NumObjects, *TierPopulationString);
+}
+
+bool FAIStatesBenchmarkResult::IsWithinBudget(const FAIStatesBenchmarkBudget& Budget, TArray<FString>& OutErrors) const
+{
+	bool bWithinBudget = true;
+
+	if(Budget.MaxGameThreadMs > 0.0f && AverageGameThreadMs > Budget.MaxGameThreadMs)
+	{
+		OutErrors.Add(FString::Printf(TEXT("%d bots: game thread %.3f ms is over budget %.3f ms"), NumBots, AverageGameThreadMs, Budget.MaxGameThreadMs));
+		bWithinBudget = false;
+	}
+
+	if(Budget.MaxAIStatesMs > 0.0f && AverageAIStatesMs > Budget.MaxAIStatesMs)
+	{
+		OutErrors.Add(FString::Printf(TEXT("%d bots: AI states %.3f ms is over budget %.3f ms"), NumBots, AverageAIStatesMs, Budget.MaxAIStatesMs));
+		bWithinBudget = false;
+	}
+
+	return bWithinBudget;
+}
+
+void FAIStatesBenchmarkRecorder::Start(int32 NumBots)
+{
+	Result = FAIStatesBenchmarkResult();
+	Result.NumBots = NumBots;
+	TotalGameThreadMs = 0.0;
+	TotalAIStatesMs = 0.0;
+	TotalAllocations = 0;
+}
+
+void FAIStatesBenchmarkRecorder::AddFrame(double GameThreadMs, double AIStatesMs, uint64 NumAllocations)
+{
+	Result.NumFrames++;
+	Result.PeakGameThreadMs = FMath::Max(Result.PeakGameThreadMs, GameThreadMs);
+	Result.PeakAIStatesMs = FMath::Max(Result.PeakAIStatesMs, AIStatesMs);
+	TotalGameThreadMs += GameThreadMs;
+	TotalAIStatesMs += AIStatesMs;
+	TotalAllocations += NumAllocations;
+}
+
+FAIStatesBenchmarkResult FAIStatesBenchmarkRecorder::Finish(uint64 UsedPhysicalMemory, int32 NumObjects)
+{
+	if(Result.NumFrames > 0)
+	{
+		Result.AverageGameThreadMs = TotalGameThreadMs / Result.NumFrames;
+		Result.AverageAIStatesMs = TotalAIStatesMs / Result.NumFrames;
+		Result.AverageAllocations = static_cast<double>(TotalAllocations) / Result.NumFrames;
+	}
+
+	Result.UsedPhysicalMemory = UsedPhysicalMemory;
+	Result.NumObjects = NumObjects;
+	return Result;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "AIStatesBenchmark.generated.h"
+
+// Bot count run by the scalability benchmark together with frame times it must stay under
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FAIStatesBenchmarkBudget
+{
+	GENERATED_BODY()
+
+	// Number of bots spawned for this run
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 1))
+	int32 NumBots = 16;
+
+	// Highest average game thread time per frame. Zero disables the check
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0, Units = "ms"))
+	float MaxGameThreadMs = 0.0f;
+
+	// Highest average AI states subsystem time per frame. Zero disables the check
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0, Units = "ms"))
+	float MaxAIStatesMs = 0.0f;
+};
+
+// Frame times and memory measured by a single benchmark run
+struct LYRAGAME_API FAIStatesBenchmarkResult
+{
+	int32 NumBots = 0;
+	int32 NumFrames = 0;
+
+	double AverageGameThreadMs = 0.0;
+	double PeakGameThreadMs = 0.0;
+	double AverageAIStatesMs = 0.0;
+	double PeakAIStatesMs = 0.0;
+
+	// Heap allocations per frame, zero in builds without allocation counting
+	double AverageAllocations = 0.0;
+
+	uint64 UsedPhysicalMemory = 0;
+	int32 NumObjects = 0;
+
+	// Number of bots in every significance tier once the run finished, most significant first
+	TArray<int32> TierPopulation;
+
+	static FString GetCSVHeader();
+	FString ToCSVRow() const;
+
+	// False if an average frame time is over the budget, the reason is appended to OutErrors
+	bool IsWithinBudget(const FAIStatesBenchmarkBudget& Budget, TArray<FString>& OutErrors) const;
+};
+
+/**
+ * FAIStatesBenchmarkRecorder
+ *
+ *	Accumulates frame times of one benchmark run. Frames are added while the run measures,
+ *	memory is sampled once it finishes.
+ */
+class LYRAGAME_API FAIStatesBenchmarkRecorder
+{
+public:
+
+	void Start(int32 NumBots);
+
+	void AddFrame(double GameThreadMs, double AIStatesMs, uint64 NumAllocations);
+
+	FAIStatesBenchmarkResult Finish(uint64 UsedPhysicalMemory, int32 NumObjects);
+
+	int32 GetNumFrames() const { return Result.NumFrames; }
+
+private:
+
+	FAIStatesBenchmarkResult Result;
+
+	double TotalGameThreadMs = 0.0;
+	double TotalAIStatesMs = 0.0;
+	uint64 TotalAllocations = 0;
+};
@@ -0,0 +1,106 @@
+#include "AIStatesBlackboardWriter.h"
+
+#include "AIStatesStats.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blackboard Writes"), STAT_AIStates_BlackboardWrites, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Blackboard Commits"), STAT_AIStates_BlackboardCommits, STATGROUP_AIStates);
+
+void FAIStatesBlackboardWriter::SetValueAsObject(FBlackboard::FKey Key, UObject* Value)
+{
+	FAIStatesBlackboardWrite Write;
+	Write.Key = Key;
+	Write.Kind = FAIStatesBlackboardWrite::EKind::Object;
+	Write.Object = Value;
+	Stage(Write);
+}
+
+void FAIStatesBlackboardWriter::SetValueAsVector(FBlackboard::FKey Key, const FVector& Value)
+{
+	FAIStatesBlackboardWrite Write;
+	Write.Key = Key;
+	Write.Kind = FAIStatesBlackboardWrite::EKind::Vector;
+	Write.Vector = Value;
+	Stage(Write);
+}
+
+void FAIStatesBlackboardWriter::ClearValue(FBlackboard::FKey Key)
+{
+	FAIStatesBlackboardWrite Write;
+	Write.Key = Key;
+	Write.Kind = FAIStatesBlackboardWrite::EKind::Clear;
+	Stage(Write);
+}
+
+void FAIStatesBlackboardWriter::EndBatch()
+{
+	if(!ensureMsgf(BatchDepth > 0, TEXT("FAIStatesBlackboardWriter::EndBatch - No batch to end!")))
+	{
+		return;
+	}
+
+	if(--BatchDepth == 0)
+	{
+		Commit();
+	}
+}
+
+void FAIStatesBlackboardWriter::Stage(const FAIStatesBlackboardWrite& Write)
+{
+	// Keys missing in the blackboard asset resolve to invalid ids
+	if(Write.Key == FBlackboard::InvalidKey)
+	{
+		return;
+	}
+
+	FAIStatesBlackboardWrite* PendingWrite = PendingWrites.FindByPredicate([&Write](const FAIStatesBlackboardWrite& Other) { return Other.Key == Write.Key; });
+	if(PendingWrite)
+	{
+		*PendingWrite = Write;
+	}
+	else
+	{
+		PendingWrites.Add(Write);
+	}
+
+	if(IsInBatch() == false)
+	{
+		Commit();
+	}
+}
+
+void FAIStatesBlackboardWriter::Commit()
+{
+	UBlackboardComponent* BlackboardComp = Blackboard.Get();
+	if(BlackboardComp == nullptr || PendingWrites.IsEmpty())
+	{
+		PendingWrites.Reset();
+		return;
+	}
+
+	// Notifications queued while paused are sent once per key on resume
+	BlackboardComp->PauseObserverNotifications();
+	for(const FAIStatesBlackboardWrite& Write : PendingWrites)
+	{
+		switch(Write.Kind)
+		{
+		case FAIStatesBlackboardWrite::EKind::Object:
+			BlackboardComp->SetValue<UBlackboardKeyType_Object>(Write.Key, Write.Object.Get());
+			break;
+
+		case FAIStatesBlackboardWrite::EKind::Vector:
+			BlackboardComp->SetValue<UBlackboardKeyType_Vector>(Write.Key, Write.Vector);
+			break;
+
+		default:
+			BlackboardComp->ClearValue(Write.Key);
+			break;
+		}
+	}
+	BlackboardComp->ResumeObserverNotifications(true);
+
+	INC_DWORD_STAT_BY(STAT_AIStates_BlackboardWrites, PendingWrites.Num());
+	INC_DWORD_STAT(STAT_AIStates_BlackboardCommits);
+	PendingWrites.Reset();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BlackboardComponent.h"
+
+// Single blackboard write staged by FAIStatesBlackboardWriter
+struct FAIStatesBlackboardWrite
+{
+	enum class EKind : uint8
+	{
+		Object,
+		Vector,
+		Clear
+	};
+
+	FBlackboard::FKey Key = FBlackboard::InvalidKey;
+	EKind Kind = EKind::Clear;
+	TWeakObjectPtr<UObject> Object;
+	FVector Vector = FVector::ZeroVector;
+};
+
+/**
+ * FAIStatesBlackboardWriter
+ *
+ *	Writes of an AI state controller to its blackboard by key id. Writes made inside a batch are staged, the last write of
+ *	each key wins, and the outermost batch commits them together with observer notifications paused. Behavior tree
+ *	decorators observing the keys are notified once per changed key after every write is applied. Writes outside a
+ *	batch are committed right away.
+ */
+class LYRAGAME_API FAIStatesBlackboardWriter
+{
+public:
+
+	void SetBlackboard(UBlackboardComponent* InBlackboard) { Blackboard = InBlackboard; }
+
+	void SetValueAsObject(FBlackboard::FKey Key, UObject* Value);
+	void SetValueAsVector(FBlackboard::FKey Key, const FVector& Value);
+	void ClearValue(FBlackboard::FKey Key);
+
+	// Batches nest, only the outermost one commits
+	void BeginBatch() { BatchDepth++; }
+	void EndBatch();
+
+	bool IsInBatch() const { return BatchDepth > 0; }
+
+	int32 GetNumPendingWrites() const { return PendingWrites.Num(); }
+
+private:
+
+	void Stage(const FAIStatesBlackboardWrite& Write);
+
+	// Applies staged writes to the blackboard, dropped if there is none
+	void Commit();
+
+	TWeakObjectPtr<UBlackboardComponent> Blackboard;
+
+	// Writes staged by the current batch, one per key
+	TArray<FAIStatesBlackboardWrite, TInlineAllocator<4>> PendingWrites;
+
+	int32 BatchDepth = 0;
+};
+
+// Stages blackboard writes of its scope, committed once the outermost scope ends
+struct FAIStatesBlackboardBatchScope
+{
+	explicit FAIStatesBlackboardBatchScope(FAIStatesBlackboardWriter& InWriter) : Writer(InWriter) { Writer.BeginBatch(); }
+	~FAIStatesBlackboardBatchScope() { Writer.EndBatch(); }
+
+	UE_NONCOPYABLE(FAIStatesBlackboardBatchScope);
+
+private:
+
+	FAIStatesBlackboardWriter& Writer;
+};
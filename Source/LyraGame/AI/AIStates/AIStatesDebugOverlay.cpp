@@ -0,0 +1,180 @@
+#include "AIStatesDebugOverlay.h"
+
+#include "AIStatesStats.h"
+#include "AIStatesSubsystem.h"
+#include "AI/AIStateController.h"
+#include "Debug/DebugDrawService.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerController.h"
+#include "SceneView.h"
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+DECLARE_CYCLE_STAT(TEXT("Debug Overlay"), STAT_AIStates_DebugOverlay, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Debug Overlay Drawn Bots"), STAT_AIStates_DebugOverlayDrawnBots, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Debug Overlay Culled Bots"), STAT_AIStates_DebugOverlayCulledBots, STATGROUP_AIStates);
+
+namespace AIStatesDebugOverlay
+{
+	static TAutoConsoleVariable<float> CVarMaxDistance(
+		TEXT("lyra.aistates.debug.maxdistance"),
+		5000.0f,
+		TEXT("Distance from the view in centimeters beyond which the AI states debug overlay skips bots.\n"),
+		ECVF_Cheat);
+
+	// Height above the pawn origin the overlay text of a bot starts at
+	constexpr float TextHeightOffset = 120.0f;
+
+	// Current state or action of the controller, with pick probability while its record is still in the ring
+	FString DescribeCurrent(const FString& Name, const FAIStatesDebugRecord* Record)
+	{
+		if(Name.IsEmpty() || Name == TEXT("None"))
+		{
+			return TEXT("-");
+		}
+
+		return Record && Record->Name == FName(*Name) ? FString::Printf(TEXT("%s %d%%"), *Name, FMath::RoundToInt(Record->Probability * 100.0f)) : Name;
+	}
+}
+#endif
+
+void FAIStatesDebugRing::Add(const FAIStatesDebugRecord& Record)
+{
+	Records[NextIndex] = Record;
+	NextIndex = (NextIndex + 1) % Capacity;
+	NumRecords = FMath::Min(NumRecords + 1, Capacity);
+}
+
+const FAIStatesDebugRecord& FAIStatesDebugRing::GetNewest(int32 Age) const
+{
+	check(Age >= 0 && Age < NumRecords);
+	return Records[(NextIndex - 1 - Age + Capacity) % Capacity];
+}
+
+const FAIStatesDebugRecord* FAIStatesDebugRing::FindNewest(EAIStatesDebugEvent Event) const
+{
+	for(int32 Age = 0; Age < NumRecords; Age++)
+	{
+		const FAIStatesDebugRecord& Record = GetNewest(Age);
+		if(Record.Event == Event)
+		{
+			return &Record;
+		}
+	}
+
+	return nullptr;
+}
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+FAIStatesDebugOverlay::~FAIStatesDebugOverlay()
+{
+	Unregister();
+}
+
+void FAIStatesDebugOverlay::Register(UAIStatesSubsystem& InSubsystem)
+{
+	if(IsRegistered())
+	{
+		return;
+	}
+
+	Subsystem = &InSubsystem;
+	DrawHandle = UDebugDrawService::Register(TEXT("Game"), FDebugDrawDelegate::CreateRaw(this, &FAIStatesDebugOverlay::Draw));
+}
+
+void FAIStatesDebugOverlay::Unregister()
+{
+	if(IsRegistered())
+	{
+		UDebugDrawService::Unregister(DrawHandle);
+		DrawHandle.Reset();
+	}
+
+	Subsystem.Reset();
+}
+
+void FAIStatesDebugOverlay::Draw(UCanvas* Canvas, APlayerController* PlayerController)
+{
+	using namespace AIStatesDebugOverlay;
+
+	// Draw service is shared by every world, only viewports of the subsystem world are drawn into
+	const UAIStatesSubsystem* SubsystemPtr = Subsystem.Get();
+	if(SubsystemPtr == nullptr || Canvas == nullptr || PlayerController == nullptr || PlayerController->GetWorld() != SubsystemPtr->GetWorld() || GEngine == nullptr)
+	{
+		return;
+	}
+
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_DebugOverlay);
+
+	FVector ViewLocation;
+	if(Canvas->SceneView)
+	{
+		ViewLocation = Canvas->SceneView->ViewMatrices.GetViewOrigin();
+	}
+	else
+	{
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+	}
+
+	const double WorldTime = SubsystemPtr->GetWorld()->GetTimeSeconds();
+	const float MaxDistanceSquared = FMath::Square(CVarMaxDistance.GetValueOnGameThread());
+	UFont* Font = GEngine->GetSmallFont();
+	const float LineHeight = Font->GetMaxCharHeight();
+
+	const FAIStatesAgentRegistry& Agents = SubsystemPtr->GetAgents();
+	const TArray<TWeakObjectPtr<AAIStateController>>& Controllers = Agents.GetControllers();
+	const TArray<FVector>& Locations = Agents.GetLocations();
+
+	int32 NumDrawn = 0;
+	for(int32 AgentIndex = 0; AgentIndex < Agents.Num(); AgentIndex++)
+	{
+		const AAIStateController* Controller = Controllers[AgentIndex].Get();
+		const FVector TextLocation = Locations[AgentIndex] + FVector(0.0f, 0.0f, TextHeightOffset);
+		if(Controller == nullptr || FVector::DistSquared(TextLocation, ViewLocation) > MaxDistanceSquared)
+		{
+			continue;
+		}
+
+		// Behind the view or off screen
+		const FVector ScreenLocation = Canvas->Project(TextLocation);
+		if(ScreenLocation.Z <= 0.0f || ScreenLocation.X < 0.0f || ScreenLocation.X > Canvas->ClipX || ScreenLocation.Y < 0.0f || ScreenLocation.Y > Canvas->ClipY)
+		{
+			continue;
+		}
+
+		// Current state and action come from the controller, the ring only adds history
+		const FAIStatesDebugRing& DebugRing = Controller->GetDebugRing();
+		const FAIStatesDebugRecord* InterruptRecord = DebugRing.FindNewest(EAIStatesDebugEvent::Interrupted);
+
+		const FAIStatesInterruptWatcher& InterruptWatcher = Controller->GetInterruptWatcher();
+		FString InterruptStatus = InterruptWatcher.IsArmed() ? (InterruptWatcher.NeedsPolling() ? TEXT("Polled") : TEXT("Watching")) : TEXT("-");
+		if(InterruptRecord)
+		{
+			InterruptStatus += FString::Printf(TEXT(", fired %.1fs ago"), WorldTime - InterruptRecord->WorldTime);
+		}
+
+		const FString Lines[] =
+		{
+			FString::Printf(TEXT("State: %s"), *DescribeCurrent(Controller->GetCurrentStateName().ToString(), DebugRing.FindNewest(EAIStatesDebugEvent::State))),
+			FString::Printf(TEXT("Ability: %s"), *DescribeCurrent(Controller->GetActiveActionName(), DebugRing.FindNewest(EAIStatesDebugEvent::Ability))),
+			FString::Printf(TEXT("Interrupt: %s"), *InterruptStatus),
+			FString::Printf(TEXT("Tier: %d"), Controller->GetSignificanceTier())
+		};
+
+		Canvas->SetDrawColor(InterruptWatcher.IsArmed() ? FColor::Yellow : FColor::White);
+		for(int32 LineIndex = 0; LineIndex < UE_ARRAY_COUNT(Lines); LineIndex++)
+		{
+			Canvas->DrawText(Font, Lines[LineIndex], ScreenLocation.X, ScreenLocation.Y + LineIndex * LineHeight);
+		}
+
+		NumDrawn++;
+	}
+
+	Canvas->SetDrawColor(FColor::White);
+	Canvas->DrawText(Font, FString::Printf(TEXT("AI States: %d of %d bots drawn"), NumDrawn, Agents.Num()), 10.0f, Canvas->ClipY * 0.5f);
+
+	SET_DWORD_STAT(STAT_AIStates_DebugOverlayDrawnBots, NumDrawn);
+	SET_DWORD_STAT(STAT_AIStates_DebugOverlayCulledBots, Agents.Num() - NumDrawn);
+}
+#endif
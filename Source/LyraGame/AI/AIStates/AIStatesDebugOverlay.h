@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+
+class APlayerController;
+class UAIStatesSubsystem;
+class UCanvas;
+
+// Kind of event a controller recorded for the debug overlay
+enum class EAIStatesDebugEvent : uint8
+{
+	State,
+	Ability,
+	Approach,
+	Interrupted
+};
+
+// Single event recorded by a controller for the debug overlay
+struct FAIStatesDebugRecord
+{
+	double WorldTime = 0.0;
+	EAIStatesDebugEvent Event = EAIStatesDebugEvent::State;
+
+	// Entered state or activated ability, none for interrupts
+	FName Name;
+
+	// Probability the state or ability was picked with among the available ones
+	float Probability = 0.0f;
+};
+
+/**
+ * FAIStatesDebugRing
+ *
+ *	Last debug events of a single controller. Written by the controller while lyra.aistates.debug is on,
+ *	the oldest event is overwritten once the ring is full.
+ */
+class LYRAGAME_API FAIStatesDebugRing
+{
+public:
+
+	static constexpr int32 Capacity = 8;
+
+	void Add(const FAIStatesDebugRecord& Record);
+
+	void Reset() { NumRecords = 0; NextIndex = 0; }
+
+	int32 Num() const { return NumRecords; }
+
+	// Record with given age, zero is the newest
+	const FAIStatesDebugRecord& GetNewest(int32 Age) const;
+
+	// Newest record of given event kind, nullptr if none is kept
+	const FAIStatesDebugRecord* FindNewest(EAIStatesDebugEvent Event) const;
+
+private:
+
+	TStaticArray<FAIStatesDebugRecord, Capacity> Records;
+	int32 NextIndex = 0;
+	int32 NumRecords = 0;
+};
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+/**
+ * FAIStatesDebugOverlay
+ *
+ *	Draws current state, ability, pick probabilities and interrupt status of every registered AI in one canvas pass
+ *	of the debug draw service. Current state and ability are read from the controllers, pick probabilities and interrupt
+ *	times from their debug rings while the records are kept. Bots too far from the view or off screen are culled.
+ */
+class LYRAGAME_API FAIStatesDebugOverlay
+{
+public:
+
+	~FAIStatesDebugOverlay();
+
+	void Register(UAIStatesSubsystem& InSubsystem);
+	void Unregister();
+
+	bool IsRegistered() const { return DrawHandle.IsValid(); }
+
+private:
+
+	void Draw(UCanvas* Canvas, APlayerController* PlayerController);
+
+	TWeakObjectPtr<UAIStatesSubsystem> Subsystem;
+	FDelegateHandle DrawHandle;
+};
+#endif
@@ -0,0 +1,232 @@
+#include "AIStatesDecisionTrace.h"
+
+#include "AIStatesSet.h"
+
+namespace AIStatesDecisionTrace
+{
+	constexpr int32 MaxTracedCandidates = 64;
+	const TCHAR* SeedPrefix = TEXT("Seed=");
+
+	TCHAR KindToChar(EAIStatesDecisionKind Kind)
+	{
+		switch(Kind)
+		{
+		case EAIStatesDecisionKind::State:
+			return TEXT('S');
+		case EAIStatesDecisionKind::Ability:
+			return TEXT('A');
+		default:
+			return TEXT('R');
+		}
+	}
+}
+
+FString FAIStatesDecisionRecord::ToString() const
+{
+	// Floats are printed with 9 significant digits so they parse back to the same value
+	return FString::Printf(TEXT("%c,%.3f,%d,%d,%llx,%.9g,%.9g"),
+		AIStatesDecisionTrace::KindToChar(Kind), WorldTime, StateIndex, ChosenIndex, CandidateMask, TotalWeight, Roll);
+}
+
+bool FAIStatesDecisionRecord::FromString(const FString& String, FAIStatesDecisionRecord& OutRecord)
+{
+	TArray<FString> Fields;
+	String.TrimStartAndEnd().ParseIntoArray(Fields, TEXT(","));
+	if(Fields.Num() != 7 || Fields[0].Len() != 1)
+	{
+		return false;
+	}
+
+	switch(Fields[0][0])
+	{
+	case TEXT('S'):
+		OutRecord.Kind = EAIStatesDecisionKind::State;
+		break;
+	case TEXT('A'):
+		OutRecord.Kind = EAIStatesDecisionKind::Ability;
+		break;
+	case TEXT('R'):
+		OutRecord.Kind = EAIStatesDecisionKind::Roll;
+		break;
+	default:
+		return false;
+	}
+
+	OutRecord.WorldTime = FCString::Atod(*Fields[1]);
+	OutRecord.StateIndex = FCString::Atoi(*Fields[2]);
+	OutRecord.ChosenIndex = FCString::Atoi(*Fields[3]);
+	OutRecord.CandidateMask = FCString::Strtoui64(*Fields[4], nullptr, 16);
+	OutRecord.TotalWeight = FCString::Atof(*Fields[5]);
+	OutRecord.Roll = FCString::Atof(*Fields[6]);
+
+	return true;
+}
+
+FAIStatesDecision::FAIStatesDecision(EAIStatesDecisionKind Kind, int32 StateIndex)
+{
+	Record.Kind = Kind;
+	Record.StateIndex = StateIndex;
+}
+
+void FAIStatesDecision::AddCandidate(int32 Index, float Weight)
+{
+	Candidates.Add(Index, Weight);
+	Record.CandidateMask |= Index < AIStatesDecisionTrace::MaxTracedCandidates ? 1ull << Index : 0;
+}
+
+int32 FAIStatesDecision::Pick(const FRandomStream& RandomStream)
+{
+	return Candidates.IsEmpty() ? INDEX_NONE : Pick(RandomStream.FRand());
+}
+
+int32 FAIStatesDecision::Pick(float Roll)
+{
+	PickedIndex = Candidates.PickIndex(Roll);
+
+	Record.ChosenIndex = PickedIndex != INDEX_NONE ? Candidates.GetItem(PickedIndex) : INDEX_NONE;
+	Record.TotalWeight = Candidates.GetTotalWeight();
+	Record.Roll = Roll;
+	return Record.ChosenIndex;
+}
+
+void FAIStatesDecisionTrace::Initialize(int32 InSeed, int32 InCapacity)
+{
+	Seed = InSeed;
+	Capacity = FMath::Max(InCapacity, 0);
+	Head = 0;
+
+	Records.Reset();
+	Records.Reserve(Capacity);
+}
+
+void FAIStatesDecisionTrace::Add(const FAIStatesDecisionRecord& Record)
+{
+	if(Capacity <= 0)
+	{
+		return;
+	}
+
+	if(Records.Num() < Capacity)
+	{
+		Records.Add(Record);
+		return;
+	}
+
+	Records[Head] = Record;
+	Head = (Head + 1) % Capacity;
+}
+
+void FAIStatesDecisionTrace::GetRecords(TArray<FAIStatesDecisionRecord>& OutRecords) const
+{
+	OutRecords.Reset(Records.Num());
+	for(int32 Offset = 0; Offset < Records.Num(); Offset++)
+	{
+		OutRecords.Add(Records[(Head + Offset) % Records.Num()]);
+	}
+}
+
+FString FAIStatesDecisionTrace::ToString() const
+{
+	TArray<FAIStatesDecisionRecord> OrderedRecords;
+	GetRecords(OrderedRecords);
+
+	FString String = FString::Printf(TEXT("%s%d\n"), AIStatesDecisionTrace::SeedPrefix, Seed);
+	for(const FAIStatesDecisionRecord& Record : OrderedRecords)
+	{
+		String += Record.ToString();
+		String += TEXT("\n");
+	}
+
+	return String;
+}
+
+bool FAIStatesDecisionTrace::FromString(const FString& String)
+{
+	TArray<FString> Lines;
+	String.ParseIntoArrayLines(Lines);
+	if(Lines.Num() == 0 || Lines[0].StartsWith(AIStatesDecisionTrace::SeedPrefix) == false)
+	{
+		return false;
+	}
+
+	Initialize(FCString::Atoi(*Lines[0].RightChop(FCString::Strlen(AIStatesDecisionTrace::SeedPrefix))), Lines.Num() - 1);
+
+	for(int32 LineIndex = 1; LineIndex < Lines.Num(); LineIndex++)
+	{
+		FAIStatesDecisionRecord Record;
+		if(FAIStatesDecisionRecord::FromString(Lines[LineIndex], Record) == false)
+		{
+			return false;
+		}
+
+		Add(Record);
+	}
+
+	return true;
+}
+
+int32 FAIStatesDecisionTrace::ReplayDecision(const UAIStatesSet& StatesSet, const FAIStatesDecisionRecord& Record)
+{
+	if(Record.Kind == EAIStatesDecisionKind::Roll)
+	{
+		return Record.ChosenIndex;
+	}
+
+	// Candidates are added in index order, same as the controller collects them
+	FAIStatesDecision Decision(Record.Kind, Record.StateIndex);
+	if(Record.Kind == EAIStatesDecisionKind::State)
+	{
+		for(int32 StateIndex = 0; StateIndex < FMath::Min(StatesSet.States.Num(), AIStatesDecisionTrace::MaxTracedCandidates); StateIndex++)
+		{
+			if(Record.CandidateMask & (1ull << StateIndex))
+			{
+				Decision.AddCandidate(StateIndex, StatesSet.States[StateIndex].StateWeight);
+			}
+		}
+	}
+	else if(StatesSet.States.IsValidIndex(Record.StateIndex))
+	{
+		// Controllers skip abilities without action data, so runtime indexes only count valid ones
+		int32 AbilityIndex = 0;
+		for(const FAIStateAbilityNamedWrapper& AbilityWrapper : StatesSet.States[Record.StateIndex].Abilities)
+		{
+			const auto* Ability = AbilityWrapper.Ability.GetPtr<FAIStateActionData>();
+			if(Ability == nullptr)
+			{
+				continue;
+			}
+
+			if(AbilityIndex < AIStatesDecisionTrace::MaxTracedCandidates && (Record.CandidateMask & (1ull << AbilityIndex)))
+			{
+				Decision.AddCandidate(AbilityIndex, Ability->ProbabilityWeight);
+			}
+			AbilityIndex++;
+		}
+	}
+
+	if(FMath::IsNearlyEqual(Decision.GetCandidates().GetTotalWeight(), Record.TotalWeight) == false)
+	{
+		return INDEX_NONE;
+	}
+
+	return Decision.Pick(Record.Roll);
+}
+
+bool FAIStatesDecisionTrace::Replay(const UAIStatesSet& StatesSet, TConstArrayView<FAIStatesDecisionRecord> Records, FString* OutError)
+{
+	for(int32 RecordIndex = 0; RecordIndex < Records.Num(); RecordIndex++)
+	{
+		const FAIStatesDecisionRecord& Record = Records[RecordIndex];
+		const int32 ReplayedIndex = ReplayDecision(StatesSet, Record);
+		if(ReplayedIndex != Record.ChosenIndex)
+		{
+			if(OutError)
+			{
+				*OutError = FString::Printf(TEXT("Record %d (%s) chose %d, replay chose %d"), RecordIndex, *Record.ToString(), Record.ChosenIndex, ReplayedIndex);
+			}
+			return false;
+		}
+	}
+
+	return true;
+}
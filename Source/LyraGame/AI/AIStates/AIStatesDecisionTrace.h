@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIStatesWeightedSampler.h"
+
+class UAIStatesSet;
+
+// Kind of the traced decision
+enum class EAIStatesDecisionKind : uint8
+{
+	// Pick of the next state among states with met conditions
+	State,
+	// Pick of an ability among activatable abilities of the current state
+	Ability,
+	// Any other roll of the decision stream, like weighted ability classes, query items or action durations.
+	// Candidates don't come from the states set, so replay keeps the recorded choice
+	Roll
+};
+
+// Single weighted decision made by an AI state controller
+struct LYRAGAME_API FAIStatesDecisionRecord
+{
+	// World time of the decision
+	double WorldTime = 0.0;
+
+	EAIStatesDecisionKind Kind = EAIStatesDecisionKind::State;
+
+	// State active when the decision was made, none for rolls
+	int32 StateIndex = INDEX_NONE;
+
+	// Chosen state or ability index
+	int32 ChosenIndex = INDEX_NONE;
+
+	// Candidate states or abilities, one bit per index. Indexes past 63 are not traced
+	uint64 CandidateMask = 0;
+
+	// Sum of candidate weights, used to detect weight changes on replay
+	float TotalWeight = 0.0f;
+
+	// Random roll in [0, 1) used for the pick
+	float Roll = 0.0f;
+
+	FString ToString() const;
+	static bool FromString(const FString& String, FAIStatesDecisionRecord& OutRecord);
+};
+
+/**
+ * FAIStatesDecision
+ *
+ *	Single weighted pick of a state or ability among candidates added in index order. Controllers pick from their random
+ *	stream and replay picks again from the recorded roll, so live and replayed decisions go through the same selection.
+ */
+class LYRAGAME_API FAIStatesDecision
+{
+public:
+
+	FAIStatesDecision(EAIStatesDecisionKind Kind, int32 StateIndex);
+
+	// Adds candidate with given weight. Candidates without positive weight are traced but can never be picked
+	void AddCandidate(int32 Index, float Weight);
+
+	// Picks candidate by next roll of the random stream, INDEX_NONE if there is nothing to pick
+	int32 Pick(const FRandomStream& RandomStream);
+
+	// Picks candidate by given roll in [0, 1), INDEX_NONE if there is nothing to pick
+	int32 Pick(float Roll);
+
+	// Getter function retrieving candidates with pick probabilities
+	const TAIStatesWeightedSampler<int32>& GetCandidates() const { return Candidates; }
+
+	// Getter function retrieving probability the picked candidate had, zero before a pick
+	float GetPickedProbability() const { return PickedIndex != INDEX_NONE ? Candidates.GetProbability(PickedIndex) : 0.0f; }
+
+	// Getter function retrieving the decision in the form it is traced
+	const FAIStatesDecisionRecord& GetRecord() const { return Record; }
+
+private:
+
+	TAIStatesWeightedSampler<int32> Candidates;
+	FAIStatesDecisionRecord Record;
+
+	// Index of the picked candidate in the sampler
+	int32 PickedIndex = INDEX_NONE;
+};
+
+/**
+ * FAIStatesDecisionTrace
+ *
+ *	Ring buffer of the last decisions of a single controller together with the seed of its random stream.
+ *	A trace dumped from a live server can be fed back through the same states set to reproduce and bisect a decision offline.
+ */
+class LYRAGAME_API FAIStatesDecisionTrace
+{
+public:
+
+	// Clears the trace and sets seed of the traced random stream. Zero capacity disables tracing
+	void Initialize(int32 InSeed, int32 InCapacity);
+
+	void Add(const FAIStatesDecisionRecord& Record);
+
+	bool IsEnabled() const { return Capacity > 0; }
+	int32 GetSeed() const { return Seed; }
+	int32 Num() const { return Records.Num(); }
+	SIZE_T GetAllocatedSize() const { return Records.GetAllocatedSize(); }
+
+	// Traced records, oldest first
+	void GetRecords(TArray<FAIStatesDecisionRecord>& OutRecords) const;
+
+	// Seed line followed by one line per record, oldest first
+	FString ToString() const;
+	bool FromString(const FString& String);
+
+	// Picks state or ability of the record again from the states set weights and the recorded roll, rolls keep their recorded choice
+	static int32 ReplayDecision(const UAIStatesSet& StatesSet, const FAIStatesDecisionRecord& Record);
+
+	// Replays every record, returns false and describes the first record which made a different decision
+	static bool Replay(const UAIStatesSet& StatesSet, TConstArrayView<FAIStatesDecisionRecord> Records, FString* OutError = nullptr);
+
+private:
+
+	TArray<FAIStatesDecisionRecord> Records;
+
+	// Index of the oldest record once the buffer is full
+	int32 Head = 0;
+	int32 Capacity = 0;
+	int32 Seed = 0;
+};
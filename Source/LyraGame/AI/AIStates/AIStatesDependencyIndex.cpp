@@ -0,0 +1,177 @@
+#include "AIStatesDependencyIndex.h"
+
+#include "AIStatesProgram.h"
+
+namespace AIStatesDependencyIndex
+{
+	// Adds state to the mask of given input, adding the input if it wasn't read by any state yet
+	template<typename InputType>
+	void AddDependency(const InputType& Input, int32 StateIndex, int32 NumStates, TArray<InputType>& Inputs, TArray<TBitArray<>>& InputStates)
+	{
+		int32 InputIndex = Inputs.IndexOfByKey(Input);
+		if(InputIndex == INDEX_NONE)
+		{
+			InputIndex = Inputs.Add(Input);
+			InputStates.Emplace(false, NumStates);
+		}
+
+		InputStates[InputIndex][StateIndex] = true;
+	}
+
+	template<typename InputType>
+	void MarkDependents(const InputType& Input, const TArray<InputType>& Inputs, const TArray<TBitArray<>>& InputStates, TBitArray<>& DirtyStates)
+	{
+		const int32 InputIndex = Inputs.IndexOfByKey(Input);
+		if(InputIndex != INDEX_NONE)
+		{
+			DirtyStates.CombineWithBitwiseOR(InputStates[InputIndex], EBitwiseOperatorFlags::MaintainSize);
+		}
+	}
+}
+
+void FAIStatesDependencyIndex::Build(const FAIStatesProgram& Program, TConstArrayView<int32> StateConditionGroups)
+{
+	using namespace AIStatesDependencyIndex;
+
+	NumStates = StateConditionGroups.Num();
+
+	SelfTags.Reset();
+	TargetTags.Reset();
+	SelfAttributes.Reset();
+	TargetAttributes.Reset();
+	SelfTagStates.Reset();
+	TargetTagStates.Reset();
+	SelfAttributeStates.Reset();
+	TargetAttributeStates.Reset();
+
+	TargetStates.Init(false, NumStates);
+	DistanceStates.Init(false, NumStates);
+	UntrackedStates.Init(false, NumStates);
+
+	for(int32 StateIndex = 0; StateIndex < NumStates; StateIndex++)
+	{
+		for(const FAIStatesOp& Op : Program.GetGroupOps(StateConditionGroups[StateIndex]))
+		{
+			// Virtual conditions, other agents and recent tag timers have no change events to subscribe to
+			if(Op.OpCode == EAIStatesOpCode::Virtual || Op.OpCode == EAIStatesOpCode::CountAgentsWithTag
+				|| Op.OpCode == EAIStatesOpCode::RecentTag || Op.Target == EAIStatesOpTarget::Agent)
+			{
+				UntrackedStates[StateIndex] = true;
+				continue;
+			}
+
+			const bool bReadsTarget = Op.Target == EAIStatesOpTarget::Player;
+			if(bReadsTarget)
+			{
+				TargetStates[StateIndex] = true;
+			}
+
+			if(Op.OpCode == EAIStatesOpCode::MaxDistance)
+			{
+				DistanceStates[StateIndex] = true;
+			}
+
+			for(const FGameplayTag& Tag : Program.GetOpTags(Op))
+			{
+				if(bReadsTarget)
+				{
+					AddDependency(Tag, StateIndex, NumStates, TargetTags, TargetTagStates);
+				}
+				else
+				{
+					AddDependency(Tag, StateIndex, NumStates, SelfTags, SelfTagStates);
+				}
+			}
+
+			if(const FGameplayAttribute* Attribute = Program.GetOpAttribute(Op))
+			{
+				if(bReadsTarget)
+				{
+					AddDependency(*Attribute, StateIndex, NumStates, TargetAttributes, TargetAttributeStates);
+				}
+				else
+				{
+					AddDependency(*Attribute, StateIndex, NumStates, SelfAttributes, SelfAttributeStates);
+				}
+			}
+		}
+	}
+}
+
+void FAIStatesDependencyIndex::MarkTagDependents(const FGameplayTag& Tag, bool bFromTarget, TBitArray<>& DirtyStates) const
+{
+	AIStatesDependencyIndex::MarkDependents(Tag, bFromTarget ? TargetTags : SelfTags, bFromTarget ? TargetTagStates : SelfTagStates, DirtyStates);
+}
+
+void FAIStatesDependencyIndex::MarkAttributeDependents(const FGameplayAttribute& Attribute, bool bFromTarget, TBitArray<>& DirtyStates) const
+{
+	AIStatesDependencyIndex::MarkDependents(Attribute, bFromTarget ? TargetAttributes : SelfAttributes, bFromTarget ? TargetAttributeStates : SelfAttributeStates, DirtyStates);
+}
+
+SIZE_T FAIStatesDependencyIndex::GetAllocatedSize() const
+{
+	SIZE_T Size = SelfTags.GetAllocatedSize() + TargetTags.GetAllocatedSize() + SelfAttributes.GetAllocatedSize() + TargetAttributes.GetAllocatedSize()
+		+ SelfTagStates.GetAllocatedSize() + TargetTagStates.GetAllocatedSize() + SelfAttributeStates.GetAllocatedSize() + TargetAttributeStates.GetAllocatedSize()
+		+ TargetStates.GetAllocatedSize() + DistanceStates.GetAllocatedSize() + UntrackedStates.GetAllocatedSize();
+
+	for(const TArray<TBitArray<>>* InputStates : { &SelfTagStates, &TargetTagStates, &SelfAttributeStates, &TargetAttributeStates })
+	{
+		for(const TBitArray<>& States : *InputStates)
+		{
+			Size += States.GetAllocatedSize();
+		}
+	}
+
+	return Size;
+}
+
+void FAIStatesInterruptDependencies::Build(const FAIStatesProgram& Program, int32 FirstGroup, int32 NumGroups)
+{
+	Reset();
+
+	// Variants which were never compiled can only be polled
+	if(FirstGroup == INDEX_NONE || FirstGroup + NumGroups > Program.GetNumGroups())
+	{
+		bUntracked = NumGroups > 0;
+		return;
+	}
+
+	for(int32 GroupIndex = FirstGroup; GroupIndex < FirstGroup + NumGroups; GroupIndex++)
+	{
+		for(const FAIStatesOp& Op : Program.GetGroupOps(GroupIndex))
+		{
+			if(Op.OpCode == EAIStatesOpCode::Virtual || Op.OpCode == EAIStatesOpCode::CountAgentsWithTag
+				|| Op.OpCode == EAIStatesOpCode::RecentTag || Op.Target == EAIStatesOpTarget::Agent)
+			{
+				bUntracked = true;
+				continue;
+			}
+
+			const bool bReadsTarget = Op.Target == EAIStatesOpTarget::Player;
+			if(Op.OpCode == EAIStatesOpCode::MaxDistance)
+			{
+				bReadsDistance = true;
+			}
+
+			for(const FGameplayTag& Tag : Program.GetOpTags(Op))
+			{
+				(bReadsTarget ? TargetTags : SelfTags).AddUnique(Tag);
+			}
+
+			if(const FGameplayAttribute* Attribute = Program.GetOpAttribute(Op))
+			{
+				(bReadsTarget ? TargetAttributes : SelfAttributes).AddUnique(*Attribute);
+			}
+		}
+	}
+}
+
+void FAIStatesInterruptDependencies::Reset()
+{
+	SelfTags.Reset();
+	TargetTags.Reset();
+	SelfAttributes.Reset();
+	TargetAttributes.Reset();
+	bReadsDistance = false;
+	bUntracked = false;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "GameplayTagContainer.h"
+
+struct FAIStatesProgram;
+
+/**
+ * FAIStatesDependencyIndex
+ *
+ *	Records which inputs the entry conditions of every state read, built from the compiled condition program.
+ *	Controllers subscribe to the listed self and target tags and attributes and only re-evaluate states whose inputs changed.
+ *	States reading other agents, recent tag timers or conditions without typed operation can't be tracked by events and are re-evaluated on every update.
+ */
+struct LYRAGAME_API FAIStatesDependencyIndex
+{
+	// Rebuilds index for states with given condition groups in the program
+	void Build(const FAIStatesProgram& Program, TConstArrayView<int32> StateConditionGroups);
+
+	int32 GetNumStates() const { return NumStates; }
+
+	// Marks states reading given tag of the controlled pawn or of the target as dirty
+	void MarkTagDependents(const FGameplayTag& Tag, bool bFromTarget, TBitArray<>& DirtyStates) const;
+
+	// Marks states reading given attribute of the controlled pawn or of the target as dirty
+	void MarkAttributeDependents(const FGameplayAttribute& Attribute, bool bFromTarget, TBitArray<>& DirtyStates) const;
+
+	// Tags and attributes controllers have to subscribe to
+	const TArray<FGameplayTag>& GetSelfTags() const { return SelfTags; }
+	const TArray<FGameplayTag>& GetTargetTags() const { return TargetTags; }
+	const TArray<FGameplayAttribute>& GetSelfAttributes() const { return SelfAttributes; }
+	const TArray<FGameplayAttribute>& GetTargetAttributes() const { return TargetAttributes; }
+
+	// States reading anything from the target, dirty whenever the target changes
+	const TBitArray<>& GetTargetStates() const { return TargetStates; }
+
+	// States with distance conditions to the target, re-evaluated on a slower fallback interval
+	const TBitArray<>& GetDistanceStates() const { return DistanceStates; }
+
+	// States which inputs can't be tracked, dirty on every update
+	const TBitArray<>& GetUntrackedStates() const { return UntrackedStates; }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	// Inputs read by at least one state
+	TArray<FGameplayTag> SelfTags;
+	TArray<FGameplayTag> TargetTags;
+	TArray<FGameplayAttribute> SelfAttributes;
+	TArray<FGameplayAttribute> TargetAttributes;
+
+	// States reading input with the same index, one bit per state
+	TArray<TBitArray<>> SelfTagStates;
+	TArray<TBitArray<>> TargetTagStates;
+	TArray<TBitArray<>> SelfAttributeStates;
+	TArray<TBitArray<>> TargetAttributeStates;
+
+	TBitArray<> TargetStates;
+	TBitArray<> DistanceStates;
+	TBitArray<> UntrackedStates;
+
+	int32 NumStates = 0;
+};
+
+/**
+ * FAIStatesInterruptDependencies
+ *
+ *	Inputs read by the interrupt variants of a single interruptible action, built from their compiled groups.
+ *	Interrupt watchers subscribe to the listed tags and attributes while the action runs, instead of polling its variants.
+ */
+struct LYRAGAME_API FAIStatesInterruptDependencies
+{
+	// Rebuilds dependencies of consecutive variant groups in the program
+	void Build(const FAIStatesProgram& Program, int32 FirstGroup, int32 NumGroups);
+
+	void Reset();
+
+	// True if any variant reads distance to the target, which has no change event
+	bool ReadsDistance() const { return bReadsDistance; }
+
+	// True if any variant reads inputs without change events other than distance
+	bool IsUntracked() const { return bUntracked; }
+
+	TArray<FGameplayTag> SelfTags;
+	TArray<FGameplayTag> TargetTags;
+	TArray<FGameplayAttribute> SelfAttributes;
+	TArray<FGameplayAttribute> TargetAttributes;
+
+private:
+
+	bool bReadsDistance = false;
+	bool bUntracked = false;
+};
@@ -0,0 +1,246 @@
+#include "AIStatesEQSCache.h"
+
+#include "AIStatesStats.h"
+#include "AI/AIStateController.h"
+#include "Algo/AnyOf.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "EnvironmentQuery/EnvQueryManager.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesEQSCache)
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Cache Hits"), STAT_AIStates_EQSCacheHits, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Cache Shared Executions"), STAT_AIStates_EQSCacheSharedExecutions, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Cache Misses"), STAT_AIStates_EQSCacheMisses, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS Cache Denied Executions"), STAT_AIStates_EQSCacheDeniedExecutions, STATGROUP_AIStates);
+
+FAIStatesEQSCacheKey FAIStatesEQSCache::MakeKey(const UEnvQuery& Query, TConstArrayView<FEnvNamedValue> QueryParams, const FVector& QuerierLocation, const FVector& ContextLocation) const
+{
+	auto ToCell = [this](const FVector& Location)
+	{
+		return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+	};
+
+	FAIStatesEQSCacheKey Key;
+	Key.Query = FObjectKey(&Query);
+	Key.ParamsHash = HashQueryParams(QueryParams);
+	Key.QuerierCell = ToCell(QuerierLocation);
+	Key.ContextCell = ToCell(ContextLocation);
+	return Key;
+}
+
+uint32 FAIStatesEQSCache::HashQueryParams(TConstArrayView<FEnvNamedValue> QueryParams)
+{
+	uint32 Hash = 0;
+	for(const FEnvNamedValue& Param : QueryParams)
+	{
+		Hash = HashCombine(Hash, HashCombine(GetTypeHash(Param.ParamName), HashCombine(GetTypeHash(static_cast<uint8>(Param.ParamType)), GetTypeHash(Param.Value))));
+	}
+
+	return Hash;
+}
+
+void FAIStatesEQSCache::Run(UEnvQuery& Query, TConstArrayView<FEnvNamedValue> QueryParams, AAIStateController& Controller, EAIStatesEQSDistribution Distribution,
+	const FAIStatesEQSQueryFinished& OnQueryFinished, float TimeToLive, bool bAllowExecute)
+{
+	APawn* Querier = Controller.GetPawn();
+	UWorld* QueryWorld = Controller.GetWorld();
+	if(Querier == nullptr || QueryWorld == nullptr)
+	{
+		OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+		return;
+	}
+
+	World = QueryWorld;
+
+	const FVector QuerierLocation = Querier->GetActorLocation();
+	const FVector ContextLocation = Controller.GetTarget() ? Controller.GetTarget()->GetActorLocation() : QuerierLocation;
+	const FAIStatesEQSCacheKey Key = MakeKey(Query, QueryParams, QuerierLocation, ContextLocation);
+
+	const FAIStatesEQSWaiter Waiter = { &Controller, Distribution, OnQueryFinished };
+	const double WorldTime = QueryWorld->GetTimeSeconds();
+
+	FAIStatesEQSCacheEntry* Entry = Entries.Find(Key);
+	if(Entry && Entry->Result.IsValid() && WorldTime - Entry->ResultTime <= TimeToLive)
+	{
+		INC_DWORD_STAT(STAT_AIStates_EQSCacheHits);
+		Serve(Entry->Result.Get(), Waiter, Entry->NumServed++);
+		return;
+	}
+
+	if(Entry && Entry->QueryId != INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_AIStates_EQSCacheSharedExecutions);
+		Entry->Waiters.Add(Waiter);
+		return;
+	}
+
+	if(bAllowExecute == false)
+	{
+		INC_DWORD_STAT(STAT_AIStates_EQSCacheDeniedExecutions);
+		OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+		return;
+	}
+
+	INC_DWORD_STAT(STAT_AIStates_EQSCacheMisses);
+
+	FEnvQueryRequest QueryRequest(&Query, Querier);
+	QueryRequest.SetNamedParams(TArray<FEnvNamedValue>(QueryParams));
+
+	// Every matching item is kept, so controllers sharing the result can spread over them
+	const int32 QueryId = QueryRequest.Execute(EEnvQueryRunMode::AllMatching, FQueryFinishedSignature::CreateRaw(this, &FAIStatesEQSCache::OnQueryFinished, Key));
+	if(QueryId == INDEX_NONE)
+	{
+		OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+		return;
+	}
+
+	FAIStatesEQSCacheEntry& NewEntry = Entries.FindOrAdd(Key);
+	NewEntry.QueryId = QueryId;
+	NewEntry.Waiters.Add(Waiter);
+}
+
+void FAIStatesEQSCache::RunUncached(UEnvQuery& Query, TConstArrayView<FEnvNamedValue> QueryParams, AAIStateController& Controller, EAIStatesEQSDistribution Distribution,
+	const FAIStatesEQSQueryFinished& OnQueryFinished)
+{
+	FEnvQueryRequest QueryRequest(&Query, Controller.GetPawn());
+	QueryRequest.SetNamedParams(TArray<FEnvNamedValue>(QueryParams));
+
+	const FAIStatesEQSWaiter Waiter = { &Controller, Distribution, OnQueryFinished };
+	const int32 QueryId = QueryRequest.Execute(EEnvQueryRunMode::AllMatching, FQueryFinishedSignature::CreateLambda([Waiter](TSharedPtr<FEnvQueryResult> Result)
+	{
+		Serve(Result.Get(), Waiter, 0);
+	}));
+
+	if(QueryId == INDEX_NONE)
+	{
+		OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+	}
+}
+
+void FAIStatesEQSCache::OnQueryFinished(TSharedPtr<FEnvQueryResult> Result, FAIStatesEQSCacheKey Key)
+{
+	// Entries of invalidated executions are gone, their waiters were already told
+	FAIStatesEQSCacheEntry* Entry = Entries.Find(Key);
+	if(Entry == nullptr)
+	{
+		return;
+	}
+
+	Entry->QueryId = INDEX_NONE;
+	Entry->Result = Result.IsValid() && Result->IsSuccessful() ? Result : nullptr;
+	Entry->ResultTime = World.IsValid() ? World->GetTimeSeconds() : 0.0;
+
+	// Waiters may run new queries from their delegates, which can reallocate the entries
+	TArray<FAIStatesEQSWaiter> Waiters = MoveTemp(Entry->Waiters);
+	const TSharedPtr<FEnvQueryResult> SharedResult = Entry->Result;
+	int32 ConsumerIndex = Entry->NumServed;
+	Entry->NumServed += Waiters.Num();
+
+	for(const FAIStatesEQSWaiter& Waiter : Waiters)
+	{
+		Serve(SharedResult.Get(), Waiter, ConsumerIndex++);
+	}
+}
+
+void FAIStatesEQSCache::Serve(const FEnvQueryResult* Result, const FAIStatesEQSWaiter& Waiter, int32 ConsumerIndex)
+{
+	AAIStateController* Controller = Waiter.Controller.Get();
+	if(Controller == nullptr)
+	{
+		return;
+	}
+
+	if(Result == nullptr || Result->IsSuccessful() == false || Result->Items.IsEmpty())
+	{
+		Waiter.OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+		return;
+	}
+
+	TArray<float, TInlineAllocator<64>> Scores;
+	Scores.Reserve(Result->Items.Num());
+	for(const FEnvQueryItem& Item : Result->Items)
+	{
+		Scores.Add(Item.Score);
+	}
+
+	const int32 ItemIndex = PickItemIndex(Scores, Waiter.Distribution, ConsumerIndex,
+		[Controller](FAIStatesDecision& Decision) { return Controller->PickDecision(Decision); });
+	Waiter.OnQueryFinished.ExecuteIfBound(true, Result->GetItemAsLocation(ItemIndex));
+}
+
+int32 FAIStatesEQSCache::PickItemIndex(TConstArrayView<float> Scores, EAIStatesEQSDistribution Distribution, int32 ConsumerIndex, TFunctionRef<int32(FAIStatesDecision&)> PickDecision)
+{
+	if(Scores.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	switch(Distribution)
+	{
+	case EAIStatesEQSDistribution::RoundRobin:
+		return FMath::Abs(ConsumerIndex) % Scores.Num();
+
+	case EAIStatesEQSDistribution::WeightedRandom:
+	{
+		// Items without positive score are never picked, unless no item has one and all are equally likely
+		const bool bAnyPositiveScore = Algo::AnyOf(Scores, [](float Score) { return Score > 0.0f; });
+
+		FAIStatesDecision ItemDecision(EAIStatesDecisionKind::Roll, INDEX_NONE);
+		for(int32 ItemIndex = 0; ItemIndex < Scores.Num(); ItemIndex++)
+		{
+			ItemDecision.AddCandidate(ItemIndex, bAnyPositiveScore ? Scores[ItemIndex] : 1.0f);
+		}
+
+		return PickDecision(ItemDecision);
+	}
+
+	default:
+		return 0;
+	}
+}
+
+void FAIStatesEQSCache::Update(double WorldTime, float TimeToLive)
+{
+	for(auto EntryIt = Entries.CreateIterator(); EntryIt; ++EntryIt)
+	{
+		const FAIStatesEQSCacheEntry& Entry = EntryIt->Value;
+		if(Entry.QueryId == INDEX_NONE && WorldTime - Entry.ResultTime > TimeToLive)
+		{
+			EntryIt.RemoveCurrent();
+		}
+	}
+}
+
+void FAIStatesEQSCache::Invalidate()
+{
+	TArray<int32, TInlineAllocator<16>> RunningQueries;
+	TArray<FAIStatesEQSWaiter> Waiters;
+	for(TPair<FAIStatesEQSCacheKey, FAIStatesEQSCacheEntry>& EntryPair : Entries)
+	{
+		if(EntryPair.Value.QueryId != INDEX_NONE)
+		{
+			RunningQueries.Add(EntryPair.Value.QueryId);
+		}
+
+		Waiters.Append(MoveTemp(EntryPair.Value.Waiters));
+	}
+
+	// Entries go first, so aborted executions calling back find nothing
+	Entries.Reset();
+
+	if(UEnvQueryManager* QueryManager = World.IsValid() ? UEnvQueryManager::GetCurrent(World.Get()) : nullptr)
+	{
+		for(const int32 QueryId : RunningQueries)
+		{
+			QueryManager->AbortQuery(QueryId);
+		}
+	}
+
+	for(const FAIStatesEQSWaiter& Waiter : Waiters)
+	{
+		if(Waiter.Controller.IsValid())
+		{
+			Waiter.OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
+#include "UObject/ObjectKey.h"
+
+#include "AIStatesEQSCache.generated.h"
+
+class AAIStateController;
+class FAIStatesDecision;
+class UEnvQuery;
+
+// How controllers sharing one query execution pick their item from its result
+UENUM(BlueprintType)
+enum class EAIStatesEQSDistribution : uint8
+{
+	// Every controller takes the best scored item
+	Best,
+	// Controllers take items in score order, one after another
+	RoundRobin,
+	// Controllers pick items randomly, weighted by item score
+	WeightedRandom
+};
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FAIStatesEQSQueryFinished, bool, bSuccess, FVector, Location);
+
+// Query execution identified by query asset, its params and quantized querier and context locations
+struct FAIStatesEQSCacheKey
+{
+	FObjectKey Query;
+	uint32 ParamsHash = 0;
+	FIntVector QuerierCell = FIntVector::ZeroValue;
+	FIntVector ContextCell = FIntVector::ZeroValue;
+
+	bool operator==(const FAIStatesEQSCacheKey& Other) const
+	{
+		return Query == Other.Query && ParamsHash == Other.ParamsHash && QuerierCell == Other.QuerierCell && ContextCell == Other.ContextCell;
+	}
+
+	friend uint32 GetTypeHash(const FAIStatesEQSCacheKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.Query), Key.ParamsHash), HashCombine(GetTypeHash(Key.QuerierCell), GetTypeHash(Key.ContextCell)));
+	}
+};
+
+// Controller waiting for a shared query execution
+struct FAIStatesEQSWaiter
+{
+	TWeakObjectPtr<AAIStateController> Controller;
+	EAIStatesEQSDistribution Distribution = EAIStatesEQSDistribution::Best;
+	FAIStatesEQSQueryFinished OnQueryFinished;
+};
+
+// Result of a single query execution shared by every controller asking with the same key
+struct FAIStatesEQSCacheEntry
+{
+	TSharedPtr<FEnvQueryResult> Result;
+
+	// World time of the result, negative until the execution finishes
+	double ResultTime = -1.0;
+
+	// Id of the running execution, INDEX_NONE once it finished
+	int32 QueryId = INDEX_NONE;
+
+	TArray<FAIStatesEQSWaiter> Waiters;
+
+	// Number of controllers served from this result, advances round robin distribution
+	int32 NumServed = 0;
+};
+
+/**
+ * FAIStatesEQSCache
+ *
+ *	Environment query results shared by AI controllers asking the same query with the same params from nearby locations.
+ *	The first controller runs the query, controllers asking while it runs wait for the same execution and controllers
+ *	asking within time to live take the stored result. Each controller picks its item by distribution mode.
+ */
+class LYRAGAME_API FAIStatesEQSCache
+{
+public:
+
+	~FAIStatesEQSCache() { Reset(); }
+
+	void SetCellSize(float InCellSize) { CellSize = FMath::Max(InCellSize, 1.0f); }
+
+	FAIStatesEQSCacheKey MakeKey(const UEnvQuery& Query, TConstArrayView<FEnvNamedValue> QueryParams, const FVector& QuerierLocation, const FVector& ContextLocation) const;
+
+	// Serves the query result to the controller, running the query only if no execution with the same key is fresh or running.
+	// Controllers not allowed to execute are only served shared results
+	void Run(UEnvQuery& Query, TConstArrayView<FEnvNamedValue> QueryParams, AAIStateController& Controller, EAIStatesEQSDistribution Distribution,
+		const FAIStatesEQSQueryFinished& OnQueryFinished, float TimeToLive, bool bAllowExecute = true);
+
+	// Runs the query for the controller alone, bypassing the cache
+	static void RunUncached(UEnvQuery& Query, TConstArrayView<FEnvNamedValue> QueryParams, AAIStateController& Controller, EAIStatesEQSDistribution Distribution,
+		const FAIStatesEQSQueryFinished& OnQueryFinished);
+
+	// Function dropping expired results
+	void Update(double WorldTime, float TimeToLive);
+
+	// Drops every result, running executions are aborted
+	void Invalidate();
+
+	void Reset() { Invalidate(); }
+
+	int32 Num() const { return Entries.Num(); }
+
+	// Picks item for the consumer with given index. Scores are sorted from the best item.
+	// Weighted random picks go through given decision pick, so controllers trace the roll
+	static int32 PickItemIndex(TConstArrayView<float> Scores, EAIStatesEQSDistribution Distribution, int32 ConsumerIndex, TFunctionRef<int32(FAIStatesDecision&)> PickDecision);
+
+	// Hash of query params, order of params matters
+	static uint32 HashQueryParams(TConstArrayView<FEnvNamedValue> QueryParams);
+
+private:
+
+	void OnQueryFinished(TSharedPtr<FEnvQueryResult> Result, FAIStatesEQSCacheKey Key);
+
+	// Picks item of the result for the waiter and calls its delegate
+	static void Serve(const FEnvQueryResult* Result, const FAIStatesEQSWaiter& Waiter, int32 ConsumerIndex);
+
+	TMap<FAIStatesEQSCacheKey, FAIStatesEQSCacheEntry> Entries;
+
+	// World running the executions, used to abort them
+	TWeakObjectPtr<UWorld> World;
+
+	float CellSize = 300.0f;
+};
@@ -0,0 +1,153 @@
+#include "AIStatesInterruptWatcher.h"
+
+#include "AIStatesSet.h"
+#include "AIStatesSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "AI/AIStateController.h"
+
+FAIStatesInterruptWatcher::~FAIStatesInterruptWatcher()
+{
+	Disarm();
+}
+
+void FAIStatesInterruptWatcher::Arm(AAIStateController& InController, const FAIInterruptibleActionData& InInterruptibleData)
+{
+	Disarm();
+
+	if(InInterruptibleData.ConditionsToInterrupt.IsEmpty())
+	{
+		return;
+	}
+
+	Controller = &InController;
+	InterruptibleData = &InInterruptibleData;
+
+	Bind(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(InController.GetPawn()), false);
+	Bind(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(InController.GetTarget()), true);
+
+	if(NeedsPolling())
+	{
+		if(UAIStatesSubsystem* AIStatesSubsystem = InController.GetWorld()->GetSubsystem<UAIStatesSubsystem>())
+		{
+			AIStatesSubsystem->AddPolledInterruptWatcher(&InController);
+		}
+	}
+
+	// Variants may already pass when the action starts
+	Check();
+}
+
+void FAIStatesInterruptWatcher::Disarm()
+{
+	if(IsArmed() == false)
+	{
+		return;
+	}
+
+	Unbind(false);
+	Unbind(true);
+
+	AAIStateController* ControllerPtr = Controller.Get();
+	if(UWorld* World = ControllerPtr ? ControllerPtr->GetWorld() : nullptr)
+	{
+		if(UAIStatesSubsystem* AIStatesSubsystem = World->GetSubsystem<UAIStatesSubsystem>())
+		{
+			AIStatesSubsystem->RemovePolledInterruptWatcher(ControllerPtr);
+		}
+	}
+
+	InterruptibleData = nullptr;
+	Controller.Reset();
+}
+
+void FAIStatesInterruptWatcher::OnTargetChanged(UAbilitySystemComponent* NewTargetASC)
+{
+	if(IsArmed() == false)
+	{
+		return;
+	}
+
+	Unbind(true);
+	Bind(NewTargetASC, true);
+	Check();
+}
+
+bool FAIStatesInterruptWatcher::Check()
+{
+	AAIStateController* ControllerPtr = Controller.Get();
+	if(IsArmed() == false || ControllerPtr == nullptr)
+	{
+		return false;
+	}
+
+	if(InterruptibleData->ShouldInterrupt(ControllerPtr) == false)
+	{
+		return false;
+	}
+
+	// Disarmed first, so whatever ends the action in response can arm the watcher again
+	Disarm();
+	ControllerPtr->OnInterruptWatcherFired();
+	return true;
+}
+
+bool FAIStatesInterruptWatcher::NeedsPolling() const
+{
+	return IsArmed() && (InterruptibleData->CompiledDependencies.ReadsDistance() || InterruptibleData->CompiledDependencies.IsUntracked());
+}
+
+void FAIStatesInterruptWatcher::Bind(UAbilitySystemComponent* ASC, bool bTarget)
+{
+	if(IsValid(ASC) == false || IsArmed() == false)
+	{
+		return;
+	}
+
+	const FAIStatesInterruptDependencies& Dependencies = InterruptibleData->CompiledDependencies;
+	for(const FGameplayTag& Tag : bTarget ? Dependencies.TargetTags : Dependencies.SelfTags)
+	{
+		ASC->RegisterGameplayTagEvent(Tag, EGameplayTagEventType::AnyCountChange).AddRaw(this, &FAIStatesInterruptWatcher::OnTagChanged);
+	}
+
+	for(const FGameplayAttribute& Attribute : bTarget ? Dependencies.TargetAttributes : Dependencies.SelfAttributes)
+	{
+		ASC->GetGameplayAttributeValueChangeDelegate(Attribute).AddRaw(this, &FAIStatesInterruptWatcher::OnAttributeChanged);
+	}
+
+	TWeakObjectPtr<UAbilitySystemComponent>& BoundASC = bTarget ? TargetASC : SelfASC;
+	BoundASC = ASC;
+}
+
+void FAIStatesInterruptWatcher::Unbind(bool bTarget)
+{
+	TWeakObjectPtr<UAbilitySystemComponent>& BoundASC = bTarget ? TargetASC : SelfASC;
+	UAbilitySystemComponent* ASC = BoundASC.Get();
+	BoundASC.Reset();
+
+	if(ASC == nullptr || IsArmed() == false)
+	{
+		return;
+	}
+
+	const FAIStatesInterruptDependencies& Dependencies = InterruptibleData->CompiledDependencies;
+	for(const FGameplayTag& Tag : bTarget ? Dependencies.TargetTags : Dependencies.SelfTags)
+	{
+		ASC->RegisterGameplayTagEvent(Tag, EGameplayTagEventType::AnyCountChange).RemoveAll(this);
+	}
+
+	for(const FGameplayAttribute& Attribute : bTarget ? Dependencies.TargetAttributes : Dependencies.SelfAttributes)
+	{
+		ASC->GetGameplayAttributeValueChangeDelegate(Attribute).RemoveAll(this);
+	}
+}
+
+void FAIStatesInterruptWatcher::OnTagChanged(const FGameplayTag Tag, int32 NewCount)
+{
+	Check();
+}
+
+void FAIStatesInterruptWatcher::OnAttributeChanged(const FOnAttributeChangeData& ChangeData)
+{
+	Check();
+}
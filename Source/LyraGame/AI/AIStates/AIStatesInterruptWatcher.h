@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+class AAIStateController;
+class UAbilitySystemComponent;
+struct FAIInterruptibleActionData;
+struct FOnAttributeChangeData;
+
+/**
+ * FAIStatesInterruptWatcher
+ *
+ *	Watches interrupt variants of the interruptible action run by a controller. Armed when the action is activated, it
+ *	subscribes to the tags and attributes its variants read and evaluates them only when one of those changes, so an
+ *	interrupt fires in the same frame its input changes. Variants reading distance or inputs without change events are
+ *	checked by the AI states subsystem once per tick instead. Fires at most once and disarms itself before firing.
+ */
+class LYRAGAME_API FAIStatesInterruptWatcher
+{
+public:
+
+	FAIStatesInterruptWatcher() = default;
+	~FAIStatesInterruptWatcher();
+
+	// Subscriptions are bound to this address
+	FAIStatesInterruptWatcher(const FAIStatesInterruptWatcher&) = delete;
+	FAIStatesInterruptWatcher& operator=(const FAIStatesInterruptWatcher&) = delete;
+
+	// Starts watching variants of given data, which has to outlive the watcher or its disarm. Checks them right away
+	void Arm(AAIStateController& InController, const FAIInterruptibleActionData& InInterruptibleData);
+
+	// Stops watching and drops every subscription
+	void Disarm();
+
+	// Moves target subscriptions to the new target and checks variants against it
+	void OnTargetChanged(UAbilitySystemComponent* TargetASC);
+
+	// Evaluates variants and fires the interrupt if any passes, true if it fired
+	bool Check();
+
+	bool IsArmed() const { return InterruptibleData != nullptr; }
+
+	// True if the subsystem has to check variants every tick, because some inputs have no change events
+	bool NeedsPolling() const;
+
+private:
+
+	void Bind(UAbilitySystemComponent* ASC, bool bTarget);
+	void Unbind(bool bTarget);
+
+	void OnTagChanged(const FGameplayTag Tag, int32 NewCount);
+	void OnAttributeChanged(const FOnAttributeChangeData& ChangeData);
+
+	TWeakObjectPtr<AAIStateController> Controller;
+
+	// Watched data, owned by the states set of the controller or by its default approach ability
+	const FAIInterruptibleActionData* InterruptibleData = nullptr;
+
+	// Ability system components the watcher is subscribed to
+	TWeakObjectPtr<UAbilitySystemComponent> SelfASC;
+	TWeakObjectPtr<UAbilitySystemComponent> TargetASC;
+};
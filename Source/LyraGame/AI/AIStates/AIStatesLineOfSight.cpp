@@ -0,0 +1,97 @@
+#include "AIStatesLineOfSight.h"
+
+#include "AIStatesStats.h"
+#include "AI/AIStateController.h"
+#include "Engine/World.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Line Of Sight Traces"), STAT_AIStates_AsyncLineOfSightTraces, STATGROUP_AIStates);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued Line Of Sight Requests"), STAT_AIStates_QueuedLineOfSightRequests, STATGROUP_AIStates);
+
+FAIStatesLineOfSightEntry* FAIStatesLineOfSightCache::Find(const AActor* Target, float TraceSphereRadius)
+{
+	return Entries.FindByPredicate([Target, TraceSphereRadius](const FAIStatesLineOfSightEntry& Entry)
+	{
+		return Entry.Target.Get() == Target && Entry.TraceSphereRadius == TraceSphereRadius;
+	});
+}
+
+FAIStatesLineOfSightEntry& FAIStatesLineOfSightCache::FindOrAdd(const AActor* Target, float TraceSphereRadius)
+{
+	if(FAIStatesLineOfSightEntry* Entry = Find(Target, TraceSphereRadius))
+	{
+		return *Entry;
+	}
+
+	Entries.RemoveAllSwap([](const FAIStatesLineOfSightEntry& Entry)
+	{
+		return Entry.Target.IsValid() == false;
+	});
+
+	FAIStatesLineOfSightEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.Target = Target;
+	Entry.TraceSphereRadius = TraceSphereRadius;
+
+	return Entry;
+}
+
+FCollisionQueryParams FAIStatesLineOfSightQueue::MakeQueryParams(const AActor* Querier, const AActor* Target)
+{
+	// Ignored actors use inline storage, so building the params doesn't allocate
+	FCollisionQueryParams CollisionParams(SCENE_QUERY_STAT(WeaponLineOfSight), true, Querier);
+	CollisionParams.AddIgnoredActor(Target);
+
+	return CollisionParams;
+}
+
+void FAIStatesLineOfSightQueue::Add(const FAIStatesLineOfSightRequest& Request)
+{
+	QueuedRequests.Add(Request);
+}
+
+int32 FAIStatesLineOfSightQueue::Flush(UWorld& World, const FTraceDelegate& TraceDelegate, int32 MaxTraces)
+{
+	const int32 NumToIssue = FMath::Min(QueuedRequests.Num(), FMath::Max(MaxTraces, 0));
+	for(int32 RequestIndex = 0; RequestIndex < NumToIssue; RequestIndex++)
+	{
+		const FAIStatesLineOfSightRequest& Request = QueuedRequests[RequestIndex];
+		const AAIStateController* Controller = Request.Controller.Get();
+		if(Controller == nullptr || Request.Target.IsValid() == false)
+		{
+			continue;
+		}
+
+		const uint32 RequestId = NextRequestId++;
+		InFlightRequests.Add(RequestId, Request);
+
+		World.AsyncSweepByChannel(EAsyncTraceType::Test, Request.From, Request.To, FQuat::Identity, ECC_Visibility,
+			FCollisionShape::MakeSphere(Request.TraceSphereRadius), MakeQueryParams(Controller->GetPawn(), Request.Target.Get()),
+			FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, RequestId);
+		INC_DWORD_STAT(STAT_AIStates_AsyncLineOfSightTraces);
+	}
+
+	QueuedRequests.RemoveAt(0, NumToIssue, false);
+	SET_DWORD_STAT(STAT_AIStates_QueuedLineOfSightRequests, QueuedRequests.Num());
+
+	return NumToIssue;
+}
+
+void FAIStatesLineOfSightQueue::OnTraceCompleted(const FTraceDatum& TraceDatum, double WorldTime)
+{
+	FAIStatesLineOfSightRequest Request;
+	if(InFlightRequests.RemoveAndCopyValue(TraceDatum.UserData, Request) == false)
+	{
+		return;
+	}
+
+	// Test traces report a blocking hit as a single result
+	if(const AAIStateController* Controller = Request.Controller.Get())
+	{
+		Controller->OnLineOfSightResult(Request.Target.Get(), Request.TraceSphereRadius, TraceDatum.OutHits.Num() == 0, WorldTime);
+	}
+}
+
+void FAIStatesLineOfSightQueue::Reset()
+{
+	QueuedRequests.Reset();
+	InFlightRequests.Reset();
+}
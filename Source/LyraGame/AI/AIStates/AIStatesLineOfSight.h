@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "WorldCollision.h"
+
+class AAIStateController;
+
+// Line of sight result of a controller to a single target
+struct FAIStatesLineOfSightEntry
+{
+	TWeakObjectPtr<const AActor> Target;
+	float TraceSphereRadius = 0.0f;
+
+	// World time at which the result was traced, negative until the first result arrives
+	double ResultTime = -1.0;
+
+	bool bHasLineOfSight = false;
+
+	// Set while a refresh is queued or in flight, so repeated queries don't queue it again
+	bool bPending = false;
+
+	bool HasResult() const { return ResultTime >= 0.0; }
+
+	// True if the result is older than its time to live and no refresh is queued yet
+	bool NeedsRefresh(double WorldTime, float TimeToLive) const { return HasResult() && bPending == false && WorldTime - ResultTime > TimeToLive; }
+};
+
+/**
+ * FAIStatesLineOfSightCache
+ *
+ *	Line of sight results of a single controller from its pawn to its targets, one entry per target and sweep radius.
+ *	Results older than their time to live are refreshed through FAIStatesLineOfSightQueue, the previous result is served until the refresh arrives.
+ *	Queries from other view points are not cached, their results don't hold for the pawn location.
+ */
+struct LYRAGAME_API FAIStatesLineOfSightCache
+{
+	FAIStatesLineOfSightEntry* Find(const AActor* Target, float TraceSphereRadius);
+
+	// Adds entry without result if there is none yet. Entries of destroyed targets are removed first
+	FAIStatesLineOfSightEntry& FindOrAdd(const AActor* Target, float TraceSphereRadius);
+
+	void Reset() { Entries.Reset(); }
+	int32 Num() const { return Entries.Num(); }
+	SIZE_T GetAllocatedSize() const { return Entries.GetAllocatedSize(); }
+
+private:
+
+	TArray<FAIStatesLineOfSightEntry> Entries;
+};
+
+// Line of sight sweep requested by a controller
+struct FAIStatesLineOfSightRequest
+{
+	TWeakObjectPtr<const AAIStateController> Controller;
+	TWeakObjectPtr<const AActor> Target;
+	FVector From = FVector::ZeroVector;
+	FVector To = FVector::ZeroVector;
+	float TraceSphereRadius = 0.0f;
+};
+
+/**
+ * FAIStatesLineOfSightQueue
+ *
+ *	Collects line of sight sweeps of every controller during the frame and issues them together as async traces.
+ *	Results arrive one frame later and are written to line of sight caches of the requesting controllers.
+ */
+class LYRAGAME_API FAIStatesLineOfSightQueue
+{
+public:
+
+	// Collision query ignoring both the querier and the target, shared by async and blocking line of sight sweeps
+	static FCollisionQueryParams MakeQueryParams(const AActor* Querier, const AActor* Target);
+
+	void Add(const FAIStatesLineOfSightRequest& Request);
+
+	// Issues up to MaxTraces queued sweeps as async traces, the rest stays queued for the next frame. Returns number of issued sweeps
+	int32 Flush(UWorld& World, const FTraceDelegate& TraceDelegate, int32 MaxTraces);
+
+	// Writes result of a finished async trace to the cache of the requesting controller
+	void OnTraceCompleted(const FTraceDatum& TraceDatum, double WorldTime);
+
+	void Reset();
+
+	int32 GetNumQueued() const { return QueuedRequests.Num(); }
+	int32 GetNumInFlight() const { return InFlightRequests.Num(); }
+
+private:
+
+	// Requests waiting for the next flush, oldest first
+	TArray<FAIStatesLineOfSightRequest> QueuedRequests;
+
+	// Requests issued as async traces, by trace user data
+	TMap<uint32, FAIStatesLineOfSightRequest> InFlightRequests;
+
+	uint32 NextRequestId = 0;
+};
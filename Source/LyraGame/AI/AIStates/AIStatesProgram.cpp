@@ -0,0 +1,406 @@
+#include "AIStatesProgram.h"
+
+#include "AIStatesSet.h"
+#include "AIStatesStats.h"
+#include "AIStatesSubsystem.h"
+#include "AIStatesWorldSnapshot.h"
+#include "AIUtilityLibrary.h"
+
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "AbilitySystem/LyraAbilitySystemComponent.h"
+#include "InstancedStruct.h"
+
+#include "LyraGame/AI/AIStateController.h"
+
+namespace AIStatesProgram
+{
+	static TAutoConsoleVariable<int32> CVarConditionEvaluation(
+		TEXT("lyra.aistates.conditionevaluation"),
+		1,
+		TEXT("Selects how AI state conditions are evaluated.\n")
+		TEXT("0 = virtual condition calls\n")
+		TEXT("1 = compiled condition program\n")
+		TEXT("2 = both, reporting every mismatch (non shipping builds only)\n"),
+		ECVF_Cheat);
+
+	EAIStatesOpTarget ResolveTarget(EAIStatesEvaluationTarget EvaluationTargetKind)
+	{
+		switch(EvaluationTargetKind)
+		{
+		case EAIStatesEvaluationTarget::Player:
+			return EAIStatesOpTarget::Player;
+		case EAIStatesEvaluationTarget::Self:
+			return EAIStatesOpTarget::Self;
+		default:
+			return EAIStatesOpTarget::Agent;
+		}
+	}
+
+	bool ApplyInversion(bool bResult, bool bInverted)
+	{
+		return (bResult && bInverted == false) || (bResult == false && bInverted);
+	}
+}
+
+FAIStatesEvaluationContext::FAIStatesEvaluationContext(AAIStateController* InController)
+	: Controller(InController)
+{
+	if(Controller == nullptr)
+	{
+		return;
+	}
+
+	Pawn = Controller->GetPawn();
+	PlayerASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Controller->GetTarget());
+	SelfASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Pawn);
+
+	if(const UWorld* World = Controller->GetWorld())
+	{
+		if(UAIStatesSubsystem* Subsystem = World->GetSubsystem<UAIStatesSubsystem>())
+		{
+			AIStatesSubsystem = Subsystem;
+			WorldSnapshot = &Subsystem->GetWorldSnapshot();
+		}
+	}
+}
+
+void FAIStatesConditionEvaluation::EvaluateThreadSafeStates()
+{
+	if(Program == nullptr || StatesSet == nullptr)
+	{
+		return;
+	}
+
+	for(TConstSetBitIterator<> It(PendingStates); It; ++It)
+	{
+		const int32 StateIndex = It.GetIndex();
+		const int32 ConditionGroup = StatesSet->GetStateConditionGroup(StateIndex);
+		if(Program->IsGroupThreadSafe(ConditionGroup) == false)
+		{
+			continue;
+		}
+
+		Results[StateIndex] = Program->EvaluateGroup(ConditionGroup, Context);
+		EvaluatedStates[StateIndex] = true;
+	}
+}
+
+void FAIStatesProgram::Reset()
+{
+	Ops.Reset();
+	Groups.Reset();
+	TagPool.Reset();
+	AttributePool.Reset();
+}
+
+int32 FAIStatesProgram::CompileConditions(TConstArrayView<FInstancedStruct> Conditions)
+{
+	FAIStatesConditionGroup& Group = Groups.AddDefaulted_GetRef();
+	Group.FirstOp = Ops.Num();
+
+	for(const FInstancedStruct& ConditionInstancedStruct : Conditions)
+	{
+		CompileCondition(ConditionInstancedStruct);
+	}
+
+	Group.NumOps = Ops.Num() - Group.FirstOp;
+
+	for(int32 OpIndex = Group.FirstOp; OpIndex < Ops.Num(); OpIndex++)
+	{
+		if(IsOpThreadSafe(Ops[OpIndex]) == false)
+		{
+			Group.bThreadSafe = false;
+		}
+	}
+
+	return Groups.Num() - 1;
+}
+
+bool FAIStatesProgram::IsOpThreadSafe(const FAIStatesOp& Op)
+{
+	switch(Op.OpCode)
+	{
+	// Virtual conditions may touch anything
+	case EAIStatesOpCode::Virtual:
+		return Op.Condition == nullptr;
+
+	// Distance to the player goes through the AI utility library, which resolves the target pawn,
+	// distance to agents queries the spatial grid, which the game thread moves agents in
+	case EAIStatesOpCode::MaxDistance:
+		return false;
+
+	// Agents are read from the world snapshot, recent tags included. Self and player are read from live ability system components
+	case EAIStatesOpCode::Attribute:
+	case EAIStatesOpCode::HasTags:
+	case EAIStatesOpCode::TagCount:
+	case EAIStatesOpCode::RecentTag:
+		return Op.Target == EAIStatesOpTarget::Agent;
+
+	default:
+		return true;
+	}
+}
+
+void FAIStatesProgram::CompileCondition(const FInstancedStruct& ConditionInstancedStruct)
+{
+	FAIStatesOp& Op = Ops.AddDefaulted_GetRef();
+
+	const auto* Condition = ConditionInstancedStruct.GetPtr<FAIStateConditionData>();
+	if(Condition == nullptr)
+	{
+		// Empty condition always fails, same as in the virtual path
+		return;
+	}
+
+	Op.Condition = Condition;
+	Op.bInverted = Condition->bInverted;
+	Op.EvaluationTarget = Condition->EvaluationTarget;
+	Op.Target = AIStatesProgram::ResolveTarget(Condition->GetEvaluationTargetKind());
+
+	// Exact type match only, derived condition types may override CheckCondition
+	const UScriptStruct* ConditionType = ConditionInstancedStruct.GetScriptStruct();
+	if(ConditionType == FMaxDistanceToCondition::StaticStruct())
+	{
+		const auto& MaxDistanceCondition = ConditionInstancedStruct.Get<FMaxDistanceToCondition>();
+		Op.OpCode = EAIStatesOpCode::MaxDistance;
+		Op.Threshold = MaxDistanceCondition.MaxDistanceTo;
+
+		// Distance is measured to the player target or to the nearest other agent with evaluation target tag
+		Op.Target = Op.Target == EAIStatesOpTarget::Player ? EAIStatesOpTarget::Player : EAIStatesOpTarget::Agent;
+	}
+	else if(ConditionType == FAttributeChangeCondition::StaticStruct())
+	{
+		const auto& AttributeCondition = ConditionInstancedStruct.Get<FAttributeChangeCondition>();
+		Op.OpCode = EAIStatesOpCode::Attribute;
+		Op.Threshold = AttributeCondition.MinValue;
+		Op.AttributeIndex = AttributePool.AddUnique(AttributeCondition.Attribute);
+	}
+	else if(ConditionType == FGameplayTagMultipleBasedCondition::StaticStruct())
+	{
+		const auto& TagsCondition = ConditionInstancedStruct.Get<FGameplayTagMultipleBasedCondition>();
+		Op.OpCode = EAIStatesOpCode::HasTags;
+		Op.bHasAny = TagsCondition.bHasAny;
+		Op.FirstTag = TagPool.Num();
+		Op.NumTags = TagsCondition.ConditionTag.Num();
+		TagPool.Append(TagsCondition.ConditionTag.GetGameplayTagArray());
+	}
+	else if(ConditionType == FTagCountCondition::StaticStruct())
+	{
+		const auto& TagCountCondition = ConditionInstancedStruct.Get<FTagCountCondition>();
+		Op.OpCode = EAIStatesOpCode::TagCount;
+		Op.MinCount = TagCountCondition.MinCount;
+		Op.FirstTag = TagPool.Add(TagCountCondition.ConditionTag);
+		Op.NumTags = 1;
+	}
+	else if(ConditionType == FCountEnemiesWithTag::StaticStruct())
+	{
+		const auto& CountCondition = ConditionInstancedStruct.Get<FCountEnemiesWithTag>();
+		Op.OpCode = EAIStatesOpCode::CountAgentsWithTag;
+		Op.MinCount = CountCondition.MinCount;
+		Op.bInvertedHasTag = CountCondition.bInvertedHasTag;
+	}
+	else if(ConditionType == FCheckRecentlyChangedTag::StaticStruct())
+	{
+		const auto& RecentTagCondition = ConditionInstancedStruct.Get<FCheckRecentlyChangedTag>();
+		Op.OpCode = EAIStatesOpCode::RecentTag;
+		Op.Threshold = static_cast<float>(RecentTagCondition.MaxTimePassed);
+		Op.FirstTag = TagPool.Add(RecentTagCondition.RecentTag);
+		Op.NumTags = 1;
+	}
+	else
+	{
+		Op.OpCode = EAIStatesOpCode::Virtual;
+	}
+}
+
+bool FAIStatesProgram::EvaluateGroup(int32 GroupIndex, const FAIStatesEvaluationContext& Context) const
+{
+	if(!ensureMsgf(Groups.IsValidIndex(GroupIndex), TEXT("Condition group index is out of bounds!")))
+	{
+		return false;
+	}
+
+	const FAIStatesConditionGroup& Group = Groups[GroupIndex];
+	for(int32 OpIndex = Group.FirstOp; OpIndex < Group.FirstOp + Group.NumOps; OpIndex++)
+	{
+		if(EvaluateOp(Ops[OpIndex], Context) == false)
+		{
+			INC_DWORD_STAT_BY(STAT_AIStates_ConditionsEvaluated, OpIndex - Group.FirstOp + 1);
+			return false;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_AIStates_ConditionsEvaluated, Group.NumOps);
+	return true;
+}
+
+bool FAIStatesProgram::EvaluateAnyGroup(int32 FirstGroup, int32 GroupCount, const FAIStatesEvaluationContext& Context) const
+{
+	for(int32 GroupIndex = FirstGroup; GroupIndex < FirstGroup + GroupCount; GroupIndex++)
+	{
+		if(EvaluateGroup(GroupIndex, Context))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool FAIStatesProgram::EvaluateOp(const FAIStatesOp& Op, const FAIStatesEvaluationContext& Context) const
+{
+	if(Op.OpCode == EAIStatesOpCode::Virtual)
+	{
+		return Op.Condition && Op.Condition->CheckCondition(Context.Controller);
+	}
+
+	if(!ensureMsgf(Context.AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	{
+		return false;
+	}
+
+	// Agent evaluated by this operation, only used with Agent target. Tag conditions are decided by the last agent with the tag,
+	// tag counts by any agent with the tag, everything else by the first one, same as the virtual conditions
+	const FAIStatesWorldSnapshot* Snapshot = nullptr;
+	int32 AgentIndex = INDEX_NONE;
+	if(Op.Target == EAIStatesOpTarget::Agent && Op.OpCode != EAIStatesOpCode::CountAgentsWithTag && Op.OpCode != EAIStatesOpCode::MaxDistance)
+	{
+		Snapshot = Context.GetWorldSnapshot();
+		switch(Op.OpCode)
+		{
+		case EAIStatesOpCode::HasTags:
+			AgentIndex = Snapshot->FindLastAgentWithTag(Op.EvaluationTarget);
+			break;
+		case EAIStatesOpCode::TagCount:
+			AgentIndex = Snapshot->FindFirstAgentWithTagCount(Op.EvaluationTarget, GetOpTags(Op)[0], Op.MinCount);
+			break;
+		default:
+			AgentIndex = Snapshot->FindFirstAgentWithTag(Op.EvaluationTarget);
+			break;
+		}
+	}
+
+	const UAbilitySystemComponent* TargetASC = Op.Target == EAIStatesOpTarget::Player ? Context.PlayerASC : Context.SelfASC;
+	const TConstArrayView<FGameplayTag> Tags = GetOpTags(Op);
+
+	bool bResult = false;
+	switch(Op.OpCode)
+	{
+	case EAIStatesOpCode::MaxDistance:
+		if(Op.Target == EAIStatesOpTarget::Player)
+		{
+			bResult = UAIUtilityLibrary::GetDistanceToAITarget(Context.Controller) < Op.Threshold;
+		}
+		else if(Context.Pawn)
+		{
+			FAIStatesSpatialFilter Filter;
+			Filter.RequiredTag = Op.EvaluationTarget;
+			Filter.IgnoredAgent = Context.SelfASC;
+			bResult = Context.AIStatesSubsystem->GetSpatialGrid().FindNearest(Context.Pawn->GetActorLocation(), Op.Threshold, Filter) != nullptr;
+		}
+		break;
+
+	case EAIStatesOpCode::Attribute:
+		{
+			const FGameplayAttribute& Attribute = AttributePool[Op.AttributeIndex];
+			float CurrentValue = 0.0f;
+			bool bHasAttribute = false;
+			if(Op.Target != EAIStatesOpTarget::Agent)
+			{
+				if(IsValid(TargetASC))
+				{
+					CurrentValue = TargetASC->GetGameplayAttributeValue(Attribute, bHasAttribute);
+				}
+			}
+			else if(AgentIndex != INDEX_NONE)
+			{
+				bHasAttribute = Snapshot->GetAttributeValue(AgentIndex, Attribute, CurrentValue);
+			}
+			bResult = bHasAttribute && CurrentValue >= Op.Threshold;
+		}
+		break;
+
+	case EAIStatesOpCode::HasTags:
+		if(Op.Target != EAIStatesOpTarget::Agent ? IsValid(TargetASC) : AgentIndex != INDEX_NONE)
+		{
+			// Any tag passes for any matching, every tag has to pass otherwise
+			bResult = Op.bHasAny == false;
+			for(const FGameplayTag& Tag : Tags)
+			{
+				const bool bHasTag = Op.Target != EAIStatesOpTarget::Agent ? TargetASC->HasMatchingGameplayTag(Tag) : Snapshot->HasTag(AgentIndex, Tag);
+				if(bHasTag == Op.bHasAny)
+				{
+					bResult = Op.bHasAny;
+					break;
+				}
+			}
+		}
+		break;
+
+	case EAIStatesOpCode::TagCount:
+		if(Op.Target != EAIStatesOpTarget::Agent)
+		{
+			bResult = IsValid(TargetASC) && TargetASC->GetTagCount(Tags[0]) >= Op.MinCount;
+		}
+		else
+		{
+			bResult = AgentIndex != INDEX_NONE;
+		}
+		break;
+
+	case EAIStatesOpCode::CountAgentsWithTag:
+		{
+			const FAIStatesWorldSnapshot* AgentsSnapshot = Context.GetWorldSnapshot();
+			const int32 AgentsWithTag = AgentsSnapshot->CountAgentsWithTag(Op.EvaluationTarget);
+			const int32 TagsCount = Op.EvaluationTarget.IsValid() && Op.bInvertedHasTag ? AgentsSnapshot->Num() - AgentsWithTag : AgentsWithTag;
+			bResult = TagsCount >= Op.MinCount;
+		}
+		break;
+
+	case EAIStatesOpCode::RecentTag:
+		{
+			bool bHasRememberedTag = false;
+			float RecentTagPassedTime = 0.0f;
+			if(Op.Target != EAIStatesOpTarget::Agent)
+			{
+				if(const auto* LyraASC = Cast<ULyraAbilitySystemComponent>(TargetASC))
+				{
+					bHasRememberedTag = LyraASC->GetRecentTagTimePassed(Tags[0], RecentTagPassedTime);
+				}
+			}
+			else if(AgentIndex != INDEX_NONE)
+			{
+				bHasRememberedTag = Snapshot->GetRecentTagTimePassed(AgentIndex, Tags[0], RecentTagPassedTime);
+			}
+
+			// Inversion only applies to remembered tags
+			return bHasRememberedTag && AIStatesProgram::ApplyInversion(RecentTagPassedTime <= Op.Threshold, Op.bInverted);
+		}
+
+	default:
+		checkNoEntry();
+		break;
+	}
+
+	return AIStatesProgram::ApplyInversion(bResult, Op.bInverted);
+}
+
+SIZE_T FAIStatesProgram::GetAllocatedSize() const
+{
+	return Ops.GetAllocatedSize() + Groups.GetAllocatedSize() + TagPool.GetAllocatedSize() + AttributePool.GetAllocatedSize();
+}
+
+EAIStatesConditionEvaluationMode FAIStatesProgram::GetEvaluationMode()
+{
+	const int32 Mode = AIStatesProgram::CVarConditionEvaluation.GetValueOnGameThread();
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if(Mode >= static_cast<int32>(EAIStatesConditionEvaluationMode::Compare))
+	{
+		return EAIStatesConditionEvaluationMode::Compare;
+	}
+#endif
+
+	return Mode <= 0 ? EAIStatesConditionEvaluationMode::Virtual : EAIStatesConditionEvaluationMode::Compiled;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "GameplayTagContainer.h"
+
+class AAIStateController;
+class UAbilitySystemComponent;
+class UAIStatesSet;
+class UAIStatesSubsystem;
+struct FAIStateConditionData;
+struct FAIStatesProgram;
+struct FAIStatesWorldSnapshot;
+struct FInstancedStruct;
+
+// Path used to evaluate AI state conditions, selected with lyra.aistates.conditionevaluation
+enum class EAIStatesConditionEvaluationMode : uint8
+{
+	// Virtual CheckCondition call per condition
+	Virtual,
+	// Flat program compiled from the states set
+	Compiled,
+	// Runs both paths and reports every mismatch. Non shipping builds only
+	Compare
+};
+
+// Typed operation of the compiled condition program, one per condition struct type
+enum class EAIStatesOpCode : uint8
+{
+	MaxDistance,
+	Attribute,
+	HasTags,
+	TagCount,
+	CountAgentsWithTag,
+	RecentTag,
+	// Condition type without typed operation, evaluated through its virtual CheckCondition. Fails for empty conditions
+	Virtual
+};
+
+// Evaluation target of a single operation, resolved from the EvaluationTarget tag at compile time
+enum class EAIStatesOpTarget : uint8
+{
+	Player,
+	Self,
+	// Registered AI agent owning EvaluationTarget tag, picked per operation the same way as by its virtual condition
+	Agent
+};
+
+// Single compiled condition
+struct FAIStatesOp
+{
+	EAIStatesOpCode OpCode = EAIStatesOpCode::Virtual;
+	EAIStatesOpTarget Target = EAIStatesOpTarget::Agent;
+
+	bool bInverted = false;
+	bool bHasAny = false;
+	bool bInvertedHasTag = false;
+
+	// Index of the first tag in program tag pool and number of tags used by this operation
+	int32 FirstTag = INDEX_NONE;
+	int32 NumTags = 0;
+
+	// Index of the attribute in program attribute pool
+	int32 AttributeIndex = INDEX_NONE;
+
+	// Compared value: max distance, min attribute value or max time passed
+	float Threshold = 0.0f;
+
+	// Compared count for tag count operations
+	int32 MinCount = 0;
+
+	// Tag identifying evaluated agent when Target is Agent
+	FGameplayTag EvaluationTarget;
+
+	// Source condition, evaluated directly by Virtual operations
+	const FAIStateConditionData* Condition = nullptr;
+};
+
+// Range of operations which all have to pass
+struct FAIStatesConditionGroup
+{
+	int32 FirstOp = 0;
+	int32 NumOps = 0;
+
+	// False if any operation has to run on the game thread, see FAIStatesProgram::IsOpThreadSafe
+	bool bThreadSafe = true;
+};
+
+// Per evaluation cache of everything operations read, so each lookup happens once per controller update.
+// Built on the game thread, workers only read it
+struct FAIStatesEvaluationContext
+{
+	explicit FAIStatesEvaluationContext(AAIStateController* InController);
+
+	// World snapshot of this frame, resolved on construction so workers never build it
+	const FAIStatesWorldSnapshot* GetWorldSnapshot() const { return WorldSnapshot; }
+
+	AAIStateController* Controller = nullptr;
+	const APawn* Pawn = nullptr;
+	const UAbilitySystemComponent* PlayerASC = nullptr;
+	const UAbilitySystemComponent* SelfASC = nullptr;
+	const UAIStatesSubsystem* AIStatesSubsystem = nullptr;
+
+private:
+
+	const FAIStatesWorldSnapshot* WorldSnapshot = nullptr;
+};
+
+/**
+ * FAIStatesConditionEvaluation
+ *
+ *	State condition results of a single controller update.
+ *	Prepared and applied by the controller on the game thread, thread safe states may be evaluated on a worker in between.
+ */
+struct LYRAGAME_API FAIStatesConditionEvaluation
+{
+	FAIStatesConditionEvaluation() : Context(nullptr) {}
+
+	// Evaluates compiled conditions of pending states which don't need the game thread. Reads only the program and the world snapshot
+	void EvaluateThreadSafeStates();
+
+	FAIStatesEvaluationContext Context;
+	EAIStatesConditionEvaluationMode EvaluationMode = EAIStatesConditionEvaluationMode::Compiled;
+	bool bDirtyTracking = false;
+
+	// States set and its program resolved on the game thread, so workers don't touch weak pointers or compile lazily
+	const UAIStatesSet* StatesSet = nullptr;
+	const FAIStatesProgram* Program = nullptr;
+
+	// States which conditions have to be evaluated in this update, one bit per state
+	TBitArray<> PendingStates;
+
+	// States already evaluated and their results, one bit per state
+	TBitArray<> EvaluatedStates;
+	TBitArray<> Results;
+};
+
+/**
+ * FAIStatesProgram
+ *
+ *	Flat predicate program compiled from AI states set conditions once the asset is loaded.
+ *	Every state and every interrupt variant becomes a group of operations evaluated as AND, interrupt variants are evaluated as OR of their groups.
+ *	Gameplay tags and evaluation targets are resolved at compile time, so evaluation does no name lookups or virtual calls for known condition types.
+ */
+struct LYRAGAME_API FAIStatesProgram
+{
+	// Removes every compiled operation and group
+	void Reset();
+
+	// Compiles conditions into a new group and returns its index
+	int32 CompileConditions(TConstArrayView<FInstancedStruct> Conditions);
+
+	// True if every operation of the group passes
+	bool EvaluateGroup(int32 GroupIndex, const FAIStatesEvaluationContext& Context) const;
+
+	// True if any of the consecutive groups passes
+	bool EvaluateAnyGroup(int32 FirstGroup, int32 GroupCount, const FAIStatesEvaluationContext& Context) const;
+
+	// Number of compiled groups
+	int32 GetNumGroups() const { return Groups.Num(); }
+
+	// True if given group can be evaluated off the game thread
+	bool IsGroupThreadSafe(int32 GroupIndex) const { return Groups.IsValidIndex(GroupIndex) && Groups[GroupIndex].bThreadSafe; }
+
+	// Operations of given group
+	TConstArrayView<FAIStatesOp> GetGroupOps(int32 GroupIndex) const { return MakeArrayView(Ops).Slice(Groups[GroupIndex].FirstOp, Groups[GroupIndex].NumOps); }
+
+	// Tags read by given operation
+	TConstArrayView<FGameplayTag> GetOpTags(const FAIStatesOp& Op) const { return Op.NumTags > 0 ? MakeArrayView(TagPool).Slice(Op.FirstTag, Op.NumTags) : TConstArrayView<FGameplayTag>(); }
+
+	// Attribute read by given operation, nullptr if operation reads no attribute
+	const FGameplayAttribute* GetOpAttribute(const FAIStatesOp& Op) const { return AttributePool.IsValidIndex(Op.AttributeIndex) ? &AttributePool[Op.AttributeIndex] : nullptr; }
+
+	SIZE_T GetAllocatedSize() const;
+
+	// False for operations which have to run on the game thread, their groups are never evaluated on workers
+	static bool IsOpThreadSafe(const FAIStatesOp& Op);
+
+	// Evaluation path currently selected by console variable
+	static EAIStatesConditionEvaluationMode GetEvaluationMode();
+
+private:
+
+	void CompileCondition(const FInstancedStruct& ConditionInstancedStruct);
+	bool EvaluateOp(const FAIStatesOp& Op, const FAIStatesEvaluationContext& Context) const;
+
+	TArray<FAIStatesOp> Ops;
+	TArray<FAIStatesConditionGroup> Groups;
+
+	// Pools referenced by operations
+	TArray<FGameplayTag> TagPool;
+	TArray<FGameplayAttribute> AttributePool;
+};
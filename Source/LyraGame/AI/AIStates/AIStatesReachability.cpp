@@ -0,0 +1,140 @@
+#include "AIStatesReachability.h"
+
+#include "AIStatesStats.h"
+#include "NavigationSystem.h"
+#include "NavFilters/NavigationQueryFilter.h"
+#include "NavMesh/RecastNavMesh.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesReachability)
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched Reachability Raycasts"), STAT_AIStates_BatchedReachabilityRaycasts, STATGROUP_AIStates);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued Reachability Raycasts"), STAT_AIStates_QueuedReachabilityRaycasts, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Reachability"), STAT_AIStates_UpdateReachability, STATGROUP_AIStates);
+
+void FAIStatesReachabilityCache::SetCellSize(float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.0f);
+	Invalidate();
+}
+
+FAIStatesReachabilityKey FAIStatesReachabilityCache::MakeKey(const FVector& From, const FVector& To, TSubclassOf<UNavigationQueryFilter> FilterClass) const
+{
+	FAIStatesReachabilityKey Key;
+	Key.FromCell = FIntVector(FMath::FloorToInt(From.X / CellSize), FMath::FloorToInt(From.Y / CellSize), FMath::FloorToInt(From.Z / CellSize));
+	Key.ToCell = FIntVector(FMath::FloorToInt(To.X / CellSize), FMath::FloorToInt(To.Y / CellSize), FMath::FloorToInt(To.Z / CellSize));
+	Key.FilterClass = FilterClass;
+
+	return Key;
+}
+
+EAIStatesReachability FAIStatesReachabilityCache::Query(const FAIStatesReachabilityKey& Key, const FVector& From, const FVector& To, double WorldTime, float TimeToLive, bool bQueueRaycast)
+{
+	FAIStatesReachabilityEntry* Entry = Entries.Find(Key);
+	if(Entry == nullptr && bQueueRaycast)
+	{
+		Entry = &Entries.Add(Key);
+	}
+
+	if(Entry == nullptr)
+	{
+		return EAIStatesReachability::Unknown;
+	}
+
+	const bool bExpired = Entry->HasResult() == false || WorldTime - Entry->ResultTime > TimeToLive;
+	if(bExpired && bQueueRaycast && Entry->bPending == false)
+	{
+		Entry->bPending = true;
+		QueuedRequests.Add({ Key, From, To });
+	}
+
+	// Callers that don't queue raycast the segment themselves, so an expired result would never be refreshed for them
+	if(Entry->HasResult() == false || (bExpired && bQueueRaycast == false))
+	{
+		return EAIStatesReachability::Unknown;
+	}
+
+	return Entry->bReachable ? EAIStatesReachability::Reachable : EAIStatesReachability::Unreachable;
+}
+
+void FAIStatesReachabilityCache::Store(const FAIStatesReachabilityKey& Key, bool bReachable, double WorldTime)
+{
+	FAIStatesReachabilityEntry& Entry = Entries.FindOrAdd(Key);
+	Entry.ResultTime = WorldTime;
+	Entry.bReachable = bReachable;
+	Entry.bPending = false;
+}
+
+int32 FAIStatesReachabilityCache::Update(UWorld& World, int32 MaxRaycasts, float TimeToLive)
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdateReachability);
+
+	const double WorldTime = World.GetTimeSeconds();
+	if(WorldTime >= NextPruneTime)
+	{
+		for(auto It = Entries.CreateIterator(); It; ++It)
+		{
+			if(It->Value.bPending == false && WorldTime - It->Value.ResultTime > 2.0 * TimeToLive)
+			{
+				It.RemoveCurrent();
+			}
+		}
+		NextPruneTime = WorldTime + TimeToLive;
+	}
+
+	const auto* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&World);
+	const auto* NavMesh = NavSystem ? Cast<ARecastNavMesh>(NavSystem->GetDefaultNavDataInstance()) : nullptr;
+	if(NavMesh == nullptr || QueuedRequests.IsEmpty())
+	{
+		return 0;
+	}
+
+	// Segments raycast with the same query filter share one batch
+	const int32 NumToRaycast = FMath::Min(QueuedRequests.Num(), FMath::Max(MaxRaycasts, 0));
+	TArrayView<FAIStatesReachabilityRequest> Batch(QueuedRequests.GetData(), NumToRaycast);
+	Batch.StableSort([](const FAIStatesReachabilityRequest& A, const FAIStatesReachabilityRequest& B)
+	{
+		return A.Key.FilterClass.Get() < B.Key.FilterClass.Get();
+	});
+
+	TArray<FNavigationRaycastWork> Workload;
+	Workload.Reserve(NumToRaycast);
+	for(int32 BatchStart = 0; BatchStart < NumToRaycast;)
+	{
+		const TSubclassOf<UNavigationQueryFilter> FilterClass = Batch[BatchStart].Key.FilterClass;
+
+		Workload.Reset();
+		int32 BatchEnd = BatchStart;
+		for(; BatchEnd < NumToRaycast && Batch[BatchEnd].Key.FilterClass == FilterClass; BatchEnd++)
+		{
+			Workload.Emplace(Batch[BatchEnd].From, Batch[BatchEnd].To);
+		}
+
+		FSharedConstNavQueryFilter QueryFilter = FilterClass ? UNavigationQueryFilter::GetQueryFilter(*NavMesh, nullptr, FilterClass) : FSharedConstNavQueryFilter();
+		NavMesh->BatchRaycast(Workload, QueryFilter.IsValid() ? QueryFilter : NavMesh->GetDefaultQueryFilter());
+
+		for(int32 WorkIndex = 0; WorkIndex < Workload.Num(); WorkIndex++)
+		{
+			Store(Batch[BatchStart + WorkIndex].Key, Workload[WorkIndex].bDidHit == false, WorldTime);
+		}
+
+		BatchStart = BatchEnd;
+	}
+
+	QueuedRequests.RemoveAt(0, NumToRaycast, false);
+	INC_DWORD_STAT_BY(STAT_AIStates_BatchedReachabilityRaycasts, NumToRaycast);
+	SET_DWORD_STAT(STAT_AIStates_QueuedReachabilityRaycasts, QueuedRequests.Num());
+
+	return NumToRaycast;
+}
+
+void FAIStatesReachabilityCache::Invalidate()
+{
+	Entries.Reset();
+	QueuedRequests.Reset();
+}
+
+void FAIStatesReachabilityCache::Reset()
+{
+	Invalidate();
+	NextPruneTime = 0.0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+#include "AIStatesReachability.generated.h"
+
+class UNavigationQueryFilter;
+
+// Result of a non-blocking reachability query
+UENUM(BlueprintType)
+enum class EAIStatesReachability : uint8
+{
+	// No result yet, a raycast is queued
+	Unknown,
+	Reachable,
+	Unreachable
+};
+
+// Navmesh segment identified by quantized end points and the query filter used to raycast it
+struct FAIStatesReachabilityKey
+{
+	FIntVector FromCell = FIntVector::ZeroValue;
+	FIntVector ToCell = FIntVector::ZeroValue;
+	TSubclassOf<UNavigationQueryFilter> FilterClass;
+
+	bool operator==(const FAIStatesReachabilityKey& Other) const
+	{
+		return FromCell == Other.FromCell && ToCell == Other.ToCell && FilterClass == Other.FilterClass;
+	}
+
+	friend uint32 GetTypeHash(const FAIStatesReachabilityKey& Key)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Key.FromCell), GetTypeHash(Key.ToCell)), GetTypeHash(Key.FilterClass.Get()));
+	}
+};
+
+// Cached reachability of a single segment
+struct FAIStatesReachabilityEntry
+{
+	// World time at which the segment was raycast, negative until the first result arrives
+	double ResultTime = -1.0;
+
+	bool bReachable = false;
+
+	// Set while a raycast is queued, so repeated queries don't queue it again
+	bool bPending = false;
+
+	bool HasResult() const { return ResultTime >= 0.0; }
+};
+
+// Segment waiting for its raycast
+struct FAIStatesReachabilityRequest
+{
+	FAIStatesReachabilityKey Key;
+	FVector From = FVector::ZeroVector;
+	FVector To = FVector::ZeroVector;
+};
+
+/**
+ * FAIStatesReachabilityCache
+ *
+ *	Navmesh reachability shared by every controller, keyed by segment end points snapped to a grid, so bots near each other
+ *	chasing the same player share results. Missing and expired results are raycast in per frame batches, one BatchRaycast per query filter.
+ *	Every result is dropped when navmesh tiles are rebuilt.
+ */
+class LYRAGAME_API FAIStatesReachabilityCache
+{
+public:
+
+	// Changes size of the grid end points are snapped to and drops every result
+	void SetCellSize(float InCellSize);
+
+	FAIStatesReachabilityKey MakeKey(const FVector& From, const FVector& To, TSubclassOf<UNavigationQueryFilter> FilterClass) const;
+
+	// Cached result of the segment. Never blocks. With bQueueRaycast set, missing and expired results are queued for raycast and
+	// expired results are still returned. Without it, expired results are unknown so blocking callers raycast and store a fresh one
+	EAIStatesReachability Query(const FAIStatesReachabilityKey& Key, const FVector& From, const FVector& To, double WorldTime, float TimeToLive, bool bQueueRaycast = true);
+
+	void Store(const FAIStatesReachabilityKey& Key, bool bReachable, double WorldTime);
+
+	// Raycasts up to MaxRaycasts queued segments and stores their results. Returns number of raycast segments
+	int32 Update(UWorld& World, int32 MaxRaycasts, float TimeToLive);
+
+	// Drops every result and queued raycast, called when navmesh tiles are rebuilt
+	void Invalidate();
+
+	void Reset();
+
+	int32 Num() const { return Entries.Num(); }
+	int32 GetNumQueued() const { return QueuedRequests.Num(); }
+
+private:
+
+	TMap<FAIStatesReachabilityKey, FAIStatesReachabilityEntry> Entries;
+
+	// Segments waiting for raycast, oldest first
+	TArray<FAIStatesReachabilityRequest> QueuedRequests;
+
+	float CellSize = 100.0f;
+
+	// World time at which results nobody asked for within two times to live are removed
+	double NextPruneTime = 0.0;
+};
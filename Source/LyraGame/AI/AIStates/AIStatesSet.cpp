@@ -4,6 +4,7 @@
 #include "AIStatesSet.h"
 
 #include "AIStatesSubsystem.h"
+#include "AIStatesWorldSnapshot.h"
 
 #include "AbilitySystemComponent.h"
 #include "AbilitySystemGlobals.h"
@@ -12,50 +13,81 @@
 #include "LyraGame/AI/AIStates/AIUtilityLibrary.h"
 #include "LyraGame/AI/AIStateController.h"
 
+DECLARE_CYCLE_STAT(TEXT("Should Interrupt"), STAT_AIStates_ShouldInterrupt, STATGROUP_AIStates);
+
+namespace AIConditions
+{
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(ConditionLeader, "AI.Condition.Leader", "Condition evaluated against the squad leader.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(ConditionRegular, "AI.Condition.Regular", "Condition evaluated against regular AI agents.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(ConditionAnyAI, "AI.Condition.AnyAI", "Condition evaluated against any AI agent.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(ConditionSelf, "AI.Condition.Self", "Condition evaluated against the pawn of the evaluating AI.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(ConditionPlayer, "AI.Condition.Player", "Condition evaluated against the current target of the evaluating AI.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(RequestMoveTo, "AI.Request.MoveTo", "Triggers the move to location ability.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(RequestApproachTarget, "AI.Request.ApproachTarget", "Triggers the approach target ability.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(RequestOrbit, "AI.Request.Orbit", "Triggers the orbit ability.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(RequestWait, "AI.Request.Wait", "Triggers the wait ability.");
+	UE_DEFINE_GAMEPLAY_TAG_COMMENT(RequestAction, "AI.Request.Action", "Triggers an AI action ability.");
+}
+
+void FAIStateConditionData::RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const
+{
+	if(ReadsOtherAgents())
+	{
+		Snapshot.RegisterTag(EvaluationTarget);
+	}
+}
+
+bool FAIStateConditionData::ReadsOtherAgents() const
+{
+	const EAIStatesEvaluationTarget Kind = GetEvaluationTargetKind();
+	return Kind != EAIStatesEvaluationTarget::Player && Kind != EAIStatesEvaluationTarget::Self;
+}
+
+EAIStatesEvaluationTarget FAIStateConditionData::ClassifyEvaluationTarget(const FGameplayTag& Tag)
+{
+	if(Tag == AIConditions::ConditionPlayer)
+	{
+		return EAIStatesEvaluationTarget::Player;
+	}
+
+	if(Tag == AIConditions::ConditionSelf)
+	{
+		return EAIStatesEvaluationTarget::Self;
+	}
+
+	return Tag == AIConditions::ConditionAnyAI ? EAIStatesEvaluationTarget::AnyAI : EAIStatesEvaluationTarget::Tagged;
+}
+
 bool FMaxDistanceToCondition::CheckCondition(AAIStateController* SourceAI) const
 {
-	if(ensureMsgf(SourceAI != nullptr, TEXT("SourceAI is nullptr!")))
+	if(!ensureMsgf(SourceAI != nullptr, TEXT("SourceAI is nullptr!")))
 	{
 		return false;
 	}
 
-	if(ensureMsgf(SourceAI->GetWorld() != nullptr, TEXT("World is nullptr!")))
+	if(!ensureMsgf(SourceAI->GetWorld() != nullptr, TEXT("World is nullptr!")))
 	{
 		return false;
 	}
 
-	const auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
 	{
 		return false;
 	}
 	
 	bool bResult = false;
-	if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionPlayerTagName))
+	if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Player)
 	{
 		bResult = UAIUtilityLibrary::GetDistanceToAITarget(SourceAI) < this->MaxDistanceTo;	
 	}
-	else
+	else if(const APawn* SourcePawn = SourceAI->GetPawn())
 	{
-		const TArray<TObjectPtr<UAbilitySystemComponent>>& AIsASCList = AIStatesSubsystem->GetActiveAIActors();
-		for(const TObjectPtr<UAbilitySystemComponent>& ASC : AIsASCList)
-		{
-			if(!ASC == false)
-			{
-				continue;
-			}
-			
-			const AActor* AIActor = ASC->GetOwnerActor();
-			const APawn* SourcePawn = SourceAI->GetPawn();
-
-			// Check for specific AI Tag Identifiers
-			if(EvaluationTarget.IsValid() == false || ASC.Get()->HasMatchingGameplayTag(EvaluationTarget)
-				&& ASC->GetOwnerActor() && SourceAI->GetPawn())
-			{
-				bResult = FVector::Distance(AIActor->GetActorLocation(), SourcePawn->GetActorLocation()) < this->MaxDistanceTo; 
-				break;
-			}
-		}
+		// Nearest other AI agent with specific AI Tag Identifier
+		FAIStatesSpatialFilter Filter;
+		Filter.RequiredTag = EvaluationTarget;
+		Filter.IgnoredAgent = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourcePawn);
+		bResult = AIStatesSubsystem->GetSpatialGrid().FindNearest(SourcePawn->GetActorLocation(), this->MaxDistanceTo, Filter) != nullptr;
 	}
 
 	return (bResult && bInverted == false) || (bResult == false && bInverted);
@@ -64,14 +96,14 @@ bool FMaxDistanceToCondition::CheckCondition(AAIStateController* SourceAI) const
 // Tags - check either all matching tags or any matching tag, can be used with single/multiple tags
 bool FGameplayTagMultipleBasedCondition::CheckCondition(AAIStateController* SourceAI) const
 {
-	const auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
 	{
 		return false;
 	}
 
 	bool bResult = false;
-	if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionPlayerTagName))
+	if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Player)
 	{
 		auto* PlayerASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetTarget());
 		if(IsValid(PlayerASC))
@@ -79,7 +111,7 @@ bool FGameplayTagMultipleBasedCondition::CheckCondition(AAIStateController* Sour
 			bResult = bHasAny ? PlayerASC->HasAnyMatchingGameplayTags(ConditionTag) : PlayerASC->HasAllMatchingGameplayTags(ConditionTag);
 		}
 	}
-	else if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionSelfTagName))
+	else if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Self)
 	{
 		const auto* SourceASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetPawn());
 		if(IsValid(SourceASC))
@@ -89,35 +121,41 @@ bool FGameplayTagMultipleBasedCondition::CheckCondition(AAIStateController* Sour
 	}
 	else
 	{
-		const auto& AIsASCList = AIStatesSubsystem->GetActiveAIActors();
-		for(const auto& ASC : AIsASCList)
+		// Check for specific AI Tag Identifiers, the last matching agent decides
+		const FAIStatesWorldSnapshot& Snapshot = AIStatesSubsystem->GetWorldSnapshot();
+		const int32 AgentIndex = Snapshot.FindLastAgentWithTag(EvaluationTarget);
+		if(AgentIndex != INDEX_NONE)
 		{
-			if(!ASC == false)
-			{
-				continue;
-			}
-
-			// Check for specific AI Tag Identifiers
-			if(EvaluationTarget.IsValid() == false || ASC.Get()->HasMatchingGameplayTag(EvaluationTarget))
-			{
-				bResult = bHasAny ? ASC.Get()->HasAnyMatchingGameplayTags(ConditionTag) : ASC.Get()->HasAllMatchingGameplayTags(ConditionTag);
-			}
+			bResult = bHasAny ? Snapshot.HasAnyTags(AgentIndex, ConditionTag) : Snapshot.HasAllTags(AgentIndex, ConditionTag);
 		}
 	}
 	
 	return (bResult && bInverted == false) || (bResult == false && bInverted);
 }
 
+void FGameplayTagMultipleBasedCondition::RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const
+{
+	Super::RegisterSnapshotInputs(Snapshot);
+
+	if(ReadsOtherAgents())
+	{
+		for(const FGameplayTag& Tag : ConditionTag)
+		{
+			Snapshot.RegisterTag(Tag);
+		}
+	}
+}
+
 bool FTagCountCondition::CheckCondition(AAIStateController* SourceAI) const
 {
-	const auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
 	{
 		return false;
 	}
 
 	bool bResult = false;
-	if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionPlayerTagName))
+	if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Player)
 	{
 		const auto* PlayerASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetTarget());
 		if(IsValid(PlayerASC) && PlayerASC->GetTagCount(ConditionTag) >= MinCount)
@@ -125,7 +163,7 @@ bool FTagCountCondition::CheckCondition(AAIStateController* SourceAI) const
 			bResult = true;
 		}
 	}
-	else if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionSelfTagName))
+	else if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Self)
 	{
 		const auto* SourceASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetPawn());
 		if(SourceASC && SourceASC->GetTagCount(ConditionTag) >= MinCount)
@@ -135,50 +173,36 @@ bool FTagCountCondition::CheckCondition(AAIStateController* SourceAI) const
 	}
 	else
 	{
-		const TArray<TObjectPtr<UAbilitySystemComponent>>& AIASCList = AIStatesSubsystem->GetActiveAIActors();
-		for(const TObjectPtr<UAbilitySystemComponent>& ASC : AIASCList)
-		{
-			if(!ASC)
-			{
-				continue;
-			}
-
-			// Check for specific AI Tag Identifiers
-			if(EvaluationTarget.IsValid() == false || ASC.Get()->HasMatchingGameplayTag(EvaluationTarget)
-				&& ASC.Get()->GetTagCount(ConditionTag) >= MinCount)
-			{
-				bResult = true;
-				break;
-			}
-		}
+		// Check for specific AI Tag Identifiers, any agent with enough tags passes
+		const FAIStatesWorldSnapshot& Snapshot = AIStatesSubsystem->GetWorldSnapshot();
+		bResult = Snapshot.FindFirstAgentWithTagCount(EvaluationTarget, ConditionTag, MinCount) != INDEX_NONE;
 	}
 	
 	return (bResult && bInverted == false) || (bResult == false && bInverted);
 }
 
-bool FCountEnemiesWithTag::CheckCondition(AAIStateController* SourceAI) const
+void FTagCountCondition::RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const
 {
-	const auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	Super::RegisterSnapshotInputs(Snapshot);
+
+	if(ReadsOtherAgents())
 	{
-		return false;
+		Snapshot.RegisterTag(ConditionTag);
 	}
+}
 
-	int32 TagsCount = 0;
-	const TArray<TObjectPtr<UAbilitySystemComponent>>& AIASCList = AIStatesSubsystem->GetActiveAIActors();
-	for(const TObjectPtr<UAbilitySystemComponent>& ASC : AIASCList)
+bool FCountEnemiesWithTag::CheckCondition(AAIStateController* SourceAI) const
+{
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
 	{
-		if(!ASC == false)
-		{
-			continue;
-		}
-
-		// Check for specific AI Tag Identifiers
-		if(EvaluationTarget.IsValid() == false || ASC.Get()->HasMatchingGameplayTag(EvaluationTarget) != bInvertedHasTag)
-		{
-			TagsCount++;
-		}
+		return false;
 	}
+
+	// Check for specific AI Tag Identifiers
+	const FAIStatesWorldSnapshot& Snapshot = AIStatesSubsystem->GetWorldSnapshot();
+	const int32 AgentsWithTag = Snapshot.CountAgentsWithTag(EvaluationTarget);
+	const int32 TagsCount = EvaluationTarget.IsValid() && bInvertedHasTag ? Snapshot.Num() - AgentsWithTag : AgentsWithTag;
 	
 	const bool bResult = TagsCount >= MinCount;
 	
@@ -187,17 +211,17 @@ bool FCountEnemiesWithTag::CheckCondition(AAIStateController* SourceAI) const
 
 bool FCheckRecentlyChangedTag::CheckCondition(AAIStateController* SourceAI) const
 {
-	const auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
 	{
 		return false;
 	}
 
 	bool bResult = false;
 	
-	float bHasRememberedTag = false;
+	bool bHasRememberedTag = false;
 	float RecentTagPassedTime = 0.0f;
-	if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionPlayerTagName))
+	if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Player)
 	{
 		const auto* PlayerASC = Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetTarget()));
 		if(PlayerASC)
@@ -205,9 +229,9 @@ bool FCheckRecentlyChangedTag::CheckCondition(AAIStateController* SourceAI) cons
 			bHasRememberedTag = PlayerASC->GetRecentTagTimePassed(RecentTag, RecentTagPassedTime);
 		}
 	}
-	else if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionSelfTagName))
+	else if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Self)
 	{
-		const auto* SourceASC = Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetTarget()));
+		const auto* SourceASC = Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetPawn()));
 		if(SourceASC)
 		{
 			bHasRememberedTag = SourceASC->GetRecentTagTimePassed(RecentTag, RecentTagPassedTime);
@@ -215,21 +239,12 @@ bool FCheckRecentlyChangedTag::CheckCondition(AAIStateController* SourceAI) cons
 	}
 	else
 	{
-		const auto& AIsASCList = AIStatesSubsystem->GetActiveAIActors();
-		for(const auto& ASC : AIsASCList)
+		// Check for specific AI Tag Identifiers
+		const FAIStatesWorldSnapshot& Snapshot = AIStatesSubsystem->GetWorldSnapshot();
+		const int32 AgentIndex = Snapshot.FindFirstAgentWithTag(EvaluationTarget);
+		if(AgentIndex != INDEX_NONE)
 		{
-			if(!ASC)
-			{
-				continue;
-			}
-			const auto* AbilitySystemComp = Cast<ULyraAbilitySystemComponent>(ASC.Get());
-			
-			// Check for specific AI Tag Identifiers
-			if(EvaluationTarget.IsValid() == false || (IsValid(AbilitySystemComp) && AbilitySystemComp->HasMatchingGameplayTag(EvaluationTarget)))
-			{
-				bHasRememberedTag = AbilitySystemComp->GetRecentTagTimePassed(RecentTag, RecentTagPassedTime);
-				break;
-			}
+			bHasRememberedTag = Snapshot.GetRecentTagTimePassed(AgentIndex, RecentTag, RecentTagPassedTime);
 		}
 	}
 
@@ -242,20 +257,152 @@ bool FCheckRecentlyChangedTag::CheckCondition(AAIStateController* SourceAI) cons
 	return bResult;
 }
 
+void FCheckRecentlyChangedTag::RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const
+{
+	Super::RegisterSnapshotInputs(Snapshot);
+
+	if(ReadsOtherAgents())
+	{
+		Snapshot.RegisterRecentTag(RecentTag);
+	}
+}
+
+bool FHasDirectNavPathCondition::CheckCondition(AAIStateController* SourceAI) const
+{
+	if(!ensureMsgf(SourceAI != nullptr, TEXT("SourceAI is nullptr!")))
+	{
+		return false;
+	}
+
+	const EAIStatesReachability Reachability = SourceAI->QueryDirectNavPathToActor(SourceAI->GetTarget(), OffsetFromTarget);
+	const bool bResult = Reachability == EAIStatesReachability::Unknown ? bPassWhileUnknown : Reachability == EAIStatesReachability::Reachable;
+
+	return (bResult && bInverted == false) || (bResult == false && bInverted);
+}
+
+bool FHasAttackTokenCondition::CheckCondition(AAIStateController* SourceAI) const
+{
+	if(!ensureMsgf(SourceAI != nullptr, TEXT("SourceAI is nullptr!")))
+	{
+		return false;
+	}
+
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	AActor* Target = SourceAI->GetTarget();
+	if(AIStatesSubsystem == nullptr || Target == nullptr)
+	{
+		return bInverted;
+	}
+
+	if(bRequestToken)
+	{
+		AIStatesSubsystem->RequestAttackToken(SourceAI, Target, Threat);
+	}
+
+	const bool bResult = AIStatesSubsystem->HasAttackToken(SourceAI, Target);
+	return (bResult && bInverted == false) || (bResult == false && bInverted);
+}
+
+FAIInterruptibleActionData::FAIInterruptibleActionData(const FAIInterruptibleActionData& Other)
+	: ConditionsToInterrupt(Other.ConditionsToInterrupt)
+	, MinDuration(Other.MinDuration)
+	, MaxDuration(Other.MaxDuration)
+{
+}
+
+FAIInterruptibleActionData& FAIInterruptibleActionData::operator=(const FAIInterruptibleActionData& Other)
+{
+	ConditionsToInterrupt = Other.ConditionsToInterrupt;
+	MinDuration = Other.MinDuration;
+	MaxDuration = Other.MaxDuration;
+
+	// Group indexes of the source point into another program, or into this one before the data changed
+	CompiledVariantsStart = INDEX_NONE;
+	CompiledDependencies.Reset();
+	return *this;
+}
+
+bool FAIInterruptibleActionData::ShouldInterrupt(AAIStateController* SourceController) const
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_ShouldInterrupt);
+
+	auto EvaluateVirtual = [this, SourceController]()
+	{
+		for(const auto& [VariantTitle, ConditionsVariant] : ConditionsToInterrupt)
+		{
+			bool IsConditionsVariantValid = true;
+
+			for(const FInstancedStruct& ConditionInstancedStruct : ConditionsVariant)
+			{
+				const auto* Condition = ConditionInstancedStruct.GetPtr<FAIStateConditionData>();
+				if(Condition == nullptr)
+				{
+					IsConditionsVariantValid = false;
+					break;
+				}
+
+				AISTATES_SCOPE_CONDITION(FAIStatesConditionProfile::ForType(ConditionInstancedStruct.GetScriptStruct()));
+				INC_DWORD_STAT(STAT_AIStates_ConditionsEvaluated);
+				if(Condition->CheckCondition(SourceController) == false)
+				{
+					IsConditionsVariantValid = false;
+					break;
+				}
+			}
+
+			// If any group was valid return true
+			if(IsConditionsVariantValid)
+			{
+				INC_DWORD_STAT(STAT_AIStates_InterruptsFired);
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	// Copies of set data are never compiled and fall back to virtual calls, same as data of a set recompiled with fewer groups
+	UAIStatesSet* AIStatesSet = SourceController ? SourceController->GetAIStatesSetConfig() : nullptr;
+	const FAIStatesProgram* ConditionProgram = AIStatesSet ? &AIStatesSet->GetConditionProgram() : nullptr;
+	const bool bCompiled = ConditionProgram && CompiledVariantsStart != INDEX_NONE
+		&& CompiledVariantsStart + ConditionsToInterrupt.Num() <= ConditionProgram->GetNumGroups();
+
+	const EAIStatesConditionEvaluationMode EvaluationMode = FAIStatesProgram::GetEvaluationMode();
+	if(bCompiled == false || EvaluationMode == EAIStatesConditionEvaluationMode::Virtual)
+	{
+		return EvaluateVirtual();
+	}
+
+	FAIStatesEvaluationContext EvaluationContext(SourceController);
+	const bool bResult = ConditionProgram->EvaluateAnyGroup(CompiledVariantsStart, ConditionsToInterrupt.Num(), EvaluationContext);
+	if(bResult)
+	{
+		INC_DWORD_STAT(STAT_AIStates_InterruptsFired);
+	}
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if(EvaluationMode == EAIStatesConditionEvaluationMode::Compare && EvaluateVirtual() != bResult)
+	{
+		UE_LOG(LogTemp, Error, TEXT("FAIInterruptibleActionData::ShouldInterrupt - Compiled interrupt conditions of %s differ from virtual conditions!"), *GetNameSafe(AIStatesSet))
+	}
+#endif
+
+	return bResult;
+}
+
 TSubclassOf<ULyraGameplayAbility> FAIStateInterruptibleAbility::Activate(AAIStateController* SourceAI)
 {
-	if(ensureMsgf(SourceAI != nullptr, TEXT("Source AI is nullptr!")))
+	if(!ensureMsgf(SourceAI != nullptr, TEXT("Source AI is nullptr!")))
 	{
 		return nullptr;
 	}
 	
 	auto* AbilitySystemComp = Cast<ULyraAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetPawn()));
-	if(ensureMsgf(AbilitySystemComp != nullptr, TEXT("Ability system component is nullptr!")))
+	if(!ensureMsgf(AbilitySystemComp != nullptr, TEXT("Ability system component is nullptr!")))
 	{
 		return nullptr;
 	}
 
-	const FGameplayTag InterruptibleAbilityTag = FGameplayTag::RequestGameplayTag(InterruptibleAbilityTagName);
 	const FGameplayAbilitySpec* AbilitySpec = AbilitySystemComp->GetActivatableGameplayAbilitySpecByTag(InterruptibleAbilityTag);
 
 	// Activate ability sending Interruptible data within payload
@@ -274,33 +421,21 @@ TSubclassOf<ULyraGameplayAbility> FAIStateInterruptibleAbility::Activate(AAIStat
 
 bool FAIStateInterruptibleAbility::ShouldAbilityBeInterrupted(AAIStateController* SourceController)
 {
-	for(const auto& [VariantTitle, ConditionsVariant] : InterruptibleActionData.ConditionsToInterrupt)
-	{
-		bool IsConditionsVariantValid = true;
-
-		for(const FInstancedStruct& ConditionInstancedStruct : ConditionsVariant)
-		{
-			const auto* Condition = ConditionInstancedStruct.GetPtr<FAIStateConditionData>();
-			if(Condition == nullptr || Condition->CheckCondition(SourceController) == false)
-			{
-				IsConditionsVariantValid = false;
-				break;
-			}
-		}
-
-		// If any group was valid return true
-		if(IsConditionsVariantValid)
-		{
-			return true;
-		}
-	}
-	
-	return false;
+	return InterruptibleActionData.ShouldInterrupt(SourceController);
 }
 
-float FAIStateInterruptibleAbility::GetMaxDuration() const
+float FAIStateInterruptibleAbility::GetMaxDuration(AAIStateController* SourceAI) const
 {
-	return FMath::RandRange(InterruptibleActionData.MinDuration, InterruptibleActionData.MaxDuration);
+	if(!ensureMsgf(SourceAI != nullptr, TEXT("Source AI is nullptr!")))
+	{
+		return InterruptibleActionData.MinDuration;
+	}
+
+	// Rolled by the decision stream of the controller as the only candidate, the roll places the duration in the range
+	FAIStatesDecision DurationDecision(EAIStatesDecisionKind::Roll, INDEX_NONE);
+	DurationDecision.AddCandidate(0, 1.0f);
+	SourceAI->PickDecision(DurationDecision);
+	return FMath::Lerp(InterruptibleActionData.MinDuration, InterruptibleActionData.MaxDuration, DurationDecision.GetRecord().Roll);
 }
 
 TSubclassOf<ULyraGameplayAbility> FWeightedAbility::Activate(AAIStateController* SourceAI)
@@ -328,7 +463,7 @@ bool FWeightedAbility::CanAbilityBeActivated(AAIStateController* SourceAI) const
 	return ASC->CanActivateAbilityByClass(AbilityClass, OwnedGameplayTagContainer, FailureTagsEmpty);
 }
 
-FString FWeightedAbility::GetAbilityName()
+FString FWeightedAbility::GetAbilityName() const
 {
 	return AbilityClass ? AbilityClass->GetName().LeftChop(2) : FString("None");
 }
@@ -342,53 +477,216 @@ bool FWeightedAbility::GetApproachTargetData(FApproachTargetData& OutApproachTar
 // Attributes
 bool FAttributeChangeCondition::CheckCondition(AAIStateController* SourceAI) const
 {
-	const auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
-	if(ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
+	auto* AIStatesSubsystem = SourceAI->GetWorld()->GetSubsystem<UAIStatesSubsystem>();
+	if(!ensureMsgf(AIStatesSubsystem != nullptr, TEXT("AI states subsystem is nullptr!")))
 	{
 		return false;
 	}
 
 	// Lambda to check attribute value
-	auto CheckAttributeValue = [&](const auto* ASC) -> TOptional<bool> {
-		if (!IsValid(ASC)) return FNullOpt{false};
+	auto CheckAttributeValue = [&](const auto* ASC) -> bool {
+		if (!IsValid(ASC)) return false;
 
 		bool bHasAttribute;
 		const float CurrentValue = ASC->GetGameplayAttributeValue(Attribute, bHasAttribute);
 		return bHasAttribute ? CurrentValue >= MinValue : false;
 	};
 
-	TOptional bResult = false;
-	if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionPlayerTagName))
+	bool bResult = false;
+	if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Player)
 	{
 		const UAbilitySystemComponent* PlayerASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetTarget());
 		bResult = CheckAttributeValue(PlayerASC);
 	}
-	else if(EvaluationTarget == FGameplayTag::RequestGameplayTag(AIConditions::ConditionSelfTagName))
+	else if(GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Self)
 	{
 		const UAbilitySystemComponent* SourceASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(SourceAI->GetPawn());
 		bResult = CheckAttributeValue(SourceASC);
 	}
 	else
 	{
-		const TArray<TObjectPtr<UAbilitySystemComponent>>& AIASCList = AIStatesSubsystem->GetActiveAIActors();
-		for(const TObjectPtr<UAbilitySystemComponent>& ASC : AIASCList)
+		// Check for specific AI Tag Identifiers
+		const FAIStatesWorldSnapshot& Snapshot = AIStatesSubsystem->GetWorldSnapshot();
+		const int32 AgentIndex = Snapshot.FindFirstAgentWithTag(EvaluationTarget);
+		float CurrentValue = 0.0f;
+		if(AgentIndex != INDEX_NONE && Snapshot.GetAttributeValue(AgentIndex, Attribute, CurrentValue))
+		{
+			bResult = CurrentValue >= MinValue;
+		}
+	}
+	
+	return (bResult && bInverted == false) || (bResult == false && bInverted);
+}
+
+void FAttributeChangeCondition::RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const
+{
+	Super::RegisterSnapshotInputs(Snapshot);
+
+	if(ReadsOtherAgents())
+	{
+		Snapshot.RegisterAttribute(Attribute);
+	}
+}
+
+void UAIStatesSet::PostLoad()
+{
+	Super::PostLoad();
+
+	CompileConditionProgram();
+}
+
+#if WITH_EDITOR
+void UAIStatesSet::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	CompileConditionProgram();
+}
+#endif
+
+void UAIStatesSet::ForEachCondition(TFunctionRef<void(const FAIStateConditionData&)> Visitor) const
+{
+	for(const FAIStateDataConfig& State : States)
+	{
+		for(const FInstancedStruct& ConditionInstancedStruct : State.Conditions)
 		{
-			if(!ASC)
+			if(const auto* Condition = ConditionInstancedStruct.GetPtr<FAIStateConditionData>())
+			{
+				Visitor(*Condition);
+			}
+		}
+	}
+
+	ForEachInterruptibleData([&Visitor](const FAIInterruptibleActionData& InterruptibleData)
+	{
+		for(const FAIStateConditionsVariant& Variant : InterruptibleData.ConditionsToInterrupt)
+		{
+			for(const FInstancedStruct& ConditionInstancedStruct : Variant.ConditionsVariant)
+			{
+				if(const auto* Condition = ConditionInstancedStruct.GetPtr<FAIStateConditionData>())
+				{
+					Visitor(*Condition);
+				}
+			}
+		}
+	});
+}
+
+void UAIStatesSet::ForEachInterruptibleData(TFunctionRef<void(const FAIInterruptibleActionData&)> Visitor) const
+{
+	Visitor(DefaultApproachData.InterruptibleData);
+
+	for(const FAIStateDataConfig& State : States)
+	{
+		for(const FAIStateAbilityNamedWrapper& AbilityWrapper : State.Abilities)
+		{
+			const auto* Ability = AbilityWrapper.Ability.GetPtr<FAIStateActionData>();
+			if(Ability == nullptr)
 			{
 				continue;
 			}
 
-			// Check for specific AI Tag Identifiers
-			if(EvaluationTarget.IsValid() == false || ASC.Get()->HasMatchingGameplayTag(EvaluationTarget))
+			if(const FAIInterruptibleActionData* InterruptibleData = Ability->GetInterruptibleActionData())
 			{
-				bool bHasAttribute;
-				const auto CurrentValue = ASC.Get()->GetGameplayAttributeValue(Attribute,bHasAttribute);
-			
-				bResult = bHasAttribute ? CurrentValue >= MinValue : false;
-				break;
+				Visitor(*InterruptibleData);
+			}
+
+			if(const FAIInterruptibleActionData* ApproachInterruptibleData = Ability->GetApproachInterruptibleActionData())
+			{
+				Visitor(*ApproachInterruptibleData);
 			}
 		}
 	}
-	
-	return (bResult && bInverted == false) || (bResult == false && bInverted);
-}
\ No newline at end of file
+}
+
+void UAIStatesSet::CompileConditionProgram()
+{
+	ConditionProgram.Reset();
+	StateConditionGroups.Reset(States.Num());
+
+	// Evaluation targets are classified once here instead of comparing tags on every check
+	ForEachCondition([](const FAIStateConditionData& Condition)
+	{
+		Condition.ResolveEvaluationTarget();
+	});
+
+	for(const FAIStateDataConfig& State : States)
+	{
+		StateConditionGroups.Add(ConditionProgram.CompileConditions(State.Conditions));
+	}
+
+	// Variants of each interrupt data are compiled into consecutive groups
+	ForEachInterruptibleData([this](const FAIInterruptibleActionData& InterruptibleData)
+	{
+		InterruptibleData.CompiledVariantsStart = ConditionProgram.GetNumGroups();
+		for(const FAIStateConditionsVariant& Variant : InterruptibleData.ConditionsToInterrupt)
+		{
+			ConditionProgram.CompileConditions(Variant.ConditionsVariant);
+		}
+
+		InterruptibleData.CompiledDependencies.Build(ConditionProgram, InterruptibleData.CompiledVariantsStart, InterruptibleData.ConditionsToInterrupt.Num());
+	});
+
+	DependencyIndex.Build(ConditionProgram, StateConditionGroups);
+
+	RuntimeStates.Reset(States.Num());
+	for(FAIStateDataConfig& State : States)
+	{
+		FAIStateRuntimeData& RuntimeState = RuntimeStates.AddDefaulted_GetRef();
+		RuntimeState.StateWeight = State.StateWeight;
+		RuntimeState.bMakeBlockedOnExit = State.bBlockOnExit;
+		RuntimeState.TraceName = FString::Printf(TEXT("%s.%s"), *GetName(), *State.StateName.ToString());
+
+		for(const FInstancedStruct& ConditionInstancedStruct : State.Conditions)
+		{
+			const FAIStateConditionData* Condition = ConditionInstancedStruct.GetPtr<FAIStateConditionData>();
+			RuntimeState.Conditions.Add(Condition);
+			RuntimeState.ConditionProfiles.Add(FAIStatesConditionProfile::Make(ConditionInstancedStruct.GetScriptStruct(), this, State.StateName));
+
+			if(Condition && Condition->IsEvaluatedPerSquadMember())
+			{
+				RuntimeState.SquadMemberConditions.Add(Condition);
+			}
+		}
+
+		for(FAIStateAbilityNamedWrapper& AbilityWrapper : State.Abilities)
+		{
+			if(auto* StateActionData = AbilityWrapper.Ability.GetMutablePtr<FAIStateActionData>())
+			{
+				RuntimeState.Abilities.Add(StateActionData);
+			}
+		}
+	}
+
+	bConditionProgramCompiled = true;
+}
+
+const FAIStatesProgram& UAIStatesSet::GetConditionProgram()
+{
+	if(bConditionProgramCompiled == false)
+	{
+		CompileConditionProgram();
+	}
+
+	return ConditionProgram;
+}
+
+const FAIStatesDependencyIndex& UAIStatesSet::GetDependencyIndex()
+{
+	if(bConditionProgramCompiled == false)
+	{
+		CompileConditionProgram();
+	}
+
+	return DependencyIndex;
+}
+
+const TArray<FAIStateRuntimeData>& UAIStatesSet::GetRuntimeStates()
+{
+	if(bConditionProgramCompiled == false)
+	{
+		CompileConditionProgram();
+	}
+
+	return RuntimeStates;
+}
@@ -5,34 +5,54 @@
 #include "CoreMinimal.h"
 #include "AttributeSet.h"
 #include "GameplayTagContainer.h"
+#include "NativeGameplayTags.h"
 #include "Engine/DataAsset.h"
 #include "InstancedStruct.h"
 #include "EnvironmentQuery/EnvQueryTypes.h"
+#include "AIStatesProgram.h"
+#include "AIStatesDependencyIndex.h"
+#include "AIStatesEQSCache.h"
+#include "AIStatesStats.h"
 
 #include "AIStatesSet.generated.h"
 
 enum class EMovementGait : uint8;
 struct FAISatesActorData;
+struct FAIStatesWorldSnapshot;
 struct FEnvNamedValue;
 
 class AAIStateController;
 class UEnvQuery;
 class ULyraGameplayAbility;
 
+// Native tags used by AI states, registered with the tag manager at module startup
 namespace AIConditions
 {
-	static FName ConditionLeaderTagName = TEXT("AI.Condition.Leader");
-	static FName ConditionRegularTagName = TEXT("AI.Condition.Regular");
-	static FName ConditionAnyAITagName = TEXT("AI.Condition.AnyAI");
-	static FName ConditionSelfTagName = TEXT("AI.Condition.Self");
-	static FName ConditionPlayerTagName = TEXT("AI.Condition.Player");
-	static FName RequestMoveToTagName = TEXT("AI.Request.MoveTo");
-	static FName ApproachTargetTagName = TEXT("AI.Request.ApproachTarget");
-	static FName RequestOrbitTagName = TEXT("AI.Request.Orbit");
-	static FName RequestWaitTagName = TEXT("AI.Request.Wait");
-	static FName RequestActionTagName = TEXT("AI.Request.Action");
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(ConditionLeader);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(ConditionRegular);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(ConditionAnyAI);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(ConditionSelf);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(ConditionPlayer);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(RequestMoveTo);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(RequestApproachTarget);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(RequestOrbit);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(RequestWait);
+	LYRAGAME_API	UE_DECLARE_GAMEPLAY_TAG_EXTERN(RequestAction);
 }
 
+// Kind of the condition evaluation target, classified from the EvaluationTarget tag when the states set loads
+enum class EAIStatesEvaluationTarget : uint8
+{
+	// Current target of the controller
+	Player,
+	// Pawn of the evaluating controller
+	Self,
+	// Any other AI agent
+	AnyAI,
+	// Other AI agent owning the EvaluationTarget tag
+	Tagged
+};
+
 UENUM(BlueprintType)
 enum class EMovementGait : uint8
 {
@@ -50,6 +70,24 @@ struct LYRAGAME_API FAIStateConditionData
 	
 	virtual bool CheckCondition(AAIStateController* SourceAI) const { return false; }
 
+	// Registers tags and attributes this condition reads from other AI agents, so they are copied into the world snapshot
+	virtual void RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const;
+
+	// True if condition is evaluated against other AI agents rather than the player or self
+	bool ReadsOtherAgents() const;
+
+	// True if regular squad members check this condition themselves when following the state chosen by their leader.
+	// Conditions of the controller's own pawn by default, conditions against the shared target are left to the leader
+	virtual bool IsEvaluatedPerSquadMember() const { return GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Self; }
+
+	// Caches kind of the evaluation target, called when the owning states set compiles its conditions
+	void ResolveEvaluationTarget() const { EvaluationTargetKind = ClassifyEvaluationTarget(EvaluationTarget); }
+
+	// Kind of the evaluation target, classified on the fly if the condition was never resolved
+	EAIStatesEvaluationTarget GetEvaluationTargetKind() const { return EvaluationTargetKind.IsSet() ? EvaluationTargetKind.GetValue() : ClassifyEvaluationTarget(EvaluationTarget); }
+
+	static EAIStatesEvaluationTarget ClassifyEvaluationTarget(const FGameplayTag& Tag);
+
 	// Flag inverting AI state condition
 	UPROPERTY(EditAnywhere, meta = (DisplayPriority=1))
 	bool bInverted = false;
@@ -57,9 +95,14 @@ struct LYRAGAME_API FAIStateConditionData
 	// Tag for evaluation target (player, AI etc)
 	UPROPERTY(EditAnywhere, meta = (DisplayPriority=2))
 	FGameplayTag EvaluationTarget;
-	
+
+private:
+
+	// Kind of EvaluationTarget, set by ResolveEvaluationTarget
+	mutable TOptional<EAIStatesEvaluationTarget> EvaluationTargetKind;
 };
 
+// Passes when the player target, or the nearest other AI agent owning evaluation target tag, is within MaxDistanceTo
 USTRUCT(BlueprintType, DisplayName="Max Distance To Chosen Target")
 struct LYRAGAME_API FMaxDistanceToCondition : public FAIStateConditionData
 {
@@ -87,6 +130,7 @@ struct LYRAGAME_API FAttributeChangeCondition : public FAIStateConditionData
 	float MinValue = 0.0f;
 	
 	virtual bool CheckCondition(AAIStateController* SourceAI) const override;
+	virtual void RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const override;
 };
 
 // Tag based conditions
@@ -105,9 +149,10 @@ struct LYRAGAME_API FGameplayTagMultipleBasedCondition : public FAIStateConditio
 	bool bHasAny = false;
 	
 	virtual bool CheckCondition(AAIStateController* SourceAI) const override;
+	virtual void RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const override;
 };
 
-// Counts instances of tags per Target ex. EngagedByEnemy Tags on Player - so we can limit too many AI from attacking
+// Counts instances of tags per Target ex. EngagedByEnemy Tags on Player. Prefer Has Attack Token to limit AI attacking the same target
 USTRUCT(BlueprintType, DisplayName="Has Tag Count")
 struct LYRAGAME_API FTagCountCondition : public FAIStateConditionData
 {
@@ -122,6 +167,7 @@ struct LYRAGAME_API FTagCountCondition : public FAIStateConditionData
 	int MinCount = 0;
 	
 	virtual bool CheckCondition(AAIStateController* SourceAI) const override;
+	virtual void RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const override;
 };
 
 USTRUCT(BlueprintType, DisplayName="Count Enemies with Tag")
@@ -154,6 +200,42 @@ struct LYRAGAME_API FCheckRecentlyChangedTag : public FAIStateConditionData
 	int MaxTimePassed = 0;
 	
 	virtual bool CheckCondition(AAIStateController* SourceAI) const override;
+	virtual void RegisterSnapshotInputs(FAIStatesWorldSnapshot& Snapshot) const override;
+};
+
+// Passes when the controller target is reachable along a straight navmesh path. Reads the shared reachability cache and never raycasts itself
+USTRUCT(BlueprintType, DisplayName="Has Direct Nav Path To Target")
+struct LYRAGAME_API FHasDirectNavPathCondition : public FAIStateConditionData
+{
+	GENERATED_BODY()
+
+	virtual bool CheckCondition(AAIStateController* SourceAI) const override;
+
+	// Distance from the target at which the path may end
+	UPROPERTY(EditAnywhere)
+	float OffsetFromTarget = 0.0f;
+
+	// Result used until the first raycast of the segment finishes
+	UPROPERTY(EditAnywhere)
+	bool bPassWhileUnknown = false;
+};
+
+// Passes while the controller holds an attack token of its target. Tokens are granted by the AI states subsystem, so only a limited number of AI attack the same target
+USTRUCT(BlueprintType, DisplayName="Has Attack Token")
+struct LYRAGAME_API FHasAttackTokenCondition : public FAIStateConditionData
+{
+	GENERATED_BODY()
+
+	virtual bool CheckCondition(AAIStateController* SourceAI) const override;
+	virtual bool IsEvaluatedPerSquadMember() const override { return true; }
+
+	// Flag asking for the token on every check, without it the condition only reads tokens asked for elsewhere
+	UPROPERTY(EditAnywhere)
+	bool bRequestToken = true;
+
+	// Threat reported with the request, higher threat wins tokens over closer AI
+	UPROPERTY(EditAnywhere, meta = (EditCondition = "bRequestToken"))
+	float Threat = 1.0f;
 };
 
 // InterruptibleActionData used for tags with conditions to interrupt
@@ -179,6 +261,10 @@ struct LYRAGAME_API FAIInterruptibleActionData
 
 	FAIInterruptibleActionData() {}
 
+	// Compiled data belongs to the program of the owning states set, so copies start uncompiled
+	FAIInterruptibleActionData(const FAIInterruptibleActionData& Other);
+	FAIInterruptibleActionData& operator=(const FAIInterruptibleActionData& Other);
+
 	// Array of variant conditions to interrupt
 	UPROPERTY(EditAnywhere, meta = (TitleProperty = "VariantTitle"))
 	TArray<FAIStateConditionsVariant> ConditionsToInterrupt;
@@ -190,6 +276,16 @@ struct LYRAGAME_API FAIInterruptibleActionData
 	// Maximum duration of variant conditions to interrupt
 	UPROPERTY(EditAnywhere, meta = (DisplayPriority=3))
 	float MaxDuration = 0.0f;
+
+	// First condition group of the variants in the compiled program of the owning states set, one group per variant.
+	// Written only by the owning set when it compiles, reset by copies
+	mutable int32 CompiledVariantsStart = INDEX_NONE;
+
+	// Inputs read by the compiled variants, subscribed to by interrupt watchers while the action runs. Reset by copies
+	mutable FAIStatesInterruptDependencies CompiledDependencies;
+
+	// Evaluates interrupt variants against given controller, using compiled program of its states set when available
+	bool ShouldInterrupt(AAIStateController* SourceController) const;
 };
 
 // Structure containing data related to character movement and animation systems 
@@ -240,8 +336,8 @@ struct LYRAGAME_API FAIStateActionData
 	
 	virtual TSubclassOf<ULyraGameplayAbility> Activate(AAIStateController* SourceAI) { return {}; }
 	
-	virtual FString GetAbilityName() {return FString();}
-	virtual float GetMaxDuration() const { return false; }
+	virtual FString GetAbilityName() const {return FString();}
+	virtual float GetMaxDuration(AAIStateController* SourceAI) const { return false; }
 	virtual float GetDesiredDistance() const { return false; }
 	
 	virtual EMovementGait GetDesiredMovementGait() const { return EMovementGait::Walking; }
@@ -256,7 +352,11 @@ struct LYRAGAME_API FAIStateActionData
 	
 	virtual UEnvQuery* GetEQS() const { return nullptr; }
 	virtual TArray<FEnvNamedValue> GetEQSParams() const { return {}; }
+	virtual EAIStatesEQSDistribution GetEQSDistribution() const { return EAIStatesEQSDistribution::Best; }
 	virtual bool GetApproachTargetData(FApproachTargetData& OutApproachTargetData) const { return false; } 
+	virtual const FAIInterruptibleActionData* GetInterruptibleActionData() const { return nullptr; }
+	virtual const FAIInterruptibleActionData* GetApproachInterruptibleActionData() const { return nullptr; }
+	virtual FGameplayTag GetInterruptibleAbilityTag() const { return FGameplayTag(); }
 
 	// AI state probability weight
 	UPROPERTY(EditAnywhere, meta = (DisplayPriority=1))
@@ -275,13 +375,16 @@ struct LYRAGAME_API FAIStateInterruptibleAbility : public FAIStateActionData
 	
 	virtual bool CanAbilityBeInterrupted() override {return InterruptibleActionData.ConditionsToInterrupt.Num() > 0;}
 	virtual bool ShouldAbilityBeInterrupted(AAIStateController* SourceController) override;
-	virtual float GetMaxDuration() const override;
+	virtual float GetMaxDuration(AAIStateController* SourceAI) const override;
+	virtual const FAIInterruptibleActionData* GetInterruptibleActionData() const override { return &InterruptibleActionData; }
+	virtual FGameplayTag GetInterruptibleAbilityTag() const override { return InterruptibleAbilityTag; }
 
 	// AI state interruptible action data 
 	UPROPERTY(EditAnywhere)
 	FAIInterruptibleActionData InterruptibleActionData;
 
-	FName InterruptibleAbilityTagName;
+	// Tag of the ability triggered on activation, set by derived abilities
+	FGameplayTag InterruptibleAbilityTag;
 };
 
 // Struct defining weighted ability for AI state
@@ -292,8 +395,9 @@ struct LYRAGAME_API FWeightedAbility : public FAIStateActionData
 	
 	virtual TSubclassOf<ULyraGameplayAbility> Activate(AAIStateController* SourceAI) override;
 	virtual bool CanAbilityBeActivated(AAIStateController* SourceAI) const override;
-	virtual FString GetAbilityName() override;
+	virtual FString GetAbilityName() const override;
 	virtual bool GetApproachTargetData(FApproachTargetData& OutApproachTargetData) const override;
+	virtual const FAIInterruptibleActionData* GetApproachInterruptibleActionData() const override { return bCustomApproachTargetData ? &ApproachTargetData.InterruptibleData : nullptr; }
 
 	// Gameplay ability class
 	UPROPERTY(EditAnywhere)
@@ -313,10 +417,10 @@ struct LYRAGAME_API FMoveToLocationAbility : public FAIStateInterruptibleAbility
 {
 	GENERATED_BODY()
 
-	FMoveToLocationAbility() { InterruptibleAbilityTagName = AIConditions::RequestMoveToTagName; }
+	FMoveToLocationAbility() { InterruptibleAbilityTag = AIConditions::RequestMoveTo; }
 	
 	virtual bool CanAbilityBeActivated(AAIStateController* SourceAI) const override { return true; }
-	virtual FString GetAbilityName() override { return TEXT("Move To Location");}
+	virtual FString GetAbilityName() const override { return TEXT("Move To Location");}
 	virtual EMovementGait GetDesiredMovementGait() const override { return MovementGaitData.MovementGait; }
 	virtual FMovementGaitData GetMovementGaitData() const override { return MovementGaitData; };
 	virtual bool ShouldFollowTarget() const override { return bFollowTarget; }
@@ -324,6 +428,7 @@ struct LYRAGAME_API FMoveToLocationAbility : public FAIStateInterruptibleAbility
 
 	virtual UEnvQuery* GetEQS() const override { return EnvQuery; };
 	virtual TArray<FEnvNamedValue> GetEQSParams() const override { return QueryParams; };
+	virtual EAIStatesEQSDistribution GetEQSDistribution() const override { return EQSDistribution; }
 
 	// Navmesh EnvQuery
 	UPROPERTY(EditAnywhere)
@@ -337,6 +442,10 @@ struct LYRAGAME_API FMoveToLocationAbility : public FAIStateInterruptibleAbility
 	UPROPERTY(EditAnywhere, meta=(ForceInlineRow))
 	TArray<FEnvNamedValue> QueryParams;
 
+	// How bots sharing one execution of EnvQuery pick their location from its result
+	UPROPERTY(EditAnywhere)
+	EAIStatesEQSDistribution EQSDistribution = EAIStatesEQSDistribution::RoundRobin;
+
 	// Flag enabling target following
 	UPROPERTY(EditAnywhere)
 	bool bFollowTarget = false;
@@ -351,10 +460,10 @@ struct LYRAGAME_API FWaitAbility : public FAIStateInterruptibleAbility
 {
 	GENERATED_BODY()
 
-	FWaitAbility() {InterruptibleAbilityTagName = AIConditions::RequestWaitTagName;}
+	FWaitAbility() {InterruptibleAbilityTag = AIConditions::RequestWait;}
 
 	virtual bool CanAbilityBeActivated(AAIStateController* SourceAI) const override { return true; }
-	virtual FString GetAbilityName() override { return "Wait"; }
+	virtual FString GetAbilityName() const override { return "Wait"; }
 };
 
 USTRUCT(BlueprintType)
@@ -362,10 +471,10 @@ struct LYRAGAME_API FOrbitAbility : public FAIStateInterruptibleAbility
 {
 	GENERATED_BODY()
 
-	FOrbitAbility() { InterruptibleAbilityTagName = AIConditions::RequestOrbitTagName; }
+	FOrbitAbility() { InterruptibleAbilityTag = AIConditions::RequestOrbit; }
 
 	virtual bool CanAbilityBeActivated(AAIStateController* SourceAI) const override { return true; }
-	virtual FString GetAbilityName() override {return "Orbit";}
+	virtual FString GetAbilityName() const override {return "Orbit";}
 	virtual float GetDesiredDistance() const override {return DesiredDistance;}
 
 	// Orbit ability target distance
@@ -378,9 +487,9 @@ struct LYRAGAME_API FApproachTargetAbility : public FAIStateInterruptibleAbility
 {
 	GENERATED_BODY()
 
-	FApproachTargetAbility() { InterruptibleAbilityTagName = AIConditions::ApproachTargetTagName; }
+	FApproachTargetAbility() { InterruptibleAbilityTag = AIConditions::RequestApproachTarget; }
 	
-	virtual FString GetAbilityName() override {return "Approach Target";}
+	virtual FString GetAbilityName() const override {return "Approach Target";}
 	virtual FMovementGaitData GetMovementGaitData() const override { return MovementGaitData; }
 
 	// Data related to approaching character movement and animation systems 
@@ -426,7 +535,7 @@ struct LYRAGAME_API FAIStateDataConfig
 	TArray<FAIStateAbilityNamedWrapper> Abilities;
 };
 
-// State Runtime Data - explicit types - no casting required
+// State Runtime Data - explicit types - no casting required. Built once per states set and shared by every controller using it
 USTRUCT(BlueprintType)
 struct LYRAGAME_API FAIStateRuntimeData
 {
@@ -434,11 +543,22 @@ struct LYRAGAME_API FAIStateRuntimeData
 	
 	float StateWeight = 0.0f;
 	
-	bool bStateBlocked = false;
 	bool bMakeBlockedOnExit = false;
 	
-	TArray<TSharedPtr<FAIStateConditionData>> Conditions;
-	TArray<TSharedPtr<FAIStateActionData>> Abilities;
+	// Point into instanced structs of the owning states set
+	TArray<const FAIStateConditionData*> Conditions;
+
+	// Conditions checked by regular squad members following this state, subset of Conditions
+	TArray<const FAIStateConditionData*> SquadMemberConditions;
+
+	// Profiling names of Conditions, indexed the same way
+	TArray<FAIStatesConditionProfile> ConditionProfiles;
+
+	// Insights scope name of the state evaluation, owning asset followed by state name
+	FString TraceName;
+
+	// Abilities with valid action data only, indexed the same way by ability decisions
+	TArray<FAIStateActionData*> Abilities;
 };
 /**
  *  Data Asset for configuring states
@@ -450,10 +570,47 @@ class LYRAGAME_API UAIStatesSet : public UPrimaryDataAsset
 
 public:
 
+	// ----------------------------------------------------------------------------------------------------------------
+	// UObject
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	// Calls visitor for every state condition and every interrupt condition variant used by this set
+	void ForEachCondition(TFunctionRef<void(const FAIStateConditionData&)> Visitor) const;
+
+	// Calls visitor for default approach and every ability interrupt data used by this set
+	void ForEachInterruptibleData(TFunctionRef<void(const FAIInterruptibleActionData&)> Visitor) const;
+
+	// Compiles conditions of every state and interrupt variant into the condition program
+	void CompileConditionProgram();
+
+	// Getter function retrieving compiled condition program, compiled on first access if the asset was not loaded from disk
+	const FAIStatesProgram& GetConditionProgram();
+
+	// Getter function retrieving inputs read by conditions of every state, built together with the condition program
+	const FAIStatesDependencyIndex& GetDependencyIndex();
+
+	// Getter function retrieving runtime data of every state, built together with the condition program
+	const TArray<FAIStateRuntimeData>& GetRuntimeStates();
+
+	// Getter function retrieving condition group of state with given index in the compiled program
+	int32 GetStateConditionGroup(int32 StateIndex) const { return StateConditionGroups.IsValidIndex(StateIndex) ? StateConditionGroups[StateIndex] : INDEX_NONE; }
+
 	// AI state update rate used for testing purposes
 	UPROPERTY(EditAnywhere)
 	float AIStatesUpdateRate_TESTING = 0.15f;
 
+	// Flag letting controllers using this set form squads. Squad leaders evaluate states, regular members follow their intent
+	UPROPERTY(EditAnywhere)
+	bool bFormSquads = false;
+
+	// Flag letting controllers using this set report stimuli to the perception memory of their team and take targets from it
+	UPROPERTY(EditAnywhere)
+	bool bShareTeamPerception = false;
+
 	// Default movement approach data
 	UPROPERTY(EditAnywhere)
 	FApproachTargetData DefaultApproachData;
@@ -461,4 +618,20 @@ public:
 	// Array of AI states for this character
 	UPROPERTY(EditAnywhere, meta = (TitleProperty = "StateName"))
 	TArray<FAIStateDataConfig> States;
+
+private:
+
+	// Conditions of every state and interrupt variant compiled into flat program
+	FAIStatesProgram ConditionProgram;
+
+	// Condition group in the compiled program per state
+	TArray<int32> StateConditionGroups;
+
+	// Inputs read by conditions of every state
+	FAIStatesDependencyIndex DependencyIndex;
+
+	// Runtime data per state shared by every controller, controllers only keep their mutable state
+	TArray<FAIStateRuntimeData> RuntimeStates;
+
+	bool bConditionProgramCompiled = false;
 };
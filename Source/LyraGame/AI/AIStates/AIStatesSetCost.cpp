@@ -0,0 +1,122 @@
+#include "AIStatesSetCost.h"
+
+#include "AIStatesProgram.h"
+#include "AIStatesSet.h"
+#include "AIStatesSettings.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesSetCost)
+
+namespace AIStatesSetCost
+{
+	bool IsWorldScan(const FAIStatesOp& Op)
+	{
+		return Op.OpCode == EAIStatesOpCode::CountAgentsWithTag || Op.Target == EAIStatesOpTarget::Agent;
+	}
+
+	// Reason why conditions of the group can never pass together, empty if they may
+	FString FindContradiction(const FAIStatesProgram& Program, int32 GroupIndex)
+	{
+		const TConstArrayView<FAIStatesOp> Ops = Program.GetGroupOps(GroupIndex);
+		for(int32 OpIndex = 0; OpIndex < Ops.Num(); OpIndex++)
+		{
+			const FAIStatesOp& Op = Ops[OpIndex];
+			if(Op.OpCode == EAIStatesOpCode::Virtual && Op.Condition == nullptr)
+			{
+				return TEXT("has an empty condition, which always fails");
+			}
+
+			// Single tag required and forbidden on the same evaluated actor
+			if(Op.OpCode != EAIStatesOpCode::HasTags || Op.NumTags != 1 || Op.Target == EAIStatesOpTarget::Agent)
+			{
+				continue;
+			}
+
+			for(int32 OtherIndex = OpIndex + 1; OtherIndex < Ops.Num(); OtherIndex++)
+			{
+				const FAIStatesOp& Other = Ops[OtherIndex];
+				if(Other.OpCode == EAIStatesOpCode::HasTags && Other.NumTags == 1 && Other.Target == Op.Target
+					&& Other.bInverted != Op.bInverted && Program.GetOpTags(Other)[0] == Program.GetOpTags(Op)[0])
+				{
+					return FString::Printf(TEXT("both requires and forbids tag %s"), *Program.GetOpTags(Op)[0].ToString());
+				}
+			}
+		}
+
+		return FString();
+	}
+}
+
+FAIStatesSetCost FAIStatesSetCost::Estimate(UAIStatesSet& StatesSet)
+{
+	return Estimate(StatesSet, UAIStatesSettings::Get()->StatesSetCostWeights);
+}
+
+FAIStatesSetCost FAIStatesSetCost::Estimate(UAIStatesSet& StatesSet, const FAIStatesCostWeights& Weights)
+{
+	using namespace AIStatesSetCost;
+
+	FAIStatesSetCost Cost;
+
+	// Program holds every state and interrupt variant group, so each condition is counted once
+	const FAIStatesProgram& Program = StatesSet.GetConditionProgram();
+	for(int32 GroupIndex = 0; GroupIndex < Program.GetNumGroups(); GroupIndex++)
+	{
+		for(const FAIStatesOp& Op : Program.GetGroupOps(GroupIndex))
+		{
+			Cost.NumConditions++;
+			Cost.NumWorldScanConditions += IsWorldScan(Op) ? 1 : 0;
+		}
+	}
+
+	StatesSet.ForEachInterruptibleData([&Cost](const FAIInterruptibleActionData& InterruptibleData)
+	{
+		Cost.NumInterruptVariants += InterruptibleData.ConditionsToInterrupt.Num();
+	});
+
+	for(int32 StateIndex = 0; StateIndex < StatesSet.States.Num(); StateIndex++)
+	{
+		const FAIStateDataConfig& State = StatesSet.States[StateIndex];
+
+		bool bHasWeightedAbility = false;
+		for(const FAIStateAbilityNamedWrapper& AbilityWrapper : State.Abilities)
+		{
+			if(const auto* Ability = AbilityWrapper.Ability.GetPtr<FAIStateActionData>())
+			{
+				Cost.NumEQSQueries += Ability->GetEQS() ? 1 : 0;
+				bHasWeightedAbility |= Ability->ProbabilityWeight > 0.0f;
+			}
+		}
+
+		FString Reason;
+		if(State.StateWeight <= 0.0f)
+		{
+			Reason = TEXT("has no state weight");
+		}
+		else if(bHasWeightedAbility == false)
+		{
+			Reason = TEXT("has no ability with probability weight");
+		}
+		else if(StatesSet.GetStateConditionGroup(StateIndex) != INDEX_NONE)
+		{
+			Reason = FindContradiction(Program, StatesSet.GetStateConditionGroup(StateIndex));
+		}
+
+		if(Reason.IsEmpty() == false)
+		{
+			Cost.UnreachableStates.Add(FString::Printf(TEXT("State %s %s"), *State.StateName.ToString(), *Reason));
+		}
+	}
+
+	Cost.Score = (Cost.NumConditions - Cost.NumWorldScanConditions) * Weights.Condition
+		+ Cost.NumWorldScanConditions * Weights.WorldScanCondition
+		+ Cost.NumEQSQueries * Weights.EQSQuery
+		+ Cost.NumInterruptVariants * Weights.InterruptVariant
+		+ Cost.UnreachableStates.Num() * Weights.UnreachableState;
+
+	return Cost;
+}
+
+float FAIStatesSetCost::GetBudget()
+{
+	return UAIStatesSettings::Get()->MaxStatesSetCost;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "AIStatesSetCost.generated.h"
+
+class UAIStatesSet;
+
+// Cost added to the static score of a states set by each of its features
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FAIStatesCostWeights
+{
+	GENERATED_BODY()
+
+	// Cost of a condition reading only the bot itself or its target
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0))
+	float Condition = 1.0f;
+
+	// Cost of a condition scanning registered AI agents, such as counting enemies with a tag or reading an AnyAI target
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0))
+	float WorldScanCondition = 8.0f;
+
+	// Cost of an ability running an environment query
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0))
+	float EQSQuery = 10.0f;
+
+	// Cost of a single interrupt variant, on top of its conditions
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0))
+	float InterruptVariant = 2.0f;
+
+	// Cost of a state which can never be picked, yet its conditions are still evaluated
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0))
+	float UnreachableState = 4.0f;
+};
+
+/**
+ * FAIStatesSetCost
+ *
+ *	Static cost estimate of a states set, counted from its compiled condition program without running it.
+ *	Used by data validation to catch expensive bot configs before they ship.
+ */
+struct LYRAGAME_API FAIStatesSetCost
+{
+	// Estimates cost of the set with weights from AI States settings
+	static FAIStatesSetCost Estimate(UAIStatesSet& StatesSet);
+
+	static FAIStatesSetCost Estimate(UAIStatesSet& StatesSet, const FAIStatesCostWeights& Weights);
+
+	// Highest score a states set may have, from AI States settings. Zero or less disables the budget
+	static float GetBudget();
+
+	bool IsOverBudget(float Budget) const { return Budget > 0.0f && Score > Budget; }
+
+	int32 NumConditions = 0;
+	int32 NumWorldScanConditions = 0;
+	int32 NumEQSQueries = 0;
+	int32 NumInterruptVariants = 0;
+
+	// Why each state which can never be picked is unreachable, one entry per such state
+	TArray<FString> UnreachableStates;
+
+	float Score = 0.0f;
+};
@@ -1,9 +1,53 @@
 #include "AIStatesSettings.h"
 
+#include "GameplayEffect.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesSettings)
 
 UAIStatesSettings::UAIStatesSettings(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	CategoryName = TEXT("Game");
-}
\ No newline at end of file
+
+	// Fighting next to a player, near or in view of a player, distant, idle across the map
+	auto AddSignificanceTier = [this](float MinSignificance, float IntervalScale, float BehaviorTreeTickInterval, bool bAllowEQS)
+	{
+		FAIStatesSignificanceTier& Tier = SignificanceTiers.AddDefaulted_GetRef();
+		Tier.MinSignificance = MinSignificance;
+		Tier.StateUpdateIntervalScale = IntervalScale;
+		Tier.LineOfSightIntervalScale = IntervalScale;
+		Tier.BehaviorTreeTickInterval = BehaviorTreeTickInterval;
+		Tier.bAllowEQS = bAllowEQS;
+	};
+	AddSignificanceTier(1.5f, 1.0f, 0.0f, true);
+	AddSignificanceTier(0.75f, 2.0f, 0.1f, true);
+	AddSignificanceTier(0.25f, 4.0f, 0.25f, false);
+	AddSignificanceTier(0.0f, 8.0f, 0.5f, false);
+
+	// Small skirmish up to a crowd of bots on a dedicated server
+	auto AddBenchmarkBudget = [this](int32 NumBots, float MaxGameThreadMs, float MaxAIStatesMs)
+	{
+		FAIStatesBenchmarkBudget& Budget = BenchmarkBudgets.AddDefaulted_GetRef();
+		Budget.NumBots = NumBots;
+		Budget.MaxGameThreadMs = MaxGameThreadMs;
+		Budget.MaxAIStatesMs = MaxAIStatesMs;
+	};
+	AddBenchmarkBudget(16, 8.0f, 0.5f);
+	AddBenchmarkBudget(64, 12.0f, 1.5f);
+	AddBenchmarkBudget(256, 20.0f, 3.0f);
+	AddBenchmarkBudget(1024, 50.0f, 8.0f);
+}
+
+void UAIStatesSettings::PinRuntimeAssets() const
+{
+	if(PinnedRememberRecentTagGameplayEffect || RememberRecentTagGameplayEffect.IsNull())
+	{
+		return;
+	}
+
+	PinnedRememberRecentTagGameplayEffect = RememberRecentTagGameplayEffect.LoadSynchronous();
+	if(PinnedRememberRecentTagGameplayEffect == nullptr)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("UAIStatesSettings::PinRuntimeAssets - Unable to load RememberRecentTagGameplayEffect [%s]."), *RememberRecentTagGameplayEffect.ToString());
+	}
+}
@@ -3,9 +3,13 @@
 #include "CoreMinimal.h"
 #include "Engine/DeveloperSettings.h"
 #include "UObject/SoftObjectPtr.h"
+#include "AIStatesSignificance.h"
+#include "AIStatesBenchmark.h"
+#include "AIStatesSetCost.h"
 
 #include "AIStatesSettings.generated.h"
 
+class UAIStatesSet;
 class UGameplayEffect;
 
 UCLASS(Config = "Game", DefaultConfig, meta = (DisplayName = "AI States Settings"))
@@ -20,6 +24,209 @@ public:
 	// Gameplay effect used to add and remove dynamic tags.
 	UPROPERTY(Config, EditDefaultsOnly, Category = "Remember Recent Tags")
 	TSoftClassPtr<UGameplayEffect> RememberRecentTagGameplayEffect;
-	
+
+	// Number of controllers evaluated together before the frame time budget is checked again
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Scheduling", meta = (ClampMin = 1))
+	int32 StateEvaluationBatchSize = 8;
+
+	// Time in milliseconds the subsystem may spend evaluating AI states per frame. Due controllers over budget are deferred to the next frame
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Scheduling", meta = (ClampMin = 0.0, Units = "ms"))
+	float StateEvaluationBudgetMs = 1.0f;
+
+	// Time in seconds between re-evaluations of states with distance conditions. Other tracked states only re-evaluate when their tags or attributes change
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Dirty Tracking", meta = (ClampMin = 0.0, Units = "s"))
+	float DistanceStatesReevaluationInterval = 0.5f;
+
+	// Size in centimeters of a single cell of the grid indexing registered AI agents. Close to the typical proximity query radius works best
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Spatial Index", meta = (ClampMin = 100.0, Units = "cm"))
+	float SpatialGridCellSize = 1000.0f;
+
+	// Number of last state and ability decisions kept per controller for offline replay. Zero disables the trace
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Decision Trace", meta = (ClampMin = 0))
+	int32 DecisionTraceLength = 64;
+
+	// Time in seconds a line of sight result is served from the controller cache before it is traced again
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Line Of Sight", meta = (ClampMin = 0.0, Units = "s"))
+	float LineOfSightCacheTimeToLive = 0.25f;
+
+	// Number of queued line of sight sweeps issued as async traces per frame. The rest waits for the next frame
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Line Of Sight", meta = (ClampMin = 1))
+	int32 MaxLineOfSightTracesPerFrame = 256;
+
+	// Time in seconds a navmesh reachability result is shared before the segment is raycast again
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Reachability", meta = (ClampMin = 0.0, Units = "s"))
+	float ReachabilityCacheTimeToLive = 1.0f;
+
+	// Size in centimeters of the grid reachability segment end points are snapped to. Bots asking from the same cell share results
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Reachability", meta = (ClampMin = 1.0, Units = "cm"))
+	float ReachabilityCacheCellSize = 100.0f;
+
+	// Number of queued reachability segments raycast per frame. The rest waits for the next frame
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Reachability", meta = (ClampMin = 1))
+	int32 MaxReachabilityRaycastsPerFrame = 64;
+
+	// Level of detail tiers of AI controllers, from the most significant. Controllers stay in the first tier if empty
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance")
+	TArray<FAIStatesSignificanceTier> SignificanceTiers;
+
+	// Time in seconds between significance updates of AI controllers
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 0.0, Units = "s"))
+	float SignificanceUpdateInterval = 0.25f;
+
+	// Distance in centimeters from the nearest human player at which distance stops adding significance
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 1.0, Units = "cm"))
+	float SignificanceMaxDistance = 5000.0f;
+
+	// Half angle of the view cone in which a bot counts as on screen of a player
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 0.0, ClampMax = 180.0, Units = "deg"))
+	float SignificanceViewHalfAngle = 60.0f;
+
+	// Significance added by closeness to the nearest human player, full at zero distance
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 0.0))
+	float SignificanceDistanceWeight = 1.0f;
+
+	// Significance added while the bot is on screen of a human player
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 0.0))
+	float SignificanceOnScreenWeight = 0.5f;
+
+	// Significance added while the bot has a target
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 0.0))
+	float SignificanceCombatWeight = 1.0f;
+
+	// Amount significance has to drop below the threshold of the current tier before the controller moves to a less significant tier
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Significance", meta = (ClampMin = 0.0))
+	float SignificanceHysteresis = 0.1f;
+
+	// Number of controllers allowed to attack a target at the same time, unless set per target
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0))
+	int32 AttackTokensPerTarget = 2;
+
+	// Time after which a request or held token is dropped if the controller doesn't ask again, added to the evaluation interval
+	// of the controller so controllers in less significant tiers keep their token between evaluations
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0.0, Units = "s"))
+	float AttackTokenRequestTimeout = 1.0f;
+
+	// Longest time a controller holds a token before it has to give others a chance
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0.0, Units = "s"))
+	float AttackTokenMaxHoldTime = 8.0f;
+
+	// Priority by which a candidate has to beat the weakest holder to take over its token
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0.0))
+	float AttackTokenPreemptionMargin = 0.25f;
+
+	// Priority added by closeness to the target, full at zero distance
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0.0))
+	float AttackTokenDistanceWeight = 1.0f;
+
+	// Multiplier of threat reported by the requesting controller
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0.0))
+	float AttackTokenThreatWeight = 1.0f;
+
+	// Distance at which closeness stops adding priority
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 1.0, Units = "cm"))
+	float AttackTokenMaxDistance = 3000.0f;
+
+	// Time between arbitrations of attack tokens
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Attack Tokens", meta = (ClampMin = 0.0, Units = "s"))
+	float AttackTokenArbitrationInterval = 0.1f;
+
+	// Largest number of controllers in a squad, leader included. Less than two disables squads
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Squads", meta = (ClampMin = 0))
+	int32 MaxSquadSize = 4;
+
+	// Distance from a squad leader within which controllers without squad join its squad
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Squads", meta = (ClampMin = 0.0, Units = "cm"))
+	float SquadJoinRadius = 1500.0f;
+
+	// Distance from the leader at which a member leaves its squad
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Squads", meta = (ClampMin = 0.0, Units = "cm"))
+	float SquadLeashRadius = 3000.0f;
+
+	// Time between squad membership updates
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Squads", meta = (ClampMin = 0.0, Units = "s"))
+	float SquadUpdateInterval = 1.0f;
+
+	// Age after which intent of a leader is no longer followed and members evaluate their states themselves
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Squads", meta = (ClampMin = 0.0, Units = "s"))
+	float SquadIntentTimeout = 1.0f;
+
+	// Distance between formation slots of a squad
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Squads", meta = (ClampMin = 0.0, Units = "cm"))
+	float SquadFormationSpacing = 250.0f;
+
+	// Time between team perception updates, which decay remembered targets and hand them to controllers
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Team Perception", meta = (ClampMin = 0.0, Units = "s"))
+	float TeamPerceptionUpdateInterval = 0.25f;
+
+	// Confidence of a full strength sight stimulus
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Team Perception", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float SightStimulusConfidence = 1.0f;
+
+	// Confidence of a full strength hearing stimulus
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Team Perception", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float HearingStimulusConfidence = 0.5f;
+
+	// Time in seconds in which confidence of a target nobody senses halves
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Team Perception", meta = (ClampMin = 0.0, Units = "s"))
+	float TargetConfidenceHalfLife = 3.0f;
+
+	// Lowest confidence controllers take a target at. Less confident targets are searched for at their last known location
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Team Perception", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float MinTargetConfidence = 0.4f;
+
+	// Confidence under which a team forgets a target
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Team Perception", meta = (ClampMin = 0.0, ClampMax = 1.0))
+	float ForgetTargetConfidence = 0.05f;
+
+	// Time in seconds an environment query result is shared with controllers asking the same query from nearby
+	UPROPERTY(Config, EditDefaultsOnly, Category = "EQS Cache", meta = (ClampMin = 0.0, Units = "s"))
+	float EQSCacheTimeToLive = 0.5f;
+
+	// Size in centimeters of the grid querier and context locations are snapped to. Controllers asking from the same cells share results
+	UPROPERTY(Config, EditDefaultsOnly, Category = "EQS Cache", meta = (ClampMin = 1.0, Units = "cm"))
+	float EQSCacheCellSize = 300.0f;
+
+	// States set given to bots spawned by the scalability benchmark. Bots keep the set of their pawn if not set
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Benchmark")
+	TSoftObjectPtr<UAIStatesSet> BenchmarkStatesSet;
+
+	// Bot counts run by the scalability benchmark in order, each with the frame times it must stay under
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Benchmark")
+	TArray<FAIStatesBenchmarkBudget> BenchmarkBudgets;
+
+	// Time in seconds the benchmark simulates after spawning bots before it starts measuring
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Benchmark", meta = (ClampMin = 0.0, Units = "s"))
+	float BenchmarkWarmupDuration = 5.0f;
+
+	// Time in seconds the benchmark measures each bot count
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Benchmark", meta = (ClampMin = 0.0, Units = "s"))
+	float BenchmarkDuration = 20.0f;
+
+	// Cost added to the static score of a states set by each of its features
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cost Validation")
+	FAIStatesCostWeights StatesSetCostWeights;
+
+	// Highest static score of a states set before data validation fails it. Zero disables the budget
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Cost Validation", meta = (ClampMin = 0.0))
+	float MaxStatesSetCost = 200.0f;
+
+	// Getter function retrieving significance tier with given index, nullptr if there are no tiers
+	const FAIStatesSignificanceTier* GetSignificanceTier(int32 TierIndex) const { return SignificanceTiers.IsValidIndex(TierIndex) ? &SignificanceTiers[TierIndex] : nullptr; }
+
 	static const UAIStatesSettings* Get() { return GetDefault<UAIStatesSettings>(); }
+
+	// Loads assets used by AI states at runtime and keeps them loaded, so gameplay code never waits for the loader
+	void PinRuntimeAssets() const;
+
+	// Getter function retrieving remember recent tag effect class, nullptr until pinned
+	TSubclassOf<UGameplayEffect> GetRememberRecentTagGameplayEffectClass() const { return PinnedRememberRecentTagGameplayEffect; }
+
+	// Function replacing pinned remember recent tag effect class, used by automation tests
+	void SetRememberRecentTagGameplayEffectClass(TSubclassOf<UGameplayEffect> EffectClass) const { PinnedRememberRecentTagGameplayEffect = EffectClass; }
+
+private:
+
+	// Loaded RememberRecentTagGameplayEffect, referenced here so it stays loaded
+	UPROPERTY(Transient)
+	mutable TSubclassOf<UGameplayEffect> PinnedRememberRecentTagGameplayEffect;
 };
@@ -0,0 +1,26 @@
+#include "AIStatesSignificance.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesSignificance)
+
+int32 AIStatesSignificance::SelectTier(TConstArrayView<FAIStatesSignificanceTier> Tiers, float Significance, int32 CurrentTier, float Hysteresis)
+{
+	if(Tiers.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+
+	// Controllers without tier start from the least significant one
+	int32 Tier = Tiers.IsValidIndex(CurrentTier) ? CurrentTier : Tiers.Num() - 1;
+
+	while(Tier > 0 && Significance >= Tiers[Tier - 1].MinSignificance)
+	{
+		Tier--;
+	}
+
+	while(Tier < Tiers.Num() - 1 && Significance < Tiers[Tier].MinSignificance - Hysteresis)
+	{
+		Tier++;
+	}
+
+	return Tier;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "AIStatesSignificance.generated.h"
+
+// Level of detail of AI controllers with significance of at least MinSignificance
+USTRUCT(BlueprintType)
+struct LYRAGAME_API FAIStatesSignificanceTier
+{
+	GENERATED_BODY()
+
+	// Lowest significance of controllers in this tier. Tiers are ordered from the most significant
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float MinSignificance = 0.0f;
+
+	// Multiplier of time between state evaluations
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 1.0))
+	float StateUpdateIntervalScale = 1.0f;
+
+	// Multiplier of time a line of sight result is served from the cache before it is traced again
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 1.0))
+	float LineOfSightIntervalScale = 1.0f;
+
+	// Tick interval of the behavior tree component. Zero ticks every frame
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0.0, Units = "s"))
+	float BehaviorTreeTickInterval = 0.0f;
+
+	// Flag allowing behavior trees and abilities of controllers in this tier to run environment queries
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bAllowEQS = true;
+};
+
+namespace AIStatesSignificance
+{
+	// Picks tier for significance. Controllers move to a more significant tier as soon as they reach its threshold,
+	// but leave their current tier only once significance drops Hysteresis below its threshold
+	LYRAGAME_API int32 SelectTier(TConstArrayView<FAIStatesSignificanceTier> Tiers, float Significance, int32 CurrentTier, float Hysteresis);
+}
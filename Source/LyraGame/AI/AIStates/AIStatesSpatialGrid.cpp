@@ -0,0 +1,313 @@
+#include "AIStatesSpatialGrid.h"
+
+#include "AbilitySystemComponent.h"
+#include "Algo/BinarySearch.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesSpatialGrid)
+
+void FAIStatesSpatialGrid::SetCellSize(float InCellSize)
+{
+	InCellSize = FMath::Max(InCellSize, 1.0f);
+	if(InCellSize == CellSize)
+	{
+		return;
+	}
+
+	CellSize = InCellSize;
+
+	Cells.Reset();
+	MinCell = FIntPoint(MAX_int32, MAX_int32);
+	MaxCell = FIntPoint(MIN_int32, MIN_int32);
+
+	for(auto It = Agents.CreateIterator(); It; ++It)
+	{
+		It->Cell = GetCell(It->Location);
+		AddToCell(It.GetIndex());
+	}
+}
+
+int32 FAIStatesSpatialGrid::AddAgent(UAbilitySystemComponent* ASC, const FVector& Location, FGenericTeamId Team)
+{
+	if(const int32* ExistingId = AgentIds.Find(ASC))
+	{
+		MoveAgent(*ExistingId, Location);
+		SetAgentTeam(*ExistingId, Team);
+		return *ExistingId;
+	}
+
+	FAIStatesSpatialGridAgent Agent;
+	Agent.ASC = ASC;
+	Agent.Location = Location;
+	Agent.Cell = GetCell(Location);
+	Agent.Team = Team;
+
+	const int32 AgentId = Agents.Add(Agent);
+	AgentIds.Add(ASC, AgentId);
+	AddToCell(AgentId);
+
+	return AgentId;
+}
+
+void FAIStatesSpatialGrid::RemoveAgent(int32 AgentId)
+{
+	if(Agents.IsValidIndex(AgentId) == false)
+	{
+		return;
+	}
+
+	RemoveFromCell(AgentId);
+	AgentIds.Remove(Agents[AgentId].ASC);
+	Agents.RemoveAt(AgentId);
+}
+
+void FAIStatesSpatialGrid::Reset()
+{
+	Agents.Reset();
+	AgentIds.Reset();
+	Cells.Reset();
+	MinCell = FIntPoint(MAX_int32, MAX_int32);
+	MaxCell = FIntPoint(MIN_int32, MIN_int32);
+}
+
+void FAIStatesSpatialGrid::MoveAgent(int32 AgentId, const FVector& Location)
+{
+	FAIStatesSpatialGridAgent& Agent = Agents[AgentId];
+	Agent.Location = Location;
+
+	const FIntPoint NewCell = GetCell(Location);
+	if(NewCell != Agent.Cell)
+	{
+		RemoveFromCell(AgentId);
+		Agent.Cell = NewCell;
+		AddToCell(AgentId);
+	}
+}
+
+int32 FAIStatesSpatialGrid::FindAgentId(const UAbilitySystemComponent* ASC) const
+{
+	const int32* AgentId = AgentIds.Find(ASC);
+	return AgentId ? *AgentId : INDEX_NONE;
+}
+
+FIntPoint FAIStatesSpatialGrid::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize));
+}
+
+void FAIStatesSpatialGrid::AddToCell(int32 AgentId)
+{
+	const FIntPoint Cell = Agents[AgentId].Cell;
+	Cells.FindOrAdd(Cell).Add(AgentId);
+
+	MinCell = FIntPoint(FMath::Min(MinCell.X, Cell.X), FMath::Min(MinCell.Y, Cell.Y));
+	MaxCell = FIntPoint(FMath::Max(MaxCell.X, Cell.X), FMath::Max(MaxCell.Y, Cell.Y));
+}
+
+void FAIStatesSpatialGrid::RemoveFromCell(int32 AgentId)
+{
+	const FIntPoint Cell = Agents[AgentId].Cell;
+	if(auto* CellAgents = Cells.Find(Cell))
+	{
+		CellAgents->RemoveSingleSwap(AgentId, false);
+		if(CellAgents->IsEmpty())
+		{
+			Cells.Remove(Cell);
+		}
+	}
+}
+
+bool FAIStatesSpatialGrid::MatchesFilter(const FAIStatesSpatialGridAgent& Agent, const FAIStatesSpatialFilter& Filter) const
+{
+	if(Agent.ASC == Filter.IgnoredAgent || IsValid(Agent.ASC) == false)
+	{
+		return false;
+	}
+
+	if(Filter.TeamFilter == EAIStatesTeamFilter::SameTeam && Agent.Team != Filter.Team)
+	{
+		return false;
+	}
+
+	if(Filter.TeamFilter == EAIStatesTeamFilter::OtherTeam && Agent.Team == Filter.Team)
+	{
+		return false;
+	}
+
+	return Filter.RequiredTag.IsValid() == false || Agent.ASC->HasMatchingGameplayTag(Filter.RequiredTag);
+}
+
+template<typename VisitorType>
+void FAIStatesSpatialGrid::ForEachAgentInRadius(const FVector& Center, float Radius, const FAIStatesSpatialFilter& Filter, VisitorType&& Visitor) const
+{
+	if(Agents.Num() == 0 || Radius < 0.0f)
+	{
+		return;
+	}
+
+	// Cells overlapping the query, clamped to occupied bounds so huge radii don't walk empty space
+	const FIntPoint FirstCell = GetCell(Center - FVector(Radius));
+	const FIntPoint LastCell = GetCell(Center + FVector(Radius));
+	const int32 MinX = FMath::Max(FirstCell.X, MinCell.X);
+	const int32 MinY = FMath::Max(FirstCell.Y, MinCell.Y);
+	const int32 MaxX = FMath::Min(LastCell.X, MaxCell.X);
+	const int32 MaxY = FMath::Min(LastCell.Y, MaxCell.Y);
+
+	const float RadiusSquared = FMath::Square(Radius);
+
+	for(int32 X = MinX; X <= MaxX; X++)
+	{
+		for(int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			const auto* CellAgents = Cells.Find(FIntPoint(X, Y));
+			if(CellAgents == nullptr)
+			{
+				continue;
+			}
+
+			for(const int32 AgentId : *CellAgents)
+			{
+				const FAIStatesSpatialGridAgent& Agent = Agents[AgentId];
+				const float DistanceSquared = FVector::DistSquared(Agent.Location, Center);
+				if(DistanceSquared <= RadiusSquared && MatchesFilter(Agent, Filter) && Visitor(AgentId, DistanceSquared) == false)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+void FAIStatesSpatialGrid::QueryRadius(const FVector& Center, float Radius, const FAIStatesSpatialFilter& Filter, TArray<UAbilitySystemComponent*>& OutAgents) const
+{
+	OutAgents.Reset();
+
+	ForEachAgentInRadius(Center, Radius, Filter, [this, &OutAgents](int32 AgentId, float DistanceSquared)
+	{
+		OutAgents.Add(Agents[AgentId].ASC);
+		return true;
+	});
+}
+
+int32 FAIStatesSpatialGrid::CountInRadius(const FVector& Center, float Radius, const FAIStatesSpatialFilter& Filter) const
+{
+	int32 Count = 0;
+
+	ForEachAgentInRadius(Center, Radius, Filter, [&Count](int32 AgentId, float DistanceSquared)
+	{
+		Count++;
+		return true;
+	});
+
+	return Count;
+}
+
+UAbilitySystemComponent* FAIStatesSpatialGrid::FindNearest(const FVector& Center, float MaxRadius, const FAIStatesSpatialFilter& Filter, float* OutDistance) const
+{
+	TArray<UAbilitySystemComponent*> Nearest;
+	FindKNearest(Center, 1, MaxRadius, Filter, Nearest);
+
+	if(Nearest.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	if(OutDistance)
+	{
+		*OutDistance = FVector::Distance(Agents[AgentIds[Nearest[0]]].Location, Center);
+	}
+
+	return Nearest[0];
+}
+
+void FAIStatesSpatialGrid::FindKNearest(const FVector& Center, int32 K, float MaxRadius, const FAIStatesSpatialFilter& Filter, TArray<UAbilitySystemComponent*>& OutAgents) const
+{
+	OutAgents.Reset();
+	if(Agents.Num() == 0 || K <= 0 || MaxRadius < 0.0f)
+	{
+		return;
+	}
+
+	const FIntPoint CenterCell = GetCell(Center);
+	const float MaxRadiusSquared = FMath::Square(MaxRadius);
+
+	// Rings past the occupied bounds or past max radius can't contain any result
+	const int32 BoundsRing = FMath::Max(
+		FMath::Max(FMath::Abs(CenterCell.X - MinCell.X), FMath::Abs(MaxCell.X - CenterCell.X)),
+		FMath::Max(FMath::Abs(CenterCell.Y - MinCell.Y), FMath::Abs(MaxCell.Y - CenterCell.Y)));
+	const int32 RadiusRing = FMath::CeilToInt32(MaxRadius / CellSize) + 1;
+	const int32 LastRing = FMath::Min(BoundsRing, RadiusRing);
+
+	// Best candidates sorted by squared distance, at most K
+	TArray<TPair<float, int32>, TInlineAllocator<16>> Candidates;
+
+	auto VisitCell = [&](int32 X, int32 Y)
+	{
+		const auto* CellAgents = Cells.Find(FIntPoint(X, Y));
+		if(CellAgents == nullptr)
+		{
+			return;
+		}
+
+		for(const int32 AgentId : *CellAgents)
+		{
+			const FAIStatesSpatialGridAgent& Agent = Agents[AgentId];
+			const float DistanceSquared = FVector::DistSquared(Agent.Location, Center);
+			if(DistanceSquared > MaxRadiusSquared || (Candidates.Num() == K && DistanceSquared >= Candidates.Last().Key) || MatchesFilter(Agent, Filter) == false)
+			{
+				continue;
+			}
+
+			const int32 InsertIndex = Algo::UpperBoundBy(Candidates, DistanceSquared, [](const TPair<float, int32>& Candidate) { return Candidate.Key; });
+			Candidates.Insert(TPair<float, int32>(DistanceSquared, AgentId), InsertIndex);
+			if(Candidates.Num() > K)
+			{
+				Candidates.Pop(false);
+			}
+		}
+	};
+
+	for(int32 Ring = 0; Ring <= LastRing; Ring++)
+	{
+		// Agents in this ring are at least Ring - 1 cells away from the center, wherever it lies in its cell
+		const float RingMinDistance = FMath::Max(Ring - 1, 0) * CellSize;
+		if(Candidates.Num() == K && FMath::Square(RingMinDistance) > Candidates.Last().Key)
+		{
+			break;
+		}
+
+		if(Ring == 0)
+		{
+			VisitCell(CenterCell.X, CenterCell.Y);
+			continue;
+		}
+
+		for(int32 Offset = -Ring; Offset <= Ring; Offset++)
+		{
+			VisitCell(CenterCell.X + Offset, CenterCell.Y - Ring);
+			VisitCell(CenterCell.X + Offset, CenterCell.Y + Ring);
+		}
+
+		for(int32 Offset = -Ring + 1; Offset <= Ring - 1; Offset++)
+		{
+			VisitCell(CenterCell.X - Ring, CenterCell.Y + Offset);
+			VisitCell(CenterCell.X + Ring, CenterCell.Y + Offset);
+		}
+	}
+
+	OutAgents.Reserve(Candidates.Num());
+	for(const TPair<float, int32>& Candidate : Candidates)
+	{
+		OutAgents.Add(Agents[Candidate.Value].ASC);
+	}
+}
+
+SIZE_T FAIStatesSpatialGrid::GetAllocatedSize() const
+{
+	SIZE_T Size = Agents.GetAllocatedSize() + AgentIds.GetAllocatedSize() + Cells.GetAllocatedSize();
+	for(const auto& [Cell, CellAgents] : Cells)
+	{
+		Size += CellAgents.GetAllocatedSize();
+	}
+
+	return Size;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "GenericTeamAgentInterface.h"
+
+#include "AIStatesSpatialGrid.generated.h"
+
+class UAbilitySystemComponent;
+
+// Team relation required from agents returned by spatial queries
+UENUM(BlueprintType)
+enum class EAIStatesTeamFilter : uint8
+{
+	Any,
+	SameTeam,
+	OtherTeam
+};
+
+// Filter applied to agents returned by spatial queries
+struct LYRAGAME_API FAIStatesSpatialFilter
+{
+	// Tag agents have to own. Invalid tag matches any agent
+	FGameplayTag RequiredTag;
+
+	// Team relation to Team required from agents
+	EAIStatesTeamFilter TeamFilter = EAIStatesTeamFilter::Any;
+	FGenericTeamId Team = FGenericTeamId::NoTeam;
+
+	// Agent never returned by queries, usually the one asking
+	const UAbilitySystemComponent* IgnoredAgent = nullptr;
+};
+
+// Agent stored in the spatial grid
+struct FAIStatesSpatialGridAgent
+{
+	UAbilitySystemComponent* ASC = nullptr;
+	FVector Location = FVector::ZeroVector;
+	FIntPoint Cell = FIntPoint::ZeroValue;
+	FGenericTeamId Team = FGenericTeamId::NoTeam;
+};
+
+/**
+ * FAIStatesSpatialGrid
+ *
+ *	Uniform grid of registered AI agents in the XY plane, used for radius, nearest and count queries.
+ *	Agents are moved between cells only when they cross a cell border, distances are measured in 3D.
+ */
+struct LYRAGAME_API FAIStatesSpatialGrid
+{
+	// Changes cell size and reinserts every agent
+	void SetCellSize(float InCellSize);
+	float GetCellSize() const { return CellSize; }
+
+	// Adds agent and returns its id, stable until the agent is removed
+	int32 AddAgent(UAbilitySystemComponent* ASC, const FVector& Location, FGenericTeamId Team);
+	void RemoveAgent(int32 AgentId);
+	void Reset();
+
+	// Updates agent location, reinserting it only if it moved to another cell
+	void MoveAgent(int32 AgentId, const FVector& Location);
+	void SetAgentTeam(int32 AgentId, FGenericTeamId Team) { Agents[AgentId].Team = Team; }
+
+	int32 FindAgentId(const UAbilitySystemComponent* ASC) const;
+	const FAIStatesSpatialGridAgent& GetAgent(int32 AgentId) const { return Agents[AgentId]; }
+	int32 Num() const { return Agents.Num(); }
+
+	// Agents within radius from the center matching filter, in no particular order
+	void QueryRadius(const FVector& Center, float Radius, const FAIStatesSpatialFilter& Filter, TArray<UAbilitySystemComponent*>& OutAgents) const;
+
+	// Number of agents within radius from the center matching filter
+	int32 CountInRadius(const FVector& Center, float Radius, const FAIStatesSpatialFilter& Filter) const;
+
+	// Nearest agent within max radius matching filter, nullptr if there is none
+	UAbilitySystemComponent* FindNearest(const FVector& Center, float MaxRadius, const FAIStatesSpatialFilter& Filter, float* OutDistance = nullptr) const;
+
+	// Up to K nearest agents within max radius matching filter, sorted by distance
+	void FindKNearest(const FVector& Center, int32 K, float MaxRadius, const FAIStatesSpatialFilter& Filter, TArray<UAbilitySystemComponent*>& OutAgents) const;
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	FIntPoint GetCell(const FVector& Location) const;
+	void AddToCell(int32 AgentId);
+	void RemoveFromCell(int32 AgentId);
+	bool MatchesFilter(const FAIStatesSpatialGridAgent& Agent, const FAIStatesSpatialFilter& Filter) const;
+
+	// Calls visitor with id and squared distance of every agent matching filter within radius. Visitor returns false to stop
+	template<typename VisitorType>
+	void ForEachAgentInRadius(const FVector& Center, float Radius, const FAIStatesSpatialFilter& Filter, VisitorType&& Visitor) const;
+
+	TSparseArray<FAIStatesSpatialGridAgent> Agents;
+	TMap<const UAbilitySystemComponent*, int32> AgentIds;
+
+	// Agent ids per occupied cell
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<8>>> Cells;
+
+	// Bounds of every cell ever occupied, limits ring search of nearest queries
+	FIntPoint MinCell = FIntPoint(MAX_int32, MAX_int32);
+	FIntPoint MaxCell = FIntPoint(MIN_int32, MIN_int32);
+
+	float CellSize = 1000.0f;
+};
@@ -0,0 +1,255 @@
+#include "AIStatesSquads.h"
+
+#include "AIStatesSet.h"
+#include "AI/AIStateController.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+
+FVector FAIStatesSquad::GetFormationSlotLocation(int32 Slot, float Spacing) const
+{
+	if(Slot <= 0)
+	{
+		return Intent.Anchor.GetLocation();
+	}
+
+	const int32 Row = (Slot + 1) / 2;
+	const float Side = Slot % 2 == 1 ? 1.0f : -1.0f;
+	return Intent.Anchor.TransformPosition(FVector(-Spacing * Row, Side * Spacing * Row, 0.0f));
+}
+
+int32 FAIStatesSquadRegistry::CreateSquad(AAIStateController& Leader)
+{
+	RemoveMember(Leader);
+
+	const int32 SquadId = NextSquadId++;
+	FAIStatesSquad& Squad = Squads.Add(SquadId);
+	Squad.SquadId = SquadId;
+	Squad.TeamId = Leader.GetGenericTeamId();
+	Squad.Members.Add(&Leader);
+	MemberSquads.Add(FObjectKey(&Leader), SquadId);
+
+	UpdateMemberTags(Squad);
+	return SquadId;
+}
+
+bool FAIStatesSquadRegistry::AddMember(int32 SquadId, AAIStateController& Member)
+{
+	const int32* CurrentSquadId = MemberSquads.Find(FObjectKey(&Member));
+	if(CurrentSquadId && *CurrentSquadId == SquadId)
+	{
+		return true;
+	}
+
+	RemoveMember(Member);
+
+	FAIStatesSquad* Squad = Squads.Find(SquadId);
+	if(Squad == nullptr)
+	{
+		return false;
+	}
+
+	Squad->Members.Add(&Member);
+	MemberSquads.Add(FObjectKey(&Member), SquadId);
+
+	UpdateMemberTags(*Squad);
+	return true;
+}
+
+void FAIStatesSquadRegistry::RemoveMember(const AAIStateController& Member)
+{
+	int32 SquadId = INDEX_NONE;
+	if(MemberSquads.RemoveAndCopyValue(FObjectKey(&Member), SquadId) == false)
+	{
+		return;
+	}
+
+	ClearMemberTags(&Member);
+
+	FAIStatesSquad* Squad = Squads.Find(SquadId);
+	if(Squad == nullptr)
+	{
+		return;
+	}
+
+	const bool bWasLeader = Squad->GetLeader() == &Member;
+	Squad->Members.RemoveAll([&Member](const TWeakObjectPtr<AAIStateController>& SquadMember)
+	{
+		return SquadMember.Get() == &Member;
+	});
+
+	if(Squad->Members.IsEmpty())
+	{
+		Disband(SquadId);
+		return;
+	}
+
+	// Intent of the previous leader is dropped, the new leader publishes its own on its next evaluation
+	if(bWasLeader)
+	{
+		Squad->Intent = FAIStatesSquadIntent();
+	}
+
+	UpdateMemberTags(*Squad);
+}
+
+void FAIStatesSquadRegistry::Prune(float LeashRadius)
+{
+	TArray<AAIStateController*, TInlineAllocator<16>> MembersToRemove;
+
+	// Destroyed controllers are dropped right away, controllers without pawn leave through RemoveMember like everyone else
+	for(TPair<int32, FAIStatesSquad>& SquadPair : Squads)
+	{
+		FAIStatesSquad& Squad = SquadPair.Value;
+		if(Squad.Members.Num() > 0 && Squad.Members[0].IsValid() == false)
+		{
+			Squad.Intent = FAIStatesSquadIntent();
+		}
+
+		Squad.Members.RemoveAll([](const TWeakObjectPtr<AAIStateController>& Member)
+		{
+			return Member.IsValid() == false;
+		});
+
+		for(const TWeakObjectPtr<AAIStateController>& Member : Squad.Members)
+		{
+			if(Member->GetPawn() == nullptr)
+			{
+				MembersToRemove.Add(Member.Get());
+			}
+		}
+	}
+
+	for(auto MemberIt = MemberSquads.CreateIterator(); MemberIt; ++MemberIt)
+	{
+		if(MemberIt->Key.ResolveObjectPtr() == nullptr)
+		{
+			MemberIt.RemoveCurrent();
+		}
+	}
+
+	for(const AAIStateController* Member : MembersToRemove)
+	{
+		RemoveMember(*Member);
+	}
+	MembersToRemove.Reset();
+
+	TArray<int32, TInlineAllocator<16>> SquadsToDisband;
+	for(TPair<int32, FAIStatesSquad>& SquadPair : Squads)
+	{
+		FAIStatesSquad& Squad = SquadPair.Value;
+		if(Squad.Members.IsEmpty())
+		{
+			SquadsToDisband.Add(SquadPair.Key);
+			continue;
+		}
+
+		UpdateMemberTags(Squad);
+
+		const FVector LeaderLocation = Squad.GetLeader()->GetPawn()->GetActorLocation();
+		for(int32 MemberIndex = 1; MemberIndex < Squad.Members.Num(); MemberIndex++)
+		{
+			AAIStateController* Member = Squad.Members[MemberIndex].Get();
+			if(FVector::DistSquared(Member->GetPawn()->GetActorLocation(), LeaderLocation) > FMath::Square(LeashRadius))
+			{
+				MembersToRemove.Add(Member);
+			}
+		}
+	}
+
+	for(const int32 SquadId : SquadsToDisband)
+	{
+		Disband(SquadId);
+	}
+
+	for(const AAIStateController* Member : MembersToRemove)
+	{
+		RemoveMember(*Member);
+	}
+}
+
+void FAIStatesSquadRegistry::PublishIntent(const AAIStateController& Leader, AActor* Target, int32 StateIndex, double WorldTime)
+{
+	const int32* SquadId = MemberSquads.Find(FObjectKey(&Leader));
+	FAIStatesSquad* Squad = SquadId ? Squads.Find(*SquadId) : nullptr;
+	if(Squad == nullptr || Squad->GetLeader() != &Leader)
+	{
+		return;
+	}
+
+	Squad->Intent.Target = Target;
+	Squad->Intent.StatesSet = Leader.GetAIStatesSetConfig();
+	Squad->Intent.StateIndex = StateIndex;
+	Squad->Intent.Anchor = Leader.GetPawn() ? Leader.GetPawn()->GetActorTransform() : FTransform::Identity;
+	Squad->Intent.PublishTime = WorldTime;
+}
+
+const FAIStatesSquad* FAIStatesSquadRegistry::FindSquad(const AAIStateController& Member) const
+{
+	const int32* SquadId = MemberSquads.Find(FObjectKey(&Member));
+	return SquadId ? Squads.Find(*SquadId) : nullptr;
+}
+
+int32 FAIStatesSquadRegistry::GetFormationSlot(const AAIStateController& Member) const
+{
+	const FAIStatesSquad* Squad = FindSquad(Member);
+	if(Squad == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	return Squad->Members.IndexOfByPredicate([&Member](const TWeakObjectPtr<AAIStateController>& SquadMember)
+	{
+		return SquadMember.Get() == &Member;
+	});
+}
+
+void FAIStatesSquadRegistry::Reset()
+{
+	for(const TPair<int32, FAIStatesSquad>& SquadPair : Squads)
+	{
+		for(const TWeakObjectPtr<AAIStateController>& Member : SquadPair.Value.Members)
+		{
+			ClearMemberTags(Member.Get());
+		}
+	}
+
+	Squads.Reset();
+	MemberSquads.Reset();
+}
+
+void FAIStatesSquadRegistry::UpdateMemberTags(const FAIStatesSquad& Squad)
+{
+	for(int32 MemberIndex = 0; MemberIndex < Squad.Members.Num(); MemberIndex++)
+	{
+		const AAIStateController* Member = Squad.Members[MemberIndex].Get();
+		if(UAbilitySystemComponent* ASC = Member ? UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Member->GetPawn()) : nullptr)
+		{
+			ASC->SetLooseGameplayTagCount(AIConditions::ConditionLeader, MemberIndex == 0 ? 1 : 0);
+			ASC->SetLooseGameplayTagCount(AIConditions::ConditionRegular, MemberIndex == 0 ? 0 : 1);
+		}
+	}
+}
+
+void FAIStatesSquadRegistry::ClearMemberTags(const AAIStateController* Member)
+{
+	if(UAbilitySystemComponent* ASC = Member ? UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Member->GetPawn()) : nullptr)
+	{
+		ASC->SetLooseGameplayTagCount(AIConditions::ConditionLeader, 0);
+		ASC->SetLooseGameplayTagCount(AIConditions::ConditionRegular, 0);
+	}
+}
+
+void FAIStatesSquadRegistry::Disband(int32 SquadId)
+{
+	FAIStatesSquad Squad;
+	if(Squads.RemoveAndCopyValue(SquadId, Squad) == false)
+	{
+		return;
+	}
+
+	for(const TWeakObjectPtr<AAIStateController>& Member : Squad.Members)
+	{
+		MemberSquads.Remove(FObjectKey(Member.Get()));
+		ClearMemberTags(Member.Get());
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericTeamAgentInterface.h"
+#include "UObject/ObjectKey.h"
+
+class AAIStateController;
+class UAIStatesSet;
+
+// Decision of a squad leader published to regular members of its squad
+struct FAIStatesSquadIntent
+{
+	TWeakObjectPtr<AActor> Target;
+
+	// States set the state index belongs to, members using another set ignore the intent
+	TWeakObjectPtr<const UAIStatesSet> StatesSet;
+
+	int32 StateIndex = INDEX_NONE;
+
+	// Transform of the leader pawn when the intent was published, formation slots are placed relative to it
+	FTransform Anchor;
+
+	double PublishTime = -1.0;
+
+	bool IsFresh(double WorldTime, float Timeout) const { return PublishTime >= 0.0 && WorldTime - PublishTime <= Timeout; }
+};
+
+// Squad of controllers sharing decisions of their leader
+struct FAIStatesSquad
+{
+	int32 SquadId = INDEX_NONE;
+
+	FGenericTeamId TeamId = FGenericTeamId::NoTeam;
+
+	// Leader first, index of a member is its formation slot
+	TArray<TWeakObjectPtr<AAIStateController>> Members;
+
+	FAIStatesSquadIntent Intent;
+
+	AAIStateController* GetLeader() const { return Members.Num() > 0 ? Members[0].Get() : nullptr; }
+
+	// Location of formation slot relative to the intent anchor, slots alternate left and right in rows behind the leader
+	FVector GetFormationSlotLocation(int32 Slot, float Spacing) const;
+};
+
+/**
+ * FAIStatesSquadRegistry
+ *
+ *	Squads of AI state controllers, maintained by the AI states subsystem. Only the leader of a squad runs the full state
+ *	evaluation and publishes its target and state, regular members follow the intent after checking their own conditions.
+ *	Leaders own the AI.Condition.Leader tag and members the AI.Condition.Regular tag, so conditions can target either.
+ */
+class LYRAGAME_API FAIStatesSquadRegistry
+{
+public:
+
+	// Creates squad led by the controller, removing it from its previous squad
+	int32 CreateSquad(AAIStateController& Leader);
+
+	// Adds controller to the squad as a regular member, removing it from its previous squad
+	bool AddMember(int32 SquadId, AAIStateController& Member);
+
+	// Removes controller from its squad. Next member takes over a leaderless squad, empty squads are disbanded
+	void RemoveMember(const AAIStateController& Member);
+
+	// Function removing destroyed members and members farther than LeashRadius from their leader
+	void Prune(float LeashRadius);
+
+	// Stores decision of a squad leader, ignored for regular members
+	void PublishIntent(const AAIStateController& Leader, AActor* Target, int32 StateIndex, double WorldTime);
+
+	const FAIStatesSquad* FindSquad(const AAIStateController& Member) const;
+	FAIStatesSquad* FindSquad(int32 SquadId) { return Squads.Find(SquadId); }
+
+	// Getter function retrieving formation slot of the controller in its squad, INDEX_NONE outside of squads
+	int32 GetFormationSlot(const AAIStateController& Member) const;
+
+	const TMap<int32, FAIStatesSquad>& GetSquads() const { return Squads; }
+
+	void Reset();
+
+private:
+
+	// Gives leader and regular tags to members of the squad
+	static void UpdateMemberTags(const FAIStatesSquad& Squad);
+
+	// Takes leader and regular tags away from the controller
+	static void ClearMemberTags(const AAIStateController* Member);
+
+	void Disband(int32 SquadId);
+
+	TMap<int32, FAIStatesSquad> Squads;
+
+	// Squad of each member, by controller
+	TMap<FObjectKey, int32> MemberSquads;
+
+	int32 NextSquadId = 0;
+};
@@ -0,0 +1,48 @@
+#include "AIStatesStats.h"
+
+#include "UObject/Class.h"
+
+DEFINE_STAT(STAT_AIStates_ConditionsEvaluated);
+DEFINE_STAT(STAT_AIStates_StatesSelected);
+DEFINE_STAT(STAT_AIStates_InterruptsFired);
+
+UE_TRACE_CHANNEL_DEFINE(AIStatesChannel);
+
+FAIStatesConditionProfile FAIStatesConditionProfile::Make(const UScriptStruct* ConditionStruct, const UObject* Owner, FName StateName)
+{
+	const FString TypeName = GetNameSafe(ConditionStruct);
+
+	FAIStatesConditionProfile Profile;
+	if(Owner == nullptr)
+	{
+		Profile.TraceName = TypeName;
+	}
+	else if(StateName.IsNone())
+	{
+		Profile.TraceName = FString::Printf(TEXT("%s [%s]"), *TypeName, *Owner->GetName());
+	}
+	else
+	{
+		Profile.TraceName = FString::Printf(TEXT("%s [%s.%s]"), *TypeName, *Owner->GetName(), *StateName.ToString());
+	}
+
+#if STATS
+	Profile.StatId = FDynamicStats::CreateStatId<FStatGroup_STATGROUP_AIStates>(FName(*FString::Printf(TEXT("Condition %s"), *TypeName)));
+#endif
+
+	return Profile;
+}
+
+const FAIStatesConditionProfile& FAIStatesConditionProfile::ForType(const UScriptStruct* ConditionStruct)
+{
+	// Only reached from the game thread, worker threads evaluate compiled conditions
+	check(IsInGameThread());
+
+	static TMap<const UScriptStruct*, FAIStatesConditionProfile> TypeProfiles;
+	if(const FAIStatesConditionProfile* Profile = TypeProfiles.Find(ConditionStruct))
+	{
+		return *Profile;
+	}
+
+	return TypeProfiles.Add(ConditionStruct, Make(ConditionStruct, nullptr, NAME_None));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+// Stat group shared by every part of the AI States system. Use "stat AIStates" to display it.
+DECLARE_STATS_GROUP(TEXT("AI States"), STATGROUP_AIStates, STATCAT_Advanced);
+
+// Counters shared by the controller, the states set and the subsystem
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Conditions Evaluated"), STAT_AIStates_ConditionsEvaluated, STATGROUP_AIStates, LYRAGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("States Selected"), STAT_AIStates_StatesSelected, STATGROUP_AIStates, LYRAGAME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Interrupts Fired"), STAT_AIStates_InterruptsFired, STATGROUP_AIStates, LYRAGAME_API);
+
+// Trace channel of the AI States system. Use "-trace=default,AIStates" to record its scopes in Unreal Insights.
+UE_TRACE_CHANNEL_EXTERN(AIStatesChannel, LYRAGAME_API);
+
+class UObject;
+class UScriptStruct;
+
+// Profiling names of a single configured condition, built when its states set compiles
+struct LYRAGAME_API FAIStatesConditionProfile
+{
+	// Insights scope name, condition type followed by the owning asset and state so costs can be ranked per asset
+	FString TraceName;
+
+#if STATS
+	// Cycle counter shared by every condition of the same type
+	TStatId StatId;
+#endif
+
+	static FAIStatesConditionProfile Make(const UScriptStruct* ConditionStruct, const UObject* Owner, FName StateName);
+
+	// Profile shared by every condition of the type, for conditions outside of states
+	static const FAIStatesConditionProfile& ForType(const UScriptStruct* ConditionStruct);
+};
+
+// Game thread time spent evaluating states of a single controller
+struct FAIStatesEvaluationTiming
+{
+	// Adds time of one evaluation step, steps of one evaluation are added until it finishes
+	void AddStep(uint64 StartCycles) { PendingSeconds += FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles); }
+
+	void FinishEvaluation()
+	{
+		LastSeconds = PendingSeconds;
+		PeakSeconds = FMath::Max(PeakSeconds, PendingSeconds);
+		TotalSeconds += PendingSeconds;
+		PendingSeconds = 0.0;
+		NumEvaluations++;
+	}
+
+	double GetAverageSeconds() const { return NumEvaluations > 0 ? TotalSeconds / NumEvaluations : 0.0; }
+
+	double PendingSeconds = 0.0;
+	double LastSeconds = 0.0;
+	double PeakSeconds = 0.0;
+	double TotalSeconds = 0.0;
+	int32 NumEvaluations = 0;
+};
+
+#if STATS
+#define AISTATES_CONDITION_CYCLE_COUNTER(Profile) FScopeCycleCounter PREPROCESSOR_JOIN(AIStatesConditionCycleCounter, __LINE__)((Profile).StatId)
+#else
+#define AISTATES_CONDITION_CYCLE_COUNTER(Profile)
+#endif
+
+// Times a condition check by its type in "stat AIStates" and by type and owning asset on the AI States trace channel
+#define AISTATES_SCOPE_CONDITION(Profile) \
+	AISTATES_CONDITION_CYCLE_COUNTER(Profile); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*(Profile).TraceName, AIStatesChannel)
+
+// Cycle stat which also shows up as a scope on the AI States trace channel
+#define AISTATES_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, AIStatesChannel)
@@ -3,168 +3,1006 @@
 
 #include "AIStatesSubsystem.h"
 
+#include "AIStatesSet.h"
+#include "AIStatesSettings.h"
+#include "AIStatesStats.h"
+
 #include "AbilitySystemComponent.h"
 #include "AbilitySystemGlobals.h"
 
 #include "AI/AIStateController.h"
+#include "Character/LyraHealthComponent.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+#include "Misc/CommandLine.h"
+#include "Misc/ScopeExit.h"
+#include "Misc/Parse.h"
+#include "NavigationSystem.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "System/LyraSignificanceManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("State Evaluations"), STAT_AIStates_StateEvaluations, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Deferred State Evaluations"), STAT_AIStates_DeferredStateEvaluations, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scheduled Controllers"), STAT_AIStates_ScheduledControllers, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Scheduled Controllers"), STAT_AIStates_UpdateScheduledControllers, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Spatial Grid"), STAT_AIStates_UpdateSpatialGrid, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Parallel State Evaluation"), STAT_AIStates_ParallelStateEvaluation, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Significance"), STAT_AIStates_UpdateSignificance, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Arbitrate Attack Tokens"), STAT_AIStates_ArbitrateAttackTokens, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Squads"), STAT_AIStates_UpdateSquads, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Polled Interrupt Watchers"), STAT_AIStates_UpdatePolledInterruptWatchers, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Polled Interrupt Watchers"), STAT_AIStates_PolledInterruptWatchers, STATGROUP_AIStates);
+DECLARE_CYCLE_STAT(TEXT("Update Team Perception"), STAT_AIStates_UpdateTeamPerception, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Team Perceived Targets"), STAT_AIStates_TeamPerceivedTargets, STATGROUP_AIStates);
+
+namespace AIStatesSubsystem
+{
+	static TAutoConsoleVariable<int32> CVarParallelEvaluation(
+		TEXT("lyra.aistates.parallelevaluation"),
+		0,
+		TEXT("Evaluate compiled state conditions of due controllers on worker threads.\n")
+		TEXT("0 = serial, every controller is updated on the game thread\n")
+		TEXT("1 = parallel, only with lyra.aistates.conditionevaluation 1\n"),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarEQSCache(
+		TEXT("lyra.aistates.eqscache"),
+		1,
+		TEXT("Share environment query results between controllers asking the same query from nearby.\n")
+		TEXT("0 = off, every controller runs its own query\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarSquads(
+		TEXT("lyra.aistates.squads"),
+		1,
+		TEXT("Group controllers which states sets form squads. Leaders evaluate states, regular members follow their intent.\n")
+		TEXT("0 = off, every controller evaluates its states itself\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarTeamPerception(
+		TEXT("lyra.aistates.teamperception"),
+		1,
+		TEXT("Merge stimuli of controllers which states sets share team perception into one memory per team, and take their targets from it.\n")
+		TEXT("0 = off, stimuli are ignored and targets are left to blueprints\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+
+	static TAutoConsoleVariable<int32> CVarSignificance(
+		TEXT("lyra.aistates.significance"),
+		1,
+		TEXT("Map controllers to significance tiers from view points of human players.\n")
+		TEXT("0 = off, every controller is pinned to the most significant tier\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	static TAutoConsoleVariable<int32> CVarSignificanceDebug(
+		TEXT("lyra.aistates.significance.debug"),
+		0,
+		TEXT("Show number of AI controllers in every significance tier.\n")
+		TEXT("0 = off\n")
+		TEXT("1 = on\n"),
+		ECVF_Cheat);
+#endif
+
+	static FAutoConsoleCommandWithWorld DumpDecisionTracesCommand(
+		TEXT("lyra.aistates.dumpdecisiontraces"),
+		TEXT("Logs decision trace of every AI state controller, replayable against its states set."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			for(TActorIterator<AAIStateController> It(World); It; ++It)
+			{
+				const UAIStatesSet* AIStatesSet = It->GetAIStatesSetConfig();
+				UE_LOG(LogTemp, Log, TEXT("UAIStatesSubsystem - Decision trace of %s (index %d, states set %s):\n%s"),
+					*It->GetName(), It->GetDecisionControllerIndex(), *GetNameSafe(AIStatesSet), *It->GetDecisionTrace().ToString());
+			}
+		}));
 
-#include "Components/WidgetComponent.h"
+	static FAutoConsoleCommandWithWorld DumpControllerMemoryCommand(
+		TEXT("lyra.aistates.dumpcontrollermemory"),
+		TEXT("Logs AI states memory owned by every AI state controller and memory of states sets shared between them."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			TSet<UAIStatesSet*> SharedSets;
+			SIZE_T ControllersSize = 0;
+			int32 NumControllers = 0;
+			for(TActorIterator<AAIStateController> It(World); It; ++It)
+			{
+				ControllersSize += It->GetAIStatesAllocatedSize();
+				NumControllers++;
+				if(UAIStatesSet* AIStatesSet = It->GetAIStatesSetConfig())
+				{
+					SharedSets.Add(AIStatesSet);
+				}
+			}
 
+			SIZE_T SharedSize = 0;
+			for(UAIStatesSet* AIStatesSet : SharedSets)
+			{
+				const TArray<FAIStateRuntimeData>& RuntimeStates = AIStatesSet->GetRuntimeStates();
+				SharedSize += RuntimeStates.GetAllocatedSize();
+				for(const FAIStateRuntimeData& RuntimeState : RuntimeStates)
+				{
+					SharedSize += RuntimeState.Conditions.GetAllocatedSize() + RuntimeState.Abilities.GetAllocatedSize() + RuntimeState.ConditionProfiles.GetAllocatedSize();
+				}
+			}
+
+			UE_LOG(LogTemp, Log, TEXT("UAIStatesSubsystem - %d controllers own %llu bytes (%llu per controller), %d shared states sets %llu bytes"),
+				NumControllers, static_cast<uint64>(ControllersSize), static_cast<uint64>(NumControllers > 0 ? ControllersSize / NumControllers : 0),
+				SharedSets.Num(), static_cast<uint64>(SharedSize));
+		}));
+
+	static FAutoConsoleCommandWithWorld DumpControllerTimingsCommand(
+		TEXT("lyra.aistates.dumpcontrollertimings"),
+		TEXT("Logs game thread time every AI state controller spent evaluating states, most expensive controllers first."),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			TArray<const AAIStateController*> Controllers;
+			for(TActorIterator<AAIStateController> It(World); It; ++It)
+			{
+				Controllers.Add(*It);
+			}
+
+			Controllers.Sort([](const AAIStateController& A, const AAIStateController& B)
+			{
+				return A.GetEvaluationTiming().TotalSeconds > B.GetEvaluationTiming().TotalSeconds;
+			});
+
+			for(const AAIStateController* Controller : Controllers)
+			{
+				const FAIStatesEvaluationTiming& Timing = Controller->GetEvaluationTiming();
+				UE_LOG(LogTemp, Log, TEXT("UAIStatesSubsystem - %s (states set %s): %d evaluations, total %.3f ms, average %.3f ms, peak %.3f ms, last %.3f ms"),
+					*Controller->GetName(), *GetNameSafe(Controller->GetAIStatesSetConfig()), Timing.NumEvaluations, Timing.TotalSeconds * 1000.0,
+					Timing.GetAverageSeconds() * 1000.0, Timing.PeakSeconds * 1000.0, Timing.LastSeconds * 1000.0);
+			}
+		}));
+}
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
 void UAIStatesSubsystem::OnAIStatesDebugToggle(IConsoleVariable* Var)
 {
 	bDebug = Var->GetInt() > 0;
 
-	StaticInstance->UpdateDebugWidgets();
+	if(StaticInstance != nullptr)
+	{
+		StaticInstance->UpdateDebugOverlay();
+	}
+}
+
+void UAIStatesSubsystem::UpdateDebugOverlay()
+{
+	if(bDebug)
+	{
+		DebugOverlay.Register(*this);
+	}
+	else
+	{
+		DebugOverlay.Unregister();
+	}
+}
+#endif
+
+UAbilitySystemComponent* UAIStatesSubsystem::GetActiveAIActorByIndex(int32 Index) const
+{
+	const TArray<TObjectPtr<UAbilitySystemComponent>>& AbilitySystemComponents = Agents.GetAbilitySystemComponents();
+	if(AbilitySystemComponents.IsValidIndex(Index) && AbilitySystemComponents[Index])
+	{
+		return AbilitySystemComponents[Index].Get();
+	}
+
+	return nullptr;
+}
+
+void UAIStatesSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	FAIStatesCVars::CVarAIStatesDebug.AsVariable()
+		->SetOnChangedCallback(FConsoleVariableDelegate::CreateStatic(&UAIStatesSubsystem::OnAIStatesDebugToggle));
+#endif
+
+	SpatialGrid.SetCellSize(UAIStatesSettings::Get()->SpatialGridCellSize);
+	LineOfSightTraceDelegate.BindUObject(this, &ThisClass::OnLineOfSightTraceCompleted);
+	Reachability.SetCellSize(UAIStatesSettings::Get()->ReachabilityCacheCellSize);
+	EQSCache.SetCellSize(UAIStatesSettings::Get()->EQSCacheCellSize);
+
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectPropertyChanged.AddUObject(this, &ThisClass::OnObjectPropertyChanged);
+#endif
+
+	// Condition evaluation must never touch the asset loader
+	UAIStatesSettings::Get()->PinRuntimeAssets();
+
+	// Logged so a match can be rerun with the same decisions
+	if(FParse::Value(FCommandLine::Get(), TEXT("AIStatesSeed="), MatchSeed) == false)
+	{
+		MatchSeed = FMath::Rand();
+	}
+	UE_LOG(LogTemp, Log, TEXT("UAIStatesSubsystem::Initialize - AI states match seed %d, rerun with -AIStatesSeed=%d"), MatchSeed, MatchSeed);
+
+	StaticInstance = this;
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	// Debug may have been turned on before this world was created
+	UpdateDebugOverlay();
+#endif
+}
+
+void UAIStatesSubsystem::Deinitialize()
+{
+	ScheduledControllers.Empty();
+	PolledInterruptWatchers.Empty();
+	Agents.Reset();
+	SpatialGrid.Reset();
+	LineOfSightQueue.Reset();
+	Reachability.Reset();
+	AttackTokens.Reset();
+	Squads.Reset();
+	TeamPerception.Reset();
+	EQSCache.Reset();
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	DebugOverlay.Unregister();
+#endif
+
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectPropertyChanged.RemoveAll(this);
+#endif
+
+	if(UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.RemoveAll(this);
+	}
+
+	if(StaticInstance == this)
+	{
+		StaticInstance = nullptr;
+	}
+
+	Super::Deinitialize();
+}
+
+void UAIStatesSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Navigation system is created after world subsystems are initialized
+	if(UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&InWorld))
+	{
+		NavSystem->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &ThisClass::OnNavigationGenerationFinished);
+	}
+}
+
+void UAIStatesSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+	Reachability.Invalidate();
+}
+
+#if WITH_EDITOR
+void UAIStatesSubsystem::OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent)
+{
+	if(Object && (Object->IsA<UEnvQuery>() || Object->IsA<UAIStatesSet>()))
+	{
+		EQSCache.Invalidate();
+	}
+}
+#endif
+
+TStatId UAIStatesSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAIStatesSubsystem, STATGROUP_Tickables);
+}
+
+void UAIStatesSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double TickStartTime = FPlatformTime::Seconds();
+	ON_SCOPE_EXIT { LastTickSeconds = FPlatformTime::Seconds() - TickStartTime; };
+
+	UpdateSpatialGrid();
+	UpdatePolledInterruptWatchers();
+	UpdateSignificance();
+	UpdateSquads();
+	UpdateTeamPerception();
+	UpdateScheduledControllers();
+	ArbitrateAttackTokens();
+
+	// Sweeps and raycasts queued by this frame's updates are issued last, so their results are ready next frame
+	if(UWorld* World = GetWorld())
+	{
+		const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+		LineOfSightQueue.Flush(*World, LineOfSightTraceDelegate, Settings->MaxLineOfSightTracesPerFrame);
+		Reachability.Update(*World, Settings->MaxReachabilityRaycastsPerFrame, Settings->ReachabilityCacheTimeToLive);
+		EQSCache.Update(World->GetTimeSeconds(), Settings->EQSCacheTimeToLive);
+	}
 }
 
-void UAIStatesSubsystem::UpdateDebugWidgets()
+void UAIStatesSubsystem::UpdateSignificance()
 {
-	if(bDebug == false)
+	UWorld* World = GetWorld();
+	auto* SignificanceManager = World ? USignificanceManager::Get<ULyraSignificanceManager>(World) : nullptr;
+	if(SignificanceManager == nullptr || World->GetTimeSeconds() < NextSignificanceUpdateTime)
 	{
-		for (auto It = PerAIWidget_Debug.CreateIterator(); It; ++It)
+		return;
+	}
+
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdateSignificance);
+	NextSignificanceUpdateTime = World->GetTimeSeconds() + UAIStatesSettings::Get()->SignificanceUpdateInterval;
+
+	if(AIStatesSubsystem::CVarSignificance.GetValueOnGameThread() > 0)
+	{
+		SignificanceManager->UpdateFromPlayerViewpoints();
+	}
+	else
+	{
+		for(const FAIStatesScheduledController& Scheduled : ScheduledControllers)
 		{
-			auto* WidgetComp = PerAIWidget_Debug[It.GetIndex()];
-			if(IsValid(WidgetComp) && IsValid(WidgetComp->GetOwner()))
+			if(AAIStateController* AIController = Scheduled.Controller.Get())
 			{
-				WidgetComp->GetOwner()->RemoveOwnedComponent(WidgetComp);
-				WidgetComp->DestroyComponent();
+				AIController->SetSignificanceTier(0);
 			}
 		}
-		PerAIWidget_Debug.Empty();
+	}
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	if(AIStatesSubsystem::CVarSignificanceDebug.GetValueOnGameThread() > 0 && GEngine)
+	{
+		TArray<int32> TierPopulation;
+		GetSignificanceTierPopulation(TierPopulation);
 
+		constexpr int32 Key = 200;
+		for(int32 TierIndex = 0; TierIndex < TierPopulation.Num(); TierIndex++)
+		{
+			GEngine->AddOnScreenDebugMessage(Key + TierIndex, UAIStatesSettings::Get()->SignificanceUpdateInterval, FColor::Cyan,
+				FString::Printf(TEXT("AI significance tier %d: %d bots"), TierIndex, TierPopulation[TierIndex]));
+		}
+	}
+#endif
+}
+
+void UAIStatesSubsystem::GetSignificanceTierPopulation(TArray<int32>& OutTierPopulation) const
+{
+	OutTierPopulation.Reset();
+	OutTierPopulation.SetNumZeroed(FMath::Max(UAIStatesSettings::Get()->SignificanceTiers.Num(), 1));
+	for(const FAIStatesScheduledController& Scheduled : ScheduledControllers)
+	{
+		if(const AAIStateController* AIController = Scheduled.Controller.Get())
+		{
+			OutTierPopulation[FMath::Clamp(AIController->GetSignificanceTier(), 0, OutTierPopulation.Num() - 1)]++;
+		}
+	}
+}
+
+void UAIStatesSubsystem::AddPolledInterruptWatcher(AAIStateController* AIController)
+{
+	if(ensureMsgf(AIController != nullptr, TEXT("AI Controller is nullptr!")))
+	{
+		PolledInterruptWatchers.AddUnique(AIController);
+	}
+}
+
+void UAIStatesSubsystem::RemovePolledInterruptWatcher(const AAIStateController* AIController)
+{
+	PolledInterruptWatchers.RemoveAllSwap([AIController](const TWeakObjectPtr<AAIStateController>& Watcher)
+	{
+		return Watcher.Get() == AIController || Watcher.IsValid() == false;
+	});
+}
+
+void UAIStatesSubsystem::UpdatePolledInterruptWatchers()
+{
+	if(PolledInterruptWatchers.IsEmpty())
+	{
 		return;
 	}
 
-	PerAIWidget_Debug.Empty();
-	for(const TObjectPtr<UAbilitySystemComponent> AIAsc : ActiveAIActorsASCList)
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdatePolledInterruptWatchers);
+	SET_DWORD_STAT(STAT_AIStates_PolledInterruptWatchers, PolledInterruptWatchers.Num());
+
+	// Fired watchers disarm themselves and abilities ending in response may arm new ones, so a copy is iterated
+	PolledInterruptWatchersToCheck = PolledInterruptWatchers;
+	for(const TWeakObjectPtr<AAIStateController>& Watcher : PolledInterruptWatchersToCheck)
 	{
-		AddDebugWidget(AIAsc);
+		if(AAIStateController* AIController = Watcher.Get())
+		{
+			AIController->GetInterruptWatcher().Check();
+		}
 	}
+
+	PolledInterruptWatchers.RemoveAllSwap([](const TWeakObjectPtr<AAIStateController>& Watcher) { return Watcher.IsValid() == false; });
 }
 
-void UAIStatesSubsystem::AddDebugWidget(const TWeakObjectPtr<UAbilitySystemComponent>& AIAsc)
+void UAIStatesSubsystem::ArbitrateAttackTokens()
 {
-	if(AIAsc.IsValid() == false)
+	// Tokens asked for by this frame's updates are granted before the next evaluation of the asking controllers
+	const UWorld* World = GetWorld();
+	if(World == nullptr || World->GetTimeSeconds() < NextAttackTokenArbitrationTime)
 	{
 		return;
 	}
-	auto* AIPawn = Cast<APawn>(AIAsc->GetOwnerActor());
-	if(IsValid(AIPawn) == false)
+
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_ArbitrateAttackTokens);
+	AttackTokens.Arbitrate(World->GetTimeSeconds());
+	NextAttackTokenArbitrationTime = World->GetTimeSeconds() + UAIStatesSettings::Get()->AttackTokenArbitrationInterval;
+}
+
+void UAIStatesSubsystem::ReportStimulus(AAIStateController* AIController, AActor* Target, FVector Location, EAIStatesStimulusSense Sense, float Strength)
+{
+	const UWorld* World = GetWorld();
+	if(World == nullptr || AIController == nullptr || Target == nullptr || AIStatesSubsystem::CVarTeamPerception.GetValueOnGameThread() == 0)
 	{
 		return;
 	}
-	const auto* AIController = Cast<AAIStateController>(AIPawn->GetController());
-	if(!AIController)
+
+	// Dead targets are forgotten once they start dying, their bodies can still be sensed
+	ULyraHealthComponent* HealthComp = ULyraHealthComponent::FindHealthComponent(Target);
+	if(HealthComp && HealthComp->IsDeadOrDying())
 	{
 		return;
 	}
-	
-	// Add widget component for debug to AI Actor
-	auto* WidgetComponent = Cast<UWidgetComponent>(
-		AIPawn->AddComponentByClass(UWidgetComponent::StaticClass(),false, FTransform::Identity, false));
-		
-	if(IsValid(WidgetComponent))
+
+	if(HealthComp)
 	{
-		PerAIWidget_Debug.Add(WidgetComponent);
-		
-		WidgetComponent->SetWidgetClass(AIController->PerAIWidgetClass_Debug);
-		WidgetComponent->InitWidget();
-		WidgetComponent->SetWidgetSpace(EWidgetSpace::Screen);
+		HealthComp->OnDeathStarted.AddUniqueDynamic(this, &ThisClass::OnPerceivedTargetDeathStarted);
 	}
+
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	const float SenseConfidence = Sense == EAIStatesStimulusSense::Sight ? Settings->SightStimulusConfidence : Settings->HearingStimulusConfidence;
+	TeamPerception.Report(AIController->GetGenericTeamId(), *Target, Location, Sense, Strength * SenseConfidence, World->GetTimeSeconds());
 }
 
-void UAIStatesSubsystem::RemoveDebugWidget(const TWeakObjectPtr<UAbilitySystemComponent>& AIAsc)
+void UAIStatesSubsystem::OnPerceivedTargetDeathStarted(AActor* OwningActor)
 {
-	if(AIAsc.IsValid() == false)
+	if(OwningActor)
+	{
+		TeamPerception.Forget(*OwningActor);
+	}
+}
+
+void UAIStatesSubsystem::UpdateTeamPerception()
+{
+	const UWorld* World = GetWorld();
+	if(World == nullptr || World->GetTimeSeconds() < NextTeamPerceptionUpdateTime)
 	{
 		return;
 	}
-	auto* AIPawn = Cast<APawn>(AIAsc->GetOwnerActor());
-	if(IsValid(AIPawn) == false)
+
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	NextTeamPerceptionUpdateTime = World->GetTimeSeconds() + Settings->TeamPerceptionUpdateInterval;
+
+	if(AIStatesSubsystem::CVarTeamPerception.GetValueOnGameThread() == 0)
 	{
+		TeamPerception.Reset();
 		return;
 	}
-	const AAIController* AIController = Cast<AAIController>(AIPawn->GetController());
-	if(!AIController)
+
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdateTeamPerception);
+	TeamPerception.Update(World->GetTimeSeconds(), Settings->TargetConfidenceHalfLife, Settings->ForgetTargetConfidence);
+	SET_DWORD_STAT(STAT_AIStates_TeamPerceivedTargets, TeamPerception.Num());
+
+	for(const TWeakObjectPtr<AAIStateController>& Controller : Agents.GetControllers())
+	{
+		AAIStateController* AIController = Controller.Get();
+		const UAIStatesSet* AIStatesSet = AIController ? AIController->GetAIStatesSetConfig() : nullptr;
+		if(AIStatesSet && AIStatesSet->bShareTeamPerception)
+		{
+			AIController->UpdateTargetFromTeamPerception(TeamPerception, Settings->MinTargetConfidence);
+		}
+	}
+}
+
+void UAIStatesSubsystem::UpdateSquads()
+{
+	const UWorld* World = GetWorld();
+	if(World == nullptr || World->GetTimeSeconds() < NextSquadUpdateTime)
 	{
 		return;
 	}
-	
-	for(auto* DebugComponent : AIPawn->GetComponentsByTag(UWidgetComponent::StaticClass(), "AIStateDebug"))
+
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	NextSquadUpdateTime = World->GetTimeSeconds() + Settings->SquadUpdateInterval;
+
+	if(Settings->MaxSquadSize < 2 || AIStatesSubsystem::CVarSquads.GetValueOnGameThread() == 0)
 	{
-		AIPawn->RemoveOwnedComponent(DebugComponent);
+		Squads.Reset();
+		return;
 	}
 
-	const int32 IndexToRemove = ActiveAIActorsASCList.IndexOfByKey(AIAsc);
-	if(PerAIWidget_Debug.IsValidIndex(IndexToRemove))
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdateSquads);
+	Squads.Prune(Settings->SquadLeashRadius);
+
+	// Controllers alone in their squad join the nearest squad of their team with room, cost grows with squads rather than members
+	for(const FAIStatesScheduledController& Scheduled : ScheduledControllers)
 	{
-		UWidgetComponent* Widget = PerAIWidget_Debug[IndexToRemove];
-		PerAIWidget_Debug.RemoveAt(IndexToRemove);
-		
-		Widget->DestroyComponent();
+		AAIStateController* AIController = Scheduled.Controller.Get();
+		const UAIStatesSet* AIStatesSet = AIController ? AIController->GetAIStatesSetConfig() : nullptr;
+		if(AIStatesSet == nullptr || AIStatesSet->bFormSquads == false || AIController->GetPawn() == nullptr)
+		{
+			continue;
+		}
+
+		const FAIStatesSquad* CurrentSquad = Squads.FindSquad(*AIController);
+		if(CurrentSquad && CurrentSquad->Members.Num() > 1)
+		{
+			continue;
+		}
+
+		const FVector Location = AIController->GetPawn()->GetActorLocation();
+		const FGenericTeamId TeamId = AIController->GetGenericTeamId();
+
+		int32 BestSquadId = INDEX_NONE;
+		double BestDistanceSquared = FMath::Square(Settings->SquadJoinRadius);
+		for(const TPair<int32, FAIStatesSquad>& SquadPair : Squads.GetSquads())
+		{
+			const FAIStatesSquad& Squad = SquadPair.Value;
+			const AAIStateController* Leader = Squad.GetLeader();
+			if(&Squad == CurrentSquad || Leader == nullptr || Leader->GetPawn() == nullptr || Squad.Members.Num() >= Settings->MaxSquadSize
+				|| Squad.TeamId != TeamId || Leader->GetAIStatesSetConfig() != AIStatesSet)
+			{
+				continue;
+			}
+
+			const double DistanceSquared = FVector::DistSquared(Leader->GetPawn()->GetActorLocation(), Location);
+			if(DistanceSquared <= BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				BestSquadId = SquadPair.Key;
+			}
+		}
+
+		if(BestSquadId != INDEX_NONE)
+		{
+			Squads.AddMember(BestSquadId, *AIController);
+		}
+		else if(CurrentSquad == nullptr)
+		{
+			Squads.CreateSquad(*AIController);
+		}
 	}
 }
 
-UAbilitySystemComponent* UAIStatesSubsystem::GetActiveAIActorByIndex(int32 Index) const
+void UAIStatesSubsystem::RunCachedQuery(UEnvQuery* Query, const TArray<FEnvNamedValue>& QueryParams, AAIStateController* AIController, EAIStatesEQSDistribution Distribution,
+	const FAIStatesEQSQueryFinished& OnQueryFinished)
 {
-	if(ActiveAIActorsASCList.IsValidIndex(Index) && ActiveAIActorsASCList[Index])
+	if(Query == nullptr || IsValid(AIController) == false)
 	{
-		return ActiveAIActorsASCList[Index].Get();
+		OnQueryFinished.ExecuteIfBound(false, FVector::ZeroVector);
+		return;
 	}
 
-	return nullptr;
+	if(AIStatesSubsystem::CVarEQSCache.GetValueOnGameThread() == 0)
+	{
+		FAIStatesEQSCache::RunUncached(*Query, QueryParams, *AIController, Distribution, OnQueryFinished);
+		return;
+	}
+
+	// Controllers in tiers without EQS still take results shared by others
+	EQSCache.Run(*Query, QueryParams, *AIController, Distribution, OnQueryFinished, UAIStatesSettings::Get()->EQSCacheTimeToLive, AIController->CanUseEQS());
 }
 
-void UAIStatesSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+AAIStateController* UAIStatesSubsystem::GetSquadLeader(const AAIStateController* AIController) const
 {
-	Super::Initialize(Collection);
- 
-	FAIStatesCVars::CVarAIStatesDebug.AsVariable()
-		->SetOnChangedCallback(FConsoleVariableDelegate::CreateStatic(&UAIStatesSubsystem::OnAIStatesDebugToggle));
+	const FAIStatesSquad* Squad = AIController ? Squads.FindSquad(*AIController) : nullptr;
+	return Squad ? Squad->GetLeader() : nullptr;
+}
 
-	StaticInstance = this;
+void UAIStatesSubsystem::RequestAttackToken(AAIStateController* AIController, AActor* Target, float Threat)
+{
+	if(IsValid(AIController) == false || IsValid(Target) == false)
+	{
+		return;
+	}
 
+	AttackTokens.Request(*AIController, *Target, Threat, GetWorld()->GetTimeSeconds());
 }
 
-void UAIStatesSubsystem::RegisterAIActor(const AAIStateController* AIController)
+bool UAIStatesSubsystem::HasAttackToken(const AAIStateController* AIController, const AActor* Target) const
 {
-	if(IsValid(AIController) == false)
+	return AIController && AttackTokens.HasToken(*AIController, Target);
+}
+
+void UAIStatesSubsystem::ReleaseAttackToken(AAIStateController* AIController)
+{
+	if(AIController)
+	{
+		AttackTokens.Release(*AIController);
+	}
+}
+
+void UAIStatesSubsystem::SetAttackTokenCount(AActor* Target, int32 NumTokens)
+{
+	if(IsValid(Target))
+	{
+		AttackTokens.SetNumTokens(*Target, NumTokens < 0 ? INDEX_NONE : NumTokens);
+	}
+}
+
+void UAIStatesSubsystem::RequestLineOfSight(const AAIStateController* AIController, const AActor* Target, const FVector& From, const FVector& To, float TraceSphereRadius)
+{
+	LineOfSightQueue.Add({ AIController, Target, From, To, TraceSphereRadius });
+}
+
+void UAIStatesSubsystem::OnLineOfSightTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	LineOfSightQueue.OnTraceCompleted(TraceDatum, GetWorld()->GetTimeSeconds());
+}
+
+void UAIStatesSubsystem::UpdateSpatialGrid()
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdateSpatialGrid);
+
+	const TArray<TObjectPtr<UAbilitySystemComponent>>& AbilitySystemComponents = Agents.GetAbilitySystemComponents();
+	const TArray<int32>& SpatialAgentIds = Agents.GetSpatialAgentIds();
+	for(int32 AgentIndex = 0; AgentIndex < Agents.Num(); AgentIndex++)
+	{
+		const UAbilitySystemComponent* ASC = AbilitySystemComponents[AgentIndex];
+		const AActor* AgentActor = IsValid(ASC) ? ASC->GetAvatarActor() : nullptr;
+		if(AgentActor == nullptr)
+		{
+			continue;
+		}
+
+		const FVector Location = AgentActor->GetActorLocation();
+		const FGenericTeamId Team = FGenericTeamId::GetTeamIdentifier(AgentActor);
+		Agents.SetLocation(AgentIndex, Location);
+		Agents.SetTeam(AgentIndex, Team);
+
+		const int32 SpatialAgentId = SpatialAgentIds[AgentIndex];
+		if(SpatialAgentId != INDEX_NONE)
+		{
+			SpatialGrid.MoveAgent(SpatialAgentId, Location);
+			SpatialGrid.SetAgentTeam(SpatialAgentId, Team);
+		}
+	}
+}
+
+FAIStatesSpatialFilter UAIStatesSubsystem::MakeSpatialFilter(const AActor* Querier, const FGameplayTag& RequiredTag, EAIStatesTeamFilter TeamFilter) const
+{
+	FAIStatesSpatialFilter Filter;
+	Filter.RequiredTag = RequiredTag;
+	Filter.TeamFilter = TeamFilter;
+	Filter.Team = FGenericTeamId::GetTeamIdentifier(Querier);
+	Filter.IgnoredAgent = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(Querier);
+
+	return Filter;
+}
+
+TArray<UAbilitySystemComponent*> UAIStatesSubsystem::FindAIActorsInRadius(const AActor* Querier, float Radius, FGameplayTag RequiredTag, EAIStatesTeamFilter TeamFilter) const
+{
+	TArray<UAbilitySystemComponent*> FoundAIActors;
+	if(IsValid(Querier))
+	{
+		SpatialGrid.QueryRadius(Querier->GetActorLocation(), Radius, MakeSpatialFilter(Querier, RequiredTag, TeamFilter), FoundAIActors);
+	}
+
+	return FoundAIActors;
+}
+
+TArray<UAbilitySystemComponent*> UAIStatesSubsystem::FindNearestAIActors(const AActor* Querier, int32 Count, float MaxRadius, FGameplayTag RequiredTag, EAIStatesTeamFilter TeamFilter) const
+{
+	TArray<UAbilitySystemComponent*> FoundAIActors;
+	if(IsValid(Querier))
+	{
+		SpatialGrid.FindKNearest(Querier->GetActorLocation(), Count, MaxRadius, MakeSpatialFilter(Querier, RequiredTag, TeamFilter), FoundAIActors);
+	}
+
+	return FoundAIActors;
+}
+
+int32 UAIStatesSubsystem::CountAIActorsInRadius(const AActor* Querier, float Radius, FGameplayTag RequiredTag, EAIStatesTeamFilter TeamFilter) const
+{
+	if(IsValid(Querier) == false)
+	{
+		return 0;
+	}
+
+	return SpatialGrid.CountInRadius(Querier->GetActorLocation(), Radius, MakeSpatialFilter(Querier, RequiredTag, TeamFilter));
+}
+
+void UAIStatesSubsystem::UpdateScheduledControllers()
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_UpdateScheduledControllers);
+
+	// Drop controllers destroyed without unscheduling
+	ScheduledControllers.RemoveAllSwap([](const FAIStatesScheduledController& Entry) { return Entry.Controller.IsValid() == false; });
+
+	const int32 NumScheduled = ScheduledControllers.Num();
+	SET_DWORD_STAT(STAT_AIStates_ScheduledControllers, NumScheduled);
+	if(NumScheduled == 0)
 	{
 		return;
 	}
 
-	UAbilitySystemComponent* RequestingASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(AIController->GetPawn());
-	if(ActiveAIActorsASCList.Contains(RequestingASC) == false)
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	const double BudgetEndTime = FPlatformTime::Seconds() + Settings->StateEvaluationBudgetMs / 1000.0;
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+
+	// Due controllers in visiting order, starting with the ones deferred last frame
+	DueControllers.Reset();
+	for(int32 Visited = 0; Visited < NumScheduled; Visited++)
+	{
+		const int32 Index = (SchedulerCursor + Visited) % NumScheduled;
+		if(ScheduledControllers[Index].NextUpdateTime <= WorldTime)
+		{
+			DueControllers.Add(Index);
+		}
+	}
+
+	// Worker threads only run compiled conditions, other evaluation modes stay serial
+	const bool bParallel = AIStatesSubsystem::CVarParallelEvaluation.GetValueOnGameThread() > 0
+		&& FAIStatesProgram::GetEvaluationMode() == EAIStatesConditionEvaluationMode::Compiled;
+
+	// Parallel batches are wide enough to keep every worker busy
+	const int32 BatchSize = FMath::Max(Settings->StateEvaluationBatchSize, 1)
+		* (bParallel ? FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1) : 1);
+
+	// Controller updates may schedule and unschedule controllers, removal waits until every batch is done
+	bEvaluatingScheduledControllers = true;
+
+	// Check the budget once per batch, the first batch is always evaluated so no controller starves
+	int32 NumEvaluated = 0;
+	while(NumEvaluated < DueControllers.Num())
 	{
-		int32 Index = ActiveAIActorsASCList.Add(MoveTemp(RequestingASC));
+		if(NumEvaluated > 0 && FPlatformTime::Seconds() > BudgetEndTime)
+		{
+			break;
+		}
 
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-		if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0)
+		const TConstArrayView<int32> Batch = MakeArrayView(DueControllers).Slice(NumEvaluated, FMath::Min(BatchSize, DueControllers.Num() - NumEvaluated));
+		if(bParallel)
 		{
-			AddDebugWidget(MoveTemp(RequestingASC));
+			UpdateControllersParallel(Batch);
 		}
-#endif
-		
+		else
+		{
+			for(const int32 Index : Batch)
+			{
+				// Controllers unscheduled by an earlier update of this batch are cleared
+				if(AAIStateController* Controller = ScheduledControllers[Index].Controller.Get())
+				{
+					Controller->UpdateAIState();
+				}
+			}
+		}
+
+		for(const int32 Index : Batch)
+		{
+			FAIStatesScheduledController& Entry = ScheduledControllers[Index];
+			if(Entry.Controller.IsValid() == false)
+			{
+				continue;
+			}
+
+			// Keep the controller phase so the load stays spread, unless it fell a whole interval behind
+			Entry.NextUpdateTime += Entry.UpdateInterval;
+			if(Entry.NextUpdateTime <= WorldTime)
+			{
+				Entry.NextUpdateTime = WorldTime + Entry.UpdateInterval;
+			}
+		}
+
+		NumEvaluated += Batch.Num();
+	}
+
+	if(NumEvaluated > 0)
+	{
+		SchedulerCursor = (DueControllers[NumEvaluated - 1] + 1) % NumScheduled;
 	}
+
+	// Unscheduled controllers leave the schedule now that no index is in use
+	bEvaluatingScheduledControllers = false;
+	ScheduledControllers.RemoveAllSwap([](const FAIStatesScheduledController& Entry) { return Entry.Controller.IsValid() == false; });
+	SchedulerCursor = ScheduledControllers.Num() > 0 ? SchedulerCursor % ScheduledControllers.Num() : 0;
+
+	SET_DWORD_STAT(STAT_AIStates_StateEvaluations, NumEvaluated);
+	SET_DWORD_STAT(STAT_AIStates_DeferredStateEvaluations, DueControllers.Num() - NumEvaluated);
 }
 
-void UAIStatesSubsystem::UnregisterAIActor(const AAIStateController* AIController)
+void UAIStatesSubsystem::UpdateControllersParallel(TConstArrayView<int32> Batch)
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_ParallelStateEvaluation);
+
+	// Workers read the snapshot, so it is built before they start
+	GetWorldSnapshot();
+
+	PendingEvaluations.SetNum(Batch.Num(), false);
+	for(int32 BatchIndex = 0; BatchIndex < Batch.Num(); BatchIndex++)
+	{
+		FAIStatesPendingEvaluation& Pending = PendingEvaluations[BatchIndex];
+		Pending.Controller = ScheduledControllers[Batch[BatchIndex]].Controller;
+		AAIStateController* Controller = Pending.Controller.Get();
+		Pending.bPrepared = Controller && Controller->PrepareStateEvaluation(Pending.Evaluation);
+	}
+
+	ParallelFor(Batch.Num(), [this](int32 BatchIndex)
+	{
+		FAIStatesPendingEvaluation& Pending = PendingEvaluations[BatchIndex];
+		if(Pending.bPrepared)
+		{
+			Pending.Evaluation.EvaluateThreadSafeStates();
+		}
+	});
+
+	// State transitions, decision trace and anything touching the world happen back on the game thread
+	for(int32 BatchIndex = 0; BatchIndex < Batch.Num(); BatchIndex++)
+	{
+		FAIStatesPendingEvaluation& Pending = PendingEvaluations[BatchIndex];
+
+		// Controllers unscheduled by an earlier apply of this batch drop their results
+		AAIStateController* Controller = Pending.Controller.Get();
+		if(Pending.bPrepared && Controller && ScheduledControllers[Batch[BatchIndex]].Controller == Controller)
+		{
+			Controller->ApplyStateEvaluation(Pending.Evaluation);
+		}
+		Pending.Controller.Reset();
+	}
+}
+
+void UAIStatesSubsystem::ScheduleStateUpdates(AAIStateController* AIController, float UpdateInterval)
 {
 	if(IsValid(AIController) == false)
 	{
 		return;
 	}
-	
-	auto* RequestingASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(AIController->GetPawn());
-	if(ActiveAIActorsASCList.Contains(RequestingASC))
+
+	UpdateInterval = FMath::Max(UpdateInterval, 0.0f);
+
+	FAIStatesScheduledController* Entry = ScheduledControllers.FindByPredicate(
+		[AIController](const FAIStatesScheduledController& Scheduled) { return Scheduled.Controller == AIController; });
+
+	if(Entry == nullptr)
 	{
-		ActiveAIActorsASCList.Remove(RequestingASC);
+		Entry = &ScheduledControllers.AddDefaulted_GetRef();
+		Entry->Controller = AIController;
+	}
 
-#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-		if (FAIStatesCVars::CVarAIStatesDebug.GetValueOnGameThread() > 0)
+	// Golden ratio sequence gives evenly distributed phase offsets no matter how many controllers register
+	constexpr double GoldenRatioFraction = 0.6180339887;
+	const double PhaseOffset = FMath::Frac(NumScheduledTotal++ * GoldenRatioFraction);
+
+	Entry->UpdateInterval = UpdateInterval;
+	Entry->NextUpdateTime = GetWorld()->GetTimeSeconds() + PhaseOffset * UpdateInterval;
+}
+
+void UAIStatesSubsystem::UnscheduleStateUpdates(const AAIStateController* AIController)
+{
+	if(bEvaluatingScheduledControllers)
+	{
+		for(FAIStatesScheduledController& Scheduled : ScheduledControllers)
 		{
-			RemoveDebugWidget(RequestingASC);
+			if(Scheduled.Controller == AIController)
+			{
+				Scheduled.Controller.Reset();
+			}
 		}
-#endif
+		return;
+	}
+
+	ScheduledControllers.RemoveAllSwap(
+		[AIController](const FAIStatesScheduledController& Scheduled) { return Scheduled.Controller == AIController; });
+}
+
+void UAIStatesSubsystem::SetStateUpdateInterval(const AAIStateController* AIController, float UpdateInterval)
+{
+	FAIStatesScheduledController* Entry = ScheduledControllers.FindByPredicate(
+		[AIController](const FAIStatesScheduledController& Scheduled) { return Scheduled.Controller == AIController; });
+
+	if(Entry == nullptr)
+	{
+		return;
+	}
+
+	UpdateInterval = FMath::Max(UpdateInterval, 0.0f);
+
+	// Pull the next evaluation closer when the interval shrinks, keep it otherwise
+	Entry->NextUpdateTime = FMath::Min(Entry->NextUpdateTime, GetWorld()->GetTimeSeconds() + UpdateInterval);
+	Entry->UpdateInterval = UpdateInterval;
+}
+
+const FAIStatesWorldSnapshot& UAIStatesSubsystem::GetWorldSnapshot()
+{
+	if(WorldSnapshot.GetBuildFrame() != GFrameCounter)
+	{
+		WorldSnapshot.Build(Agents.GetAbilitySystemComponents(), GetWorld()->GetTimeSeconds());
+	}
+
+	return WorldSnapshot;
+}
+
+void UAIStatesSubsystem::RegisterConditionInputs(const UAIStatesSet* AIStatesSet)
+{
+	if(AIStatesSet == nullptr)
+	{
+		return;
+	}
+
+	bool bAlreadyRegistered = false;
+	RegisteredStatesSets.Add(AIStatesSet, &bAlreadyRegistered);
+	if(bAlreadyRegistered)
+	{
+		return;
+	}
+
+	AIStatesSet->ForEachCondition([this](const FAIStateConditionData& Condition)
+	{
+		Condition.RegisterSnapshotInputs(WorldSnapshot);
+	});
+
+	// Columns changed, make sure the next read rebuilds the snapshot
+	WorldSnapshot.Invalidate();
+}
+
+void UAIStatesSubsystem::RegisterAIActor(AAIStateController* AIController)
+{
+	if(IsValid(AIController) == false || AIController->GetPawn() == nullptr)
+	{
+		return;
+	}
+
+	RegisterConditionInputs(AIController->GetAIStatesSetConfig());
+
+	UAbilitySystemComponent* RequestingASC = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(AIController->GetPawn());
+	const int32 RegisteredIndex = Agents.GetDenseIndex(AIController->GetAgentHandle());
+	if(RegisteredIndex != INDEX_NONE)
+	{
+		if(Agents.GetAbilitySystemComponents()[RegisteredIndex] == RequestingASC)
+		{
+			return;
+		}
+
+		// Controller possessed another pawn, the agent of the previous one goes
+		RemoveAgent(AIController->GetAgentHandle());
 	}
+
+	const APawn* AIPawn = AIController->GetPawn();
+	const FVector Location = AIPawn->GetActorLocation();
+	const FGenericTeamId Team = FGenericTeamId::GetTeamIdentifier(AIPawn);
+	const int32 SpatialAgentId = IsValid(RequestingASC) ? SpatialGrid.AddAgent(RequestingASC, Location, Team) : INDEX_NONE;
+
+	AIController->SetAgentHandle(Agents.Add(RequestingASC, AIController, Team, Location, SpatialAgentId));
+	WorldSnapshot.Invalidate();
+}
+
+void UAIStatesSubsystem::UnregisterAIActor(AAIStateController* AIController)
+{
+	if(IsValid(AIController) == false)
+	{
+		return;
+	}
+
+	UnscheduleStateUpdates(AIController);
+	AttackTokens.Release(*AIController);
+	Squads.RemoveMember(*AIController);
+
+	if(const APawn* AIPawn = AIController->GetPawn())
+	{
+		TeamPerception.Forget(*AIPawn);
+	}
+
+	RemoveAgent(AIController->GetAgentHandle());
+	AIController->SetAgentHandle(FAIStatesAgentHandle());
+}
+
+void UAIStatesSubsystem::RemoveAgent(FAIStatesAgentHandle AgentHandle)
+{
+	const int32 AgentIndex = Agents.GetDenseIndex(AgentHandle);
+	if(AgentIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 SpatialAgentId = Agents.GetSpatialAgentIds()[AgentIndex];
+	if(SpatialAgentId != INDEX_NONE)
+	{
+		SpatialGrid.RemoveAgent(SpatialAgentId);
+	}
+
+	Agents.Remove(AgentHandle);
+	WorldSnapshot.Invalidate();
 }
\ No newline at end of file
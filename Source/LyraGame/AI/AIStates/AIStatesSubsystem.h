@@ -3,13 +3,27 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "Runtime/Engine/Public/Subsystems/WorldSubsystem.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "AIStatesWorldSnapshot.h"
+#include "AIStatesSpatialGrid.h"
+#include "AIStatesProgram.h"
+#include "AIStatesLineOfSight.h"
+#include "AIStatesReachability.h"
+#include "AIStatesAttackTokens.h"
+#include "AIStatesSquads.h"
+#include "AIStatesEQSCache.h"
+#include "AIStatesTeamPerception.h"
+#include "AIStatesAgentRegistry.h"
+#include "AIStatesDebugOverlay.h"
 
 #include "AIStatesSubsystem.generated.h"
 
-class UWidgetComponent;
 class UAbilitySystemComponent;
 class AAIStateController;
+class UAIStatesSet;
+class ANavigationData;
+class UEnvQuery;
 
 USTRUCT()
 struct FAIActorsData
@@ -20,37 +34,85 @@ struct FAIActorsData
 	TArray<TObjectPtr<UAbilitySystemComponent>> ASCList;
 };
 
+// Scheduling entry of a single controller evaluated by the AI states subsystem
+USTRUCT()
+struct FAIStatesScheduledController
+{
+	GENERATED_BODY()
+
+	// Controller which states are evaluated
+	UPROPERTY(Transient)
+	TWeakObjectPtr<AAIStateController> Controller;
+
+	// Time in seconds between two state evaluations of this controller
+	float UpdateInterval = 0.0f;
+
+	// World time at which this controller is due for its next state evaluation
+	double NextUpdateTime = 0.0;
+};
+
+// Controller updated in the current parallel batch together with its condition results
+struct FAIStatesPendingEvaluation
+{
+	TWeakObjectPtr<AAIStateController> Controller;
+	FAIStatesConditionEvaluation Evaluation;
+	bool bPrepared = false;
+};
+
 /**
  * Subsystem for AI States
+ *
+ *	Owns every registered AI state controller and evaluates their states in fixed-size batches
+ *	under a per-frame time budget, instead of one timer per controller.
  */
 UCLASS()
-class LYRAGAME_API UAIStatesSubsystem : public UWorldSubsystem
+class LYRAGAME_API UAIStatesSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
 
 public:
 
 	inline static UAIStatesSubsystem* StaticInstance = nullptr;
-	
+
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
-	void RegisterAIActor(const AAIStateController* AIController);
-	void UnregisterAIActor(const AAIStateController* AIController);
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// ----------------------------------------------------------------------------------------------------------------
+	// FTickableGameObject
+	// ----------------------------------------------------------------------------------------------------------------
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterAIActor(AAIStateController* AIController);
+	void UnregisterAIActor(AAIStateController* AIController);
+
+	// Adds controller to the state evaluation schedule. Its first evaluation is offset to spread controllers across frames
+	void ScheduleStateUpdates(AAIStateController* AIController, float UpdateInterval);
+
+	// Removes controller from the state evaluation schedule
+	void UnscheduleStateUpdates(const AAIStateController* AIController);
+
+	// Changes time between state evaluations of already scheduled controller
+	void SetStateUpdateInterval(const AAIStateController* AIController, float UpdateInterval);
+
+	// Getter function retrieving number of controllers with scheduled state evaluations
+	int32 GetScheduledControllerCount() const { return ScheduledControllers.Num(); }
+
+	// Checks interrupt watcher of the controller every tick, for interrupt conditions reading inputs without change events
+	void AddPolledInterruptWatcher(AAIStateController* AIController);
+	void RemovePolledInterruptWatcher(const AAIStateController* AIController);
 
 	// Debug
 #if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
-	
+
 	static void OnAIStatesDebugToggle(IConsoleVariable* Var);
 	inline static bool bDebug = false;
 
-	void UpdateDebugWidgets();
-	void AddDebugWidget(const TWeakObjectPtr<UAbilitySystemComponent>& AIAsc);
-	void RemoveDebugWidget(const TWeakObjectPtr<UAbilitySystemComponent>& AIAsc);
-	
-#endif
+	// Registers the debug overlay while lyra.aistates.debug is on and unregisters it otherwise
+	void UpdateDebugOverlay();
 
-	// Array containing widget components for AI Actor debugging 
-	UPROPERTY(BlueprintReadOnly)
-	TArray<UWidgetComponent*> PerAIWidget_Debug;
+#endif
 
 	// Getter function retrieving active AI actor by index
 	UFUNCTION(BlueprintCallable)
@@ -58,12 +120,216 @@ public:
 
 	// Getter function retrieving active AI actor count
 	UFUNCTION(BlueprintCallable)
-	int32 GetActiveAIActorCount() const { return ActiveAIActorsASCList.Num(); }
-	
-	const TArray<TObjectPtr<UAbilitySystemComponent>>& GetActiveAIActors() const { return ActiveAIActorsASCList; }
-	
+	int32 GetActiveAIActorCount() const { return Agents.Num(); }
+
+	const TArray<TObjectPtr<UAbilitySystemComponent>>& GetActiveAIActors() const { return Agents.GetAbilitySystemComponents(); }
+
+	// Getter function retrieving registered agents, densely packed per agent columns
+	const FAIStatesAgentRegistry& GetAgents() const { return Agents; }
+
+	// Getter function retrieving snapshot of all registered AI agents, built at most once per frame
+	const FAIStatesWorldSnapshot& GetWorldSnapshot();
+
+	// Registers inputs read from other agents by conditions of given states set as world snapshot columns
+	void RegisterConditionInputs(const UAIStatesSet* AIStatesSet);
+
+	// Getter function retrieving seed shared by random streams of every controller in this match
+	int32 GetMatchSeed() const { return MatchSeed; }
+
+	// Function handing out consecutive controller indexes, which seed controller random streams together with the match seed
+	int32 AcquireDecisionControllerIndex() { return NumDecisionControllers++; }
+
+	// Getter function retrieving grid of registered AI agents used for proximity queries
+	const FAIStatesSpatialGrid& GetSpatialGrid() const { return SpatialGrid; }
+
+	// Function retrieving registered AI agents within radius from querier, querier excluded
+	UFUNCTION(BlueprintCallable, Category=AI)
+	TArray<UAbilitySystemComponent*> FindAIActorsInRadius(const AActor* Querier, float Radius, FGameplayTag RequiredTag, EAIStatesTeamFilter TeamFilter = EAIStatesTeamFilter::Any) const;
+
+	// Function retrieving up to Count registered AI agents nearest to querier, sorted by distance, querier excluded
+	UFUNCTION(BlueprintCallable, Category=AI)
+	TArray<UAbilitySystemComponent*> FindNearestAIActors(const AActor* Querier, int32 Count, float MaxRadius, FGameplayTag RequiredTag, EAIStatesTeamFilter TeamFilter = EAIStatesTeamFilter::Any) const;
+
+	// Function counting registered AI agents within radius from querier, querier excluded
+	UFUNCTION(BlueprintCallable, Category=AI)
+	int32 CountAIActorsInRadius(const AActor* Querier, float Radius, FGameplayTag RequiredTag, EAIStatesTeamFilter TeamFilter = EAIStatesTeamFilter::Any) const;
+
+	// Queues line of sight sweep of the controller to target, traced asynchronously and written to the controller cache next frame
+	void RequestLineOfSight(const AAIStateController* AIController, const AActor* Target, const FVector& From, const FVector& To, float TraceSphereRadius);
+
+	// Getter function retrieving navmesh reachability shared by every controller
+	FAIStatesReachabilityCache& GetReachability() { return Reachability; }
+
+	// Asks for an attack token of the target, granted by the next arbitration. Has to be repeated while the controller wants to attack
+	UFUNCTION(BlueprintCallable, Category=AI)
+	void RequestAttackToken(AAIStateController* AIController, AActor* Target, float Threat = 1.0f);
+
+	// Function checking if controller holds an attack token of the target, or of any target if Target is not set
+	UFUNCTION(BlueprintCallable, Category=AI)
+	bool HasAttackToken(const AAIStateController* AIController, const AActor* Target = nullptr) const;
+
+	// Gives held attack token and pending request of the controller back
+	UFUNCTION(BlueprintCallable, Category=AI)
+	void ReleaseAttackToken(AAIStateController* AIController);
+
+	// Changes number of controllers allowed to attack the target at the same time, negative restores the default
+	UFUNCTION(BlueprintCallable, Category=AI)
+	void SetAttackTokenCount(AActor* Target, int32 NumTokens);
+
+	// Getter function retrieving attack tokens of every target
+	FAIStatesAttackTokenArbiter& GetAttackTokens() { return AttackTokens; }
+	const FAIStatesAttackTokenArbiter& GetAttackTokens() const { return AttackTokens; }
+
+	// Getter function retrieving squads of controllers which states sets form squads
+	FAIStatesSquadRegistry& GetSquads() { return Squads; }
+	const FAIStatesSquadRegistry& GetSquads() const { return Squads; }
+
+	// Runs environment query for the controller through the EQS cache. Controllers asking the same query from nearby share one execution
+	UFUNCTION(BlueprintCallable, Category=AI, meta = (AutoCreateRefTerm = "QueryParams"))
+	void RunCachedQuery(UEnvQuery* Query, const TArray<FEnvNamedValue>& QueryParams, AAIStateController* AIController, EAIStatesEQSDistribution Distribution, const FAIStatesEQSQueryFinished& OnQueryFinished);
+
+	// Getter function retrieving leader of the controller squad, nullptr outside of squads
+	UFUNCTION(BlueprintCallable, Category=AI)
+	AAIStateController* GetSquadLeader(const AAIStateController* AIController) const;
+
+	// Merges stimulus sensed by the controller into the perception memory of its team. Strength scales confidence of the sense
+	UFUNCTION(BlueprintCallable, Category=AI)
+	void ReportStimulus(AAIStateController* AIController, AActor* Target, FVector Location, EAIStatesStimulusSense Sense, float Strength = 1.0f);
+
+	// Getter function retrieving targets remembered by every team
+	const FAIStatesTeamPerception& GetTeamPerception() const { return TeamPerception; }
+
+	// Getter function retrieving time in seconds the last tick of this subsystem took
+	double GetLastTickSeconds() const { return LastTickSeconds; }
+
+	// Getter function retrieving number of scheduled controllers in every significance tier
+	void GetSignificanceTierPopulation(TArray<int32>& OutTierPopulation) const;
+
 private:
 
+#if WITH_EDITOR
+	// Drops shared query results once a query or states set is edited
+	void OnObjectPropertyChanged(UObject* Object, FPropertyChangedEvent& PropertyChangedEvent);
+#endif
+
+	// Drops reachability results once rebuilt navmesh tiles are ready
+	UFUNCTION()
+	void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+	// Called by async traces of the line of sight queue
+	void OnLineOfSightTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	// Evaluates due controllers in batches until every due controller is updated or the frame budget is spent
+	void UpdateScheduledControllers();
+
+	// Prepares batch of scheduled controllers on the game thread, evaluates their conditions on workers and applies results on the game thread
+	void UpdateControllersParallel(TConstArrayView<int32> Batch);
+
+	// Moves registered agents in the spatial grid to their current locations
+	void UpdateSpatialGrid();
+
+	// Scores significance of controllers from view points of human players, which maps them to significance tiers
+	void UpdateSignificance();
+
+	// Grants attack tokens asked for since the last arbitration, once per arbitration interval
+	void ArbitrateAttackTokens();
+
+	// Drops members leaving their squads and puts controllers without squad into the nearest squad of their team with room
+	void UpdateSquads();
+
+	// Checks interrupt watchers which inputs have no change events, such as distance to the target
+	void UpdatePolledInterruptWatchers();
+
+	// Decays targets remembered by teams and gives controllers sharing team perception their targets
+	void UpdateTeamPerception();
+
+	// Removes dying target from the memory of every team, so teams don't chase it until its confidence decays
+	UFUNCTION()
+	void OnPerceivedTargetDeathStarted(AActor* OwningActor);
+
+	// Builds spatial query filter relative to the querier
+	FAIStatesSpatialFilter MakeSpatialFilter(const AActor* Querier, const FGameplayTag& RequiredTag, EAIStatesTeamFilter TeamFilter) const;
+
+	// Removes agent with its debug widget and spatial grid entry
+	void RemoveAgent(FAIStatesAgentHandle AgentHandle);
+
+	// Registered agents, one per controller with a pawn
 	UPROPERTY(Transient)
-	TArray<TObjectPtr<UAbilitySystemComponent>> ActiveAIActorsASCList;
+	FAIStatesAgentRegistry Agents;
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	// Draws every registered agent in one canvas pass while lyra.aistates.debug is on
+	FAIStatesDebugOverlay DebugOverlay;
+#endif
+
+	// Shared per tick copy of registered agents read by conditions
+	FAIStatesWorldSnapshot WorldSnapshot;
+
+	// States sets which condition inputs are already registered in the world snapshot
+	TSet<FObjectKey> RegisteredStatesSets;
+
+	// Uniform grid of registered agents, updated every tick
+	FAIStatesSpatialGrid SpatialGrid;
+
+	UPROPERTY(Transient)
+	TArray<FAIStatesScheduledController> ScheduledControllers;
+
+	// Index of the scheduled controller visited first in the next frame, so deferred controllers are served first
+	int32 SchedulerCursor = 0;
+
+	// Number of controllers ever scheduled, used to spread first evaluations across the update interval
+	uint32 NumScheduledTotal = 0;
+
+	// Indexes of scheduled controllers due this frame, kept to reuse the allocation
+	TArray<int32> DueControllers;
+
+	// Set while due controllers are evaluated. Unscheduled controllers are only cleared then, so due indexes stay valid until the evaluation ends
+	bool bEvaluatingScheduledControllers = false;
+
+	// Per controller output slots of the parallel batch, kept to reuse the allocation
+	TArray<FAIStatesPendingEvaluation> PendingEvaluations;
+
+	// Controllers which interrupt watchers are checked every tick, and copy of them iterated while watchers fire
+	TArray<TWeakObjectPtr<AAIStateController>> PolledInterruptWatchers;
+	TArray<TWeakObjectPtr<AAIStateController>> PolledInterruptWatchersToCheck;
+
+	// Line of sight sweeps of every controller, issued together once per frame
+	FAIStatesLineOfSightQueue LineOfSightQueue;
+	FTraceDelegate LineOfSightTraceDelegate;
+
+	// Navmesh reachability of segments asked by controllers, raycast in per frame batches
+	FAIStatesReachabilityCache Reachability;
+
+	// Attack tokens of every target, granted in one arbitration pass
+	FAIStatesAttackTokenArbiter AttackTokens;
+
+	// World time of the next attack token arbitration
+	double NextAttackTokenArbitrationTime = 0.0;
+
+	// Environment query results shared by controllers asking the same query from nearby
+	FAIStatesEQSCache EQSCache;
+
+	// Squads of controllers, leaders evaluate states for their members
+	FAIStatesSquadRegistry Squads;
+
+	// World time of the next squad membership update
+	double NextSquadUpdateTime = 0.0;
+
+	// Targets remembered by every team, merged from stimuli of their members
+	FAIStatesTeamPerception TeamPerception;
+
+	// World time of the next team perception update
+	double NextTeamPerceptionUpdateTime = 0.0;
+
+	// World time of the next significance update
+	double NextSignificanceUpdateTime = 0.0;
+
+	// Time in seconds the last tick took, read by benchmarks
+	double LastTickSeconds = 0.0;
+
+	// Seed of the match, from -AIStatesSeed= on the command line or random
+	int32 MatchSeed = 0;
+
+	// Number of controller indexes handed out so far
+	int32 NumDecisionControllers = 0;
 };
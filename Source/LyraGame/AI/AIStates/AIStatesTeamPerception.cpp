@@ -0,0 +1,118 @@
+#include "AIStatesTeamPerception.h"
+
+#include "GameFramework/Actor.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AIStatesTeamPerception)
+
+void FAIStatesTeamPerception::Report(FGenericTeamId TeamId, AActor& Target, const FVector& Location, EAIStatesStimulusSense Sense, float Confidence, double WorldTime)
+{
+	TArray<FAIStatesPerceivedTarget>& Targets = TeamTargets.FindOrAdd(TeamId.GetId());
+
+	FAIStatesPerceivedTarget* PerceivedTarget = Targets.FindByPredicate([&Target](const FAIStatesPerceivedTarget& Other) { return Other.Target.Get() == &Target; });
+	if(PerceivedTarget == nullptr)
+	{
+		PerceivedTarget = &Targets.AddDefaulted_GetRef();
+		PerceivedTarget->Target = &Target;
+	}
+
+	// Members hearing a target someone sees don't blur its location
+	Confidence = FMath::Clamp(Confidence, 0.0f, 1.0f);
+	if(Confidence >= PerceivedTarget->Confidence)
+	{
+		PerceivedTarget->LastKnownLocation = Location;
+		PerceivedTarget->Confidence = Confidence;
+		PerceivedTarget->ConfidenceTime = WorldTime;
+	}
+
+	PerceivedTarget->LastSensedTime = FMath::Max(PerceivedTarget->LastSensedTime, WorldTime);
+	PerceivedTarget->SensedBy |= 1 << static_cast<uint8>(Sense);
+}
+
+void FAIStatesTeamPerception::Update(double WorldTime, float ConfidenceHalfLife, float ForgetConfidence)
+{
+	for(auto TeamIt = TeamTargets.CreateIterator(); TeamIt; ++TeamIt)
+	{
+		TArray<FAIStatesPerceivedTarget>& Targets = TeamIt.Value();
+		for(int32 TargetIndex = Targets.Num() - 1; TargetIndex >= 0; TargetIndex--)
+		{
+			FAIStatesPerceivedTarget& PerceivedTarget = Targets[TargetIndex];
+
+			const float DeltaTime = static_cast<float>(WorldTime - PerceivedTarget.ConfidenceTime);
+			PerceivedTarget.Confidence *= ConfidenceHalfLife > 0.0f ? FMath::Pow(0.5f, DeltaTime / ConfidenceHalfLife) : 0.0f;
+			PerceivedTarget.ConfidenceTime = WorldTime;
+
+			if(PerceivedTarget.Target.IsValid() == false || PerceivedTarget.Confidence < ForgetConfidence)
+			{
+				Targets.RemoveAtSwap(TargetIndex, 1, false);
+			}
+		}
+
+		if(Targets.IsEmpty())
+		{
+			TeamIt.RemoveCurrent();
+		}
+	}
+}
+
+void FAIStatesTeamPerception::Forget(const AActor& Target)
+{
+	for(TPair<uint8, TArray<FAIStatesPerceivedTarget>>& TeamPair : TeamTargets)
+	{
+		TeamPair.Value.RemoveAllSwap([&Target](const FAIStatesPerceivedTarget& PerceivedTarget) { return PerceivedTarget.Target.Get() == &Target; }, false);
+	}
+}
+
+const FAIStatesPerceivedTarget* FAIStatesTeamPerception::Find(FGenericTeamId TeamId, const AActor* Target) const
+{
+	if(Target == nullptr)
+	{
+		return nullptr;
+	}
+
+	return GetTargets(TeamId).FindByPredicate([Target](const FAIStatesPerceivedTarget& PerceivedTarget) { return PerceivedTarget.Target.Get() == Target; });
+}
+
+const FAIStatesPerceivedTarget* FAIStatesTeamPerception::FindBestTarget(FGenericTeamId TeamId, const FVector& Location, float MinConfidence) const
+{
+	const FAIStatesPerceivedTarget* BestTarget = nullptr;
+	double BestDistanceSquared = 0.0;
+	for(const FAIStatesPerceivedTarget& PerceivedTarget : GetTargets(TeamId))
+	{
+		if(PerceivedTarget.Confidence < MinConfidence || PerceivedTarget.Target.IsValid() == false)
+		{
+			continue;
+		}
+
+		const double DistanceSquared = FVector::DistSquared(Location, PerceivedTarget.LastKnownLocation);
+		if(BestTarget == nullptr || PerceivedTarget.Confidence > BestTarget->Confidence
+			|| (PerceivedTarget.Confidence == BestTarget->Confidence && DistanceSquared < BestDistanceSquared))
+		{
+			BestTarget = &PerceivedTarget;
+			BestDistanceSquared = DistanceSquared;
+		}
+	}
+
+	return BestTarget;
+}
+
+TConstArrayView<FAIStatesPerceivedTarget> FAIStatesTeamPerception::GetTargets(FGenericTeamId TeamId) const
+{
+	const TArray<FAIStatesPerceivedTarget>* Targets = TeamTargets.Find(TeamId.GetId());
+	return Targets ? TConstArrayView<FAIStatesPerceivedTarget>(*Targets) : TConstArrayView<FAIStatesPerceivedTarget>();
+}
+
+int32 FAIStatesTeamPerception::Num() const
+{
+	int32 NumTargets = 0;
+	for(const TPair<uint8, TArray<FAIStatesPerceivedTarget>>& TeamPair : TeamTargets)
+	{
+		NumTargets += TeamPair.Value.Num();
+	}
+
+	return NumTargets;
+}
+
+void FAIStatesTeamPerception::Reset()
+{
+	TeamTargets.Reset();
+}
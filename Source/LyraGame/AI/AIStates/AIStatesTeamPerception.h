@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericTeamAgentInterface.h"
+
+#include "AIStatesTeamPerception.generated.h"
+
+// Sense a stimulus reported to team perception came from
+UENUM(BlueprintType)
+enum class EAIStatesStimulusSense : uint8
+{
+	Sight,
+	Hearing
+};
+
+// Target remembered by a team, merged from stimuli of every member
+struct FAIStatesPerceivedTarget
+{
+	TWeakObjectPtr<AActor> Target;
+
+	// Location of the last stimulus trusted over the remembered one
+	FVector LastKnownLocation = FVector::ZeroVector;
+
+	// World time any member sensed the target last
+	double LastSensedTime = 0.0;
+
+	// Certainty of the team about the target, one for a full strength sighting. Decays while nobody senses the target
+	float Confidence = 0.0f;
+
+	// World time confidence was last raised or decayed at
+	double ConfidenceTime = 0.0;
+
+	// Senses which reported the target since it was remembered, one bit per EAIStatesStimulusSense
+	uint8 SensedBy = 0;
+
+	bool WasSensedBy(EAIStatesStimulusSense Sense) const { return (SensedBy & (1 << static_cast<uint8>(Sense))) != 0; }
+};
+
+/**
+ * FAIStatesTeamPerception
+ *
+ *	Targets remembered by every team, maintained by the AI states subsystem. Members report their sight and hearing
+ *	stimuli instead of tracking targets on their own, so a bot knows what any member of its team sensed. Confidence of a
+ *	target decays with its half-life while nobody senses it, forgotten targets are dropped.
+ */
+class LYRAGAME_API FAIStatesTeamPerception
+{
+public:
+
+	// Merges stimulus into the memory of the team. Stimuli weaker than the remembered confidence keep the last known location
+	void Report(FGenericTeamId TeamId, AActor& Target, const FVector& Location, EAIStatesStimulusSense Sense, float Confidence, double WorldTime);
+
+	// Decays confidence of every target, dropping destroyed targets and targets under ForgetConfidence
+	void Update(double WorldTime, float ConfidenceHalfLife, float ForgetConfidence);
+
+	// Removes target from the memory of every team
+	void Forget(const AActor& Target);
+
+	// Getter function retrieving memory of the team about the target, nullptr if the team doesn't remember it
+	const FAIStatesPerceivedTarget* Find(FGenericTeamId TeamId, const AActor* Target) const;
+
+	// Getter function retrieving most confident target of the team at least MinConfidence, the nearest to Location among equal ones
+	const FAIStatesPerceivedTarget* FindBestTarget(FGenericTeamId TeamId, const FVector& Location, float MinConfidence) const;
+
+	// Getter function retrieving every target remembered by the team
+	TConstArrayView<FAIStatesPerceivedTarget> GetTargets(FGenericTeamId TeamId) const;
+
+	int32 Num() const;
+
+	void Reset();
+
+private:
+
+	// Remembered targets by team id
+	TMap<uint8, TArray<FAIStatesPerceivedTarget>> TeamTargets;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Algo/BinarySearch.h"
+#include "Math/RandomStream.h"
+
+/**
+ * TAIStatesWeightedSampler
+ *
+ *	Picks one of the added items with probability proportional to its weight.
+ *	Cumulative weights are built while adding, a pick is a single binary search over them.
+ *	Storage is inline up to InlineCount items, so a sampler living on the stack doesn't allocate for typical state and ability pools.
+ */
+template<typename ItemType, int32 InlineCount = 16>
+class TAIStatesWeightedSampler
+{
+public:
+
+	void Reset()
+	{
+		Items.Reset();
+		CumulativeWeights.Reset();
+		TotalWeight = 0.0f;
+	}
+
+	// Adds item with given weight. Items without positive weight can never be picked and are skipped
+	void Add(const ItemType& Item, float Weight)
+	{
+		if(Weight <= 0.0f)
+		{
+			return;
+		}
+
+		TotalWeight += Weight;
+		Items.Add(Item);
+		CumulativeWeights.Add(TotalWeight);
+	}
+
+	int32 Num() const { return Items.Num(); }
+	bool IsEmpty() const { return Items.IsEmpty(); }
+	float GetTotalWeight() const { return TotalWeight; }
+
+	const ItemType& GetItem(int32 Index) const { return Items[Index]; }
+	float GetWeight(int32 Index) const { return CumulativeWeights[Index] - (Index > 0 ? CumulativeWeights[Index - 1] : 0.0f); }
+	float GetProbability(int32 Index) const { return TotalWeight > 0.0f ? GetWeight(Index) / TotalWeight : 0.0f; }
+
+	// Index of the item picked by roll in [0, 1), INDEX_NONE if there is nothing to pick
+	int32 PickIndex(float Roll) const
+	{
+		if(Items.IsEmpty())
+		{
+			return INDEX_NONE;
+		}
+
+		const int32 Index = Algo::UpperBound(CumulativeWeights, Roll * TotalWeight);
+		return FMath::Min(Index, Items.Num() - 1);
+	}
+
+	// Index of the item picked by next roll of the random stream, INDEX_NONE if there is nothing to pick
+	int32 PickIndex(const FRandomStream& RandomStream, float* OutRoll = nullptr) const
+	{
+		if(Items.IsEmpty())
+		{
+			return INDEX_NONE;
+		}
+
+		const float Roll = RandomStream.FRand();
+		if(OutRoll)
+		{
+			*OutRoll = Roll;
+		}
+
+		return PickIndex(Roll);
+	}
+
+	// True if more items were added than fit in the inline storage, meaning the sampler allocated
+	bool HasSpilled() const { return Items.Num() > InlineCount; }
+
+	// Heap memory used by the sampler, zero while items fit in the inline storage
+	SIZE_T GetAllocatedSize() const { return Items.GetAllocatedSize() + CumulativeWeights.GetAllocatedSize(); }
+
+private:
+
+	TArray<ItemType, TInlineAllocator<InlineCount>> Items;
+	TArray<float, TInlineAllocator<InlineCount>> CumulativeWeights;
+	float TotalWeight = 0.0f;
+};
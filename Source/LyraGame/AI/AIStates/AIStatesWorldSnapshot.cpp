@@ -0,0 +1,331 @@
+#include "AIStatesWorldSnapshot.h"
+
+#include "AIStatesStats.h"
+
+#include "AbilitySystemComponent.h"
+#include "AbilitySystem/LyraAbilitySystemComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Build World Snapshot"), STAT_AIStates_BuildWorldSnapshot, STATGROUP_AIStates);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshot Agents"), STAT_AIStates_SnapshotAgents, STATGROUP_AIStates);
+
+namespace AIStatesWorldSnapshot
+{
+	// Marks recent tag which is not remembered by the agent
+	constexpr float NoRecentTagTime = -1.0f;
+}
+
+int32 FAIStatesWorldSnapshot::RegisterTag(const FGameplayTag& Tag)
+{
+	if(Tag.IsValid() == false)
+	{
+		return INDEX_NONE;
+	}
+
+	if(const int32* Column = TagColumns.Find(Tag))
+	{
+		return *Column;
+	}
+
+	const int32 Column = TrackedTags.Add(Tag);
+	TagColumns.Add(Tag, Column);
+
+	return Column;
+}
+
+int32 FAIStatesWorldSnapshot::RegisterAttribute(const FGameplayAttribute& Attribute)
+{
+	if(Attribute.IsValid() == false)
+	{
+		return INDEX_NONE;
+	}
+
+	return TrackedAttributes.AddUnique(Attribute);
+}
+
+int32 FAIStatesWorldSnapshot::RegisterRecentTag(const FGameplayTag& Tag)
+{
+	if(Tag.IsValid() == false)
+	{
+		return INDEX_NONE;
+	}
+
+	if(const int32* Column = RecentTagColumns.Find(Tag))
+	{
+		return *Column;
+	}
+
+	const int32 Column = TrackedRecentTags.Add(Tag);
+	RecentTagColumns.Add(Tag, Column);
+
+	return Column;
+}
+
+int32 FAIStatesWorldSnapshot::FindTagColumn(const FGameplayTag& Tag) const
+{
+	const int32* Column = TagColumns.Find(Tag);
+	return Column ? *Column : INDEX_NONE;
+}
+
+int32 FAIStatesWorldSnapshot::FindAttributeColumn(const FGameplayAttribute& Attribute) const
+{
+	return TrackedAttributes.IndexOfByKey(Attribute);
+}
+
+int32 FAIStatesWorldSnapshot::FindRecentTagColumn(const FGameplayTag& Tag) const
+{
+	const int32* Column = RecentTagColumns.Find(Tag);
+	return Column ? *Column : INDEX_NONE;
+}
+
+void FAIStatesWorldSnapshot::Build(TConstArrayView<TObjectPtr<UAbilitySystemComponent>> InAbilitySystemComponents, double InWorldTime)
+{
+	AISTATES_SCOPE_CYCLE_COUNTER(STAT_AIStates_BuildWorldSnapshot);
+
+	WorldTime = InWorldTime;
+	BuildFrame = GFrameCounter;
+
+	AbilitySystemComponents.Reset();
+	for(const TObjectPtr<UAbilitySystemComponent>& ASC : InAbilitySystemComponents)
+	{
+		if(IsValid(ASC))
+		{
+			AbilitySystemComponents.Add(ASC.Get());
+		}
+	}
+
+	const int32 NumAgents = AbilitySystemComponents.Num();
+	const int32 NumTags = TrackedTags.Num();
+	const int32 NumAttributes = TrackedAttributes.Num();
+	const int32 NumRecentTags = TrackedRecentTags.Num();
+
+	Positions.SetNumUninitialized(NumAgents, false);
+	Teams.SetNumUninitialized(NumAgents, false);
+	OwnedTagBits.Init(false, NumAgents * NumTags);
+	TagCounts.SetNumUninitialized(NumAgents * NumTags, false);
+	HasAttributeBits.Init(false, NumAgents * NumAttributes);
+	AttributeValues.SetNumUninitialized(NumAgents * NumAttributes, false);
+	RecentTagTimesPassed.SetNumUninitialized(NumAgents * NumRecentTags, false);
+
+	FirstAgentWithTag.Init(INDEX_NONE, NumTags);
+	LastAgentWithTag.Init(INDEX_NONE, NumTags);
+	AgentsWithTagCount.Init(0, NumTags);
+
+	for(int32 AgentIndex = 0; AgentIndex < NumAgents; AgentIndex++)
+	{
+		const UAbilitySystemComponent* ASC = AbilitySystemComponents[AgentIndex];
+		const AActor* AgentActor = ASC->GetAvatarActor();
+
+		Positions[AgentIndex] = AgentActor ? AgentActor->GetActorLocation() : FVector::ZeroVector;
+		Teams[AgentIndex] = FGenericTeamId::GetTeamIdentifier(AgentActor);
+
+		// Tag count map already contains parent tags, so a single lookup answers both count and matching queries
+		for(int32 Column = 0; Column < NumTags; Column++)
+		{
+			const int32 Count = ASC->GetTagCount(TrackedTags[Column]);
+			const int32 CellIndex = AgentIndex * NumTags + Column;
+
+			TagCounts[CellIndex] = Count;
+			if(Count > 0)
+			{
+				OwnedTagBits[CellIndex] = true;
+				AgentsWithTagCount[Column]++;
+
+				if(FirstAgentWithTag[Column] == INDEX_NONE)
+				{
+					FirstAgentWithTag[Column] = AgentIndex;
+				}
+				LastAgentWithTag[Column] = AgentIndex;
+			}
+		}
+
+		for(int32 Column = 0; Column < NumAttributes; Column++)
+		{
+			bool bHasAttribute = false;
+			const int32 CellIndex = AgentIndex * NumAttributes + Column;
+
+			AttributeValues[CellIndex] = ASC->GetGameplayAttributeValue(TrackedAttributes[Column], bHasAttribute);
+			HasAttributeBits[CellIndex] = bHasAttribute;
+		}
+
+		const auto* LyraASC = Cast<ULyraAbilitySystemComponent>(ASC);
+		for(int32 Column = 0; Column < NumRecentTags; Column++)
+		{
+			float TimePassed = AIStatesWorldSnapshot::NoRecentTagTime;
+			if(LyraASC == nullptr || LyraASC->GetRecentTagTimePassed(TrackedRecentTags[Column], TimePassed) == false)
+			{
+				TimePassed = AIStatesWorldSnapshot::NoRecentTagTime;
+			}
+
+			RecentTagTimesPassed[AgentIndex * NumRecentTags + Column] = TimePassed;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_AIStates_SnapshotAgents, NumAgents);
+}
+
+int32 FAIStatesWorldSnapshot::FindFirstAgentWithTag(const FGameplayTag& Tag) const
+{
+	if(Tag.IsValid() == false)
+	{
+		return Num() > 0 ? 0 : INDEX_NONE;
+	}
+
+	const int32 Column = FindTagColumn(Tag);
+	if(Column != INDEX_NONE)
+	{
+		return FirstAgentWithTag[Column];
+	}
+
+	for(int32 AgentIndex = 0; AgentIndex < Num(); AgentIndex++)
+	{
+		if(AbilitySystemComponents[AgentIndex]->HasMatchingGameplayTag(Tag))
+		{
+			return AgentIndex;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+int32 FAIStatesWorldSnapshot::FindLastAgentWithTag(const FGameplayTag& Tag) const
+{
+	if(Tag.IsValid() == false)
+	{
+		return Num() - 1;
+	}
+
+	const int32 Column = FindTagColumn(Tag);
+	if(Column != INDEX_NONE)
+	{
+		return LastAgentWithTag[Column];
+	}
+
+	for(int32 AgentIndex = Num() - 1; AgentIndex >= 0; AgentIndex--)
+	{
+		if(AbilitySystemComponents[AgentIndex]->HasMatchingGameplayTag(Tag))
+		{
+			return AgentIndex;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+int32 FAIStatesWorldSnapshot::FindFirstAgentWithTagCount(const FGameplayTag& AgentTag, const FGameplayTag& CountedTag, int32 MinCount) const
+{
+	// Rows before the first agent with the tag can't match
+	const int32 FirstAgentIndex = FindFirstAgentWithTag(AgentTag);
+	if(FirstAgentIndex == INDEX_NONE)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 LastAgentIndex = FindLastAgentWithTag(AgentTag);
+	for(int32 AgentIndex = FirstAgentIndex; AgentIndex <= LastAgentIndex; AgentIndex++)
+	{
+		if((AgentTag.IsValid() == false || HasTag(AgentIndex, AgentTag)) && GetTagCount(AgentIndex, CountedTag) >= MinCount)
+		{
+			return AgentIndex;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+int32 FAIStatesWorldSnapshot::CountAgentsWithTag(const FGameplayTag& Tag) const
+{
+	if(Tag.IsValid() == false)
+	{
+		return Num();
+	}
+
+	const int32 Column = FindTagColumn(Tag);
+	if(Column != INDEX_NONE)
+	{
+		return AgentsWithTagCount[Column];
+	}
+
+	int32 Count = 0;
+	for(const UAbilitySystemComponent* ASC : AbilitySystemComponents)
+	{
+		Count += ASC->HasMatchingGameplayTag(Tag) ? 1 : 0;
+	}
+
+	return Count;
+}
+
+bool FAIStatesWorldSnapshot::HasTag(int32 AgentIndex, const FGameplayTag& Tag) const
+{
+	const int32 Column = FindTagColumn(Tag);
+	return Column != INDEX_NONE ? HasTag(AgentIndex, Column) : AbilitySystemComponents[AgentIndex]->HasMatchingGameplayTag(Tag);
+}
+
+bool FAIStatesWorldSnapshot::HasAnyTags(int32 AgentIndex, const FGameplayTagContainer& Tags) const
+{
+	for(const FGameplayTag& Tag : Tags)
+	{
+		if(HasTag(AgentIndex, Tag))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool FAIStatesWorldSnapshot::HasAllTags(int32 AgentIndex, const FGameplayTagContainer& Tags) const
+{
+	for(const FGameplayTag& Tag : Tags)
+	{
+		if(HasTag(AgentIndex, Tag) == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int32 FAIStatesWorldSnapshot::GetTagCount(int32 AgentIndex, const FGameplayTag& Tag) const
+{
+	const int32 Column = FindTagColumn(Tag);
+	return Column != INDEX_NONE ? GetTagCount(AgentIndex, Column) : AbilitySystemComponents[AgentIndex]->GetTagCount(Tag);
+}
+
+bool FAIStatesWorldSnapshot::GetAttributeValue(int32 AgentIndex, const FGameplayAttribute& Attribute, float& OutValue) const
+{
+	const int32 Column = FindAttributeColumn(Attribute);
+	if(Column == INDEX_NONE)
+	{
+		bool bHasAttribute = false;
+		OutValue = AbilitySystemComponents[AgentIndex]->GetGameplayAttributeValue(Attribute, bHasAttribute);
+		return bHasAttribute;
+	}
+
+	const int32 CellIndex = AgentIndex * TrackedAttributes.Num() + Column;
+	OutValue = AttributeValues[CellIndex];
+	return HasAttributeBits[CellIndex];
+}
+
+bool FAIStatesWorldSnapshot::GetRecentTagTimePassed(int32 AgentIndex, const FGameplayTag& Tag, float& OutTimePassed) const
+{
+	const int32 Column = FindRecentTagColumn(Tag);
+	if(Column == INDEX_NONE)
+	{
+		const auto* LyraASC = Cast<ULyraAbilitySystemComponent>(AbilitySystemComponents[AgentIndex]);
+		return LyraASC && LyraASC->GetRecentTagTimePassed(Tag, OutTimePassed);
+	}
+
+	OutTimePassed = RecentTagTimesPassed[AgentIndex * TrackedRecentTags.Num() + Column];
+	return OutTimePassed != AIStatesWorldSnapshot::NoRecentTagTime;
+}
+
+SIZE_T FAIStatesWorldSnapshot::GetAllocatedSize() const
+{
+	return TrackedTags.GetAllocatedSize() + TrackedAttributes.GetAllocatedSize() + TrackedRecentTags.GetAllocatedSize()
+		+ TagColumns.GetAllocatedSize() + RecentTagColumns.GetAllocatedSize()
+		+ AbilitySystemComponents.GetAllocatedSize() + Positions.GetAllocatedSize() + Teams.GetAllocatedSize()
+		+ OwnedTagBits.GetAllocatedSize() + TagCounts.GetAllocatedSize()
+		+ HasAttributeBits.GetAllocatedSize() + AttributeValues.GetAllocatedSize() + RecentTagTimesPassed.GetAllocatedSize()
+		+ FirstAgentWithTag.GetAllocatedSize() + LastAgentWithTag.GetAllocatedSize() + AgentsWithTagCount.GetAllocatedSize();
+}
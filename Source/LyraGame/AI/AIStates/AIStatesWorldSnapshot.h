@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AttributeSet.h"
+#include "GameplayTagContainer.h"
+#include "GenericTeamAgentInterface.h"
+
+class UAbilitySystemComponent;
+
+/**
+ * FAIStatesWorldSnapshot
+ *
+ *	Struct-of-arrays copy of every registered AI agent, built once per evaluation tick by the AI states subsystem.
+ *	Conditions reading other agents (AnyAI or tagged evaluation targets) read it instead of walking every ability system component.
+ *	Tags, attributes and recent tags have to be registered as columns before the build, unregistered inputs fall back to the ability system component.
+ */
+struct LYRAGAME_API FAIStatesWorldSnapshot
+{
+	// Registers tag read by conditions and returns its column
+	int32 RegisterTag(const FGameplayTag& Tag);
+
+	// Registers attribute read by conditions and returns its column
+	int32 RegisterAttribute(const FGameplayAttribute& Attribute);
+
+	// Registers recently changed tag read by conditions and returns its column
+	int32 RegisterRecentTag(const FGameplayTag& Tag);
+
+	int32 FindTagColumn(const FGameplayTag& Tag) const;
+	int32 FindAttributeColumn(const FGameplayAttribute& Attribute) const;
+	int32 FindRecentTagColumn(const FGameplayTag& Tag) const;
+
+	// Copies state of every given ability system component into the snapshot columns
+	void Build(TConstArrayView<TObjectPtr<UAbilitySystemComponent>> AbilitySystemComponents, double InWorldTime);
+
+	// Forces the next read to rebuild the snapshot, used when agents or columns change
+	void Invalidate() { BuildFrame = MAX_uint64; }
+
+	// Frame counter of the last build
+	uint64 GetBuildFrame() const { return BuildFrame; }
+
+	// Number of agents in the snapshot
+	int32 Num() const { return AbilitySystemComponents.Num(); }
+
+	const FVector& GetPosition(int32 AgentIndex) const { return Positions[AgentIndex]; }
+	FGenericTeamId GetTeam(int32 AgentIndex) const { return Teams[AgentIndex]; }
+	UAbilitySystemComponent* GetAbilitySystemComponent(int32 AgentIndex) const { return AbilitySystemComponents[AgentIndex]; }
+
+	// Index of the first agent owning given tag. Invalid tag matches any agent
+	int32 FindFirstAgentWithTag(const FGameplayTag& Tag) const;
+
+	// Index of the last agent owning given tag. Invalid tag matches any agent
+	int32 FindLastAgentWithTag(const FGameplayTag& Tag) const;
+
+	// Index of the first agent owning AgentTag with at least MinCount of CountedTag. Invalid agent tag matches any agent
+	int32 FindFirstAgentWithTagCount(const FGameplayTag& AgentTag, const FGameplayTag& CountedTag, int32 MinCount) const;
+
+	// Number of agents owning given tag. Invalid tag matches any agent
+	int32 CountAgentsWithTag(const FGameplayTag& Tag) const;
+
+	bool HasTag(int32 AgentIndex, const FGameplayTag& Tag) const;
+	bool HasAnyTags(int32 AgentIndex, const FGameplayTagContainer& Tags) const;
+	bool HasAllTags(int32 AgentIndex, const FGameplayTagContainer& Tags) const;
+	int32 GetTagCount(int32 AgentIndex, const FGameplayTag& Tag) const;
+	bool GetAttributeValue(int32 AgentIndex, const FGameplayAttribute& Attribute, float& OutValue) const;
+	bool GetRecentTagTimePassed(int32 AgentIndex, const FGameplayTag& Tag, float& OutTimePassed) const;
+
+	// Column based accessors, used when the column was resolved up front
+	bool HasTag(int32 AgentIndex, int32 TagColumn) const { return OwnedTagBits[AgentIndex * TrackedTags.Num() + TagColumn]; }
+	int32 GetTagCount(int32 AgentIndex, int32 TagColumn) const { return TagCounts[AgentIndex * TrackedTags.Num() + TagColumn]; }
+
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	// Registered inputs, order defines columns
+	TArray<FGameplayTag> TrackedTags;
+	TArray<FGameplayAttribute> TrackedAttributes;
+	TArray<FGameplayTag> TrackedRecentTags;
+
+	TMap<FGameplayTag, int32> TagColumns;
+	TMap<FGameplayTag, int32> RecentTagColumns;
+
+	// Per agent rows
+	TArray<UAbilitySystemComponent*> AbilitySystemComponents;
+	TArray<FVector> Positions;
+	TArray<FGenericTeamId> Teams;
+
+	// Per agent and column values, agent major
+	TBitArray<> OwnedTagBits;
+	TArray<int32> TagCounts;
+	TBitArray<> HasAttributeBits;
+	TArray<float> AttributeValues;
+	TArray<float> RecentTagTimesPassed;
+
+	// Per column aggregates so conditions asking about "any agent with tag" don't walk the rows
+	TArray<int32> FirstAgentWithTag;
+	TArray<int32> LastAgentWithTag;
+	TArray<int32> AgentsWithTagCount;
+
+	double WorldTime = 0.0;
+	uint64 BuildFrame = MAX_uint64;
+};
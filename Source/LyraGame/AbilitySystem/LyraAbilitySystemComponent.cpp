@@ -25,6 +25,12 @@ ULyraAbilitySystemComponent::ULyraAbilitySystemComponent(const FObjectInitialize
 	InputHeldSpecHandles.Reset();
 
 	FMemory::Memset(ActivationGroupCounts, 0, sizeof(ActivationGroupCounts));
+
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		OnActiveGameplayEffectAddedDelegateToSelf.AddUObject(this, &ThisClass::HandleRecentTagEffectAdded);
+		OnAnyGameplayEffectRemovedDelegate().AddUObject(this, &ThisClass::HandleRecentTagEffectRemoved);
+	}
 }
 
 void ULyraAbilitySystemComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -517,39 +523,58 @@ void ULyraAbilitySystemComponent::CancelActivationGroupAbilities(ELyraAbilityAct
 bool ULyraAbilitySystemComponent::GetRecentTagTimePassed(const FGameplayTag& RecentSearchedTag,
 	float& OutTimePassed) const
 {
-	const auto& ActiveGEs = GetActiveGameplayEffects();
-
-	// Remember Recent Tag GE Class
-	TSoftClassPtr<UGameplayEffect> EffectClassPtr = UAIStatesSettings::Get()->RememberRecentTagGameplayEffect;
-	const TSubclassOf<UGameplayEffect> RememberRecentTagGE = EffectClassPtr.LoadSynchronous();
-	if (!RememberRecentTagGE)
+	const FRecentTagMemory* Memory = RecentTagMemory.Find(RecentSearchedTag);
+	if (Memory == nullptr)
 	{
-		UE_LOG(LogLyraAbilitySystem, Warning, TEXT("GetRecentTagTimePassed: Unable to find RememberRecentTagGameplayEffect [%s]."), *EffectClassPtr.GetAssetName());
 		return false;
 	}
 
-	// Query to find valid Active GE Handle for searched tag
-	const FGameplayTagQuery GameplayTagQuery = FGameplayTagQuery::BuildQuery(
-		FGameplayTagQueryExpression()
-		.AllTagsMatch()
-		.AddTag(RecentSearchedTag)
-	);
-	
-	FGameplayEffectQuery GEQuery;
-	GEQuery.EffectDefinition = RememberRecentTagGE;
-	GEQuery.EffectTagQuery = GameplayTagQuery;
+	OutTimePassed = GetWorld()->GetTimeSeconds() - Memory->LastAddedTime;
+	return true;
+}
 
-	for(const auto& GameplayEffectHandle : GetActiveEffects(GEQuery))
+bool ULyraAbilitySystemComponent::IsRememberRecentTagEffect(const FGameplayEffectSpec& Spec) const
+{
+	// Class is pinned by the settings when the AI states subsystem starts, so this never loads
+	const TSubclassOf<UGameplayEffect> RememberRecentTagGE = UAIStatesSettings::Get()->GetRememberRecentTagGameplayEffectClass();
+	return RememberRecentTagGE && Spec.Def && Spec.Def->GetClass() == RememberRecentTagGE;
+}
+
+void ULyraAbilitySystemComponent::HandleRecentTagEffectAdded(UAbilitySystemComponent* Target, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle)
+{
+	if (!IsRememberRecentTagEffect(Spec))
 	{
-		const auto* GameplayEffect = ActiveGEs.GetActiveGameplayEffect(GameplayEffectHandle);
-		if(GameplayEffect && GameplayEffect->Spec.GetDynamicAssetTags().HasTag(RecentSearchedTag))
+		return;
+	}
+
+	// Stacking effects report every application under the same handle but are removed once, so each handle is counted once
+	bool bAlreadyRemembered = false;
+	RecentTagEffectHandles.Add(Handle, &bAlreadyRemembered);
+
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	for (const FGameplayTag& Tag : Spec.GetDynamicAssetTags())
+	{
+		FRecentTagMemory& Memory = RecentTagMemory.FindOrAdd(Tag);
+		Memory.LastAddedTime = WorldTime;
+		Memory.NumActiveEffects += bAlreadyRemembered ? 0 : 1;
+	}
+}
+
+void ULyraAbilitySystemComponent::HandleRecentTagEffectRemoved(const FActiveGameplayEffect& Effect)
+{
+	if (!IsRememberRecentTagEffect(Effect.Spec) || RecentTagEffectHandles.Remove(Effect.Handle) == 0)
+	{
+		return;
+	}
+
+	for (const FGameplayTag& Tag : Effect.Spec.GetDynamicAssetTags())
+	{
+		FRecentTagMemory* Memory = RecentTagMemory.Find(Tag);
+		if (Memory && --Memory->NumActiveEffects <= 0)
 		{
-			OutTimePassed = GetWorld()->TimeSeconds - GameplayEffect->StartWorldTime;
-			return true;
+			RecentTagMemory.Remove(Tag);
 		}
 	}
-
-	return false;
 }
 
 FGameplayAbilitySpec* ULyraAbilitySystemComponent::GetActivatableGameplayAbilitySpecByTag(FGameplayTag AbilityTag,
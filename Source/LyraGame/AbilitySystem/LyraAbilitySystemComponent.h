@@ -55,6 +55,8 @@ public:
 	bool CanActivateAbilityByClass(TSubclassOf<UGameplayAbility> InAbility, const FGameplayTagContainer& SourceTags, FGameplayTagContainer& FailureTags) const;
 	
 	float GetAbilityWeight(TSubclassOf<ULyraGameplayAbility> InAbility) const;
+
+	// Time since the remember recent tag effect last added the tag. False if no such effect with the tag is active
 	bool GetRecentTagTimePassed(const FGameplayTag& RecentSearchedTag, float& OutTimePassed) const;
 	FGameplayAbilitySpec* GetActivatableGameplayAbilitySpecByTag(FGameplayTag AbilityTag, bool bOnlyAbilitiesThatSatisfyTagRequirements = true) const;
 	bool WillAbilityAffectTarget(TSubclassOf<ULyraGameplayAbility> InAbility, const FGameplayEventData& Payload, float Leeway, float& Strength);
@@ -92,6 +94,12 @@ protected:
 	void ClientNotifyAbilityFailed(const UGameplayAbility* Ability, const FGameplayTagContainer& FailureReason);
 
 	void HandleAbilityFailed(const UGameplayAbility* Ability, const FGameplayTagContainer& FailureReason);
+
+	// Keep recent tag memory in sync with active remember recent tag effects
+	void HandleRecentTagEffectAdded(UAbilitySystemComponent* Target, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle);
+	void HandleRecentTagEffectRemoved(const FActiveGameplayEffect& Effect);
+	bool IsRememberRecentTagEffect(const FGameplayEffectSpec& Spec) const;
+
 protected:
 
 	// If set, this table is used to look up tag relationships for activate and cancel
@@ -113,4 +121,20 @@ protected:
 
 	// Number of abilities running in each activation group.
 	int32 ActivationGroupCounts[(uint8)ELyraAbilityActivationGroup::MAX];
+
+	// Tag remembered by active remember recent tag effects
+	struct FRecentTagMemory
+	{
+		// World time at which an effect last added the tag
+		double LastAddedTime = 0.0;
+
+		// Number of active effects remembering the tag, the tag is forgotten once it drops to zero
+		int32 NumActiveEffects = 0;
+	};
+
+	// Recent tags by tag, filled from effect added and removed delegates
+	TMap<FGameplayTag, FRecentTagMemory> RecentTagMemory;
+
+	// Handles of active remember recent tag effects counted in the recent tag memory
+	TSet<FActiveGameplayEffectHandle> RecentTagEffectHandles;
 };
@@ -46,6 +46,9 @@ public:
 	void Cheat_AddBot() { SpawnOneBot(); }
 	void Cheat_RemoveBot() { RemoveOneBot(); }
 
+	// Getter function retrieving bots spawned by this component, used by benchmarks growing the bot count
+	const TArray<TObjectPtr<AAIStateController>>& GetSpawnedBots() const { return SpawnedBotList; }
+
 protected:
 	virtual void ServerCreateBots();
 
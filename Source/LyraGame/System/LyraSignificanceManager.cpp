@@ -2,5 +2,92 @@
 
 #include "LyraSignificanceManager.h"
 
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesSettings.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(LyraSignificanceManager)
 
+const FName ULyraSignificanceManager::AIStateControllerTag = TEXT("AIStateController");
+
+void ULyraSignificanceManager::RegisterAIStateController(AAIStateController* Controller)
+{
+	if (Controller == nullptr || GetManagedObject(Controller) != nullptr)
+	{
+		return;
+	}
+
+	// Scored per view point, possibly on worker threads, only pawn location and target are read
+	auto SignificanceFunction = [](FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint)
+	{
+		const AAIStateController* AIController = Cast<AAIStateController>(ObjectInfo->GetObject());
+		return AIController ? CalculateAIStateControllerSignificance(*AIController, Viewpoint) : 0.0f;
+	};
+
+	// Tiers are applied on the game thread once the highest significance over every view point is known
+	auto PostSignificanceFunction = [](FManagedObjectInfo* ObjectInfo, float OldSignificance, float Significance, bool bFinal)
+	{
+		if (AAIStateController* AIController = Cast<AAIStateController>(ObjectInfo->GetObject()))
+		{
+			AIController->SetSignificance(Significance);
+		}
+	};
+
+	RegisterObject(Controller, AIStateControllerTag, SignificanceFunction, EPostSignificanceType::Sequential, PostSignificanceFunction);
+}
+
+void ULyraSignificanceManager::UpdateFromPlayerViewpoints()
+{
+	const UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	PlayerViewpoints.Reset();
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr || (PlayerController->PlayerState && PlayerController->PlayerState->IsABot()))
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		PlayerViewpoints.Emplace(ViewRotation, ViewLocation);
+	}
+
+	Update(PlayerViewpoints);
+}
+
+float ULyraSignificanceManager::CalculateAIStateControllerSignificance(const AAIStateController& Controller, const FTransform& Viewpoint)
+{
+	const APawn* Pawn = Controller.GetPawn();
+	if (Pawn == nullptr)
+	{
+		return 0.0f;
+	}
+
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	const FVector ToPawn = Pawn->GetActorLocation() - Viewpoint.GetLocation();
+	const float Distance = ToPawn.Size();
+
+	float Significance = Settings->SignificanceDistanceWeight * (1.0f - FMath::Clamp(Distance / Settings->SignificanceMaxDistance, 0.0f, 1.0f));
+
+	const float ViewCosine = FVector::DotProduct(Viewpoint.GetRotation().GetForwardVector(), ToPawn.GetSafeNormal());
+	if (Distance < Settings->SignificanceMaxDistance && ViewCosine >= FMath::Cos(FMath::DegreesToRadians(Settings->SignificanceViewHalfAngle)))
+	{
+		Significance += Settings->SignificanceOnScreenWeight;
+	}
+
+	if (Controller.GetTarget() != nullptr)
+	{
+		Significance += Settings->SignificanceCombatWeight;
+	}
+
+	return Significance;
+}
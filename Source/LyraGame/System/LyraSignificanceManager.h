@@ -6,6 +6,7 @@
 
 #include "LyraSignificanceManager.generated.h"
 
+class AAIStateController;
 class UObject;
 
 UCLASS()
@@ -13,4 +14,22 @@ class ULyraSignificanceManager : public USignificanceManager
 {
 	GENERATED_BODY()
 
+public:
+
+	// Tag of significance managed AI state controllers
+	static const FName AIStateControllerTag;
+
+	// Starts scoring significance of the controller and mapping it to AI states significance tiers
+	void RegisterAIStateController(AAIStateController* Controller);
+
+	// Updates significance of every managed object from view points of human players
+	void UpdateFromPlayerViewpoints();
+
+	// Significance of the controller pawn seen from the view point: closeness, on screen and combat involvement
+	static float CalculateAIStateControllerSignificance(const AAIStateController& Controller, const FTransform& Viewpoint);
+
+private:
+
+	// Reused view points of human players
+	TArray<FTransform> PlayerViewpoints;
 };
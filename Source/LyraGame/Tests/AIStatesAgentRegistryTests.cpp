@@ -0,0 +1,52 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AbilitySystemComponent.h"
+#include "AI/AIStates/AIStatesAgentRegistry.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesAgentRegistryTest, "LyraGame.AIStates.AgentRegistry",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesAgentRegistryTest::RunTest(const FString& Parameters)
+{
+	FAIStatesAgentRegistry Registry;
+
+	UAbilitySystemComponent* ASCs[3];
+	FAIStatesAgentHandle Handles[3];
+	for(int32 AgentIndex = 0; AgentIndex < UE_ARRAY_COUNT(ASCs); AgentIndex++)
+	{
+		ASCs[AgentIndex] = NewObject<UAbilitySystemComponent>(GetTransientPackage());
+		Handles[AgentIndex] = Registry.Add(ASCs[AgentIndex], nullptr, FGenericTeamId(AgentIndex), FVector(AgentIndex, 0.0f, 0.0f), AgentIndex);
+	}
+
+	TestEqual(TEXT("Every agent is registered"), Registry.Num(), 3);
+
+	// Removing the first agent moves the last one into its dense index
+	TestTrue(TEXT("Valid handle is removed"), Registry.Remove(Handles[0]));
+	TestEqual(TEXT("Registry shrinks"), Registry.Num(), 2);
+	TestFalse(TEXT("Removed handle is stale"), Registry.IsValid(Handles[0]));
+	TestFalse(TEXT("Stale handle is not removed again"), Registry.Remove(Handles[0]));
+
+	const int32 MovedIndex = Registry.GetDenseIndex(Handles[2]);
+	TestEqual(TEXT("Last agent takes the removed dense index"), MovedIndex, 0);
+	TestTrue(TEXT("Columns move with their agent"), Registry.GetAbilitySystemComponents()[MovedIndex] == ASCs[2]
+		&& Registry.GetTeams()[MovedIndex] == FGenericTeamId(2) && Registry.GetSpatialAgentIds()[MovedIndex] == 2);
+	TestTrue(TEXT("Dense index maps back to the handle"), Registry.GetHandle(MovedIndex) == Handles[2]);
+
+	// Reused slot gets a new generation, so the old handle never points at the new agent
+	const FAIStatesAgentHandle ReusedHandle = Registry.Add(ASCs[0], nullptr, FGenericTeamId::NoTeam, FVector::ZeroVector, INDEX_NONE);
+	TestEqual(TEXT("Free slot is reused"), ReusedHandle.Slot, Handles[0].Slot);
+	TestFalse(TEXT("Old handle stays stale after reuse"), Registry.IsValid(Handles[0]));
+	TestTrue(TEXT("New handle is valid"), Registry.IsValid(ReusedHandle));
+
+	Registry.Reset();
+	TestEqual(TEXT("Reset removes every agent"), Registry.Num(), 0);
+	TestFalse(TEXT("Handles are stale after reset"), Registry.IsValid(ReusedHandle) || Registry.IsValid(Handles[1]));
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
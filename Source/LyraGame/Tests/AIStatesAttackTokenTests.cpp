@@ -0,0 +1,76 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesSettings.h"
+#include "AI/AIStates/AIStatesSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesAttackTokenTest, "LyraGame.AIStates.AttackTokens",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesAttackTokenTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	UAIStatesSubsystem* AIStatesSubsystem = World->GetSubsystem<UAIStatesSubsystem>();
+	if(!TestNotNull(TEXT("AI states subsystem exists"), AIStatesSubsystem))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	AActor* Target = World->SpawnActor<AActor>();
+	AActor* OtherTarget = World->SpawnActor<AActor>();
+
+	// Slow controller evaluates like one in the least significant tier, fast one like one in the most significant tier
+	AAIStateController* SlowController = World->SpawnActor<AAIStateController>();
+	AAIStateController* FastController = World->SpawnActor<AAIStateController>();
+	AAIStateController* WeakController = World->SpawnActor<AAIStateController>();
+	SlowController->SetAIStatesUpdateInterval(1.2f);
+	FastController->SetAIStatesUpdateInterval(0.15f);
+
+	FAIStatesAttackTokenArbiter& AttackTokens = AIStatesSubsystem->GetAttackTokens();
+	AttackTokens.SetNumTokens(*Target, 2);
+
+	// Tokens are granted by priority up to the number of tokens of the target
+	AttackTokens.Request(*SlowController, *Target, 3.0f, 0.0);
+	AttackTokens.Request(*FastController, *Target, 2.0f, 0.0);
+	AttackTokens.Request(*WeakController, *Target, 1.0f, 0.0);
+	TestFalse(TEXT("Request alone doesn't grant a token"), AttackTokens.HasToken(*SlowController));
+
+	AttackTokens.Arbitrate(0.0);
+	TestEqual(TEXT("Target hands out its tokens only"), AttackTokens.GetNumHolders(*Target), 2);
+	TestTrue(TEXT("Stronger controllers hold the tokens"), AttackTokens.HasToken(*SlowController, Target) && AttackTokens.HasToken(*FastController, Target));
+	TestFalse(TEXT("Weakest controller waits for a token"), AttackTokens.HasToken(*WeakController));
+
+	// Controllers which stop asking lose their token once their evaluation interval has passed on top of the timeout
+	const float RequestTimeout = UAIStatesSettings::Get()->AttackTokenRequestTimeout;
+	const double ExpiryTime = RequestTimeout + 0.5 * (SlowController->GetAIStatesUpdateInterval() + FastController->GetAIStatesUpdateInterval());
+	AttackTokens.Arbitrate(ExpiryTime);
+	TestTrue(TEXT("Slow controller keeps its token between evaluations"), AttackTokens.HasToken(*SlowController, Target));
+	TestFalse(TEXT("Fast controller which stopped asking loses its token"), AttackTokens.HasToken(*FastController));
+	TestEqual(TEXT("Expired request isn't granted"), AttackTokens.GetNumHolders(*Target), 1);
+
+	AttackTokens.Request(*SlowController, *Target, 3.0f, ExpiryTime);
+	AttackTokens.Arbitrate(ExpiryTime + RequestTimeout);
+	TestTrue(TEXT("Renewed token is kept"), AttackTokens.HasToken(*SlowController, Target));
+
+	// Switching target frees the token for other controllers right away
+	SlowController->SetTarget(Target);
+	AttackTokens.Request(*SlowController, *Target, 3.0f, ExpiryTime + RequestTimeout);
+	AttackTokens.Arbitrate(ExpiryTime + RequestTimeout);
+	TestTrue(TEXT("Controller holds a token of its target"), AIStatesSubsystem->HasAttackToken(SlowController, Target));
+	SlowController->SetTarget(OtherTarget);
+	TestFalse(TEXT("Switching target releases the token"), AIStatesSubsystem->HasAttackToken(SlowController));
+	TestEqual(TEXT("Released token is free"), AttackTokens.GetNumHolders(*Target), 0);
+
+	AttackTokens.Reset();
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,483 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AbilitySystemComponent.h"
+#include "Async/ParallelFor.h"
+#include "LyraGameplayTags.h"
+#include "AI/AIStates/AIStatesBenchmark.h"
+#include "AI/AIStates/AIStatesProgram.h"
+#include "AI/AIStates/AIStatesSet.h"
+#include "AI/AIStates/AIStatesSpatialGrid.h"
+#include "AI/AIStates/AIStatesSubsystem.h"
+#include "AI/AIStates/AIStatesWorldSnapshot.h"
+
+#if WITH_AUTOMATION_TESTS
+
+// Benchmarks assert on results and report timings only, wall clock comparisons are unreliable on loaded machines
+namespace AIStatesBenchmarkTests
+{
+	constexpr int32 ConditionsPerController = 8;
+	constexpr int32 AgentCounts[] = { 64, 256, 1024 };
+	constexpr int32 SpatialAgentCounts[] = { 100, 500, 2000 };
+	constexpr int32 ParallelControllerCount = 4096;
+	constexpr int32 ParallelStatesPerController = 8;
+	constexpr int32 ParallelIterations = 10;
+	constexpr int32 TargetLookupIterations = 1000000;
+	constexpr int32 MemoryStatesPerSet = 16;
+	constexpr int32 MemoryConditionsPerState = 4;
+	constexpr int32 MemoryAbilitiesPerState = 4;
+	constexpr int32 MemoryControllerCount = 1000;
+
+	// Per controller copy of the states set, as controllers kept it before runtime states were shared
+	struct FPerControllerStateData
+	{
+		float StateWeight = 0.0f;
+		bool bStateBlocked = false;
+		bool bMakeBlockedOnExit = false;
+		TArray<TSharedPtr<FAIStateConditionData>> Conditions;
+		TArray<TSharedPtr<FAIStateActionData>> Abilities;
+	};
+
+	// Creates transient ability system components tagged like a mixed group of AI agents.
+	// Only the last agent owns the identifier tag, which is the worst case for conditions looking for the first match
+	TArray<TObjectPtr<UAbilitySystemComponent>> CreateAgents(int32 NumAgents, const FGameplayTag& IdentifierTag, const FGameplayTag& StatusTag)
+	{
+		TArray<TObjectPtr<UAbilitySystemComponent>> Agents;
+		Agents.Reserve(NumAgents);
+
+		for(int32 AgentIndex = 0; AgentIndex < NumAgents; AgentIndex++)
+		{
+			UAbilitySystemComponent* ASC = NewObject<UAbilitySystemComponent>(GetTransientPackage());
+			if(AgentIndex == NumAgents - 1)
+			{
+				ASC->AddLooseGameplayTag(IdentifierTag);
+			}
+			if(AgentIndex % 3 == 0)
+			{
+				ASC->AddLooseGameplayTag(StatusTag, AgentIndex % 5 + 1);
+			}
+			Agents.Add(ASC);
+		}
+
+		return Agents;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesWorldSnapshotBenchmark, "LyraGame.AIStates.Benchmark.WorldSnapshot",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FAIStatesWorldSnapshotBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesBenchmarkTests;
+
+	const FGameplayTag EvaluationTarget = LyraGameplayTags::Status_Crouching;
+	const FGameplayTag ConditionTag = LyraGameplayTags::Status_AutoRunning;
+
+	for(const int32 NumAgents : AgentCounts)
+	{
+		TArray<TObjectPtr<UAbilitySystemComponent>> Agents = CreateAgents(NumAgents, EvaluationTarget, ConditionTag);
+
+		// Per condition scan of every registered ability system component, as conditions did before the snapshot
+		int32 ScanMatches = 0;
+		const double ScanStartTime = FPlatformTime::Seconds();
+		for(int32 ControllerIndex = 0; ControllerIndex < NumAgents; ControllerIndex++)
+		{
+			// Half of the conditions look for a tagged agent, the other half count agents with tag
+			for(int32 ConditionIndex = 0; ConditionIndex < ConditionsPerController; ConditionIndex += 2)
+			{
+				for(const TObjectPtr<UAbilitySystemComponent>& ASC : Agents)
+				{
+					if(ASC->HasMatchingGameplayTag(EvaluationTarget))
+					{
+						ScanMatches += ASC->GetTagCount(ConditionTag) >= 1 ? 1 : 0;
+						break;
+					}
+				}
+
+				for(const TObjectPtr<UAbilitySystemComponent>& ASC : Agents)
+				{
+					ScanMatches += ASC->HasMatchingGameplayTag(ConditionTag) ? 1 : 0;
+				}
+			}
+		}
+		const double ScanTime = FPlatformTime::Seconds() - ScanStartTime;
+
+		// One snapshot build per tick, then every condition reads the shared columns
+		FAIStatesWorldSnapshot Snapshot;
+		Snapshot.RegisterTag(EvaluationTarget);
+		Snapshot.RegisterTag(ConditionTag);
+
+		int32 SnapshotMatches = 0;
+		const double SnapshotStartTime = FPlatformTime::Seconds();
+		Snapshot.Build(Agents, 0.0);
+		for(int32 ControllerIndex = 0; ControllerIndex < NumAgents; ControllerIndex++)
+		{
+			for(int32 ConditionIndex = 0; ConditionIndex < ConditionsPerController; ConditionIndex += 2)
+			{
+				const int32 AgentIndex = Snapshot.FindFirstAgentWithTag(EvaluationTarget);
+				if(AgentIndex != INDEX_NONE)
+				{
+					SnapshotMatches += Snapshot.GetTagCount(AgentIndex, ConditionTag) >= 1 ? 1 : 0;
+				}
+
+				SnapshotMatches += Snapshot.CountAgentsWithTag(ConditionTag);
+			}
+		}
+		const double SnapshotTime = FPlatformTime::Seconds() - SnapshotStartTime;
+
+		AddInfo(FString::Printf(TEXT("%d agents: scan %.3f ms, snapshot %.3f ms"), NumAgents, ScanTime * 1000.0, SnapshotTime * 1000.0));
+
+		TestEqual(FString::Printf(TEXT("Snapshot matches scan results for %d agents"), NumAgents), SnapshotMatches, ScanMatches);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesSpatialGridBenchmark, "LyraGame.AIStates.Benchmark.SpatialGrid",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FAIStatesSpatialGridBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesBenchmarkTests;
+
+	constexpr float WorldExtent = 20000.0f;
+	constexpr float QueryRadius = 2500.0f;
+
+	const FGameplayTag EvaluationTarget = LyraGameplayTags::Status_Crouching;
+
+	for(const int32 NumAgents : SpatialAgentCounts)
+	{
+		// Every fourth agent is a valid distance target
+		TArray<TObjectPtr<UAbilitySystemComponent>> Agents;
+		TArray<FVector> Locations;
+		FRandomStream RandomStream(NumAgents);
+		for(int32 AgentIndex = 0; AgentIndex < NumAgents; AgentIndex++)
+		{
+			UAbilitySystemComponent* ASC = NewObject<UAbilitySystemComponent>(GetTransientPackage());
+			if(AgentIndex % 4 == 0)
+			{
+				ASC->AddLooseGameplayTag(EvaluationTarget);
+			}
+			Agents.Add(ASC);
+			Locations.Add(FVector(RandomStream.FRandRange(0.0f, WorldExtent), RandomStream.FRandRange(0.0f, WorldExtent), 0.0f));
+		}
+
+		// Every agent looks for the nearest other agent with the tag, scanning every agent
+		TArray<UAbilitySystemComponent*> ScanNearest;
+		ScanNearest.Init(nullptr, NumAgents);
+		const double ScanStartTime = FPlatformTime::Seconds();
+		for(int32 QuerierIndex = 0; QuerierIndex < NumAgents; QuerierIndex++)
+		{
+			float NearestDistanceSquared = FMath::Square(QueryRadius);
+			for(int32 AgentIndex = 0; AgentIndex < NumAgents; AgentIndex++)
+			{
+				const float DistanceSquared = FVector::DistSquared(Locations[QuerierIndex], Locations[AgentIndex]);
+				if(AgentIndex != QuerierIndex && DistanceSquared <= NearestDistanceSquared && Agents[AgentIndex]->HasMatchingGameplayTag(EvaluationTarget))
+				{
+					NearestDistanceSquared = DistanceSquared;
+					ScanNearest[QuerierIndex] = Agents[AgentIndex];
+				}
+			}
+		}
+		const double ScanTime = FPlatformTime::Seconds() - ScanStartTime;
+
+		FAIStatesSpatialGrid Grid;
+		Grid.SetCellSize(QueryRadius);
+		for(int32 AgentIndex = 0; AgentIndex < NumAgents; AgentIndex++)
+		{
+			Grid.AddAgent(Agents[AgentIndex], Locations[AgentIndex], FGenericTeamId::NoTeam);
+		}
+
+		TArray<UAbilitySystemComponent*> GridNearest;
+		GridNearest.Init(nullptr, NumAgents);
+		const double GridStartTime = FPlatformTime::Seconds();
+		for(int32 QuerierIndex = 0; QuerierIndex < NumAgents; QuerierIndex++)
+		{
+			FAIStatesSpatialFilter Filter;
+			Filter.RequiredTag = EvaluationTarget;
+			Filter.IgnoredAgent = Agents[QuerierIndex];
+
+			GridNearest[QuerierIndex] = Grid.FindNearest(Locations[QuerierIndex], QueryRadius, Filter);
+		}
+		const double GridTime = FPlatformTime::Seconds() - GridStartTime;
+
+		AddInfo(FString::Printf(TEXT("%d agents: scan %.3f ms, grid %.3f ms"), NumAgents, ScanTime * 1000.0, GridTime * 1000.0));
+
+		int32 NumMismatches = 0;
+		for(int32 QuerierIndex = 0; QuerierIndex < NumAgents; QuerierIndex++)
+		{
+			NumMismatches += GridNearest[QuerierIndex] != ScanNearest[QuerierIndex] ? 1 : 0;
+		}
+		TestEqual(FString::Printf(TEXT("Grid finds the same nearest agent as scan for every querier of %d agents"), NumAgents), NumMismatches, 0);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesParallelEvaluationBenchmark, "LyraGame.AIStates.Benchmark.ParallelEvaluation",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FAIStatesParallelEvaluationBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesBenchmarkTests;
+
+	const FGameplayTag SelfTarget = AIConditions::ConditionSelf;
+	const FGameplayTag IdentifierTag = LyraGameplayTags::Status_Crouching;
+	const FGameplayTag StatusTag = LyraGameplayTags::Status_AutoRunning;
+
+	// Every state reads tags of its own agent, which is what workers evaluate
+	UAIStatesSet* StatesSet = NewObject<UAIStatesSet>(GetTransientPackage());
+	for(int32 StateIndex = 0; StateIndex < ParallelStatesPerController; StateIndex++)
+	{
+		FAIStateDataConfig& State = StatesSet->States.AddDefaulted_GetRef();
+		State.StateWeight = 1.0f;
+
+		FInstancedStruct& HasTagsInstancedStruct = State.Conditions.AddDefaulted_GetRef();
+		HasTagsInstancedStruct.InitializeAs<FGameplayTagMultipleBasedCondition>();
+		FGameplayTagMultipleBasedCondition& HasTagsCondition = HasTagsInstancedStruct.GetMutable<FGameplayTagMultipleBasedCondition>();
+		HasTagsCondition.EvaluationTarget = SelfTarget;
+		HasTagsCondition.ConditionTag.AddTag(StatusTag);
+		HasTagsCondition.bInverted = StateIndex % 2 == 1;
+
+		FInstancedStruct& TagCountInstancedStruct = State.Conditions.AddDefaulted_GetRef();
+		TagCountInstancedStruct.InitializeAs<FTagCountCondition>();
+		FTagCountCondition& TagCountCondition = TagCountInstancedStruct.GetMutable<FTagCountCondition>();
+		TagCountCondition.EvaluationTarget = SelfTarget;
+		TagCountCondition.ConditionTag = StatusTag;
+		TagCountCondition.MinCount = StateIndex % 5;
+	}
+	const FAIStatesProgram& Program = StatesSet->GetConditionProgram();
+
+	// Operations only need the subsystem to exist, a transient one stands in for the world's
+	UAIStatesSubsystem* AIStatesSubsystem = NewObject<UAIStatesSubsystem>(GetTransientPackage());
+
+	TArray<TObjectPtr<UAbilitySystemComponent>> Agents = CreateAgents(ParallelControllerCount, IdentifierTag, StatusTag);
+	TArray<FAIStatesConditionEvaluation> Evaluations;
+	Evaluations.SetNum(ParallelControllerCount);
+	for(int32 ControllerIndex = 0; ControllerIndex < ParallelControllerCount; ControllerIndex++)
+	{
+		FAIStatesConditionEvaluation& Evaluation = Evaluations[ControllerIndex];
+		Evaluation.Context.SelfASC = Agents[ControllerIndex];
+		Evaluation.Context.AIStatesSubsystem = AIStatesSubsystem;
+		Evaluation.StatesSet = StatesSet;
+		Evaluation.Program = &Program;
+		Evaluation.PendingStates.Init(true, ParallelStatesPerController);
+		Evaluation.EvaluatedStates.Init(false, ParallelStatesPerController);
+		Evaluation.Results.Init(false, ParallelStatesPerController);
+	}
+
+	// Work is split into one chunk per worker, so at most that many threads take part
+	TArray<int32> WorkerCounts = { 1, 2, 4, 8 };
+	WorkerCounts.AddUnique(FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1) + 1);
+
+	TArray<TBitArray<>> SerialResults;
+	double SerialTime = 0.0;
+	for(const int32 NumWorkers : WorkerCounts)
+	{
+		const int32 ChunkSize = FMath::DivideAndRoundUp(ParallelControllerCount, NumWorkers);
+		const double StartTime = FPlatformTime::Seconds();
+		for(int32 Iteration = 0; Iteration < ParallelIterations; Iteration++)
+		{
+			ParallelFor(NumWorkers, [&Evaluations, ChunkSize](int32 ChunkIndex)
+			{
+				const int32 LastIndex = FMath::Min((ChunkIndex + 1) * ChunkSize, Evaluations.Num());
+				for(int32 ControllerIndex = ChunkIndex * ChunkSize; ControllerIndex < LastIndex; ControllerIndex++)
+				{
+					Evaluations[ControllerIndex].EvaluateThreadSafeStates();
+				}
+			}, NumWorkers == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+		}
+		const double Time = (FPlatformTime::Seconds() - StartTime) / ParallelIterations;
+
+		if(NumWorkers == 1)
+		{
+			SerialTime = Time;
+			for(const FAIStatesConditionEvaluation& Evaluation : Evaluations)
+			{
+				SerialResults.Add(Evaluation.Results);
+			}
+		}
+
+		AddInfo(FString::Printf(TEXT("%d controllers, %d workers: %.3f ms per update (%.2fx)"),
+			ParallelControllerCount, NumWorkers, Time * 1000.0, Time > 0.0 ? SerialTime / Time : 0.0));
+
+		bool bSameResults = true;
+		for(int32 ControllerIndex = 0; ControllerIndex < ParallelControllerCount; ControllerIndex++)
+		{
+			bSameResults &= Evaluations[ControllerIndex].Results == SerialResults[ControllerIndex];
+		}
+		TestTrue(FString::Printf(TEXT("%d workers produce the same results as serial evaluation"), NumWorkers), bSameResults);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesEvaluationTargetBenchmark, "LyraGame.AIStates.Benchmark.EvaluationTarget",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FAIStatesEvaluationTargetBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesBenchmarkTests;
+
+	// Conditions targeting the player, self and other agents, looked up in turn
+	FGameplayTagMultipleBasedCondition Conditions[3];
+	Conditions[0].EvaluationTarget = AIConditions::ConditionPlayer;
+	Conditions[1].EvaluationTarget = AIConditions::ConditionSelf;
+	Conditions[2].EvaluationTarget = LyraGameplayTags::Status_Crouching;
+
+	// Tag manager lookup per check, as conditions did before targets were classified
+	const FName PlayerTagName = TEXT("AI.Condition.Player");
+	const FName SelfTagName = TEXT("AI.Condition.Self");
+	int32 RequestMatches = 0;
+	const double RequestStartTime = FPlatformTime::Seconds();
+	for(int32 Iteration = 0; Iteration < TargetLookupIterations; Iteration++)
+	{
+		const FAIStateConditionData& Condition = Conditions[Iteration % UE_ARRAY_COUNT(Conditions)];
+		if(Condition.EvaluationTarget == FGameplayTag::RequestGameplayTag(PlayerTagName))
+		{
+			RequestMatches++;
+		}
+		else if(Condition.EvaluationTarget == FGameplayTag::RequestGameplayTag(SelfTagName))
+		{
+			RequestMatches += 2;
+		}
+	}
+	const double RequestTime = FPlatformTime::Seconds() - RequestStartTime;
+
+	for(const FGameplayTagMultipleBasedCondition& Condition : Conditions)
+	{
+		Condition.ResolveEvaluationTarget();
+	}
+
+	int32 ResolvedMatches = 0;
+	const double ResolvedStartTime = FPlatformTime::Seconds();
+	for(int32 Iteration = 0; Iteration < TargetLookupIterations; Iteration++)
+	{
+		const FAIStateConditionData& Condition = Conditions[Iteration % UE_ARRAY_COUNT(Conditions)];
+		if(Condition.GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Player)
+		{
+			ResolvedMatches++;
+		}
+		else if(Condition.GetEvaluationTargetKind() == EAIStatesEvaluationTarget::Self)
+		{
+			ResolvedMatches += 2;
+		}
+	}
+	const double ResolvedTime = FPlatformTime::Seconds() - ResolvedStartTime;
+
+	AddInfo(FString::Printf(TEXT("%d checks: tag request %.2f ns per condition, resolved target %.2f ns per condition"),
+		TargetLookupIterations, RequestTime * 1.0e9 / TargetLookupIterations, ResolvedTime * 1.0e9 / TargetLookupIterations));
+
+	TestEqual(TEXT("Resolved targets classify conditions like tag requests"), ResolvedMatches, RequestMatches);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesControllerMemoryBenchmark, "LyraGame.AIStates.Benchmark.ControllerMemory",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FAIStatesControllerMemoryBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesBenchmarkTests;
+
+	UAIStatesSet* StatesSet = NewObject<UAIStatesSet>(GetTransientPackage());
+	for(int32 StateIndex = 0; StateIndex < MemoryStatesPerSet; StateIndex++)
+	{
+		FAIStateDataConfig& State = StatesSet->States.AddDefaulted_GetRef();
+		State.StateWeight = 1.0f;
+		for(int32 ConditionIndex = 0; ConditionIndex < MemoryConditionsPerState; ConditionIndex++)
+		{
+			State.Conditions.AddDefaulted_GetRef().InitializeAs<FGameplayTagMultipleBasedCondition>();
+		}
+		for(int32 AbilityIndex = 0; AbilityIndex < MemoryAbilitiesPerState; AbilityIndex++)
+		{
+			State.Abilities.AddDefaulted_GetRef().Ability.InitializeAs<FWaitAbility>();
+		}
+	}
+
+	// Per controller copy, every shared pointer also allocates its reference controller. Pointers don't own the set memory
+	auto KeepSetMemory = [](auto*) {};
+	TArray<FPerControllerStateData> PerControllerStates;
+	SIZE_T ReferenceControllersSize = 0;
+	for(FAIStateDataConfig& State : StatesSet->States)
+	{
+		FPerControllerStateData& StateData = PerControllerStates.Add_GetRef({ State.StateWeight, false, State.bBlockOnExit, {}, {} });
+		for(FInstancedStruct& Condition : State.Conditions)
+		{
+			StateData.Conditions.Add(MakeShareable(Condition.GetMutablePtr<FAIStateConditionData>(), KeepSetMemory));
+		}
+		for(FAIStateAbilityNamedWrapper& Ability : State.Abilities)
+		{
+			StateData.Abilities.Add(MakeShareable(Ability.Ability.GetMutablePtr<FAIStateActionData>(), KeepSetMemory));
+		}
+		ReferenceControllersSize += (StateData.Conditions.Num() + StateData.Abilities.Num()) * sizeof(SharedPointerInternals::TReferenceControllerBase<ESPMode::ThreadSafe>);
+	}
+
+	SIZE_T PerControllerSize = PerControllerStates.GetAllocatedSize() + ReferenceControllersSize;
+	for(const FPerControllerStateData& StateData : PerControllerStates)
+	{
+		PerControllerSize += StateData.Conditions.GetAllocatedSize() + StateData.Abilities.GetAllocatedSize();
+	}
+
+	// Shared runtime states are built once per set, controllers keep one bit per state in blocked, dirty and cached bit arrays
+	const TArray<FAIStateRuntimeData>& RuntimeStates = StatesSet->GetRuntimeStates();
+	SIZE_T SharedSize = RuntimeStates.GetAllocatedSize();
+	for(const FAIStateRuntimeData& RuntimeState : RuntimeStates)
+	{
+		SharedSize += RuntimeState.Conditions.GetAllocatedSize() + RuntimeState.Abilities.GetAllocatedSize();
+	}
+
+	TBitArray<> StateBits;
+	StateBits.Init(false, RuntimeStates.Num());
+	const SIZE_T SharedPerControllerSize = 3 * StateBits.GetAllocatedSize();
+
+	AddInfo(FString::Printf(TEXT("%d states: per controller copy %llu bytes per bot, shared states %llu bytes per bot plus %llu bytes per set"),
+		MemoryStatesPerSet, static_cast<uint64>(PerControllerSize), static_cast<uint64>(SharedPerControllerSize), static_cast<uint64>(SharedSize)));
+	AddInfo(FString::Printf(TEXT("%d controllers: per controller copy %.1f KB, shared states %.1f KB"),
+		MemoryControllerCount, PerControllerSize * MemoryControllerCount / 1024.0, (SharedPerControllerSize * MemoryControllerCount + SharedSize) / 1024.0));
+
+	TestEqual(TEXT("Runtime states match states of the set"), RuntimeStates.Num(), StatesSet->States.Num());
+	TestEqual(TEXT("Runtime states keep every ability with action data"), RuntimeStates.Num() > 0 ? RuntimeStates[0].Abilities.Num() : 0, MemoryAbilitiesPerState);
+	TestTrue(TEXT("Shared states need less memory per bot"), SharedPerControllerSize < PerControllerSize);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesBenchmarkBudgetTest, "LyraGame.AIStates.Benchmark.Budget",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesBenchmarkBudgetTest::RunTest(const FString& Parameters)
+{
+	FAIStatesBenchmarkRecorder Recorder;
+	Recorder.Start(64);
+	Recorder.AddFrame(10.0, 1.0, 100);
+	Recorder.AddFrame(14.0, 2.0, 300);
+	const FAIStatesBenchmarkResult Result = Recorder.Finish(0, 0);
+
+	TestEqual(TEXT("Every frame is recorded"), Result.NumFrames, 2);
+	TestEqual(TEXT("Game thread time is averaged"), Result.AverageGameThreadMs, 12.0);
+	TestEqual(TEXT("Peak AI states time is kept"), Result.PeakAIStatesMs, 2.0);
+	TestEqual(TEXT("Allocations are averaged per frame"), Result.AverageAllocations, 200.0);
+
+	FAIStatesBenchmarkResult TieredResult = Result;
+	TieredResult.TierPopulation = { 60, 4, 0 };
+	TestTrue(TEXT("Tier population is written to the last column"), TieredResult.ToCSVRow().EndsWith(TEXT(",60/4/0")));
+
+	FAIStatesBenchmarkBudget Budget;
+	Budget.NumBots = 64;
+	Budget.MaxGameThreadMs = 16.0f;
+	Budget.MaxAIStatesMs = 1.5f;
+
+	TArray<FString> Errors;
+	TestTrue(TEXT("Average equal to the budget passes"), Result.IsWithinBudget(Budget, Errors));
+	TestTrue(TEXT("Zero budget disables checks"), Result.IsWithinBudget(FAIStatesBenchmarkBudget(), Errors));
+
+	Budget.MaxAIStatesMs = 1.4f;
+	TestFalse(TEXT("Regression past AI states budget fails"), Result.IsWithinBudget(Budget, Errors));
+	TestEqual(TEXT("Failed budget reports a single error"), Errors.Num(), 1);
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
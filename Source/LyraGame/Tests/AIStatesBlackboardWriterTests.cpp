@@ -0,0 +1,96 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesBlackboardWriter.h"
+#include "BehaviorTree/BlackboardData.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesBlackboardWriterTest, "LyraGame.AIStates.BlackboardWriter",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesBlackboardWriterTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	AActor* Owner = World->SpawnActor<AActor>();
+	AActor* Target = World->SpawnActor<AActor>();
+
+	// Blackboard asset with one object and one vector key
+	UBlackboardData* BlackboardAsset = NewObject<UBlackboardData>();
+	FBlackboardEntry& TargetEntry = BlackboardAsset->Keys.AddDefaulted_GetRef();
+	TargetEntry.EntryName = TEXT("TargetActor");
+	TargetEntry.KeyType = NewObject<UBlackboardKeyType_Object>(BlackboardAsset);
+	FBlackboardEntry& SearchLocationEntry = BlackboardAsset->Keys.AddDefaulted_GetRef();
+	SearchLocationEntry.EntryName = TEXT("SearchLocation");
+	SearchLocationEntry.KeyType = NewObject<UBlackboardKeyType_Vector>(BlackboardAsset);
+	BlackboardAsset->UpdateKeyIDs();
+
+	UBlackboardComponent* BlackboardComp = NewObject<UBlackboardComponent>(Owner);
+	BlackboardComp->RegisterComponent();
+	if(!TestTrue(TEXT("Blackboard initializes"), BlackboardComp->InitializeBlackboard(*BlackboardAsset)))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	const FBlackboard::FKey TargetKey = BlackboardComp->GetKeyID(TEXT("TargetActor"));
+	const FBlackboard::FKey SearchLocationKey = BlackboardComp->GetKeyID(TEXT("SearchLocation"));
+
+	// Counts notifications per key the way behavior tree decorators observe them
+	TMap<FBlackboard::FKey, int32> NumNotifications;
+	const FOnBlackboardChangeNotification CountNotification = FOnBlackboardChangeNotification::CreateLambda(
+		[&NumNotifications](const UBlackboardComponent&, FBlackboard::FKey Key)
+		{
+			NumNotifications.FindOrAdd(Key)++;
+			return EBlackboardNotificationResult::ContinueObserving;
+		});
+	BlackboardComp->RegisterObserver(TargetKey, Owner, CountNotification);
+	BlackboardComp->RegisterObserver(SearchLocationKey, Owner, CountNotification);
+
+	FAIStatesBlackboardWriter BlackboardWriter;
+	BlackboardWriter.SetBlackboard(BlackboardComp);
+
+	// Writes inside a batch are staged, the last write of a key replaces earlier ones
+	const FVector SearchLocation(100.0f, 200.0f, 0.0f);
+	{
+		FAIStatesBlackboardBatchScope OuterBatch(BlackboardWriter);
+		BlackboardWriter.SetValueAsVector(SearchLocationKey, FVector::OneVector);
+		BlackboardWriter.ClearValue(TargetKey);
+
+		{
+			FAIStatesBlackboardBatchScope InnerBatch(BlackboardWriter);
+			BlackboardWriter.SetValueAsObject(TargetKey, Target);
+			BlackboardWriter.SetValueAsVector(SearchLocationKey, SearchLocation);
+			BlackboardWriter.ClearValue(FBlackboard::InvalidKey);
+		}
+
+		TestTrue(TEXT("Inner batch doesn't commit"), BlackboardWriter.IsInBatch());
+		TestEqual(TEXT("One write is staged per key, invalid keys are skipped"), BlackboardWriter.GetNumPendingWrites(), 2);
+		TestNull(TEXT("Staged object isn't written yet"), BlackboardComp->GetValue<UBlackboardKeyType_Object>(TargetKey));
+		TestEqual(TEXT("Observers aren't notified inside a batch"), NumNotifications.Num(), 0);
+	}
+
+	TestFalse(TEXT("Outermost batch ends"), BlackboardWriter.IsInBatch());
+	TestEqual(TEXT("Outermost batch commits staged writes"), BlackboardWriter.GetNumPendingWrites(), 0);
+	TestTrue(TEXT("Last object write is stored"), BlackboardComp->GetValue<UBlackboardKeyType_Object>(TargetKey) == Target);
+	TestTrue(TEXT("Last vector write is stored"), BlackboardComp->GetValue<UBlackboardKeyType_Vector>(SearchLocationKey).Equals(SearchLocation));
+	TestEqual(TEXT("Object key is notified once"), NumNotifications.FindRef(TargetKey), 1);
+	TestEqual(TEXT("Vector key is notified once"), NumNotifications.FindRef(SearchLocationKey), 1);
+
+	// Writes outside a batch are committed right away
+	BlackboardWriter.ClearValue(TargetKey);
+	TestEqual(TEXT("Write outside a batch isn't staged"), BlackboardWriter.GetNumPendingWrites(), 0);
+	TestNull(TEXT("Cleared object is written right away"), BlackboardComp->GetValue<UBlackboardKeyType_Object>(TargetKey));
+	TestEqual(TEXT("Write outside a batch notifies right away"), NumNotifications.FindRef(TargetKey), 2);
+
+	BlackboardComp->UnregisterObserversFrom(Owner);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
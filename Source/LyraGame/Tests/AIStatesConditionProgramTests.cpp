@@ -0,0 +1,108 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AbilitySystemComponent.h"
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesProgram.h"
+#include "AI/AIStates/AIStatesSet.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "InstancedStruct.h"
+#include "LyraGameplayTags.h"
+
+#if WITH_AUTOMATION_TESTS
+
+namespace AIStatesConditionProgramTests
+{
+	// Spawns controller possessing a pawn with ability system component, which registers it as AI agent
+	UAbilitySystemComponent* SpawnAgent(UWorld& World, AAIStateController*& OutController)
+	{
+		APawn* Pawn = World.SpawnActor<APawn>();
+		UAbilitySystemComponent* ASC = NewObject<UAbilitySystemComponent>(Pawn);
+		ASC->RegisterComponent();
+
+		OutController = World.SpawnActor<AAIStateController>();
+		OutController->Possess(Pawn);
+		return ASC;
+	}
+
+	// Evaluates the condition through its virtual CheckCondition and through the compiled program
+	template<typename ConditionType>
+	void Evaluate(const ConditionType& Condition, AAIStateController& Controller, bool& bOutVirtual, bool& bOutCompiled)
+	{
+		const FInstancedStruct ConditionInstancedStruct = FInstancedStruct::Make(Condition);
+
+		FAIStatesProgram Program;
+		const int32 Group = Program.CompileConditions(MakeArrayView(&ConditionInstancedStruct, 1));
+
+		FAIStatesEvaluationContext Context(&Controller);
+		bOutCompiled = Program.EvaluateGroup(Group, Context);
+		bOutVirtual = ConditionInstancedStruct.Get<FAIStateConditionData>().CheckCondition(&Controller);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesConditionProgramTest, "LyraGame.AIStates.ConditionProgram",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesConditionProgramTest::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesConditionProgramTests;
+
+	const FGameplayTag AgentTag = LyraGameplayTags::Status_Crouching;
+	const FGameplayTag ConditionTag = LyraGameplayTags::Status_AutoRunning;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+
+	// Evaluating controller is registered first and owns none of the tags
+	AAIStateController* SourceController = nullptr;
+	SpawnAgent(*World, SourceController);
+
+	// Tagged agents in registration order: one condition tag, three condition tags, none
+	AAIStateController* AgentControllers[3] = {};
+	UAbilitySystemComponent* AgentASCs[3] = {};
+	for(int32 AgentIndex = 0; AgentIndex < UE_ARRAY_COUNT(AgentASCs); AgentIndex++)
+	{
+		AgentASCs[AgentIndex] = SpawnAgent(*World, AgentControllers[AgentIndex]);
+		AgentASCs[AgentIndex]->AddLooseGameplayTag(AgentTag);
+	}
+	AgentASCs[0]->AddLooseGameplayTag(ConditionTag, 1);
+	AgentASCs[1]->AddLooseGameplayTag(ConditionTag, 3);
+
+	bool bVirtual = false;
+	bool bCompiled = false;
+
+	// Last agent with the evaluation target tag decides tag conditions
+	FGameplayTagMultipleBasedCondition TagsCondition;
+	TagsCondition.EvaluationTarget = AgentTag;
+	TagsCondition.ConditionTag.AddTag(ConditionTag);
+	TagsCondition.bHasAny = true;
+	Evaluate(TagsCondition, *SourceController, bVirtual, bCompiled);
+	TestFalse(TEXT("Last tagged agent without condition tag fails tag condition"), bVirtual);
+	TestEqual(TEXT("Compiled tag condition matches virtual one for last tagged agent"), bCompiled, bVirtual);
+
+	TagsCondition.EvaluationTarget = ConditionTag;
+	TagsCondition.ConditionTag = FGameplayTagContainer(AgentTag);
+	Evaluate(TagsCondition, *SourceController, bVirtual, bCompiled);
+	TestTrue(TEXT("Last tagged agent with condition tag passes tag condition"), bVirtual);
+	TestEqual(TEXT("Compiled tag condition matches virtual one for several tagged agents"), bCompiled, bVirtual);
+
+	// Any agent with the evaluation target tag and enough condition tags passes tag count conditions
+	FTagCountCondition TagCountCondition;
+	TagCountCondition.EvaluationTarget = AgentTag;
+	TagCountCondition.ConditionTag = ConditionTag;
+	TagCountCondition.MinCount = 2;
+	Evaluate(TagCountCondition, *SourceController, bVirtual, bCompiled);
+	TestTrue(TEXT("Agent after the first tagged one passes tag count condition"), bVirtual);
+	TestEqual(TEXT("Compiled tag count condition matches virtual one for passing agent"), bCompiled, bVirtual);
+
+	TagCountCondition.MinCount = 4;
+	Evaluate(TagCountCondition, *SourceController, bVirtual, bCompiled);
+	TestFalse(TEXT("No agent with enough condition tags fails tag count condition"), bVirtual);
+	TestEqual(TEXT("Compiled tag count condition matches virtual one without passing agent"), bCompiled, bVirtual);
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
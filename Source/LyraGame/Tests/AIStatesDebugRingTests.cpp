@@ -0,0 +1,43 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesDebugOverlay.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesDebugRingTest, "LyraGame.AIStates.DebugRing",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesDebugRingTest::RunTest(const FString& Parameters)
+{
+	FAIStatesDebugRing DebugRing;
+	TestNull(TEXT("Empty ring finds nothing"), DebugRing.FindNewest(EAIStatesDebugEvent::State));
+
+	DebugRing.Add({ 1.0, EAIStatesDebugEvent::State, "Attack", 0.5f });
+	DebugRing.Add({ 2.0, EAIStatesDebugEvent::Ability, "Shoot", 0.25f });
+	DebugRing.Add({ 3.0, EAIStatesDebugEvent::State, "Retreat", 1.0f });
+
+	TestEqual(TEXT("Every record is kept"), DebugRing.Num(), 3);
+	TestEqual(TEXT("Newest record comes first"), DebugRing.GetNewest(0).Name, FName("Retreat"));
+
+	const FAIStatesDebugRecord* AbilityRecord = DebugRing.FindNewest(EAIStatesDebugEvent::Ability);
+	TestTrue(TEXT("Newest record of the kind is found"), AbilityRecord && AbilityRecord->Name == "Shoot");
+
+	// Overflowing the ring drops the oldest records
+	for(int32 RecordIndex = 0; RecordIndex < FAIStatesDebugRing::Capacity; RecordIndex++)
+	{
+		DebugRing.Add({ 4.0 + RecordIndex, EAIStatesDebugEvent::Approach, "Approaching", 1.0f });
+	}
+
+	TestEqual(TEXT("Ring stays at capacity"), DebugRing.Num(), FAIStatesDebugRing::Capacity);
+	TestNull(TEXT("Overwritten records are gone"), DebugRing.FindNewest(EAIStatesDebugEvent::State));
+	TestEqual(TEXT("Oldest kept record is the first one after the overflow"), DebugRing.GetNewest(FAIStatesDebugRing::Capacity - 1).WorldTime, 4.0);
+
+	DebugRing.Reset();
+	TestEqual(TEXT("Reset empties the ring"), DebugRing.Num(), 0);
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,172 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AbilitySystem/LyraAbilitySystemComponent.h"
+#include "AI/AICharacter.h"
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesDecisionTrace.h"
+#include "AI/AIStates/AIStatesSet.h"
+#include "AI/AIStates/AIStatesSettings.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "UObject/UnrealType.h"
+
+#if WITH_AUTOMATION_TESTS
+
+namespace AIStatesDecisionReplayTests
+{
+	constexpr int32 NumStates = 6;
+	constexpr int32 NumAbilitiesPerState = 4;
+
+	// Every update of the test makes a state decision, an ability decision and a duration roll
+	constexpr int32 NumRecordsPerUpdate = 3;
+	constexpr int32 MaxUpdates = 20;
+
+	// Creates transient states set with distinct state and ability weights. States have no conditions, so every state is a candidate
+	UAIStatesSet* CreateStatesSet()
+	{
+		UAIStatesSet* StatesSet = NewObject<UAIStatesSet>(GetTransientPackage());
+		for(int32 StateIndex = 0; StateIndex < NumStates; StateIndex++)
+		{
+			FAIStateDataConfig& State = StatesSet->States.AddDefaulted_GetRef();
+			State.StateName = *FString::Printf(TEXT("State%d"), StateIndex);
+			State.StateWeight = StateIndex + 1.0f;
+
+			for(int32 AbilityIndex = 0; AbilityIndex < NumAbilitiesPerState; AbilityIndex++)
+			{
+				FAIStateAbilityNamedWrapper& Ability = State.Abilities.AddDefaulted_GetRef();
+				Ability.Ability.InitializeAs<FWaitAbility>();
+				FWaitAbility* WaitAbility = Ability.Ability.GetMutablePtr<FWaitAbility>();
+				WaitAbility->ProbabilityWeight = (AbilityIndex + 1) * 0.5f;
+				WaitAbility->InterruptibleActionData.MinDuration = 1.0f;
+				WaitAbility->InterruptibleActionData.MaxDuration = 1.0f + AbilityIndex;
+			}
+		}
+
+		return StatesSet;
+	}
+
+	// Spawns AI character with the states set and ability system component, possessed by a controller chasing the target
+	AAIStateController* SpawnController(UWorld& World, UAIStatesSet& StatesSet, AActor& Target)
+	{
+		AAICharacter* Character = World.SpawnActor<AAICharacter>();
+		Character->AIStatesSetConfig = &StatesSet;
+
+		ULyraAbilitySystemComponent* ASC = NewObject<ULyraAbilitySystemComponent>(Character);
+		ASC->RegisterComponent();
+		ASC->InitAbilityActorInfo(Character, Character);
+
+		// The character caches its component in a protected property, normally assigned by its blueprint
+		const FObjectProperty* ASCProperty = FindFProperty<FObjectProperty>(AAICharacter::StaticClass(), TEXT("AbilitySystemComponent"));
+		ASCProperty->SetObjectPropertyValue_InContainer(Character, ASC);
+
+		AAIStateController* Controller = World.SpawnActor<AAIStateController>();
+		Controller->Possess(Character);
+		Controller->SetTarget(&Target);
+		return Controller;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesDecisionReplayTest, "LyraGame.AIStates.DecisionReplay",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesDecisionReplayTest::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesDecisionReplayTests;
+
+	const int32 NumUpdates = FMath::Min(UAIStatesSettings::Get()->DecisionTraceLength / NumRecordsPerUpdate, MaxUpdates);
+	if(!TestTrue(TEXT("Decision trace holds the decisions of an update"), NumUpdates > 0))
+	{
+		return false;
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	UAIStatesSet* StatesSet = CreateStatesSet();
+	AActor* Target = World->SpawnActor<AActor>();
+	AAIStateController* Controller = SpawnController(*World, *StatesSet, *Target);
+
+	// Decisions are made by the controller the same way as during the match
+	TArray<FName> EnteredStates;
+	TArray<const FAIStateActionData*> PickedAbilities;
+	TArray<float> Durations;
+	for(int32 UpdateIndex = 0; UpdateIndex < NumUpdates; UpdateIndex++)
+	{
+		Controller->UpdateAIState();
+		EnteredStates.Add(Controller->GetCurrentStateName());
+
+		float PickedProbability = 0.0f;
+		const FAIStateActionData* Ability = Controller->PickCurrentStateAbility(PickedProbability);
+		PickedAbilities.Add(Ability);
+		Durations.Add(Ability ? Ability->GetMaxDuration(Controller) : 0.0f);
+	}
+
+	const FAIStatesDecisionTrace& RecordedTrace = Controller->GetDecisionTrace();
+	TArray<FAIStatesDecisionRecord> Records;
+	RecordedTrace.GetRecords(Records);
+	if(!TestEqual(TEXT("Every decision and roll is traced"), Records.Num(), NumUpdates * NumRecordsPerUpdate))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	// Trace records what the controller actually did
+	const TArray<FAIStateRuntimeData>& RuntimeStates = StatesSet->GetRuntimeStates();
+	for(int32 UpdateIndex = 0; UpdateIndex < NumUpdates; UpdateIndex++)
+	{
+		if(!TestNotNull(FString::Printf(TEXT("Update %d picks an ability"), UpdateIndex), PickedAbilities[UpdateIndex]))
+		{
+			continue;
+		}
+
+		const FAIStatesDecisionRecord& StateRecord = Records[UpdateIndex * NumRecordsPerUpdate];
+		const FAIStatesDecisionRecord& AbilityRecord = Records[UpdateIndex * NumRecordsPerUpdate + 1];
+		const FAIStatesDecisionRecord& DurationRecord = Records[UpdateIndex * NumRecordsPerUpdate + 2];
+
+		TestTrue(FString::Printf(TEXT("Update %d enters the traced state"), UpdateIndex), StateRecord.Kind == EAIStatesDecisionKind::State
+			&& StatesSet->States.IsValidIndex(StateRecord.ChosenIndex) && StatesSet->States[StateRecord.ChosenIndex].StateName == EnteredStates[UpdateIndex]);
+		TestTrue(FString::Printf(TEXT("Update %d picks the traced ability"), UpdateIndex), AbilityRecord.Kind == EAIStatesDecisionKind::Ability
+			&& RuntimeStates.IsValidIndex(AbilityRecord.StateIndex) && RuntimeStates[AbilityRecord.StateIndex].Abilities.IsValidIndex(AbilityRecord.ChosenIndex)
+			&& RuntimeStates[AbilityRecord.StateIndex].Abilities[AbilityRecord.ChosenIndex] == PickedAbilities[UpdateIndex]);
+
+		const FAIInterruptibleActionData& ActionData = static_cast<const FAIStateInterruptibleAbility*>(PickedAbilities[UpdateIndex])->InterruptibleActionData;
+		TestTrue(FString::Printf(TEXT("Update %d rolls the traced duration"), UpdateIndex), DurationRecord.Kind == EAIStatesDecisionKind::Roll
+			&& FMath::IsNearlyEqual(Durations[UpdateIndex], FMath::Lerp(ActionData.MinDuration, ActionData.MaxDuration, DurationRecord.Roll)));
+	}
+
+	// Every roll of the controller stream is traced, so the seed reproduces the recorded rolls in order
+	FRandomStream SeedRandomStream(RecordedTrace.GetSeed());
+	for(int32 RecordIndex = 0; RecordIndex < Records.Num(); RecordIndex++)
+	{
+		if(Records[RecordIndex].Roll != SeedRandomStream.FRand())
+		{
+			AddError(FString::Printf(TEXT("Record %d (%s) wasn't rolled right after the previous record"), RecordIndex, *Records[RecordIndex].ToString()));
+			break;
+		}
+	}
+
+	// Trace survives the text round trip used to take it off a server
+	FAIStatesDecisionTrace LoadedTrace;
+	TestTrue(TEXT("Trace parses"), LoadedTrace.FromString(RecordedTrace.ToString()));
+	TestEqual(TEXT("Parsed trace keeps the seed"), LoadedTrace.GetSeed(), RecordedTrace.GetSeed());
+	TestEqual(TEXT("Parsed trace keeps every record"), LoadedTrace.Num(), RecordedTrace.Num());
+
+	TArray<FAIStatesDecisionRecord> LoadedRecords;
+	LoadedTrace.GetRecords(LoadedRecords);
+
+	FString ReplayError;
+	TestTrue(TEXT("Replay makes identical decisions"), FAIStatesDecisionTrace::Replay(*StatesSet, LoadedRecords, &ReplayError));
+	if(ReplayError.IsEmpty() == false)
+	{
+		AddError(ReplayError);
+	}
+
+	// Changed weights have to be reported as divergence
+	StatesSet->States.Last().StateWeight *= 3.0f;
+	TestFalse(TEXT("Replay detects changed state weight"), FAIStatesDecisionTrace::Replay(*StatesSet, LoadedRecords));
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,59 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesDecisionTrace.h"
+#include "AI/AIStates/AIStatesEQSCache.h"
+#include "EnvironmentQuery/EnvQuery.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesEQSCacheTest, "LyraGame.AIStates.EQSCache",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesEQSCacheTest::RunTest(const FString& Parameters)
+{
+	FAIStatesEQSCache EQSCache;
+	EQSCache.SetCellSize(300.0f);
+
+	UEnvQuery* Query = NewObject<UEnvQuery>();
+	UEnvQuery* OtherQuery = NewObject<UEnvQuery>();
+
+	FEnvNamedValue Radius;
+	Radius.ParamName = TEXT("Radius");
+	Radius.ParamType = EAIParamType::Float;
+	Radius.Value = 500.0f;
+	const TArray<FEnvNamedValue> Params = { Radius };
+
+	FEnvNamedValue EditedRadius = Radius;
+	EditedRadius.Value = 800.0f;
+	const TArray<FEnvNamedValue> EditedParams = { EditedRadius };
+
+	const FVector Querier(10.0f, 10.0f, 0.0f);
+	const FVector NearbyQuerier(120.0f, 250.0f, 0.0f);
+	const FVector DistantQuerier(1000.0f, 0.0f, 0.0f);
+	const FVector Context(2000.0f, 0.0f, 0.0f);
+
+	// Bots near each other asking the same query share the key
+	const FAIStatesEQSCacheKey Key = EQSCache.MakeKey(*Query, Params, Querier, Context);
+	TestTrue(TEXT("Nearby querier shares the key"), Key == EQSCache.MakeKey(*Query, Params, NearbyQuerier, Context));
+	TestFalse(TEXT("Distant querier has own key"), Key == EQSCache.MakeKey(*Query, Params, DistantQuerier, Context));
+	TestFalse(TEXT("Other query has own key"), Key == EQSCache.MakeKey(*OtherQuery, Params, Querier, Context));
+	TestFalse(TEXT("Edited params have own key"), Key == EQSCache.MakeKey(*Query, EditedParams, Querier, Context));
+
+	// Controllers sharing a result spread over its items
+	const TArray<float> Scores = { 1.0f, 0.5f, 0.25f };
+	FRandomStream RandomStream(7);
+	auto PickDecision = [&RandomStream](FAIStatesDecision& Decision) { return Decision.Pick(RandomStream); };
+	TestEqual(TEXT("Best always picks the first item"), FAIStatesEQSCache::PickItemIndex(Scores, EAIStatesEQSDistribution::Best, 2, PickDecision), 0);
+	TestEqual(TEXT("Round robin picks items in turn"), FAIStatesEQSCache::PickItemIndex(Scores, EAIStatesEQSDistribution::RoundRobin, 1, PickDecision), 1);
+	TestEqual(TEXT("Round robin wraps around"), FAIStatesEQSCache::PickItemIndex(Scores, EAIStatesEQSDistribution::RoundRobin, 3, PickDecision), 0);
+
+	const int32 RandomIndex = FAIStatesEQSCache::PickItemIndex(Scores, EAIStatesEQSDistribution::WeightedRandom, 0, PickDecision);
+	TestTrue(TEXT("Weighted random picks an item"), Scores.IsValidIndex(RandomIndex));
+	TestEqual(TEXT("Empty result has no item"), FAIStatesEQSCache::PickItemIndex({}, EAIStatesEQSDistribution::Best, 0, PickDecision), INDEX_NONE);
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
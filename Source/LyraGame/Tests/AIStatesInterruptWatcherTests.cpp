@@ -0,0 +1,78 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesSet.h"
+#include "AbilitySystemComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "InstancedStruct.h"
+#include "LyraGameplayTags.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesInterruptWatcherTest, "LyraGame.AIStates.InterruptWatcher",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesInterruptWatcherTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	AAIStateController* Controller = World->SpawnActor<AAIStateController>();
+	AActor* Target = World->SpawnActor<AActor>();
+	UAbilitySystemComponent* TargetASC = NewObject<UAbilitySystemComponent>(Target);
+	TargetASC->RegisterComponent();
+	Controller->SetTarget(Target);
+
+	// Interrupts once the target dies
+	FGameplayTagMultipleBasedCondition TargetDeadCondition;
+	TargetDeadCondition.ConditionTag.AddTag(LyraGameplayTags::Status_Death);
+	TargetDeadCondition.bHasAny = true;
+	TargetDeadCondition.EvaluationTarget = AIConditions::ConditionPlayer;
+
+	FAIInterruptibleActionData InterruptibleData;
+	InterruptibleData.ConditionsToInterrupt.AddDefaulted_GetRef().ConditionsVariant.Add(FInstancedStruct::Make(TargetDeadCondition));
+	InterruptibleData.CompiledDependencies.TargetTags.Add(LyraGameplayTags::Status_Death);
+
+	// Interrupts are counted through the debug ring
+	IConsoleVariable* DebugCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("lyra.aistates.debug"));
+	const int32 PreviousDebug = DebugCVar ? DebugCVar->GetInt() : 0;
+	if(DebugCVar)
+	{
+		DebugCVar->Set(1, ECVF_SetByCode);
+	}
+
+	FAIStatesInterruptWatcher& InterruptWatcher = Controller->GetInterruptWatcher();
+	InterruptWatcher.Arm(*Controller, InterruptibleData);
+	TestTrue(TEXT("Watcher stays armed while no variant passes"), InterruptWatcher.IsArmed());
+	TestFalse(TEXT("Tracked tags don't need polling"), InterruptWatcher.NeedsPolling());
+
+	// Tag change on the target runs the check without polling
+	TargetASC->AddLooseGameplayTag(LyraGameplayTags::Status_Death);
+	TestFalse(TEXT("Watcher disarms once it fires"), InterruptWatcher.IsArmed());
+
+	// Further changes are not watched anymore
+	TargetASC->RemoveLooseGameplayTag(LyraGameplayTags::Status_Death);
+	TargetASC->AddLooseGameplayTag(LyraGameplayTags::Status_Death);
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	int32 NumInterrupts = 0;
+	const FAIStatesDebugRing& DebugRing = Controller->GetDebugRing();
+	for(int32 Age = 0; Age < DebugRing.Num(); Age++)
+	{
+		NumInterrupts += DebugRing.GetNewest(Age).Event == EAIStatesDebugEvent::Interrupted ? 1 : 0;
+	}
+	TestEqual(TEXT("Controller is notified once"), NumInterrupts, 1);
+#endif
+
+	if(DebugCVar)
+	{
+		DebugCVar->Set(PreviousDebug, ECVF_SetByCode);
+	}
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,60 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesLineOfSight.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesLineOfSightCacheTest, "LyraGame.AIStates.LineOfSightCache",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesLineOfSightCacheTest::RunTest(const FString& Parameters)
+{
+	constexpr float TraceSphereRadius = 30.0f;
+	constexpr float TimeToLive = 0.25f;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	AActor* Target = World->SpawnActor<AActor>();
+	AActor* OtherTarget = World->SpawnActor<AActor>();
+
+	FAIStatesLineOfSightCache LineOfSightCache;
+	TestNull(TEXT("Empty cache finds nothing"), LineOfSightCache.Find(Target, TraceSphereRadius));
+
+	// New entry has nothing to serve until the first sweep
+	FAIStatesLineOfSightEntry& Entry = LineOfSightCache.FindOrAdd(Target, TraceSphereRadius);
+	TestFalse(TEXT("New entry has no result"), Entry.HasResult());
+	TestFalse(TEXT("Entry without result isn't refreshed"), Entry.NeedsRefresh(10.0, TimeToLive));
+
+	Entry.bHasLineOfSight = true;
+	Entry.ResultTime = 1.0;
+
+	// Same target and radius hit the entry, another radius or target has own entry
+	TestTrue(TEXT("Same target and radius hit the entry"), LineOfSightCache.Find(Target, TraceSphereRadius) == &Entry);
+	TestNull(TEXT("Other radius misses"), LineOfSightCache.Find(Target, TraceSphereRadius * 2.0f));
+	LineOfSightCache.FindOrAdd(OtherTarget, TraceSphereRadius);
+	TestEqual(TEXT("Other target has own entry"), LineOfSightCache.Num(), 2);
+
+	// Result is fresh within its time to live, then refreshed once
+	FAIStatesLineOfSightEntry* CachedEntry = LineOfSightCache.Find(Target, TraceSphereRadius);
+	TestTrue(TEXT("Fresh result is served"), CachedEntry && CachedEntry->bHasLineOfSight && CachedEntry->NeedsRefresh(1.0 + TimeToLive * 0.5, TimeToLive) == false);
+	TestTrue(TEXT("Expired result needs refresh"), CachedEntry && CachedEntry->NeedsRefresh(1.0 + TimeToLive * 2.0, TimeToLive));
+	if(CachedEntry)
+	{
+		CachedEntry->bPending = true;
+	}
+	TestTrue(TEXT("Pending refresh isn't queued again"), CachedEntry && CachedEntry->NeedsRefresh(1.0 + TimeToLive * 2.0, TimeToLive) == false);
+
+	// Entries of destroyed targets are dropped once a new entry is added
+	OtherTarget->Destroy();
+	LineOfSightCache.FindOrAdd(Target, TraceSphereRadius * 2.0f);
+	TestEqual(TEXT("Destroyed target entry is dropped"), LineOfSightCache.Num(), 2);
+	TestNull(TEXT("Destroyed target misses"), LineOfSightCache.Find(OtherTarget, TraceSphereRadius));
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,65 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesReachability.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesReachabilityCacheTest, "LyraGame.AIStates.ReachabilityCache",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesReachabilityCacheTest::RunTest(const FString& Parameters)
+{
+	constexpr float CellSize = 100.0f;
+	constexpr float TimeToLive = 1.0f;
+
+	FAIStatesReachabilityCache Reachability;
+	Reachability.SetCellSize(CellSize);
+
+	const FVector Target(1000.0f, 0.0f, 0.0f);
+	const FVector From(10.0f, 10.0f, 0.0f);
+	const FVector NearbyFrom(60.0f, 40.0f, 0.0f);
+	const FVector DistantFrom(-500.0f, 0.0f, 0.0f);
+
+	// Bots in the same cell ask the same question
+	const FAIStatesReachabilityKey Key = Reachability.MakeKey(From, Target, nullptr);
+	TestTrue(TEXT("Segments from the same cell share the key"), Key == Reachability.MakeKey(NearbyFrom, Target, nullptr));
+	TestFalse(TEXT("Segments from another cell have own key"), Key == Reachability.MakeKey(DistantFrom, Target, nullptr));
+
+	// Non-blocking query queues the segment once
+	TestEqual(TEXT("First query is unknown"), Reachability.Query(Key, From, Target, 0.0, TimeToLive), EAIStatesReachability::Unknown);
+	TestEqual(TEXT("Repeated query is still unknown"), Reachability.Query(Key, NearbyFrom, Target, 0.0, TimeToLive), EAIStatesReachability::Unknown);
+	TestEqual(TEXT("Segment is queued once"), Reachability.GetNumQueued(), 1);
+
+	Reachability.Store(Key, true, 0.0);
+	TestEqual(TEXT("Stored result is served"), Reachability.Query(Key, From, Target, 0.5, TimeToLive), EAIStatesReachability::Reachable);
+	TestEqual(TEXT("Fresh result is not queued again"), Reachability.GetNumQueued(), 1);
+
+	// Expired result is served while its refresh is queued
+	TestEqual(TEXT("Expired result is served"), Reachability.Query(Key, From, Target, 2.0, TimeToLive), EAIStatesReachability::Reachable);
+	TestEqual(TEXT("Expired result is queued for refresh"), Reachability.GetNumQueued(), 2);
+
+	// Blocking callers only peek
+	const FAIStatesReachabilityKey DistantKey = Reachability.MakeKey(DistantFrom, Target, nullptr);
+	TestEqual(TEXT("Peek of unknown segment is unknown"), Reachability.Query(DistantKey, DistantFrom, Target, 2.0, TimeToLive, false), EAIStatesReachability::Unknown);
+	TestEqual(TEXT("Peek doesn't queue the segment"), Reachability.GetNumQueued(), 2);
+
+	// Blocking callers raycast expired segments themselves and store the fresh result
+	Reachability.Store(DistantKey, false, 2.0);
+	TestEqual(TEXT("Peek of fresh segment is served"), Reachability.Query(DistantKey, DistantFrom, Target, 2.5, TimeToLive, false), EAIStatesReachability::Unreachable);
+	TestEqual(TEXT("Peek of expired segment is unknown"), Reachability.Query(DistantKey, DistantFrom, Target, 4.0, TimeToLive, false), EAIStatesReachability::Unknown);
+	TestEqual(TEXT("Peek of expired segment doesn't queue it"), Reachability.GetNumQueued(), 2);
+	Reachability.Store(DistantKey, true, 4.0);
+	TestEqual(TEXT("Peek serves the refreshed result"), Reachability.Query(DistantKey, DistantFrom, Target, 4.0, TimeToLive, false), EAIStatesReachability::Reachable);
+
+	// Rebuilt navmesh drops every result
+	Reachability.Invalidate();
+	TestEqual(TEXT("Invalidated cache is empty"), Reachability.Num(), 0);
+	TestEqual(TEXT("Invalidated cache has nothing queued"), Reachability.GetNumQueued(), 0);
+	TestEqual(TEXT("Invalidated result is unknown"), Reachability.Query(Key, From, Target, 2.0, TimeToLive, false), EAIStatesReachability::Unknown);
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,80 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AbilitySystem/LyraAbilitySystemComponent.h"
+#include "AI/AIStates/AIStatesSettings.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "GameplayEffect.h"
+#include "LyraGameplayTags.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesRecentTagMemoryTest, "LyraGame.AIStates.RecentTagMemory",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesRecentTagMemoryTest::RunTest(const FString& Parameters)
+{
+	const FGameplayTag RecentTag = LyraGameplayTags::Status_Crouching;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	AActor* Owner = World->SpawnActor<AActor>();
+	ULyraAbilitySystemComponent* ASC = NewObject<ULyraAbilitySystemComponent>(Owner);
+	ASC->RegisterComponent();
+	ASC->InitAbilityActorInfo(Owner, Owner);
+
+	// Effects built here are remember recent tag effects for the duration of the test
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	const TSubclassOf<UGameplayEffect> PreviousRememberEffectClass = Settings->GetRememberRecentTagGameplayEffectClass();
+	Settings->SetRememberRecentTagGameplayEffectClass(UGameplayEffect::StaticClass());
+
+	UGameplayEffect* StackingEffect = NewObject<UGameplayEffect>(GetTransientPackage());
+	StackingEffect->DurationPolicy = EGameplayEffectDurationType::Infinite;
+	StackingEffect->StackingType = EGameplayEffectStackingType::AggregateByTarget;
+	StackingEffect->StackLimitCount = 3;
+
+	UGameplayEffect* SingleEffect = NewObject<UGameplayEffect>(GetTransientPackage());
+	SingleEffect->DurationPolicy = EGameplayEffectDurationType::Infinite;
+
+	auto ApplyRememberEffect = [ASC, &RecentTag](const UGameplayEffect* Effect)
+	{
+		FGameplayEffectSpec Spec(Effect, ASC->MakeEffectContext(), 1.0f);
+		Spec.AddDynamicAssetTag(RecentTag);
+		return ASC->ApplyGameplayEffectSpecToSelf(Spec);
+	};
+
+	float TimePassed = 0.0f;
+
+	// Stacked applications share one handle, removing some stacks keeps the tag
+	const FActiveGameplayEffectHandle StackingHandle = ApplyRememberEffect(StackingEffect);
+	ApplyRememberEffect(StackingEffect);
+	TestEqual(TEXT("Stacked applications share one effect"), ASC->GetCurrentStackCount(StackingHandle), 2);
+	TestTrue(TEXT("Stacked effect remembers the tag"), ASC->GetRecentTagTimePassed(RecentTag, TimePassed));
+
+	ASC->RemoveActiveGameplayEffect(StackingHandle, 1);
+	TestTrue(TEXT("Removing a stack keeps the tag"), ASC->GetRecentTagTimePassed(RecentTag, TimePassed));
+
+	ASC->RemoveActiveGameplayEffect(StackingHandle);
+	TestFalse(TEXT("Removing the stacked effect forgets the tag"), ASC->GetRecentTagTimePassed(RecentTag, TimePassed));
+
+	// Separate effects with the same tag are counted separately
+	const FActiveGameplayEffectHandle FirstHandle = ApplyRememberEffect(SingleEffect);
+	const FActiveGameplayEffectHandle SecondHandle = ApplyRememberEffect(SingleEffect);
+	const FActiveGameplayEffectHandle NewStackingHandle = ApplyRememberEffect(StackingEffect);
+	ApplyRememberEffect(StackingEffect);
+	TestTrue(TEXT("Separate applications have own effects"), FirstHandle != SecondHandle);
+
+	ASC->RemoveActiveGameplayEffect(FirstHandle);
+	ASC->RemoveActiveGameplayEffect(SecondHandle);
+	TestTrue(TEXT("Tag is remembered while an effect is active"), ASC->GetRecentTagTimePassed(RecentTag, TimePassed));
+
+	ASC->RemoveActiveGameplayEffect(NewStackingHandle);
+	TestFalse(TEXT("Tag is forgotten once every effect is removed"), ASC->GetRecentTagTimePassed(RecentTag, TimePassed));
+
+	Settings->SetRememberRecentTagGameplayEffectClass(PreviousRememberEffectClass);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,94 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesSet.h"
+#include "AI/AIStates/AIStatesSetCost.h"
+#include "EnvironmentQuery/EnvQuery.h"
+
+#if WITH_AUTOMATION_TESTS
+
+namespace AIStatesSetCostTests
+{
+	FAIStateDataConfig& AddState(UAIStatesSet& StatesSet, FName StateName, float StateWeight)
+	{
+		FAIStateDataConfig& State = StatesSet.States.AddDefaulted_GetRef();
+		State.StateName = StateName;
+		State.StateWeight = StateWeight;
+		return State;
+	}
+
+	template<typename AbilityType>
+	AbilityType& AddAbility(FAIStateDataConfig& State)
+	{
+		FAIStateAbilityNamedWrapper& Wrapper = State.Abilities.AddDefaulted_GetRef();
+		Wrapper.Ability.InitializeAs<AbilityType>();
+		AbilityType& Ability = *Wrapper.Ability.GetMutablePtr<AbilityType>();
+		Ability.ProbabilityWeight = 1.0f;
+		return Ability;
+	}
+
+	void AddHasTagCondition(TArray<FInstancedStruct>& Conditions, const FGameplayTag& Tag, bool bInverted)
+	{
+		FInstancedStruct& Condition = Conditions.AddDefaulted_GetRef();
+		Condition.InitializeAs<FGameplayTagMultipleBasedCondition>();
+		FGameplayTagMultipleBasedCondition& TagCondition = *Condition.GetMutablePtr<FGameplayTagMultipleBasedCondition>();
+		TagCondition.EvaluationTarget = AIConditions::ConditionSelf;
+		TagCondition.ConditionTag.AddTag(Tag);
+		TagCondition.bInverted = bInverted;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesSetCostTest, "LyraGame.AIStates.SetCost",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesSetCostTest::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesSetCostTests;
+
+	UAIStatesSet* StatesSet = NewObject<UAIStatesSet>(GetTransientPackage());
+
+	// Counts enemies and waits until the target comes close
+	FAIStateDataConfig& ScanState = AddState(*StatesSet, TEXT("Scan"), 1.0f);
+	ScanState.Conditions.AddDefaulted_GetRef().InitializeAs<FCountEnemiesWithTag>();
+	FAIStateConditionsVariant& Variant = AddAbility<FWaitAbility>(ScanState).InterruptibleActionData.ConditionsToInterrupt.AddDefaulted_GetRef();
+	FInstancedStruct& DistanceCondition = Variant.ConditionsVariant.AddDefaulted_GetRef();
+	DistanceCondition.InitializeAs<FMaxDistanceToCondition>();
+	DistanceCondition.GetMutablePtr<FMaxDistanceToCondition>()->EvaluationTarget = AIConditions::ConditionPlayer;
+
+	FAIStateDataConfig& QueryState = AddState(*StatesSet, TEXT("Query"), 1.0f);
+	AddHasTagCondition(QueryState.Conditions, AIConditions::RequestWait, false);
+	AddAbility<FMoveToLocationAbility>(QueryState).EnvQuery = NewObject<UEnvQuery>(GetTransientPackage());
+
+	FAIStateDataConfig& ContradictionState = AddState(*StatesSet, TEXT("Contradiction"), 1.0f);
+	AddHasTagCondition(ContradictionState.Conditions, AIConditions::RequestWait, false);
+	AddHasTagCondition(ContradictionState.Conditions, AIConditions::RequestWait, true);
+	AddAbility<FWaitAbility>(ContradictionState);
+
+	FAIStateDataConfig& NoWeightState = AddState(*StatesSet, TEXT("NoWeight"), 0.0f);
+	AddAbility<FWaitAbility>(NoWeightState);
+
+	// Weights of different magnitude, so every count shows up in its own digit of the score
+	FAIStatesCostWeights Weights;
+	Weights.Condition = 1.0f;
+	Weights.WorldScanCondition = 10.0f;
+	Weights.EQSQuery = 100.0f;
+	Weights.InterruptVariant = 1000.0f;
+	Weights.UnreachableState = 10000.0f;
+
+	const FAIStatesSetCost Cost = FAIStatesSetCost::Estimate(*StatesSet, Weights);
+	TestEqual(TEXT("State and interrupt conditions are counted"), Cost.NumConditions, 5);
+	TestEqual(TEXT("Counting enemies scans every agent"), Cost.NumWorldScanConditions, 1);
+	TestEqual(TEXT("Abilities with environment query are counted"), Cost.NumEQSQueries, 1);
+	TestEqual(TEXT("Interrupt variants are counted"), Cost.NumInterruptVariants, 1);
+	TestEqual(TEXT("Contradicting and weightless states are unreachable"), Cost.UnreachableStates.Num(), 2);
+	TestEqual(TEXT("Score sums weighted counts"), Cost.Score, 4.0f + 10.0f + 100.0f + 1000.0f + 20000.0f);
+
+	TestTrue(TEXT("Score over budget is flagged"), Cost.IsOverBudget(Cost.Score - 1.0f));
+	TestFalse(TEXT("Score at budget passes"), Cost.IsOverBudget(Cost.Score));
+	TestFalse(TEXT("Zero budget disables the check"), Cost.IsOverBudget(0.0f));
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,41 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesSignificance.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesSignificanceTierTest, "LyraGame.AIStates.SignificanceTiers",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesSignificanceTierTest::RunTest(const FString& Parameters)
+{
+	using namespace AIStatesSignificance;
+
+	constexpr float Hysteresis = 0.1f;
+	TArray<FAIStatesSignificanceTier> Tiers;
+	for(const float MinSignificance : { 1.5f, 0.75f, 0.0f })
+	{
+		Tiers.AddDefaulted_GetRef().MinSignificance = MinSignificance;
+	}
+
+	TestEqual(TEXT("Without tiers there is no tier"), SelectTier({}, 1.0f, 0, Hysteresis), static_cast<int32>(INDEX_NONE));
+
+	// Controllers without tier are placed by thresholds alone
+	TestEqual(TEXT("Significant controller starts in the first tier"), SelectTier(Tiers, 2.0f, INDEX_NONE, Hysteresis), 0);
+	TestEqual(TEXT("Medium controller starts in the second tier"), SelectTier(Tiers, 1.0f, INDEX_NONE, Hysteresis), 1);
+	TestEqual(TEXT("Idle controller starts in the last tier"), SelectTier(Tiers, 0.1f, INDEX_NONE, Hysteresis), 2);
+
+	// Promotion is immediate
+	TestEqual(TEXT("Reaching threshold promotes"), SelectTier(Tiers, 1.5f, 2, Hysteresis), 0);
+
+	// Demotion waits for the hysteresis
+	TestEqual(TEXT("Small drop below threshold keeps the tier"), SelectTier(Tiers, 1.45f, 0, Hysteresis), 0);
+	TestEqual(TEXT("Drop past hysteresis demotes"), SelectTier(Tiers, 1.35f, 0, Hysteresis), 1);
+	TestEqual(TEXT("Large drop demotes over several tiers"), SelectTier(Tiers, 0.2f, 0, Hysteresis), 2);
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,61 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesSquadTest, "LyraGame.AIStates.Squads",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesSquadTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	UAIStatesSubsystem* AIStatesSubsystem = World->GetSubsystem<UAIStatesSubsystem>();
+	if(!TestNotNull(TEXT("AI states subsystem exists"), AIStatesSubsystem))
+	{
+		World->DestroyWorld(false);
+		return false;
+	}
+
+	AAIStateController* Leader = World->SpawnActor<AAIStateController>();
+	AAIStateController* Members[2] = { World->SpawnActor<AAIStateController>(), World->SpawnActor<AAIStateController>() };
+	AActor* Target = World->SpawnActor<AActor>();
+
+	FAIStatesSquadRegistry& Squads = AIStatesSubsystem->GetSquads();
+	const int32 SquadId = Squads.CreateSquad(*Leader);
+	TestTrue(TEXT("Members join the squad"), Squads.AddMember(SquadId, *Members[0]) && Squads.AddMember(SquadId, *Members[1]));
+	TestTrue(TEXT("Squad creator leads the squad"), Squads.FindSquad(*Leader) && Squads.FindSquad(*Leader)->GetLeader() == Leader);
+
+	// Formation slots alternate right and left in rows behind the leader
+	Squads.PublishIntent(*Leader, Target, 0, 0.0);
+	const FAIStatesSquad* Squad = Squads.FindSquad(*Members[0]);
+	constexpr float Spacing = 100.0f;
+	TestEqual(TEXT("Members take formation slots in joining order"), Squads.GetFormationSlot(*Members[1]), 2);
+	TestTrue(TEXT("Leader slot is the anchor"), Squad && Squad->GetFormationSlotLocation(0, Spacing).Equals(FVector::ZeroVector));
+	TestTrue(TEXT("First slot is behind on the right"), Squad && Squad->GetFormationSlotLocation(1, Spacing).Equals(FVector(-Spacing, Spacing, 0.0f)));
+	TestTrue(TEXT("Second slot is behind on the left"), Squad && Squad->GetFormationSlotLocation(2, Spacing).Equals(FVector(-Spacing, -Spacing, 0.0f)));
+
+	// Following the intent switches the member to the intent target, which releases its attack token but not its squad
+	TestTrue(TEXT("Intent carries the leader target"), Squad && Squad->Intent.Target.Get() == Target);
+	Members[0]->SetTarget(Squad->Intent.Target.Get());
+	TestTrue(TEXT("Member follows the intent target"), Members[0]->GetTarget() == Target);
+	TestTrue(TEXT("Member stays in its squad after following"), Squads.FindSquad(*Members[0]) == Squads.FindSquad(*Leader));
+	TestEqual(TEXT("Member keeps its formation slot"), Squads.GetFormationSlot(*Members[0]), 1);
+
+	// Unregistered member leaves its squad, unregistered leader hands the squad over
+	AIStatesSubsystem->UnregisterAIActor(Members[1]);
+	TestNull(TEXT("Unregistered member leaves its squad"), Squads.FindSquad(*Members[1]));
+	AIStatesSubsystem->UnregisterAIActor(Leader);
+	TestTrue(TEXT("Next member leads once the leader is unregistered"), Squads.FindSquad(*Members[0]) && Squads.FindSquad(*Members[0])->GetLeader() == Members[0]);
+
+	Squads.Reset();
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
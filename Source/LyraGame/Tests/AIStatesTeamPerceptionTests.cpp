@@ -0,0 +1,62 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesTeamPerception.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesTeamPerceptionTest, "LyraGame.AIStates.TeamPerception",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesTeamPerceptionTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	AActor* Near = World->SpawnActor<AActor>();
+	AActor* Far = World->SpawnActor<AActor>();
+
+	const FGenericTeamId Team(1);
+	const FGenericTeamId OtherTeam(2);
+	const FVector SeenLocation(100.0f, 0.0f, 0.0f);
+	const FVector HeardLocation(500.0f, 0.0f, 0.0f);
+
+	FAIStatesTeamPerception TeamPerception;
+	TeamPerception.Report(Team, *Near, SeenLocation, EAIStatesStimulusSense::Sight, 1.0f, 0.0);
+	TeamPerception.Report(Team, *Far, FVector(5000.0f, 0.0f, 0.0f), EAIStatesStimulusSense::Sight, 1.0f, 0.0);
+
+	// Stimuli of every member end up in the same memory of the team
+	TestEqual(TEXT("Both targets are remembered"), TeamPerception.GetTargets(Team).Num(), 2);
+	TestTrue(TEXT("Other teams don't share the memory"), TeamPerception.GetTargets(OtherTeam).IsEmpty());
+
+	const FAIStatesPerceivedTarget* BestTarget = TeamPerception.FindBestTarget(Team, FVector::ZeroVector, 0.5f);
+	TestTrue(TEXT("Nearest of equally confident targets is the best one"), BestTarget && BestTarget->Target.Get() == Near);
+
+	// Hearing a seen target marks it as heard without blurring where it was seen
+	TeamPerception.Report(Team, *Near, HeardLocation, EAIStatesStimulusSense::Hearing, 0.5f, 0.5);
+	const FAIStatesPerceivedTarget* NearTarget = TeamPerception.Find(Team, Near);
+	TestTrue(TEXT("Weaker stimulus keeps the last known location"), NearTarget && NearTarget->LastKnownLocation.Equals(SeenLocation));
+	TestTrue(TEXT("Weaker stimulus marks the sense"), NearTarget && NearTarget->WasSensedBy(EAIStatesStimulusSense::Hearing));
+
+	// Confidence halves with every half-life nobody senses the target
+	TeamPerception.Update(2.0, 2.0f, 0.1f);
+	NearTarget = TeamPerception.Find(Team, Near);
+	TestTrue(TEXT("Confidence decays by its half-life"), NearTarget && FMath::IsNearlyEqual(NearTarget->Confidence, 0.5f));
+
+	TeamPerception.Report(Team, *Far, FVector(5000.0f, 0.0f, 0.0f), EAIStatesStimulusSense::Sight, 1.0f, 2.0);
+	BestTarget = TeamPerception.FindBestTarget(Team, FVector::ZeroVector, 0.0f);
+	TestTrue(TEXT("Freshly sensed target is more confident than a nearer decayed one"), BestTarget && BestTarget->Target.Get() == Far);
+
+	TeamPerception.Update(8.0, 2.0f, 0.1f);
+	TestNull(TEXT("Target under forget confidence is dropped"), TeamPerception.Find(Team, Near));
+	TestNotNull(TEXT("Target over forget confidence is kept"), TeamPerception.Find(Team, Far));
+
+	TeamPerception.Forget(*Far);
+	TestEqual(TEXT("Forgotten target is removed"), TeamPerception.Num(), 0);
+
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,66 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#include "AI/AIStates/AIStatesWeightedSampler.h"
+
+#if WITH_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAIStatesWeightedSamplerTest, "LyraGame.AIStates.WeightedSampler",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FAIStatesWeightedSamplerTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 InlineCount = 4;
+	constexpr int32 NumPicks = 100000;
+
+	TAIStatesWeightedSampler<int32, InlineCount> Sampler;
+	TestEqual(TEXT("Empty sampler picks nothing"), Sampler.PickIndex(0.5f), INDEX_NONE);
+
+	// Items without positive weight are skipped
+	Sampler.Add(10, 1.0f);
+	Sampler.Add(20, 2.0f);
+	Sampler.Add(30, 0.0f);
+	Sampler.Add(40, 3.0f);
+	Sampler.Add(50, 4.0f);
+	TestEqual(TEXT("Items without weight are skipped"), Sampler.Num(), 4);
+	TestEqual(TEXT("Total weight sums added weights"), Sampler.GetTotalWeight(), 10.0f);
+	TestEqual(TEXT("Item after a skipped one keeps its weight"), Sampler.GetWeight(2), 3.0f);
+
+	// Rolls map onto cumulative weight ranges
+	TestEqual(TEXT("Lowest roll picks the first item"), Sampler.PickIndex(0.0f), 0);
+	TestEqual(TEXT("Roll at a range boundary picks the next item"), Sampler.PickIndex(0.1f), 1);
+	TestEqual(TEXT("Roll inside a range picks its item"), Sampler.PickIndex(0.5f), 2);
+	TestEqual(TEXT("Highest roll picks the last item"), Sampler.PickIndex(0.9999f), 3);
+
+	// Picks from a seeded stream follow the weights
+	int32 NumPicked[InlineCount] = {};
+	const FRandomStream RandomStream(1234);
+	for(int32 PickIndex = 0; PickIndex < NumPicks; PickIndex++)
+	{
+		const int32 ItemIndex = Sampler.PickIndex(RandomStream);
+		if(ItemIndex != INDEX_NONE)
+		{
+			NumPicked[ItemIndex]++;
+		}
+	}
+
+	for(int32 ItemIndex = 0; ItemIndex < Sampler.Num(); ItemIndex++)
+	{
+		const float Frequency = float(NumPicked[ItemIndex]) / NumPicks;
+		TestTrue(FString::Printf(TEXT("Item %d is picked with its probability %.2f, got %.3f"), Sampler.GetItem(ItemIndex), Sampler.GetProbability(ItemIndex), Frequency),
+			FMath::IsNearlyEqual(Frequency, Sampler.GetProbability(ItemIndex), 0.01f));
+	}
+
+	// Storage stays inline up to the inline count
+	TestFalse(TEXT("Full inline storage hasn't spilled"), Sampler.HasSpilled());
+	TestEqual(TEXT("Full inline storage doesn't allocate"), Sampler.GetAllocatedSize(), SIZE_T(0));
+
+	Sampler.Add(60, 1.0f);
+	TestTrue(TEXT("Item past the inline count spills"), Sampler.HasSpilled());
+	TestTrue(TEXT("Spilled sampler allocates"), Sampler.GetAllocatedSize() > 0);
+
+	return true;
+}
+
+#endif // WITH_AUTOMATION_TESTS
@@ -0,0 +1,282 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "Tests/LyraTestControllerAIStatesBenchmark.h"
+
+#include "AI/AICharacter.h"
+#include "AI/AIStateController.h"
+#include "AI/AIStates/AIStatesSet.h"
+#include "AI/AIStates/AIStatesSettings.h"
+#include "AI/AIStates/AIStatesSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameModes/LyraBotCreationComponent.h"
+#include "GameModes/LyraExperienceManagerComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "System/LyraSignificanceManager.h"
+#include "UObject/UObjectArray.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(LyraTestControllerAIStatesBenchmark)
+
+namespace LyraAIStatesBenchmark
+{
+	// Bots spawned per frame while growing the bot count, spawning a thousand at once would stall the server for seconds
+	constexpr int32 MaxBotsSpawnedPerFrame = 16;
+
+	uint64 GetAllocationCount()
+	{
+#if !UE_BUILD_SHIPPING
+		return FMalloc::TotalMallocCalls.load(std::memory_order_relaxed);
+#else
+		return 0;
+#endif
+	}
+}
+
+void ULyraTestControllerAIStatesBenchmark::OnInit()
+{
+	Super::OnInit();
+
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+	Budgets = Settings->BenchmarkBudgets;
+
+	// Bot counts from the command line keep budgets of matching counts, other counts are only measured
+	FString BotCountsString;
+	if(FParse::Value(FCommandLine::Get(), TEXT("AIStatesBenchmarkBots="), BotCountsString))
+	{
+		TArray<FString> BotCounts;
+		BotCountsString.ParseIntoArray(BotCounts, TEXT(","));
+
+		TArray<FAIStatesBenchmarkBudget> CommandLineBudgets;
+		for(const FString& BotCount : BotCounts)
+		{
+			const int32 NumBots = FCString::Atoi(*BotCount);
+			if(NumBots <= 0)
+			{
+				continue;
+			}
+
+			const FAIStatesBenchmarkBudget* Budget = Budgets.FindByPredicate([NumBots](const FAIStatesBenchmarkBudget& Other) { return Other.NumBots == NumBots; });
+			FAIStatesBenchmarkBudget& CommandLineBudget = CommandLineBudgets.Add_GetRef(Budget ? *Budget : FAIStatesBenchmarkBudget());
+			CommandLineBudget.NumBots = NumBots;
+		}
+
+		Budgets = MoveTemp(CommandLineBudgets);
+	}
+
+	// Bot counts only grow, bots of a run stay for the next one
+	Budgets.Sort([](const FAIStatesBenchmarkBudget& A, const FAIStatesBenchmarkBudget& B) { return A.NumBots < B.NumBots; });
+
+	if(FParse::Value(FCommandLine::Get(), TEXT("AIStatesBenchmarkCSV="), CSVPath) == false)
+	{
+		CSVPath = FPaths::ProjectSavedDir() / TEXT("AIStatesBenchmark") / FString::Printf(TEXT("AIStatesBenchmark-%s.csv"), *FDateTime::Now().ToString());
+	}
+
+	StatesSet = Settings->BenchmarkStatesSet.LoadSynchronous();
+	if(StatesSet == nullptr && Settings->BenchmarkStatesSet.IsNull() == false)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ULyraTestControllerAIStatesBenchmark::OnInit - Unable to load BenchmarkStatesSet [%s]."), *Settings->BenchmarkStatesSet.ToString());
+		EndTest(1);
+		return;
+	}
+
+	if(Budgets.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("ULyraTestControllerAIStatesBenchmark::OnInit - No bot counts to run."));
+		EndTest(1);
+		return;
+	}
+
+	// Bots are measured at full detail unless significance is asked for
+	IConsoleVariable* SignificanceCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("lyra.aistates.significance"));
+	if(SignificanceCVar && FParse::Param(FCommandLine::Get(), TEXT("AIStatesBenchmarkSignificance")) == false)
+	{
+		PreviousSignificance = SignificanceCVar->GetInt();
+		SignificanceCVar->Set(0, ECVF_SetByCode);
+	}
+
+	SetPhase(EBenchmarkPhase::WaitingForGame);
+}
+
+void ULyraTestControllerAIStatesBenchmark::OnTick(float TimeDelta)
+{
+	Super::OnTick(TimeDelta);
+
+	UWorld* World = GetWorld();
+	ULyraBotCreationComponent* BotCreationComponent = FindBotCreationComponent();
+	if(World == nullptr || BotCreationComponent == nullptr)
+	{
+		return;
+	}
+
+	// Bots respawned after dying get the set of their pawn class again, so every bot is checked each frame
+	ApplyStatesSet(*BotCreationComponent);
+
+	const double TimeInPhase = FPlatformTime::Seconds() - PhaseStartTime;
+	const UAIStatesSettings* Settings = UAIStatesSettings::Get();
+
+	switch(Phase)
+	{
+	case EBenchmarkPhase::WaitingForGame:
+	{
+		const ULyraExperienceManagerComponent* ExperienceComponent = World->GetGameState()->FindComponentByClass<ULyraExperienceManagerComponent>();
+		if(ExperienceComponent && ExperienceComponent->IsExperienceLoaded())
+		{
+			StartBudget(0);
+		}
+		break;
+	}
+
+	case EBenchmarkPhase::SpawningBots:
+		if(SpawnBots(*BotCreationComponent))
+		{
+			SetPhase(EBenchmarkPhase::WarmingUp);
+		}
+		break;
+
+	case EBenchmarkPhase::WarmingUp:
+		if(TimeInPhase >= Settings->BenchmarkWarmupDuration)
+		{
+			Recorder.Start(Budgets[CurrentBudgetIndex].NumBots);
+			LastAllocationCount = LyraAIStatesBenchmark::GetAllocationCount();
+			SetPhase(EBenchmarkPhase::Measuring);
+		}
+		break;
+
+	case EBenchmarkPhase::Measuring:
+	{
+		const UAIStatesSubsystem* AIStatesSubsystem = World->GetSubsystem<UAIStatesSubsystem>();
+		const uint64 AllocationCount = LyraAIStatesBenchmark::GetAllocationCount();
+		Recorder.AddFrame(FPlatformTime::ToMilliseconds(GGameThreadTime), AIStatesSubsystem ? AIStatesSubsystem->GetLastTickSeconds() * 1000.0 : 0.0,
+			AllocationCount - LastAllocationCount);
+		LastAllocationCount = AllocationCount;
+
+		if(TimeInPhase >= Settings->BenchmarkDuration)
+		{
+			FAIStatesBenchmarkResult& Result = Results.Add_GetRef(Recorder.Finish(FPlatformMemory::GetStats().UsedPhysical, GUObjectArray.GetObjectArrayNumMinusAvailable()));
+			if(AIStatesSubsystem)
+			{
+				AIStatesSubsystem->GetSignificanceTierPopulation(Result.TierPopulation);
+			}
+			UE_LOG(LogTemp, Display, TEXT("ULyraTestControllerAIStatesBenchmark - %s"), *Result.ToCSVRow());
+
+			if(Budgets.IsValidIndex(CurrentBudgetIndex + 1))
+			{
+				StartBudget(CurrentBudgetIndex + 1);
+			}
+			else
+			{
+				FinishBenchmark();
+			}
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	MarkHeartbeatActive();
+}
+
+ULyraBotCreationComponent* ULyraTestControllerAIStatesBenchmark::FindBotCreationComponent() const
+{
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World ? World->GetGameState() : nullptr;
+	return GameState ? GameState->FindComponentByClass<ULyraBotCreationComponent>() : nullptr;
+}
+
+bool ULyraTestControllerAIStatesBenchmark::SpawnBots(ULyraBotCreationComponent& BotCreationComponent)
+{
+	const int32 NumBots = Budgets[CurrentBudgetIndex].NumBots;
+
+#if WITH_SERVER_CODE
+	for(int32 SpawnIndex = 0; SpawnIndex < LyraAIStatesBenchmark::MaxBotsSpawnedPerFrame && BotCreationComponent.GetSpawnedBots().Num() < NumBots; SpawnIndex++)
+	{
+		BotCreationComponent.Cheat_AddBot();
+	}
+#endif
+
+	return BotCreationComponent.GetSpawnedBots().Num() >= NumBots;
+}
+
+void ULyraTestControllerAIStatesBenchmark::ApplyStatesSet(ULyraBotCreationComponent& BotCreationComponent)
+{
+	UWorld* World = GetWorld();
+	UAIStatesSubsystem* AIStatesSubsystem = World->GetSubsystem<UAIStatesSubsystem>();
+	if(StatesSet == nullptr || AIStatesSubsystem == nullptr)
+	{
+		return;
+	}
+
+	ULyraSignificanceManager* SignificanceManager = USignificanceManager::Get<ULyraSignificanceManager>(World);
+	for(AAIStateController* Bot : BotCreationComponent.GetSpawnedBots())
+	{
+		AAICharacter* AICharacter = Bot ? Cast<AAICharacter>(Bot->GetPawn()) : nullptr;
+		if(AICharacter == nullptr || AICharacter->AIStatesSetConfig == StatesSet)
+		{
+			continue;
+		}
+
+		AICharacter->AIStatesSetConfig = StatesSet;
+		if(Bot->SetupAIStatesFromConfig())
+		{
+			AIStatesSubsystem->ScheduleStateUpdates(Bot, Bot->GetAIStatesUpdateInterval());
+			if(SignificanceManager)
+			{
+				SignificanceManager->RegisterAIStateController(Bot);
+			}
+		}
+	}
+}
+
+void ULyraTestControllerAIStatesBenchmark::StartBudget(int32 BudgetIndex)
+{
+	CurrentBudgetIndex = BudgetIndex;
+	SetPhase(EBenchmarkPhase::SpawningBots);
+}
+
+void ULyraTestControllerAIStatesBenchmark::FinishBenchmark()
+{
+	SetPhase(EBenchmarkPhase::Finished);
+
+	IConsoleVariable* SignificanceCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("lyra.aistates.significance"));
+	if(SignificanceCVar && PreviousSignificance.IsSet())
+	{
+		SignificanceCVar->Set(PreviousSignificance.GetValue(), ECVF_SetByCode);
+	}
+
+	TArray<FString> Lines = { FAIStatesBenchmarkResult::GetCSVHeader() };
+	TArray<FString> Errors;
+	for(int32 ResultIndex = 0; ResultIndex < Results.Num(); ResultIndex++)
+	{
+		Lines.Add(Results[ResultIndex].ToCSVRow());
+		Results[ResultIndex].IsWithinBudget(Budgets[ResultIndex], Errors);
+	}
+
+	if(FFileHelper::SaveStringArrayToFile(Lines, *CSVPath))
+	{
+		UE_LOG(LogTemp, Display, TEXT("ULyraTestControllerAIStatesBenchmark - Results written to %s"), *CSVPath);
+	}
+	else
+	{
+		Errors.Add(FString::Printf(TEXT("Unable to write results to %s"), *CSVPath));
+	}
+
+	for(const FString& Error : Errors)
+	{
+		UE_LOG(LogTemp, Error, TEXT("ULyraTestControllerAIStatesBenchmark - %s"), *Error);
+	}
+
+	EndTest(Errors.IsEmpty() ? 0 : 1);
+}
+
+void ULyraTestControllerAIStatesBenchmark::SetPhase(EBenchmarkPhase NewPhase)
+{
+	Phase = NewPhase;
+	PhaseStartTime = FPlatformTime::Seconds();
+}
@@ -0,0 +1,82 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "GauntletTestController.h"
+#include "AI/AIStates/AIStatesBenchmark.h"
+
+#include "LyraTestControllerAIStatesBenchmark.generated.h"
+
+class UAIStatesSet;
+class ULyraBotCreationComponent;
+
+/**
+ * ULyraTestControllerAIStatesBenchmark
+ *
+ *	Headless scalability benchmark of the AI States system, run with -gauntlet=LyraTestControllerAIStatesBenchmark
+ *	on a dedicated server with -nullrhi. Grows the bot count through the bot creation component for every budget
+ *	in AI States settings, measures frame times and memory, writes them to CSV and fails when a budget is exceeded.
+ *
+ *	Without human players every bot would fall to the least significant tier, so bots are pinned to the most significant
+ *	one through lyra.aistates.significance 0 and the tier population is written to the CSV.
+ *
+ *	-AIStatesBenchmarkBots=16,64 runs only the given bot counts, -AIStatesBenchmarkCSV= overrides the output file,
+ *	-AIStatesBenchmarkSignificance keeps significance tiers on.
+ */
+UCLASS()
+class ULyraTestControllerAIStatesBenchmark : public UGauntletTestController
+{
+	GENERATED_BODY()
+
+protected:
+
+	//~UGauntletTestController interface
+	virtual void OnInit() override;
+	virtual void OnTick(float TimeDelta) override;
+	//~End of UGauntletTestController interface
+
+private:
+
+	enum class EBenchmarkPhase : uint8
+	{
+		WaitingForGame,
+		SpawningBots,
+		WarmingUp,
+		Measuring,
+		Finished
+	};
+
+	ULyraBotCreationComponent* FindBotCreationComponent() const;
+
+	// Spawns a limited number of bots per frame until the current budget bot count is reached, true once it is
+	bool SpawnBots(ULyraBotCreationComponent& BotCreationComponent);
+
+	// Gives bots without the benchmark states set the set, when one is configured
+	void ApplyStatesSet(ULyraBotCreationComponent& BotCreationComponent);
+
+	void StartBudget(int32 BudgetIndex);
+
+	void FinishBenchmark();
+
+	void SetPhase(EBenchmarkPhase NewPhase);
+
+	TArray<FAIStatesBenchmarkBudget> Budgets;
+	TArray<FAIStatesBenchmarkResult> Results;
+
+	FAIStatesBenchmarkRecorder Recorder;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UAIStatesSet> StatesSet;
+
+	FString CSVPath;
+
+	EBenchmarkPhase Phase = EBenchmarkPhase::WaitingForGame;
+	double PhaseStartTime = 0.0;
+	int32 CurrentBudgetIndex = INDEX_NONE;
+
+	// Allocation count at the end of the previous measured frame
+	uint64 LastAllocationCount = 0;
+
+	// Value of lyra.aistates.significance before the benchmark pinned tiers, restored once it finishes
+	TOptional<int32> PreviousSignificance;
+};